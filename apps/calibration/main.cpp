@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+
+#include "logging.hpp"
+#include "work_stealing.hpp"
+#include "offline_simulator.hpp"
+#include "stylized_facts.hpp"
+
+// ------------------------------------------------------------
+// Calibration harness
+// ------------------------------------------------------------
+//
+// Usage: Calibration [option=value ...]
+//   runs=<n>                 independent simulations (default 32)
+//   duration=<seconds>       simulated seconds per run (default 60)
+//   seed=<n>                 run i simulates with seed + i (default 1)
+//   threads=<n>              worker threads (default: one per hardware thread)
+//   agents=<type=count,...>  population, as for the simulator (default mixed=1)
+//   sample_ms=<n>            book sampling interval for spreads and returns (default 100)
+//   out=<path>               results CSV (default: stdout)
+//   lambda_insert=<v|lo:hi>  LAMBDA_INSERT_BASE
+//   cancel_scaling=<v|lo:hi> CANCEL_SCALING_FACTOR
+//   w_mm= w_taker= w_deep= w_noise=<v|lo:hi>
+//                            multipliers on the archetype weights (default 1);
+//                            at least one must be able to exceed 0
+//
+// - Every run is an OfflineSimulator: in-process, headless and
+//   deterministic, so a results row is reproducible from its seed and
+//   parameters alone.
+// - A parameter given as lo:hi is drawn uniformly per run, from one RNG in
+//   run order, so the sweep does not depend on how runs are scheduled. It
+//   has a stream of its own, apart from every run's arrivals, agents and
+//   fair value.
+// - Runs are spread over the workers by a WorkStealingScheduler: run
+//   lengths vary with the parameters, and idle workers take queued runs from
+//   busy ones.
+// - Stylized facts are accumulated online while the run advances; one CSV
+//   row per run, written in run order once all have finished.
+//
+namespace {
+
+constexpr std::array<Price_t, 3> BOUNDS = {1, 5, 10};
+// PCG stream of the parameter draws; see LATENT_STREAM for the others.
+constexpr uint64_t PARAM_STREAM = ~0ull;
+
+struct Range {
+    double lo;
+    double hi;
+
+    double draw(PCGRNG& rng) const { return lo == hi ? lo : lo + (hi - lo) * rng.standard_uniform(); }
+};
+
+struct RunResult {
+    uint64_t seed = 0;
+    DynamicsParams params;
+    OfflineStats stats;
+    StylizedFactsSummary facts;
+    double wall_seconds = 0.0;
+};
+
+bool parse_number(std::string_view text, double& out) {
+    // std::from_chars for double is not available everywhere yet.
+    try {
+        size_t used = 0;
+        out = std::stod(std::string(text), &used);
+        return used == text.size();
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+bool parse_range(std::string_view text, Range& out) {
+    const size_t colon = text.find(':');
+    if (colon == std::string_view::npos) {
+        if (!parse_number(text, out.lo)) return false;
+        out.hi = out.lo;
+        return true;
+    }
+    return parse_number(text.substr(0, colon), out.lo)
+        && parse_number(text.substr(colon + 1), out.hi)
+        && out.lo <= out.hi;
+}
+
+bool parse_count(std::string_view text, uint64_t& out) {
+    const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), out);
+    return ec == std::errc{} && end == text.data() + text.size();
+}
+
+RunResult simulate(const AgentPopulation& population, uint64_t seed, const DynamicsParams& params,
+                   double duration, double sample_interval) {
+    const auto t0 = std::chrono::steady_clock::now();
+
+    StylizedFacts facts;
+    auto sim = std::make_unique<OfflineSimulator<BOUNDS.size()>>(population, seed, BOUNDS, params);
+    sim->insert_generated = [&facts](const InsertDecision& insert) { facts.on_order_size(insert.quantity); };
+
+    const size_t samples = static_cast<size_t>(duration / sample_interval);
+    for (size_t i = 0; i < samples; ++i) {
+        sim->run(sample_interval);
+        facts.on_book(sim->market().best_bid_price(), sim->market().best_ask_price());
+    }
+
+    RunResult result;
+    result.seed = seed;
+    result.params = params;
+    result.stats = sim->stats();
+    result.facts = facts.summary();
+    result.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return result;
+}
+
+void write_results(std::ostream& out, const std::vector<RunResult>& results) {
+    out << "run,seed,lambda_insert_base,cancel_scaling_factor,w_mm,w_taker,w_deep,w_noise,"
+           "inserts,cancels,trades,traded_volume,samples,"
+           "spread_mean,spread_one_tick,spread_p50,spread_p90,"
+           "return_acf1,abs_return_acf1,abs_return_acf10,return_kurtosis,"
+           "size_mean,size_p50,size_p90,size_p99,wall_s\n";
+    out << std::setprecision(6);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const RunResult& r = results[i];
+        const auto& w = r.params.archetype_weights;
+        out << i << ',' << r.seed << ','
+            << r.params.lambda_insert_base << ',' << r.params.cancel_scaling_factor << ','
+            << w[0] << ',' << w[1] << ',' << w[2] << ',' << w[3] << ','
+            << r.stats.inserts << ',' << r.stats.cancels << ',' << r.stats.trades << ','
+            << r.stats.traded_volume << ',' << r.facts.samples << ','
+            << r.facts.spread_mean << ',' << r.facts.spread_one_tick << ','
+            << r.facts.spread_p50 << ',' << r.facts.spread_p90 << ','
+            << r.facts.return_acf1 << ',' << r.facts.abs_return_acf1 << ','
+            << r.facts.abs_return_acf10 << ',' << r.facts.return_kurtosis << ','
+            << r.facts.size_mean << ',' << r.facts.size_p50 << ','
+            << r.facts.size_p90 << ',' << r.facts.size_p99 << ','
+            << r.wall_seconds << '\n';
+    }
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        uint64_t runs = 32;
+        uint64_t duration_s = 60;
+        uint64_t seed = 1;
+        uint64_t threads = 0;
+        uint64_t sample_ms = 100;
+        std::string out_path;
+        AgentPopulation population;
+
+        const DynamicsParams defaults;
+        Range lambda_insert{defaults.lambda_insert_base, defaults.lambda_insert_base};
+        Range cancel_scaling{defaults.cancel_scaling_factor, defaults.cancel_scaling_factor};
+        std::array<Range, NUM_AGENT_TYPES> weights;
+        weights.fill(Range{1.0, 1.0});
+
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view arg = argv[i];
+            const size_t eq = arg.find('=');
+            const std::string_view key = arg.substr(0, eq);
+            const std::string_view value = eq == std::string_view::npos ? std::string_view{} : arg.substr(eq + 1);
+
+            bool ok = eq != std::string_view::npos;
+            AgentType type;
+            if (!ok) {
+            } else if (key == "runs") {
+                ok = parse_count(value, runs) && runs > 0;
+            } else if (key == "duration") {
+                ok = parse_count(value, duration_s) && duration_s > 0;
+            } else if (key == "seed") {
+                ok = parse_count(value, seed);
+            } else if (key == "threads") {
+                ok = parse_count(value, threads);
+            } else if (key == "sample_ms") {
+                ok = parse_count(value, sample_ms) && sample_ms > 0;
+            } else if (key == "out") {
+                out_path = std::string(value);
+            } else if (key == "agents") {
+                ok = parse_agent_population(value, population);
+            } else if (key == "lambda_insert") {
+                ok = parse_range(value, lambda_insert) && lambda_insert.lo > 0.0;
+            } else if (key == "cancel_scaling") {
+                ok = parse_range(value, cancel_scaling) && cancel_scaling.lo > 0.0;
+            } else if (key.rfind("w_", 0) == 0 && parse_agent_type(key.substr(2), type)) {
+                Range& w = weights[static_cast<size_t>(type)];
+                ok = parse_range(value, w) && w.lo >= 0.0;
+            } else {
+                ok = false;
+            }
+            if (!ok) {
+                std::cerr << "Invalid option '" << arg << "'\n";
+                return 1;
+            }
+        }
+        // All-zero multipliers leave decide_insert nothing to normalise.
+        if (std::all_of(weights.begin(), weights.end(), [](const Range& w) { return w.hi == 0.0; })) {
+            std::cerr << "Invalid options: every w_* is 0\n";
+            return 1;
+        }
+
+        auto core = boost::log::core::get();
+        core->set_filter(
+            boost::log::expressions::attr<LogLevel>("Severity") >= LogLevel::LL_ERROR
+        );
+
+        // Parameter vectors are drawn up front, in run order.
+        std::vector<DynamicsParams> params(runs);
+        PCGRNG param_rng(seed, PARAM_STREAM);
+        for (DynamicsParams& p : params) {
+            p.lambda_insert_base = lambda_insert.draw(param_rng);
+            p.cancel_scaling_factor = cancel_scaling.draw(param_rng);
+            for (size_t t = 0; t < NUM_AGENT_TYPES; ++t) p.archetype_weights[t] = weights[t].draw(param_rng);
+        }
+
+        const double duration = static_cast<double>(duration_s);
+        const double sample_interval = static_cast<double>(sample_ms) / 1000.0;
+        std::vector<RunResult> results(runs);
+
+        WorkStealingScheduler scheduler(threads);
+        const auto t0 = std::chrono::steady_clock::now();
+        scheduler.run(runs, [&](size_t run, size_t /*worker*/) {
+            results[run] = simulate(population, seed + run, params[run], duration, sample_interval);
+        });
+        const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+        if (out_path.empty()) {
+            write_results(std::cout, results);
+        } else {
+            std::ofstream out(out_path);
+            if (!out) throw std::runtime_error("cannot open " + out_path);
+            write_results(out, results);
+        }
+
+        std::cerr << "[CAL] " << runs << " runs x " << duration_s << " s simulated on "
+                  << scheduler.threads() << " threads in " << wall << " s ("
+                  << scheduler.steals() << " steals)\n";
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Calibration error: " << e.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,204 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "types.hpp"
+
+// ------------------------------------------------------------
+// StylizedFacts
+// ------------------------------------------------------------
+//
+// Online statistics of a simulated market, compared against the empirical
+// regularities of real order books: the spread distribution, the absence of
+// linear autocorrelation in returns, volatility clustering (autocorrelated
+// absolute returns), fat-tailed returns and a heavy-tailed order size
+// distribution.
+//
+// Design:
+// - Fixed memory whatever the run length: histograms, power sums and the
+//   last MAX_LAG returns.
+// - Returns are log mid-price changes between book samples taken at a
+//   fixed interval of simulated time; a one-sided book breaks the chain.
+// - Autocorrelations use the pooled mean and variance of the series and
+//   only pairs of returns within one unbroken chain.
+// - Order sizes land in log-spaced buckets (four per octave), so quantiles
+//   are good to about 9%.
+//
+struct StylizedFactsSummary {
+    uint64_t samples = 0;
+
+    double spread_mean = 0.0;       // ticks
+    double spread_one_tick = 0.0;   // fraction of samples at one tick
+    double spread_p50 = 0.0;
+    double spread_p90 = 0.0;
+
+    double return_acf1 = 0.0;
+    double abs_return_acf1 = 0.0;
+    double abs_return_acf10 = 0.0;
+    double return_kurtosis = 0.0;   // excess
+
+    double size_mean = 0.0;
+    double size_p50 = 0.0;
+    double size_p90 = 0.0;
+    double size_p99 = 0.0;
+};
+
+class StylizedFacts {
+    public:
+        static constexpr size_t MAX_LAG = 10;
+
+        // Power sums and lagged cross products of one series. Products pair
+        // values of one run only: break_run() starts a new one, and acf()
+        // divides by the pairs actually summed at each lag.
+        struct Series {
+            uint64_t n = 0;
+            uint64_t run = 0; // values since the last break
+            double sum = 0.0, sum2 = 0.0, sum3 = 0.0, sum4 = 0.0;
+            std::array<double, MAX_LAG + 1> cross{};   // cross[k]: sum of x_t * x_{t-k}
+            std::array<uint64_t, MAX_LAG + 1> pairs{}; // pairs[k]: products in cross[k]
+            std::array<double, MAX_LAG + 1> recent{};  // ring of the last values
+            size_t head = 0;
+
+            void add(double x) {
+                for (size_t k = 1; k <= MAX_LAG && k <= run; ++k) {
+                    cross[k] += x * recent[(head + MAX_LAG + 1 - k) % (MAX_LAG + 1)];
+                    ++pairs[k];
+                }
+                recent[head] = x;
+                head = (head + 1) % (MAX_LAG + 1);
+                ++n;
+                ++run;
+                const double x2 = x * x;
+                sum += x;
+                sum2 += x2;
+                sum3 += x2 * x;
+                sum4 += x2 * x2;
+            }
+
+            void break_run() { run = 0; }
+
+            double variance() const {
+                if (n == 0) return 0.0;
+                const double mean = sum / static_cast<double>(n);
+                return sum2 / static_cast<double>(n) - mean * mean;
+            }
+
+            double acf(size_t lag) const {
+                const double var = variance();
+                if (lag > MAX_LAG || pairs[lag] == 0 || var <= 0.0) return 0.0;
+                const double mean = sum / static_cast<double>(n);
+                return (cross[lag] / static_cast<double>(pairs[lag]) - mean * mean) / var;
+            }
+        };
+
+        // One book sample; call at a fixed interval of simulated time.
+        void on_book(std::optional<Price_t> best_bid, std::optional<Price_t> best_ask) {
+            if (!best_bid || !best_ask) {
+                break_chain_();
+                return;
+            }
+            ++samples_;
+            const Price_t spread = *best_ask - *best_bid;
+            ++spread_hist_[std::clamp<Price_t>(spread, 0, SPREAD_BUCKETS - 1)];
+            spread_sum_ += static_cast<double>(spread);
+
+            const double mid = 0.5 * static_cast<double>(*best_bid + *best_ask);
+            if (last_mid_ && *last_mid_ > 0.0 && mid > 0.0) {
+                on_return_(std::log(mid / *last_mid_));
+                last_mid_ = mid;
+            } else {
+                // No return for this step, so the next one starts a new chain.
+                break_chain_();
+                last_mid_ = mid;
+            }
+        }
+
+        void on_order_size(Volume_t quantity) {
+            if (quantity == 0) return;
+            ++sizes_;
+            size_sum_ += static_cast<double>(quantity);
+            const int bucket = static_cast<int>(std::floor(4.0 * std::log2(static_cast<double>(quantity))));
+            ++size_hist_[static_cast<size_t>(std::clamp(bucket, 0, static_cast<int>(SIZE_BUCKETS) - 1))];
+        }
+
+        const Series& returns() const { return returns_; }
+        const Series& abs_returns() const { return abs_returns_; }
+
+        StylizedFactsSummary summary() const {
+            StylizedFactsSummary s;
+            s.samples = samples_;
+            if (samples_ > 0) {
+                s.spread_mean = spread_sum_ / static_cast<double>(samples_);
+                s.spread_one_tick = static_cast<double>(spread_hist_[1]) / static_cast<double>(samples_);
+                s.spread_p50 = static_cast<double>(quantile_(spread_hist_, samples_, 0.50));
+                s.spread_p90 = static_cast<double>(quantile_(spread_hist_, samples_, 0.90));
+            }
+
+            s.return_acf1 = returns_.acf(1);
+            s.abs_return_acf1 = abs_returns_.acf(1);
+            s.abs_return_acf10 = abs_returns_.acf(MAX_LAG);
+            const double var = returns_.variance();
+            if (returns_.n > 0 && var > 0.0) {
+                const double n = static_cast<double>(returns_.n);
+                const double mean = returns_.sum / n;
+                const double m4 = returns_.sum4 / n - 4.0 * mean * returns_.sum3 / n
+                                + 6.0 * mean * mean * returns_.sum2 / n - 3.0 * mean * mean * mean * mean;
+                s.return_kurtosis = m4 / (var * var) - 3.0;
+            }
+
+            if (sizes_ > 0) {
+                s.size_mean = size_sum_ / static_cast<double>(sizes_);
+                s.size_p50 = size_of_bucket_(quantile_(size_hist_, sizes_, 0.50));
+                s.size_p90 = size_of_bucket_(quantile_(size_hist_, sizes_, 0.90));
+                s.size_p99 = size_of_bucket_(quantile_(size_hist_, sizes_, 0.99));
+            }
+            return s;
+        }
+
+    private:
+        static constexpr Price_t SPREAD_BUCKETS = 64; // last bucket: 63 ticks and wider
+        static constexpr size_t SIZE_BUCKETS = 4 * 32;
+
+        void break_chain_() {
+            last_mid_.reset();
+            returns_.break_run();
+            abs_returns_.break_run();
+        }
+
+        void on_return_(double r) {
+            returns_.add(r);
+            abs_returns_.add(std::abs(r));
+        }
+
+        // Smallest bucket whose cumulative count reaches q of total.
+        template <size_t B>
+        static size_t quantile_(const std::array<uint64_t, B>& hist, uint64_t total, double q) {
+            const double target = q * static_cast<double>(total);
+            uint64_t seen = 0;
+            for (size_t i = 0; i < B; ++i) {
+                seen += hist[i];
+                if (static_cast<double>(seen) >= target) return i;
+            }
+            return B - 1;
+        }
+
+        // Geometric centre of a size bucket.
+        static double size_of_bucket_(size_t bucket) {
+            return std::exp2((static_cast<double>(bucket) + 0.5) / 4.0);
+        }
+
+        uint64_t samples_ = 0;
+        std::array<uint64_t, SPREAD_BUCKETS> spread_hist_{};
+        double spread_sum_ = 0.0;
+        std::optional<double> last_mid_;
+        Series returns_;
+        Series abs_returns_;
+
+        uint64_t sizes_ = 0;
+        double size_sum_ = 0.0;
+        std::array<uint64_t, SIZE_BUCKETS> size_hist_{};
+};
@@ -1,43 +1,88 @@
 #include "application.hpp"
 #include <iostream>
-#include <cstdlib>
-#include <chrono>
-#include <ctime>
-#include <iomanip>
-#include <sstream>
+#include <charconv>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <boost/log/core.hpp>
 #include <boost/log/expressions.hpp>
 #include "logging.hpp"
 
+// Usage: FinancialExchange [option=value ...]
+//   port=<n>                 client port (default 16000)
+//   threads=<n>              IO threads (default 1; per_core adds an engine thread)
+//   admin=<n>                metrics endpoint port on 127.0.0.1 (default 0: disabled)
+//   profile=<name>           socket profile: latency, throughput or bulk (default latency)
+//   model=<name>             IO model: shared or per_core (default shared)
+//   mode=<name>              IO thread mode: blocking or busy_poll (per_core only;
+//                            default blocking)
+//   shm=<path>               Unix socket for shared-memory session discovery (Linux)
+//   unix=<path>              Unix domain stream listener
+//   warmup=<spec>            none, or prefault plus any of lock, numa, outboxes=N,
+//                            orders=N, comma-separated (default prefault)
+//   topology=<path>          thread topology file (see src/thread_affinity.hpp)
+namespace {
+    bool parse_count(std::string_view text, uint64_t& out) {
+        const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), out);
+        return ec == std::errc{} && end == text.data() + text.size();
+    }
+}
+
 int main(int argc, char* argv[]) {
     try {
         auto core = boost::log::core::get();
         core->set_filter(
             boost::log::expressions::attr<LogLevel>("Severity") >= LogLevel::LL_ERROR
         );
-        uint16_t port = 16000;
-        std::size_t io_threads = 1;
+        ApplicationOptions options;
 
-        if (argc > 1) {
-            int p = std::atoi(argv[1]);
-            if (p > 0 && p <= 65535) {
-                port = static_cast<uint16_t>(p);
-            } else {
-                std::cerr << "Invalid port number, using default: " << port << "\n";
-            }
-        }
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view arg = argv[i];
+            const size_t eq = arg.find('=');
+            const std::string_view key = arg.substr(0, eq);
+            const std::string_view value = eq == std::string_view::npos ? std::string_view{} : arg.substr(eq + 1);
 
-        if (argc > 2) {
-            int t = std::atoi(argv[2]);
-            if (t > 0) {
-                io_threads = static_cast<std::size_t>(t);
+            bool ok = eq != std::string_view::npos;
+            uint64_t n = 0;
+            std::string error;
+            if (!ok) {
+            } else if (key == "port") {
+                ok = parse_count(value, n) && n > 0 && n <= 65535;
+                options.port = static_cast<uint16_t>(n);
+            } else if (key == "threads") {
+                ok = parse_count(value, n) && n > 0;
+                options.num_threads = static_cast<size_t>(n);
+            } else if (key == "admin") {
+                ok = parse_count(value, n) && n <= 65535;
+                options.admin_port = static_cast<uint16_t>(n);
+            } else if (key == "profile") {
+                ok = parse_socket_profile(value, options.socket_profile);
+            } else if (key == "model") {
+                ok = value == "shared" || value == "per_core";
+                options.io_model = value == "per_core" ? IoModel::PER_CORE : IoModel::SHARED;
+            } else if (key == "mode") {
+                ok = value == "blocking" || value == "busy_poll";
+                options.io_thread_mode = value == "busy_poll" ? IoThreadMode::BUSY_POLL : IoThreadMode::BLOCKING;
+            } else if (key == "shm") {
+                ok = !value.empty();
+                options.shm_socket_path = std::string(value);
+            } else if (key == "unix") {
+                ok = !value.empty();
+                options.unix_socket_path = std::string(value);
+            } else if (key == "warmup") {
+                ok = parse_memory_warmup(value, options.warmup);
+            } else if (key == "topology") {
+                ok = ThreadTopology::load(std::string(value), options.thread_topology, error);
             } else {
-                std::cerr << "Invalid thread count, using default: " << io_threads << "\n";
+                ok = false;
+            }
+            if (!ok) {
+                std::cerr << "Invalid option '" << arg << "'" << (error.empty() ? "" : ": " + error) << "\n";
+                return 1;
             }
         }
 
-        Application app(port, io_threads);
+        Application app(options);
         app.start();
         app.wait();
 
@@ -0,0 +1,146 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+#include "market_dynamics.hpp"
+#include "pcg32.hpp"
+
+// ------------------------------------------------------------
+// Agent population
+// ------------------------------------------------------------
+//
+// The simulated participants. Each agent has a fixed archetype (or "mixed":
+// a type drawn per order, which is how a single agent stands in for the
+// whole market), its own RNG stream and an activity level.
+//
+// Design:
+// - Agents are plain data; the simulator owns the market-wide arrival
+//   process and picks which agent acts, in proportion to activity, so a
+//   population of thousands costs one binary search per order.
+// - Population spec: comma-separated type=count, types mm, taker, deep,
+//   noise and mixed, e.g. "mm=400,taker=50,deep=200,noise=350".
+// - Everything is derived from one seed: agent i draws from PCG stream
+//   i + 1 (stream 0 is the simulator's own), so a run is reproducible for a
+//   given seed and population.
+//
+struct AgentGroup {
+    std::optional<AgentType> type; // nullopt: mixed
+    size_t count = 0;
+};
+
+struct AgentPopulation {
+    std::vector<AgentGroup> groups{AgentGroup{std::nullopt, 1}};
+
+    size_t total() const {
+        size_t n = 0;
+        for (const AgentGroup& g : groups) n += g.count;
+        return n;
+    }
+};
+
+inline const char* agent_group_name(const std::optional<AgentType>& type) {
+    return type ? agent_type_name(*type) : "mixed";
+}
+
+inline bool parse_agent_population(std::string_view spec, AgentPopulation& out) {
+    AgentPopulation parsed;
+    parsed.groups.clear();
+    while (!spec.empty()) {
+        const size_t comma = spec.find(',');
+        const std::string_view item = spec.substr(0, comma);
+        spec = comma == std::string_view::npos ? std::string_view{} : spec.substr(comma + 1);
+
+        const size_t eq = item.find('=');
+        if (eq == std::string_view::npos) return false;
+        const std::string_view name = item.substr(0, eq);
+        const std::string_view count = item.substr(eq + 1);
+
+        AgentGroup group;
+        if (name != "mixed") {
+            AgentType type;
+            if (!parse_agent_type(name, type)) return false;
+            group.type = type;
+        }
+        const auto [end, ec] = std::from_chars(count.data(), count.data() + count.size(), group.count);
+        if (ec != std::errc{} || end != count.data() + count.size()) return false;
+        if (group.count > 0) parsed.groups.push_back(group);
+    }
+    if (parsed.total() == 0) return false;
+    out = std::move(parsed);
+    return true;
+}
+
+struct Agent {
+    std::optional<AgentType> type;
+    size_t group;
+    PCGRNG rng;
+    double activity;
+
+    uint64_t inserts = 0;
+    uint64_t fills = 0;
+    uint64_t filled_volume = 0;
+};
+
+class AgentRoster {
+    public:
+        AgentRoster(const AgentPopulation& population, uint64_t seed)
+        : population_(population) {
+            agents_.reserve(population.total());
+            cumulative_.reserve(population.total());
+            double sum = 0.0;
+            for (size_t g = 0; g < population.groups.size(); ++g) {
+                for (size_t i = 0; i < population.groups[g].count; ++i) {
+                    PCGRNG rng(seed, agents_.size() + 1);
+                    // Log-normal activity with mean 1: a few agents are busy,
+                    // most trade occasionally.
+                    const double activity = std::exp(ACTIVITY_SIGMA * rng.standard_normal() - 0.5 * ACTIVITY_SIGMA * ACTIVITY_SIGMA);
+                    agents_.push_back(Agent{population.groups[g].type, g, rng, activity});
+                    sum += activity;
+                    cumulative_.push_back(sum);
+                }
+            }
+        }
+
+        size_t size() const { return agents_.size(); }
+        Agent& operator[](size_t idx) { return agents_[idx]; }
+        const Agent& operator[](size_t idx) const { return agents_[idx]; }
+
+        // Index of the agent to act next, drawn in proportion to activity;
+        // u is uniform on [0, 1).
+        size_t pick(double u) const {
+            const double target = u * cumulative_.back();
+            const auto it = std::upper_bound(cumulative_.begin(), cumulative_.end(), target);
+            return std::min<size_t>(static_cast<size_t>(it - cumulative_.begin()), agents_.size() - 1);
+        }
+
+        // One line per group: agents, inserts, fills and filled volume.
+        void print_summary(std::ostream& out) const {
+            for (size_t g = 0; g < population_.groups.size(); ++g) {
+                uint64_t inserts = 0, fills = 0, volume = 0;
+                for (const Agent& a : agents_) {
+                    if (a.group != g) continue;
+                    inserts += a.inserts;
+                    fills += a.fills;
+                    volume += a.filled_volume;
+                }
+                out << "  " << agent_group_name(population_.groups[g].type)
+                    << " agents=" << population_.groups[g].count
+                    << " inserts=" << inserts
+                    << " fills=" << fills
+                    << " filled_volume=" << volume << '\n';
+            }
+        }
+
+    private:
+        static constexpr double ACTIVITY_SIGMA = 0.75;
+
+        AgentPopulation population_;
+        std::vector<Agent> agents_;
+        std::vector<double> cumulative_; // running sum of activity
+};
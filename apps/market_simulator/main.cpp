@@ -1,17 +1,87 @@
 #include "simulator.hpp"
+#include "offline_simulator.hpp"
 #include "pcg32.hpp"
+#include "shm_transport.hpp"
 
 #include <boost/asio.hpp>
 #include <iostream>
 #include <boost/log/core.hpp>
 #include <boost/log/expressions.hpp>
 #include "logging.hpp"
+#include <charconv>
+#include <chrono>
+#include <string>
+#include <string_view>
 #include <thread>
 #include <vector>
 
-int main() {
+// Usage: simulator [shm:<socket path> | unix:<socket path> | offline] [option=value ...]
+// Without an endpoint the simulator connects over TCP to 127.0.0.1:16000.
+// "offline" runs the agents against an in-process order book under a virtual
+// clock instead (OfflineSimulator): as fast as possible, deterministic per seed.
+// Options:
+//   agents=<type=count,...>  population; types mm, taker, deep, noise, mixed
+//                            (default mixed=1: one agent drawing a type per order)
+//   sessions=<n>             exchange sessions the agents share (default 1, live only)
+//   seed=<n>                 seed for arrivals, the fair-value process and every
+//                            agent's RNG (default 0)
+//   threads=<n>              threads running the io_context (default 1, live only)
+//   duration=<seconds>       stop after this long and print the agent summary
+//                            (default: run until the exchange disconnects;
+//                            offline: simulated seconds, default 60)
+namespace {
+    bool parse_count(std::string_view text, uint64_t& out) {
+        const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), out);
+        return ec == std::errc{} && end == text.data() + text.size();
+    }
+}
+
+int main(int argc, char* argv[]) {
     try {
-        size_t n_simulators = 1;
+        SimulatorConfig config;
+        uint64_t io_threads = 1;
+        uint64_t duration_s = 0;
+
+        bool offline = false;
+        std::string shm_socket_path;
+        std::string unix_socket_path;
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view arg = argv[i];
+            const size_t eq = arg.find('=');
+            if (eq == std::string_view::npos) {
+                if (arg == "offline") {
+                    offline = true;
+                } else if (arg.rfind("shm:", 0) == 0) {
+                    shm_socket_path = std::string(arg.substr(4));
+                } else if (arg.rfind("unix:", 0) == 0) {
+                    unix_socket_path = std::string(arg.substr(5));
+                } else {
+                    std::cerr << "Unknown endpoint '" << arg << "', using TCP.\n";
+                }
+                continue;
+            }
+
+            const std::string_view key = arg.substr(0, eq);
+            const std::string_view value = arg.substr(eq + 1);
+            uint64_t n = 0;
+            bool ok = false;
+            if (key == "agents") {
+                ok = parse_agent_population(value, config.population);
+            } else if (key == "sessions") {
+                ok = parse_count(value, n) && n > 0 && n <= MAX_CONNECTIONS;
+                config.sessions = n;
+            } else if (key == "seed") {
+                ok = parse_count(value, config.seed);
+            } else if (key == "threads") {
+                ok = parse_count(value, io_threads) && io_threads > 0;
+            } else if (key == "duration") {
+                ok = parse_count(value, duration_s);
+            }
+            if (!ok) {
+                std::cerr << "Invalid option '" << arg << "'\n";
+                return 1;
+            }
+        }
 
         auto core = boost::log::core::get();
         core->set_filter(
@@ -20,45 +90,98 @@ int main() {
 
         const std::array<Price_t, 3> bounds = {1, 5, 10};
 
-        // Threads to hold simulators
-        std::vector<std::thread> threads;
-        threads.reserve(n_simulators);
-        for (size_t i = 0; i < n_simulators; ++i) {
-            threads.emplace_back([i, bounds]() {
-                try {
-                    boost::asio::io_context io_context;
-                    // Resolve and connect to exchange
-                    tcp::resolver resolver(io_context);
-                    tcp::socket socket(io_context);
-                    auto endpoints = resolver.resolve("127.0.0.1", "16000");
-                    boost::asio::connect(socket, endpoints);
-                    // Each simulator gets its own RNG seed
-                    auto rng = std::make_unique<PCGRNG>(static_cast<uint64_t>(i), 0);
-                    std::atomic<bool> shutdown_requested{false};
-
-                    auto on_shutdown = [&](Connection*) {
-                        if (shutdown_requested.exchange(true)) return;
-                        io_context.stop();
-                    };
-
-                    MarketSimulator<3> sim(
-                        io_context,
-                        std::move(socket),
-                        std::move(rng),
-                        bounds,
-                        on_shutdown
-                    );
-                    sim.start();
-                    io_context.run();
-                } catch (const std::exception& e) {
-                    std::cerr << "[Simulator " << i << "] Error: " << e.what() << "\n";
-                }
+        if (offline) {
+            const double seconds = duration_s > 0 ? static_cast<double>(duration_s) : 60.0;
+            auto sim = std::make_unique<OfflineSimulator<3>>(config.population, config.seed, bounds);
+            const auto t0 = std::chrono::steady_clock::now();
+            sim->run(seconds);
+            const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+            const OfflineStats& stats = sim->stats();
+            std::cout << "[SIM] offline: " << seconds << " s simulated in " << wall << " s, "
+                      << sim->agents().size() << " agents, seed " << config.seed << "\n"
+                      << "  events=" << stats.events
+                      << " inserts=" << stats.inserts
+                      << " cancels=" << stats.cancels
+                      << " trades=" << stats.trades
+                      << " traded_volume=" << stats.traded_volume
+                      << " rejects=" << stats.rejects << "\n";
+            sim->agents().print_summary(std::cout);
+            return 0;
+        }
+
+        boost::asio::io_context io_context;
+
+        SessionFactory make_session;
+        if (!shm_socket_path.empty()) {
+#if defined(__linux__)
+            make_session = [&](InboundQueue& inbound, OutboundQueue&) -> std::unique_ptr<Session> {
+                return std::make_unique<ShmClientSession>(io_context, shm_socket_path, inbound);
+            };
+#else
+            throw std::runtime_error("shared-memory transport is only available on Linux");
+#endif
+        } else if (!unix_socket_path.empty()) {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+            make_session = [&](InboundQueue& inbound, OutboundQueue& outbound) -> std::unique_ptr<Session> {
+                boost::asio::local::stream_protocol::socket socket(io_context);
+                socket.connect(boost::asio::local::stream_protocol::endpoint(unix_socket_path));
+                return std::make_unique<Connection>(io_context, std::move(socket), 0, inbound, outbound,
+                                                    true, ConnectionRole::CLIENT);
+            };
+#else
+            throw std::runtime_error("Unix domain sockets are not available on this platform");
+#endif
+        } else {
+            make_session = [&](InboundQueue& inbound, OutboundQueue& outbound) -> std::unique_ptr<Session> {
+                // Resolve and connect to exchange
+                tcp::resolver resolver(io_context);
+                tcp::socket socket(io_context);
+                auto endpoints = resolver.resolve("127.0.0.1", "16000");
+                boost::asio::connect(socket, endpoints);
+                auto connection = std::make_unique<Connection>(io_context, std::move(socket), 0, inbound, outbound,
+                                                               true, ConnectionRole::CLIENT);
+                connection->set_socket_profile(SocketProfile::LATENCY);
+                return connection;
+            };
+        }
+
+        auto on_shutdown = [&](Session*) {
+            io_context.stop();
+        };
+
+        MarketSimulator<3> sim(
+            io_context,
+            make_session,
+            config,
+            bounds,
+            on_shutdown
+        );
+
+        boost::asio::steady_timer run_timer(io_context);
+        if (duration_s > 0) {
+            run_timer.expires_after(std::chrono::seconds(duration_s));
+            run_timer.async_wait([&](const boost::system::error_code& ec) {
+                if (ec) return;
+                sim.stop();
+                boost::asio::post(io_context, [&] { io_context.stop(); });
             });
         }
 
+        sim.start();
+
+        std::vector<std::thread> threads;
+        threads.reserve(io_threads - 1);
+        for (size_t i = 1; i < io_threads; ++i) {
+            threads.emplace_back([&] { io_context.run(); });
+        }
+        io_context.run();
         for (auto& t : threads) {
             t.join();
         }
+
+        std::cout << "[SIM] " << sim.agents().size() << " agents over " << config.sessions << " session(s), seed " << config.seed << "\n";
+        sim.agents().print_summary(std::cout);
     }
     catch (const std::exception& e) {
         std::cerr << "Simulator error: " << e.what() << '\n';
@@ -1,8 +1,11 @@
 #pragma once
 #include "state.hpp"
+#include <array>
 #include <vector>
 #include <cmath>
 #include <algorithm>
+#include <optional>
+#include <string_view>
 
 constexpr double LAMBDA_INSERT_BASE = 25'000.0;
 constexpr double CANCEL_SCALING_FACTOR = 50'000.0;
@@ -17,12 +20,46 @@ enum class AgentType : uint8_t {
     NOISE = 3     // uninformed/noise
 };
 
+constexpr size_t NUM_AGENT_TYPES = 4;
+
+inline const char* agent_type_name(AgentType type) {
+    switch (type) {
+        case AgentType::MM: return "mm";
+        case AgentType::TAKER: return "taker";
+        case AgentType::DEEP: return "deep";
+        case AgentType::NOISE: return "noise";
+        default: return "unknown";
+    }
+}
+
+inline bool parse_agent_type(std::string_view name, AgentType& out) {
+    for (size_t i = 0; i < NUM_AGENT_TYPES; ++i) {
+        const AgentType type = static_cast<AgentType>(i);
+        if (name == agent_type_name(type)) {
+            out = type;
+            return true;
+        }
+    }
+    return false;
+}
+
 enum class OrderRegime : uint8_t {
     MARKETABLE = 0,
     IMPROVE = 1,
     PASSIVE = 2
 };
 
+// Tunable parameters of MarketDynamics; the defaults are the constants above.
+struct DynamicsParams {
+    double lambda_insert_base = LAMBDA_INSERT_BASE;
+    double cancel_scaling_factor = CANCEL_SCALING_FACTOR;
+    // Multipliers on the state-dependent archetype weights of decide_insert,
+    // indexed by AgentType.
+    std::array<double, NUM_AGENT_TYPES> archetype_weights{1.0, 1.0, 1.0, 1.0};
+
+    double lambda_cancel_base() const { return lambda_insert_base / cancel_scaling_factor; }
+};
+
 struct InsertDecision {
     Side side;
     Price_t price;
@@ -34,7 +71,15 @@ struct InsertDecision {
 template<size_t N>
 class MarketDynamics {
 public:
-    InsertDecision decide_insert(const SimulationState<N>& state, double cumulative_hazard, RNG* rng) const {
+    MarketDynamics() = default;
+    explicit MarketDynamics(const DynamicsParams& params) : params_(params) {}
+
+    const DynamicsParams& params() const { return params_; }
+
+    // archetype: the agent's fixed type; without one, a type is drawn per
+    // order from state-dependent weights (one agent standing for the market).
+    InsertDecision decide_insert(const SimulationState<N>& state, double cumulative_hazard, RNG* rng,
+                                 std::optional<AgentType> archetype = std::nullopt) const {
         const auto& ts  = state.time_state();
         const auto& ps  = state.price_state();
         const auto& vs  = state.vol_state();
@@ -85,11 +130,16 @@ public:
         double w_deep  = 0.25 + 0.15 * (1.0 - urgency);
         double w_noise = 0.10;
 
+        w_mm    *= params_.archetype_weights[static_cast<size_t>(AgentType::MM)];
+        w_taker *= params_.archetype_weights[static_cast<size_t>(AgentType::TAKER)];
+        w_deep  *= params_.archetype_weights[static_cast<size_t>(AgentType::DEEP)];
+        w_noise *= params_.archetype_weights[static_cast<size_t>(AgentType::NOISE)];
+
         // Normalize
         double w_sum = w_mm + w_taker + w_deep + w_noise;
         w_mm /= w_sum; w_taker /= w_sum; w_deep /= w_sum; w_noise /= w_sum;
 
-        AgentType agent = sample_agent_(rng, w_mm, w_taker, w_deep, w_noise);
+        AgentType agent = archetype ? *archetype : sample_agent_(rng, w_mm, w_taker, w_deep, w_noise);
 
         // ------------------------------------------------------------
         // 3) Choose regime explicitly: MARKETABLE / IMPROVE / PASSIVE
@@ -325,10 +375,10 @@ public:
             + 0.60 * thinness;
 
         insert_mult = std::clamp(insert_mult, 0.3, 10.0);
-        lambda_insert = LAMBDA_INSERT_BASE * insert_mult;
+        lambda_insert = params_.lambda_insert_base * insert_mult;
 
         // CANCEL: depends strongly on open orders, near-touch activity, volatility/jumps, and adverse selection
-        double depth_mult = 0.35 + static_cast<double>(open_order_count) / CANCEL_SCALING_FACTOR;
+        double depth_mult = 0.35 + static_cast<double>(open_order_count) / params_.cancel_scaling_factor;
         double vol_mult = 1.0 + 1.2 * std::min(vol_s, 1.5) + 1.0 * vol.jump_intensity;
         double flow_mult = 1.0 + 1.0 * std::abs(fs.flow_imbalance) + 0.6 * std::abs(fs.taker_sign_ewma);
         double spread_mult = 1.0 + 0.25 * spread_ticks;
@@ -337,10 +387,11 @@ public:
         double cancel_mult = depth_mult * vol_mult * flow_mult * spread_mult * excite_mult;
         cancel_mult = std::clamp(cancel_mult, 0.2, 25.0);
 
-        lambda_cancel = LAMBDA_CANCEL_BASE * cancel_mult;
+        lambda_cancel = params_.lambda_cancel_base() * cancel_mult;
     }
 
 private:
+    DynamicsParams params_;
 
     static inline Price_t stochastic_round(double x, RNG* rng) {
         double f = std::floor(x);
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string_view>
+
+#include "types.hpp"
+#include "protocol.hpp"
+#include "callbacks.hpp"
+#include "order_book.hpp"
+#include "pcg32.hpp"
+#include "market_dynamics.hpp"
+#include "order_manager.hpp"
+#include "state.hpp"
+#include "shadow_order_book.hpp"
+#include "agents.hpp"
+
+struct OfflineStats {
+    uint64_t events = 0;
+    uint64_t inserts = 0;
+    uint64_t cancels = 0;
+    uint64_t trades = 0;
+    uint64_t traded_volume = 0;
+    uint64_t rejects = 0;
+};
+
+// ------------------------------------------------------------
+// OfflineSimulator
+// ------------------------------------------------------------
+//
+// The agents of MarketSimulator trading against an in-process OrderBook
+// under a virtual clock: no sockets, no timers, no wall-clock time, so a
+// simulated hour runs as fast as the CPU allows and a seed always produces
+// the same run.
+//
+// Design:
+// - The simulator is the book's OrderBookCallbacks sink. Level updates and
+//   trades reach the ShadowOrderBook and SimulationState in the same form
+//   the live feed delivers them; order events go to the CancelHazard and to
+//   the agents, with the agent index as the book's client id.
+// - Discrete-event loop over three sources: the next insert (exponential
+//   inter-arrival at the current intensity, redrawn whenever the intensity
+//   changes, which the memoryless arrivals allow), the next cancellation
+//   (CancelHazard::time_to_next_due()) and the state tick, which keeps the
+//   live simulator's 1 ms cadence for syncing state and intensities.
+// - Ties resolve cancel, then insert, then tick, so the order of events is
+//   a function of the seed alone.
+//
+template <size_t N>
+class OfflineSimulator final : public OrderBookCallbacks {
+    public:
+        static constexpr double TICK_SECONDS = 0.001;
+
+        OfflineSimulator(
+            const AgentPopulation& population,
+            uint64_t seed,
+            const std::array<Price_t, N>& liquidity_bucket_bounds,
+            const DynamicsParams& params = {}
+        )
+        : rng_(seed, 0)
+        , roster_(population, seed)
+        , lambda_insert_(params.lambda_insert_base)
+        , lambda_cancel_(params.lambda_cancel_base())
+        , dynamics_(params)
+        , state_(liquidity_bucket_bounds, seed, LATENT_STREAM)
+        , book_(std::make_unique<OrderBook>()) {
+            book_->set_callbacks(this);
+            next_insert_ = rng_.exponential(lambda_insert_);
+        }
+
+        // Called with every order the agents send, before it reaches the book.
+        std::function<void(const InsertDecision&)> insert_generated;
+
+        OfflineSimulator(const OfflineSimulator&) = delete;
+        OfflineSimulator& operator=(const OfflineSimulator&) = delete;
+
+        // Advances the virtual clock by seconds, processing every event due.
+        void run(double seconds) {
+            const double end = now_ + seconds;
+            for (;;) {
+                const double next_cancel = now_ + hazard_.time_to_next_due();
+                const double t = std::min({next_cancel, next_insert_, next_tick_});
+                if (t > end) break;
+                ++stats_.events;
+
+                if (t == next_cancel) {
+                    now_ = t;
+                    hazard_.advance_to_next_due();
+                    hazard_.pop_due([this](Id_t exchange_order_id) { cancel_(exchange_order_id); });
+                    continue;
+                }
+
+                hazard_.advance(t - now_);
+                now_ = t;
+                if (t == next_insert_) {
+                    generate_insert_(roster_.pick(rng_.standard_uniform()));
+                    next_insert_ = now_ + rng_.exponential(lambda_insert_);
+                } else {
+                    tick_();
+                }
+            }
+            hazard_.advance(end - now_);
+            now_ = end;
+        }
+
+        // Virtual time, in seconds since the start.
+        double now() const { return now_; }
+        const OfflineStats& stats() const { return stats_; }
+        const AgentRoster& agents() const { return roster_; }
+        const SimulationState<N>& state() const { return state_; }
+        const ShadowOrderBook& market() const { return shadow_order_book_; }
+        const OrderBook& book() const { return *book_; }
+
+        // OrderBookCallbacks
+        void on_trade(
+            const Order& maker_order,
+            Id_t taker_client_id,
+            Id_t /*taker_order_id*/,
+            Price_t price,
+            Volume_t /*taker_total_quantity*/,
+            Volume_t /*taker_cumulative_quantity*/,
+            Volume_t traded_quantity,
+            Time_t timestamp
+        ) override {
+            ++stats_.trades;
+            stats_.traded_volume += traded_quantity;
+            if (maker_order.quantity_remaining_ == 0) hazard_.remove(maker_order.order_id_);
+
+            for (const Id_t agent_idx : {maker_order.client_id_, taker_client_id}) {
+                Agent& agent = roster_[agent_idx];
+                ++agent.fills;
+                agent.filled_volume += traded_quantity;
+            }
+
+            const PayloadTradeEvent trade = make_trade_event(
+                static_cast<Id_t>(stats_.trades),
+                static_cast<Id_t>(stats_.trades),
+                price,
+                traded_quantity,
+                maker_order.is_bid_ ? Side::SELL : Side::BUY,
+                timestamp
+            );
+            state_.on_trade(&trade);
+        }
+
+        void on_order_inserted(Id_t /*client_request_id*/, const Order& order, Time_t /*timestamp*/) override {
+            hazard_.add(order.order_id_, pending_hazard_threshold_);
+        }
+
+        void on_order_cancelled(Id_t, const Order&, Time_t) override { ++stats_.cancels; }
+        void on_order_amended(Id_t, Volume_t, const Order&, Time_t) override {}
+
+        void on_level_update(Side side, PriceLevel const& level, Time_t /*timestamp*/) override {
+            const PayloadPriceLevelUpdate update = make_price_level_update(0, side, level.price_, level.total_quantity_, timestamp_());
+            const Volume_t old_volume = shadow_order_book_.volume_at(side, level.price_);
+            shadow_order_book_.on_price_level_update(&update);
+            state_.on_level_update(shadow_order_book_, side, level.price_, old_volume);
+        }
+
+        void on_error(Id_t, Id_t, uint16_t, std::string_view, Time_t) override { ++stats_.rejects; }
+
+    private:
+        inline Time_t timestamp_() const { return static_cast<Time_t>(now_ * 1e9); }
+
+        void tick_() {
+            state_.sync_with_book(shadow_order_book_, TICK_SECONDS);
+            dynamics_.update_intensity(state_, hazard_.open_count(), lambda_insert_, lambda_cancel_);
+            hazard_.set_rate(lambda_cancel_);
+            next_insert_ = now_ + rng_.exponential(lambda_insert_);
+            next_tick_ += TICK_SECONDS;
+        }
+
+        void generate_insert_(size_t agent_idx) {
+            Agent& agent = roster_[agent_idx];
+            const InsertDecision insert = dynamics_.decide_insert(state_, hazard_.cumulative(), &agent.rng, agent.type);
+            ++stats_.inserts;
+            ++agent.inserts;
+            if (insert_generated) insert_generated(insert);
+            pending_hazard_threshold_ = insert.cancellation_hazard_mass;
+            book_->submit_order(
+                insert.price,
+                insert.quantity,
+                insert.side == Side::BUY,
+                static_cast<Id_t>(agent_idx),
+                request_id_++,
+                timestamp_()
+            );
+        }
+
+        void cancel_(Id_t exchange_order_id) {
+            const Order* order = book_->find_order(exchange_order_id);
+            if (!order) return;
+            book_->cancel_order(order->client_id_, request_id_++, exchange_order_id, timestamp_());
+        }
+
+        PCGRNG rng_; // arrivals and agent picks; agents draw from their own streams
+        AgentRoster roster_;
+
+        double now_ = 0.0;
+        double next_tick_ = TICK_SECONDS;
+        double next_insert_ = 0.0;
+        double lambda_insert_;
+        double lambda_cancel_;
+
+        ShadowOrderBook shadow_order_book_;
+        MarketDynamics<N> dynamics_;
+        SimulationState<N> state_;
+        CancelHazard hazard_;
+        std::unique_ptr<OrderBook> book_;
+
+        Id_t request_id_ = 0;
+        double pending_hazard_threshold_ = 0.0; // of the insert being submitted
+        OfflineStats stats_;
+};
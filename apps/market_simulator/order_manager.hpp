@@ -6,15 +6,116 @@
 #include <unordered_map>
 #include <atomic>
 #include <cassert>
+#include <limits>
 
 #include "types.hpp"
 #include "protocol.hpp"
+#include "session.hpp"
+
+// ------------------------------------------------------------
+// CancelHazard
+// ------------------------------------------------------------
+//
+// Cancellation bookkeeping for resting orders: each order carries a hazard
+// threshold drawn when it was sent, and is cancelled once the cumulative
+// hazard (the cancel rate integrated over time) passes it.
+//
+// Design:
+// - No clock of its own: callers advance it by elapsed time, wall-clock time
+//   in OrderManager and virtual time in the offline simulator.
+// - Orders that leave the book another way are only dropped from the live
+//   set; their queue entries are pruned when they reach the top.
+//
+class CancelHazard {
+    public:
+        inline void advance(double dt) {
+            if (lambda_ > 0.0 && dt > 0.0) cumulative_ += lambda_ * dt;
+        }
+
+        inline void set_rate(double lambda) { lambda_ = lambda; }
+        inline double rate() const { return lambda_; }
+        inline double cumulative() const { return cumulative_; }
+        inline size_t open_count() const { return active_.size(); }
+
+        void add(Id_t exchange_order_id, double hazard_threshold) {
+            active_.insert(exchange_order_id);
+            queue_.push({hazard_threshold, exchange_order_id});
+        }
+
+        // The order was filled or cancelled.
+        void remove(Id_t exchange_order_id) { active_.erase(exchange_order_id); }
+
+        // Time until the next live order is due at the current rate: 0 when
+        // one is due already, infinity when none will be.
+        double time_to_next_due() {
+            prune_top_();
+            if (queue_.empty() || lambda_ <= 0.0) return std::numeric_limits<double>::infinity();
+            const double remaining_hazard = queue_.top().hazard_threshold - cumulative_;
+            return remaining_hazard <= 0.0 ? 0.0 : remaining_hazard / lambda_;
+        }
+
+        // Brings the cumulative hazard up to the next live order's threshold,
+        // for an event loop that has advanced time by time_to_next_due() and
+        // must not miss the order to rounding.
+        void advance_to_next_due() {
+            prune_top_();
+            if (!queue_.empty() && queue_.top().hazard_threshold > cumulative_) {
+                cumulative_ = queue_.top().hazard_threshold;
+            }
+        }
+
+        // Removes every order that is due, calling f(exchange_order_id) for each.
+        template <typename F>
+        void pop_due(F&& f) {
+            prune_top_();
+            while (!queue_.empty() && queue_.top().hazard_threshold <= cumulative_) {
+                const Id_t exchange_order_id = queue_.top().exchange_order_id;
+                queue_.pop();
+                active_.erase(exchange_order_id);
+                f(exchange_order_id);
+                prune_top_();
+            }
+        }
+
+    private:
+        struct HazardEntry {
+            double hazard_threshold;
+            Id_t   exchange_order_id;
+        };
+
+        struct CompareHazard {
+            bool operator()(const HazardEntry& a, const HazardEntry& b) const {
+                return a.hazard_threshold > b.hazard_threshold;
+            }
+        };
+
+        void prune_top_() {
+            while (!queue_.empty()) {
+                const auto& top = queue_.top();
+                if (active_.find(top.exchange_order_id) != active_.end()) {
+                    break; // top is live
+                }
+                queue_.pop(); // dead entry
+            }
+        }
+
+        double cumulative_ = 0.0;
+        double lambda_ = 0.0;
+
+        std::priority_queue<
+            HazardEntry,
+            std::vector<HazardEntry>,
+            CompareHazard
+        > queue_;
+
+        std::unordered_set<Id_t> active_;
+};
 
 class OrderManager {
     public:
         OrderManager(
             boost::asio::strand<boost::asio::io_context::executor_type>& strand,
-            Connection& connection,
+            Session& connection,
             std::atomic<Id_t>& request_id
         )
         : strand_(strand)
@@ -47,8 +148,7 @@ class OrderManager {
                     const double hazard_threshold = it->second;
                     pending_inserts_.erase(it);
 
-                    active_orders_.insert(exchange_id);
-                    expiry_queue_.push({hazard_threshold, exchange_id});
+                    hazard_.add(exchange_id, hazard_threshold);
                     reschedule_next_expiry();
                 }
             );
@@ -62,7 +162,7 @@ class OrderManager {
             boost::asio::dispatch(
                 strand_,
                 [this, exchange_id = msg->exchange_order_id] {
-                    active_orders_.erase(exchange_id);
+                    hazard_.remove(exchange_id);
                 }
             );
         }
@@ -72,7 +172,7 @@ class OrderManager {
                 strand_,
                 [this, lambda_cancel] {
                     advance_hazard_to_now();
-                    lambda_cancel_ = lambda_cancel;
+                    hazard_.set_rate(lambda_cancel);
                     reschedule_next_expiry();
                 }
             );
@@ -82,34 +182,22 @@ class OrderManager {
             #ifndef NDEBUG
                 assert(strand_.running_in_this_thread());
             #endif
-            return active_orders_.size();
+            return hazard_.open_count();
         }
 
         const double cumulative_hazard() const {
             #ifndef NDEBUG
                 assert(strand_.running_in_this_thread());
             #endif
-            return cumulative_hazard_;
+            return hazard_.cumulative();
         }
 
     private:
-        struct HazardEntry {
-            double hazard_threshold;
-            Id_t   exchange_order_id;
-        };
-
-        struct CompareHazard {
-            bool operator()(const HazardEntry& a, const HazardEntry& b) const {
-                return a.hazard_threshold > b.hazard_threshold;
-            }
-        };
-
         void advance_hazard_to_now() {
             auto now = std::chrono::steady_clock::now();
 
-            if (last_update_time_.time_since_epoch().count() != 0 && lambda_cancel_ > 0.0) {
-                double dt = std::chrono::duration<double>(now - last_update_time_).count();
-                cumulative_hazard_ += lambda_cancel_ * dt;
+            if (last_update_time_.time_since_epoch().count() != 0) {
+                hazard_.advance(std::chrono::duration<double>(now - last_update_time_).count());
             }
 
             last_update_time_ = now;
@@ -120,16 +208,11 @@ class OrderManager {
 
             advance_hazard_to_now();
 
-            if (lambda_cancel_ <= 0.0) return;
-
-            prune_top_();
-            if (expiry_queue_.empty()) return;
-
-            const auto& next = expiry_queue_.top();
-            const double remaining_hazard = next.hazard_threshold - cumulative_hazard_;
+            const double dt = hazard_.time_to_next_due();
+            if (dt == std::numeric_limits<double>::infinity()) return;
 
             // If due (or past due), process immediately in the strand to avoid recursion.
-            if (remaining_hazard <= 0.0) {
+            if (dt <= 0.0) {
                 boost::asio::post(
                     strand_,
                     [this] { fire_next_expiry(boost::system::error_code{}); }
@@ -137,7 +220,6 @@ class OrderManager {
                 return;
             }
 
-            const double dt = remaining_hazard / lambda_cancel_;
             timer_.expires_after(
                 std::chrono::duration_cast<std::chrono::steady_clock::duration>(
                     std::chrono::duration<double>(dt)
@@ -157,71 +239,32 @@ class OrderManager {
 
             advance_hazard_to_now();
 
-            if (lambda_cancel_ <= 0.0) {
+            if (hazard_.rate() <= 0.0) {
                 return;
             }
 
-            prune_top_();
-
-            while (!expiry_queue_.empty()) {
-                const auto& top = expiry_queue_.top();
-                if (top.hazard_threshold > cumulative_hazard_) {
-                    break; // next not due yet
-                }
-
-                auto entry = top;
-                expiry_queue_.pop();
-                if (!active_orders_.erase(entry.exchange_order_id)) {
-                    prune_top_();
-                    continue;
-                }
-
+            hazard_.pop_due([this](Id_t exchange_order_id) {
                 const Id_t client_id = client_request_id_++;
+                const auto cancel = make_cancel_order(client_id, exchange_order_id);
                 connection_.send_message(
                     static_cast<Message_t>(MessageType::CANCEL_ORDER),
-                    &make_cancel_order(client_id, entry.exchange_order_id)
+                    &cancel
                 );
+            });
 
-                prune_top_();
-            }
-            
             reschedule_next_expiry();
         }
 
 
-        void prune_top_() {
-            while (!expiry_queue_.empty()) {
-                const auto& top = expiry_queue_.top();
-                if (active_orders_.find(top.exchange_order_id) != active_orders_.end()) {
-                    break; // top is live
-                }
-                expiry_queue_.pop(); // dead entry
-            }
-        }
-
-        bool top_is_due_() const {
-            if (expiry_queue_.empty()) return false;
-            return expiry_queue_.top().hazard_threshold <= cumulative_hazard_;
-        }
-
-
     private:
         boost::asio::strand<boost::asio::io_context::executor_type>& strand_;
         boost::asio::steady_timer timer_;
 
-        Connection& connection_;
+        Session& connection_;
         std::atomic<Id_t>& client_request_id_;
 
-        double cumulative_hazard_ = 0.0;
-        double lambda_cancel_ = 0.0;
+        CancelHazard hazard_;
         std::chrono::steady_clock::time_point last_update_time_;
 
-        std::priority_queue<
-            HazardEntry,
-            std::vector<HazardEntry>,
-            CompareHazard
-        > expiry_queue_;
-
-        std::unordered_set<Id_t> active_orders_;
         std::unordered_map<Id_t, double> pending_inserts_;
 };
@@ -77,7 +77,7 @@ class PCGRNG final : public RNG {
         }
         
         inline bool bernoulli(double p) override {
-            return rng_.uniform() > 0.5;
+            return rng_.uniform() < p;
         }
         
         inline uint32_t uniform_int(uint32_t lower_bound, uint32_t upper_bound) {
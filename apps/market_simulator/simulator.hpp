@@ -5,58 +5,110 @@
 #include <memory>
 #include <vector>
 #include <chrono>
+#include <deque>
 #include <mutex>
+#include <unordered_map>
 
 #include <boost/asio.hpp>
 
 #include "types.hpp"
 #include "protocol.hpp"
 #include "rng.hpp"
+#include "pcg32.hpp"
 #include "connectivity.hpp"
+#include "session.hpp"
 #include "market_dynamics.hpp"
 #include "order_manager.hpp"
 #include "state.hpp"
 #include "shadow_order_book.hpp"
+#include "agents.hpp"
 
 constexpr size_t MESSAGES_PER_DRAIN = 2'000;
-constexpr size_t HIGH_OUTBOUND_Q_SIZE = (OUTBOUND_Q_CAP * 85) / 100;
-constexpr size_t LOW_OUTBOUND_Q_SIZE  = (OUTBOUND_Q_CAP * 70) / 100;
+// Outbound pause / resume thresholds, in percent of the session's capacity.
+constexpr size_t HIGH_OUTBOUND_PCT = 85;
+constexpr size_t LOW_OUTBOUND_PCT  = 70;
+
+// Builds the session over the simulator's queues: a TCP Connection, or a
+// shared-memory session (which only uses the inbound queue).
+using SessionFactory = std::function<std::unique_ptr<Session>(InboundQueue&, OutboundQueue&)>;
+
+struct SimulatorConfig {
+    size_t sessions = 1;
+    AgentPopulation population;
+    uint64_t seed = 0;
+};
 
+// ------------------------------------------------------------
+// MarketSimulator
+// ------------------------------------------------------------
+//
+// A population of agents trading through a few exchange sessions from one
+// io_context.
+//
+// Design:
+// - Market data is ingested once: session 0 subscribes and feeds the one
+//   ShadowOrderBook and SimulationState every agent decides from.
+// - Order flow is one Poisson arrival process at the market-wide intensity;
+//   each arrival picks an agent by activity (AgentRoster), which decides with
+//   its own archetype and RNG and sends on session agent % sessions.
+// - Each session keeps its own queues, OrderManager (cancellations) and
+//   backpressure; all of them, and the simulator, run on one strand, so the
+//   io_context may be run by several threads. Session callbacks are posted
+//   onto it.
+// - Fills are attributed back to agents for the end-of-run summary.
+//
 template <size_t N>
 class MarketSimulator {
     public:
         MarketSimulator(
             boost::asio::io_context& context,
-            tcp::socket socket,
-            std::unique_ptr<RNG> rng,
+            const SessionFactory& make_session,
+            const SimulatorConfig& config,
             const std::array<Price_t, N>& liquidity_bucket_bounds,
-            std::function<void(Connection*)> on_shutdown
+            std::function<void(Session*)> on_shutdown
         )
         : context_(context)
         , sim_strand_(boost::asio::make_strand(context))
         , event_timer_(context)
-        , rng_(std::move(rng))
-        , inbound_(std::make_unique<InboundQueue>())
-        , outbound_(std::make_unique<OutboundQueue>())
-        , connection_(context, std::move(socket), 0, *inbound_, *outbound_)
-        , state_(liquidity_bucket_bounds)
+        , rng_(config.seed, 0)
+        , roster_(config.population, config.seed)
+        , state_(liquidity_bucket_bounds, config.seed, LATENT_STREAM)
         , request_id_(0)
-        // , metrics_timer_(context)
-        , order_manager_(sim_strand_, connection_, request_id_) {
-            connection_.large_message_received = [this](Id_t cid, Message_t type, std::shared_ptr<std::vector<uint8_t>> buf) {
-                this->on_large_message(cid, type, buf);
-            };
-            connection_.disconnected = [this, on_shutdown = std::move(on_shutdown)](Connection* c) {
-                running_.store(false, std::memory_order_release);
-                event_timer_.cancel();
-                if (on_shutdown) on_shutdown(c);
-            };
-
-            connection_.inbound_ready = [this] {
-                if (!running_.load(std::memory_order_acquire)) return;
-                schedule_inbound_drain_();
-            };
-
+        , on_shutdown_(std::move(on_shutdown)) {
+            const size_t sessions = config.sessions == 0 ? 1 : config.sessions;
+            lanes_.reserve(sessions);
+            for (size_t idx = 0; idx < sessions; ++idx) {
+                auto lane = std::make_unique<Lane>();
+                lane->inbound = std::make_unique<InboundQueue>();
+                lane->outbound = std::make_unique<OutboundQueue>();
+                lane->session = make_session(*lane->inbound, *lane->outbound);
+                lane->orders = std::make_unique<OrderManager>(sim_strand_, *lane->session, request_id_);
+
+                Lane* l = lane.get();
+                // Sessions call back from whichever thread serves them (with
+                // threads>1, or the shm poller); the book and state belong to
+                // the strand. The payload is borrowed, so it is copied first.
+                lane->session->large_message_received = [this](Id_t cid, Message_t type, const uint8_t* payload, uint16_t payload_size) {
+                    if (!payload) return;
+                    std::vector<uint8_t> frame(payload, payload + payload_size);
+                    boost::asio::post(sim_strand_, [this, cid, type, frame = std::move(frame)] {
+                        on_large_message(cid, type, frame.data(), static_cast<uint16_t>(frame.size()));
+                    });
+                };
+                lane->session->disconnected = [this](Session* c) {
+                    running_.store(false, std::memory_order_release);
+                    boost::asio::dispatch(sim_strand_, [this, c] {
+                        event_timer_.cancel();
+                        if (shutdown_notified_.exchange(true)) return;
+                        if (on_shutdown_) on_shutdown_(c);
+                    });
+                };
+                lane->session->inbound_ready = [this, l] {
+                    if (!running_.load(std::memory_order_acquire)) return;
+                    schedule_inbound_drain_(*l);
+                };
+                lanes_.push_back(std::move(lane));
+            }
         }
 
 
@@ -64,11 +116,17 @@ class MarketSimulator {
 
         void start() {
             running_.store(true, std::memory_order_release);
-            // start_metrics_();
-            connection_.async_read();
+            for (auto& lane : lanes_) lane->session->start();
             boost::asio::post(sim_strand_, [this]{
+                for (auto& lane : lanes_) {
+                    // Ask for the compact protocol; the session falls back to v1 if the exchange or transport cannot.
+                    const PayloadConnect connect = make_connect(request_id_++, lane->session->max_protocol_version());
+                    lane->session->send_message(static_cast<Message_t>(MessageType::CONNECT), &connect);
+                }
+                const PayloadSubscribe subscribe = make_subscribe(request_id_++);
+                lanes_.front()->session->send_message(static_cast<Message_t>(MessageType::SUBSCRIBE), &subscribe);
                 last_tick_ = std::chrono::steady_clock::now();
-                schedule_tick(); 
+                schedule_tick();
             });
         }
 
@@ -76,43 +134,26 @@ class MarketSimulator {
             running_.store(false, std::memory_order_release);
             boost::asio::dispatch(sim_strand_, [this] {
                 event_timer_.cancel();
-                connection_.close();
+                for (auto& lane : lanes_) lane->session->close();
             });
         }
 
+        // Per-agent counters; read once the io_context has stopped.
+        const AgentRoster& agents() const { return roster_; }
 
     private:
-        // void start_metrics_() {
-        //     metrics_timer_.expires_after(std::chrono::seconds(1));
-        //     metrics_timer_.async_wait(boost::asio::bind_executor(
-        //         sim_strand_,
-        //         [this](const boost::system::error_code& ec) {
-        //             if (ec || !running_.load(std::memory_order_acquire)) return;
-
-        //             const double avg_us =
-        //                 (tick_count_ == 0) ? 0.0 : (handler_ns_accum_ / 1000.0) / static_cast<double>(tick_count_);
-
-        //             static std::mutex cout_mtx;
-        //             std::lock_guard<std::mutex> lk(cout_mtx);
-        //             std::cout
-        //                 << "[SIM] ticks/s=" << tick_count_
-        //                 << " avg_handler_us=" << avg_us
-        //                 << " inserts_sent/s=" << inserts_sent_
-        //                 << " inbound_processed/s=" << inbound_msgs_processed_
-        //                 << " inbound_backlog_max=" << inbound_backlog_max_
-        //                 << "\n";
-
-        //             // reset per-second counters
-        //             tick_count_ = 0;
-        //             handler_ns_accum_ = 0;
-        //             inserts_sent_ = 0;
-        //             inbound_msgs_processed_ = 0;
-        //             inbound_backlog_max_ = 0;
-
-        //             start_metrics_();
-        //         }
-        //     ));
-        // }
+        // One exchange session and the orders sent over it.
+        struct Lane {
+            std::unique_ptr<InboundQueue> inbound;
+            std::unique_ptr<OutboundQueue> outbound;
+            std::unique_ptr<Session> session;
+            std::unique_ptr<OrderManager> orders;
+            std::atomic<bool> drain_scheduled{false};
+            bool outbound_paused = false;
+            // Inserts sent and not yet resolved, oldest first, with the agent
+            // that sent each.
+            std::deque<std::pair<Id_t, uint32_t>> pending;
+        };
 
         void schedule_tick() {
             event_timer_.expires_after(std::chrono::duration_cast<boost::asio::steady_timer::duration>(tick_));
@@ -121,86 +162,81 @@ class MarketSimulator {
                 [this](const boost::system::error_code& ec) {
                     if (ec || !running_.load(std::memory_order_acquire)) return;
 
-                    if (inbound_->size_approx() != 0) {
-                        drain_inbound_bounded(MESSAGES_PER_DRAIN);
+                    for (auto& lane : lanes_) {
+                        if (lane->inbound->size_approx() != 0) {
+                            drain_inbound_bounded(*lane, MESSAGES_PER_DRAIN);
+                        }
                     }
-                    
+
                     const auto t0 = std::chrono::steady_clock::now();
                     double dt = std::chrono::duration<double>(t0 - last_tick_).count();
                     if (dt < 0.0) dt = 0.0;
                     if (dt > 0.25) dt = 0.25;
                     last_tick_ = t0;
                     state_.sync_with_book(shadow_order_book_, dt);
-                    order_manager_.update_cancel_rate(lambda_cancel_);
-                    dynamics_.update_intensity(state_, order_manager_.open_order_count(), lambda_insert_, lambda_cancel_);
 
-                    const auto out_depth = outbound_->size_approx();
-                    if (!outbound_paused_ && out_depth >= HIGH_OUTBOUND_Q_SIZE) {
-                        outbound_paused_ = true;
+                    size_t open_orders = 0;
+                    for (auto& lane : lanes_) {
+                        lane->orders->update_cancel_rate(lambda_cancel_);
+                        open_orders += lane->orders->open_order_count();
                     }
-
-                    if (outbound_paused_) {
-                        if (out_depth <= LOW_OUTBOUND_Q_SIZE) {
-                            outbound_paused_ = false;
-                        } else {
-                            schedule_tick();
-                            return;
+                    dynamics_.update_intensity(state_, open_orders, lambda_insert_, lambda_cancel_);
+
+                    for (auto& lane : lanes_) {
+                        const size_t out_depth = lane->session->outbound_depth();
+                        const size_t out_capacity = lane->session->outbound_capacity();
+                        if (!lane->outbound_paused && out_depth >= out_capacity * HIGH_OUTBOUND_PCT / 100) {
+                            lane->outbound_paused = true;
+                        } else if (lane->outbound_paused && out_depth <= out_capacity * LOW_OUTBOUND_PCT / 100) {
+                            lane->outbound_paused = false;
                         }
                     }
 
                     const double mean = lambda_insert_ * dt;
-                    const std::uint32_t k = rng_->poisson(mean);
+                    const std::uint32_t k = rng_.poisson(mean);
 
                     for (std::uint32_t i = 0; i < k; ++i) {
-                        generate_insert();
+                        generate_insert(roster_.pick(rng_.standard_uniform()));
                     }
 
-                    // const auto t1 = std::chrono::steady_clock::now();
-                    // handler_ns_accum_ += (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
-                    // tick_count_ += 1;
-
                     schedule_tick();
                 }
             ));
         }
 
 
-        void drain_inbound_bounded(size_t max_msgs) {
+        void drain_inbound_bounded(Lane& lane, size_t max_msgs) {
             InboundMessage msg{};
-            std::size_t n = 0;
-            for (size_t i = 0; i < max_msgs && inbound_->try_pop(msg); ++i) {
-                on_message(msg.message_type, msg.payload.data());
-                ++n;
+            for (size_t i = 0; i < max_msgs && lane.inbound->try_pop(msg); ++i) {
+                on_message(lane, msg.message_type, msg.payload.data());
             }
-            // inbound_msgs_processed_ += n;
-
-            // const auto backlog = inbound_.size_approx();
-            // if (backlog > inbound_backlog_max_) inbound_backlog_max_ = backlog;
         }
 
-        void schedule_inbound_drain_() {
+        void schedule_inbound_drain_(Lane& lane) {
             bool expected = false;
-            if (!inbound_drain_scheduled_.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+            if (!lane.drain_scheduled.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
                 return;
             }
 
-            boost::asio::post(sim_strand_, [this] {
-                inbound_drain_scheduled_.store(false, std::memory_order_release);
+            boost::asio::post(sim_strand_, [this, &lane] {
+                lane.drain_scheduled.store(false, std::memory_order_release);
 
-                drain_inbound_bounded(MESSAGES_PER_DRAIN);
+                drain_inbound_bounded(lane, MESSAGES_PER_DRAIN);
 
-                if (running_.load(std::memory_order_acquire) && inbound_->size_approx() != 0) {
-                    schedule_inbound_drain_();
+                if (running_.load(std::memory_order_acquire) && lane.inbound->size_approx() != 0) {
+                    schedule_inbound_drain_(lane);
                 }
             });
         }
 
 
-        void on_message(Message_t message_type, const uint8_t* payload) {
+        void on_message(Lane& lane, Message_t message_type, const uint8_t* payload) {
             switch (static_cast<MessageType>(message_type)) {
                 case MessageType::PRICE_LEVEL_UPDATE: {
                     const PayloadPriceLevelUpdate* update = reinterpret_cast<const PayloadPriceLevelUpdate*>(payload);
+                    const Volume_t old_volume = shadow_order_book_.volume_at(update->side, update->price);
                     shadow_order_book_.on_price_level_update(update);
+                    state_.on_level_update(shadow_order_book_, update->side, update->price, old_volume);
                     break;
                 }
                 case MessageType::TRADE_EVENT: {
@@ -209,27 +245,72 @@ class MarketSimulator {
                     break;
                 } case MessageType::CONFIRM_ORDER_INSERTED: {
                     const PayloadConfirmOrderInserted* insert_confirmation = reinterpret_cast<const PayloadConfirmOrderInserted*>(payload);
-                    order_manager_.on_insert_acknowledged(insert_confirmation);
+                    lane.orders->on_insert_acknowledged(insert_confirmation);
+                    on_insert_confirmed_(lane, insert_confirmation);
                     break;
                 } case MessageType::PARTIAL_FILL_ORDER: {
                     const PayloadPartialFill* partial_fill = reinterpret_cast<const PayloadPartialFill*>(payload);
-                    order_manager_.on_partial_fill(partial_fill);
+                    lane.orders->on_partial_fill(partial_fill);
+                    on_fill_(lane, partial_fill);
+                    break;
+                } case MessageType::CONFIRM_ORDER_CANCELLED: {
+                    const PayloadConfirmOrderCancelled* cancel = reinterpret_cast<const PayloadConfirmOrderCancelled*>(payload);
+                    order_agent_.erase(cancel->exchange_order_id);
+                    break;
+                } case MessageType::ERROR_MSG: {
+                    const PayloadError* error = reinterpret_cast<const PayloadError*>(payload);
+                    // A rejected insert is the oldest pending one; cancel
+                    // rejections carry ids that are never pending.
+                    if (!lane.pending.empty() && lane.pending.front().first == error->client_request_id) {
+                        lane.pending.pop_front();
+                    }
                     break;
                 }
                 default: return;
             }
         }
 
-        void on_large_message(Id_t /*connection_id*/, Message_t message_type, const std::shared_ptr<std::vector<uint8_t>>& buf) {
-            if (!buf) return;
+        // Inserts on one session resolve in the order they were sent: each
+        // ends in a confirmation (it rested), in fills down to zero leaves
+        // (filled on arrival) or in an error, and the fills an order takes on
+        // arrival come before its confirmation.
+        void on_insert_confirmed_(Lane& lane, const PayloadConfirmOrderInserted* msg) {
+            while (!lane.pending.empty() && lane.pending.front().first != msg->client_request_id) {
+                lane.pending.pop_front();
+            }
+            if (lane.pending.empty()) return;
+            order_agent_[msg->exchange_order_id] = lane.pending.front().second;
+            lane.pending.pop_front();
+        }
+
+        void on_fill_(Lane& lane, const PayloadPartialFill* msg) {
+            uint32_t agent;
+            if (auto it = order_agent_.find(msg->exchange_order_id); it != order_agent_.end()) {
+                agent = it->second;
+                if (msg->leaves_quantity == 0) order_agent_.erase(it);
+            } else {
+                // Not resting: the order matching on arrival, which is the
+                // oldest unresolved insert on this session.
+                if (lane.pending.empty()) return;
+                agent = lane.pending.front().second;
+                if (msg->leaves_quantity == 0) lane.pending.pop_front();
+            }
+            Agent& a = roster_[agent];
+            ++a.fills;
+            a.filled_volume += msg->last_quantity;
+        }
+
+        void on_large_message(Id_t /*connection_id*/, Message_t message_type, const uint8_t* payload, uint16_t payload_size) {
+            if (!payload) return;
 
             switch (static_cast<MessageType>(message_type)) {
                 case MessageType::ORDER_BOOK_SNAPSHOT: {
-                    if (buf->size() != sizeof(PayloadOrderBookSnapshot)) return;
+                    if (payload_size != sizeof(PayloadOrderBookSnapshot)) return;
 
-                    const auto* snap = reinterpret_cast<const PayloadOrderBookSnapshot*>(buf->data());
+                    const auto* snap = reinterpret_cast<const PayloadOrderBookSnapshot*>(payload);
 
                     shadow_order_book_.on_order_book_snapshot(snap);
+                    state_.on_book_rebuilt(shadow_order_book_);
                     return;
                 }
                 default:
@@ -238,9 +319,13 @@ class MarketSimulator {
         }
 
 
-        void generate_insert() {
+        void generate_insert(size_t agent_idx) {
+            Lane& lane = *lanes_[agent_idx % lanes_.size()];
+            if (lane.outbound_paused) return;
+
+            Agent& agent = roster_[agent_idx];
             Id_t request_id = request_id_++;
-            InsertDecision insert = dynamics_.decide_insert(state_, order_manager_.cumulative_hazard(), rng_.get());
+            InsertDecision insert = dynamics_.decide_insert(state_, lane.orders->cumulative_hazard(), &agent.rng, agent.type);
             PayloadInsertOrder payload = make_insert_order(
                 request_id,
                 insert.side,
@@ -248,12 +333,13 @@ class MarketSimulator {
                 insert.quantity,
                 insert.lifespan
             );
-            order_manager_.register_pending_insert(request_id, insert.cancellation_hazard_mass);
-            connection_.send_message(
+            lane.orders->register_pending_insert(request_id, insert.cancellation_hazard_mass);
+            lane.pending.emplace_back(request_id, static_cast<uint32_t>(agent_idx));
+            lane.session->send_message(
                 static_cast<Message_t>(MessageType::INSERT_ORDER),
                 &payload
             );
-            // inserts_sent_ += 1;
+            ++agent.inserts;
         }
 
 
@@ -264,30 +350,21 @@ class MarketSimulator {
         std::chrono::duration<double> tick_{0.001};
         std::chrono::steady_clock::time_point last_tick_{};
 
-        std::unique_ptr<RNG> rng_;
-        std::unique_ptr<InboundQueue> inbound_;
-        std::unique_ptr<OutboundQueue> outbound_;
-
-        Connection connection_;
+        PCGRNG rng_; // arrivals and agent picks; agents draw from their own streams
+        AgentRoster roster_;
+        std::vector<std::unique_ptr<Lane>> lanes_;
 
         double lambda_insert_{LAMBDA_INSERT_BASE};
         double lambda_cancel_{LAMBDA_CANCEL_BASE};
 
         std::atomic<bool> running_{false};
-        std::atomic<bool> inbound_drain_scheduled_{false};
-        std::atomic<Id_t> request_id_{0};
-        bool outbound_paused_{false};
+        std::atomic<bool> shutdown_notified_{false};
 
         ShadowOrderBook shadow_order_book_;
         MarketDynamics<N> dynamics_;
         SimulationState<N> state_;
-        OrderManager order_manager_;
-
-        // // metrics
-        // boost::asio::steady_timer metrics_timer_;
-        // std::uint64_t tick_count_{0};
-        // std::uint64_t handler_ns_accum_{0};
-        // std::uint64_t inserts_sent_{0};
-        // std::uint64_t inbound_msgs_processed_{0};
-        // std::uint64_t inbound_backlog_max_{0};
+        std::atomic<Id_t> request_id_;
+        std::function<void(Session*)> on_shutdown_;
+
+        std::unordered_map<Id_t, uint32_t> order_agent_; // resting order -> agent
 };
@@ -1,4 +1,5 @@
 #pragma once
+#include <algorithm>
 #include "shadow_order_book.hpp"
 #include "pcg32.hpp"
 
@@ -6,6 +7,10 @@ enum class LatentModel {GBM, OU};
 
 inline constexpr LatentModel latent_model = LatentModel::GBM;
 
+// PCG stream of the latent fair-value process. Arrivals draw from stream 0
+// and agent i from stream i + 1, so it sits at the other end of the range.
+inline constexpr uint64_t LATENT_STREAM = ~0ull - 1;
+
 struct TimeState {
     double sim_time;
     double time_since_event;
@@ -107,14 +112,163 @@ inline WeightedMoments compute_weighted_moments(
 }
 
 
+// Weight and distance power sums (w, w*d, w*d^2, w*d^3) of one book side
+// per liquidity bucket, bucket i holding the levels within bounds[i] ticks
+// of the touch. Kept in step with level updates rather than rebuilt from the
+// whole book every tick.
+//
+// Sums are exact integers. When the touch moves by delta ticks every
+// tracked distance moves by delta, so the sums are shifted binomially and
+// only the levels crossing a bucket bound (at most |delta| per bucket) are
+// looked up and added or removed.
+template<size_t N>
+class LiquidityBucketSide {
+    public:
+        struct Sums {
+            int64_t w = 0;
+            int64_t x = 0;
+            int64_t x2 = 0;
+            int64_t x3 = 0;
+        };
+
+        explicit LiquidityBucketSide(const std::array<Price_t, N>& bounds)
+        : bounds_(bounds)
+        , max_bound_(*std::max_element(bounds.begin(), bounds.end())) {}
+
+        const std::array<Sums, N>& sums() const { return sums_; }
+
+        // Recomputes from the side, walking out from the touch.
+        void rebuild(const ClientBookSide& side) {
+            sums_.fill(Sums{});
+            ref_ = side.best_price();
+            if (!ref_) return;
+            side.for_each_level([&](Price_t price, Volume_t volume) {
+                const Price_t d = distance_(*ref_, price, side.is_bid());
+                if (d > max_bound_) return false;
+                add_(d, static_cast<int64_t>(volume));
+                return true;
+            });
+        }
+
+        // The level at price went from old_volume to what the side now holds.
+        void on_level_update(const ClientBookSide& side, Price_t price, Volume_t old_volume) {
+            const auto best = side.best_price();
+            if (!best) {
+                sums_.fill(Sums{});
+                ref_.reset();
+                return;
+            }
+            if (!ref_) {
+                rebuild(side);
+                return;
+            }
+
+            // The change itself, at its distance from the old touch. A level
+            // better than the old touch is picked up by the shift below.
+            const Price_t d = distance_(*ref_, price, side.is_bid());
+            if (d >= 0) add_(d, static_cast<int64_t>(side.volume_at(price)) - static_cast<int64_t>(old_volume));
+
+            if (*best == *ref_) return;
+            // New distance = old distance + delta.
+            const Price_t delta = distance_(*best, *ref_, side.is_bid());
+            if (delta > max_bound_ || -delta > max_bound_) {
+                rebuild(side);
+                return;
+            }
+            shift_(delta);
+            ref_ = best;
+
+            for (size_t i = 0; i < N; ++i) {
+                const Price_t bound = bounds_[i];
+                if (delta > 0) {
+                    // Pushed past the bound.
+                    for (Price_t nd = std::max(delta, bound + 1); nd <= bound + delta; ++nd) {
+                        add_one_(i, nd, -static_cast<int64_t>(level_volume_(side, nd)));
+                    }
+                    // Levels better than the old touch, now within reach.
+                    for (Price_t nd = 0; nd < delta && nd <= bound; ++nd) {
+                        add_one_(i, nd, static_cast<int64_t>(level_volume_(side, nd)));
+                    }
+                } else {
+                    // Pulled inside the bound. Levels between the old and new
+                    // touch are empty, so nothing leaves.
+                    for (Price_t nd = std::max<Price_t>(0, bound + delta + 1); nd <= bound; ++nd) {
+                        add_one_(i, nd, static_cast<int64_t>(level_volume_(side, nd)));
+                    }
+                }
+            }
+        }
+
+    private:
+        static inline Price_t distance_(Price_t ref, Price_t price, bool is_bid) {
+            return is_bid ? ref - price : price - ref;
+        }
+
+        inline Volume_t level_volume_(const ClientBookSide& side, Price_t distance) const {
+            return side.volume_at(side.is_bid() ? *ref_ - distance : *ref_ + distance);
+        }
+
+        inline void add_one_(size_t i, Price_t d, int64_t w) {
+            if (w == 0) return;
+            Sums& s = sums_[i];
+            s.w += w;
+            s.x += w * d;
+            s.x2 += w * d * d;
+            s.x3 += w * d * d * d;
+        }
+
+        inline void add_(Price_t d, int64_t w) {
+            for (size_t i = 0; i < N; ++i) {
+                if (d <= bounds_[i]) add_one_(i, d, w);
+            }
+        }
+
+        // Every tracked distance d becomes d + delta.
+        inline void shift_(int64_t delta) {
+            for (Sums& s : sums_) {
+                const int64_t x = s.x;
+                const int64_t x2 = s.x2;
+                s.x3 += 3 * delta * x2 + 3 * delta * delta * x + delta * delta * delta * s.w;
+                s.x2 += 2 * delta * x + delta * delta * s.w;
+                s.x += delta * s.w;
+            }
+        }
+
+        std::array<Price_t, N> bounds_;
+        Price_t max_bound_;
+        std::optional<Price_t> ref_; // touch the distances are measured from
+        std::array<Sums, N> sums_{};
+};
+
 template<size_t N>
 class SimulationState {
     public:
-        SimulationState(const std::array<Price_t, N>& liquidity_bucket_bounds)
-        : rng_(0, 0) {
+        // seed and stream drive the latent fair-value process.
+        SimulationState(const std::array<Price_t, N>& liquidity_bucket_bounds, uint64_t seed, uint64_t stream)
+        : rng_(seed, stream)
+        , bid_buckets_(liquidity_bucket_bounds)
+        , ask_buckets_(liquidity_bucket_bounds) {
             liq_state_.bucket_bounds = liquidity_bucket_bounds;
         }
 
+        // Feed every book change through here, after applying it to the
+        // book: the liquidity buckets follow the deltas.
+        void on_level_update(const ShadowOrderBook& order_book, Side side, Price_t price, Volume_t old_volume) {
+            if (side == Side::BUY) {
+                bid_buckets_.on_level_update(order_book.bids, price, old_volume);
+            } else {
+                ask_buckets_.on_level_update(order_book.asks, price, old_volume);
+            }
+            liq_dirty_ = true;
+        }
+
+        // After the book was replaced wholesale (snapshot).
+        void on_book_rebuilt(const ShadowOrderBook& order_book) {
+            bid_buckets_.rebuild(order_book.bids);
+            ask_buckets_.rebuild(order_book.asks);
+            liq_dirty_ = true;
+        }
+
         void sync_with_book(const ShadowOrderBook& order_book, double dt) {
             update_price_state(order_book);
             update_liq_state(order_book);
@@ -163,70 +317,26 @@ class SimulationState {
         }
 
         inline void update_liq_state(const ShadowOrderBook& order_book) {
-            const auto best_bid = order_book.best_bid_price();
-            const auto best_ask = order_book.best_ask_price();
-
-            liq_state_.has_bid_side = best_bid.has_value();
-            liq_state_.has_ask_side = best_ask.has_value();
+            liq_state_.has_bid_side = !order_book.bids.empty();
+            liq_state_.has_ask_side = !order_book.asks.empty();
 
-            liq_state_.bid_volumes.fill(0);
-            liq_state_.ask_volumes.fill(0);
-
-            bid_w_.fill(0);
-            bid_x_.fill(0);
-            bid_x2_.fill(0);
-            bid_x3_.fill(0);
-
-            ask_w_.fill(0);
-            ask_x_.fill(0);
-            ask_x2_.fill(0);
-            ask_x3_.fill(0);
-
-
-            if (best_bid) {
-                for (const auto& [price, volume] : order_book.bids()) {
-                    const double dist = static_cast<double>(*best_bid - price);
-                    if (dist < 0.0) continue;
-
-                    for (size_t i = 0; i < N; ++i) {
-                        if (dist <= liq_state_.bucket_bounds[i]) {
-                            liq_state_.bid_volumes[i] += volume;
-
-                            const double w = static_cast<double>(volume);
-                            bid_w_[i]  += w;
-                            bid_x_[i]  += w * dist;
-                            bid_x2_[i] += w * dist * dist;
-                            bid_x3_[i] += w * dist * dist * dist;
-                        }
-                    }
-                }
-            }
-
-            if (best_ask) {
-                for (const auto& [price, volume] : order_book.asks()) {
-                    const double dist = static_cast<double>(price - *best_ask);
-                    if (dist < 0.0) continue;
-
-                    for (size_t i = 0; i < N; ++i) {
-                        if (dist <= liq_state_.bucket_bounds[i]) {
-                            liq_state_.ask_volumes[i] += volume;
-
-                            const double w = static_cast<double>(volume);
-                            ask_w_[i]  += w;
-                            ask_x_[i]  += w * dist;
-                            ask_x2_[i] += w * dist * dist;
-                            ask_x3_[i] += w * dist * dist * dist;
-                        }
-                    }
-                }
-            }
-            
+            // Buckets only change with the book; skip the moments otherwise.
+            if (!liq_dirty_) return;
+            liq_dirty_ = false;
 
             constexpr double eps = 1e-9;
 
+            const auto& bid_sums = bid_buckets_.sums();
+            const auto& ask_sums = ask_buckets_.sums();
+
             for (size_t i = 0; i < N; ++i) {
-                auto bid_m = compute_weighted_moments(bid_w_[i], bid_x_[i], bid_x2_[i], bid_x3_[i]);
-                auto ask_m = compute_weighted_moments(ask_w_[i], ask_x_[i], ask_x2_[i], ask_x3_[i]);
+                const auto& b = bid_sums[i];
+                const auto& a = ask_sums[i];
+                auto bid_m = compute_weighted_moments(static_cast<double>(b.w), static_cast<double>(b.x), static_cast<double>(b.x2), static_cast<double>(b.x3));
+                auto ask_m = compute_weighted_moments(static_cast<double>(a.w), static_cast<double>(a.x), static_cast<double>(a.x2), static_cast<double>(a.x3));
+
+                liq_state_.bid_volumes[i] = static_cast<Volume_t>(b.w);
+                liq_state_.ask_volumes[i] = static_cast<Volume_t>(a.w);
 
                 liq_state_.bid_mean_distances[i] = bid_m.mean;
                 liq_state_.bid_variances[i] = bid_m.variance;
@@ -373,9 +483,9 @@ class SimulationState {
         }
 
 
-        TimeState time_state_;
-        PriceState price_state_;
-        LiquidityState<N> liq_state_;
+        TimeState time_state_{};
+        PriceState price_state_{};
+        LiquidityState<N> liq_state_{};
         VolatilityState vol_state_;
         FlowState flow_state_;
         LatentState latent_state_;
@@ -386,8 +496,9 @@ class SimulationState {
         Price_t last_trade_price_ = 0;
         Time_t last_trade_timestamp_ = 0;
 
-        std::array<double, N> bid_w_{}, bid_x_{}, bid_x2_{}, bid_x3_{};
-        std::array<double, N> ask_w_{}, ask_x_{}, ask_x2_{}, ask_x3_{};
+        LiquidityBucketSide<N> bid_buckets_;
+        LiquidityBucketSide<N> ask_buckets_;
+        bool liq_dirty_ = true;
 
         // Decay time in seconds
         static constexpr double TAU_SHORT = 1.0;
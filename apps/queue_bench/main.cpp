@@ -0,0 +1,294 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "broadcast_ring.hpp"
+#include "mpmc_queue.hpp"
+#include "mpsc_queue.hpp"
+#include "spsc_queue.hpp"
+
+// ------------------------------------------------------------
+// Queue benchmark
+// ------------------------------------------------------------
+//
+// Usage: QueueBench [ops_per_producer] [max_threads]
+//
+// - Throughput: producers push (producer, seq) items as fast as they can;
+//   consumers verify per-producer FIFO order (SPSC / MPSC), the total sum
+//   (MPMC) or gap-free sequences (broadcast, counting overruns separately).
+// - Latency: two threads ping-pong a timestamp over a pair of queues; the
+//   one-way figure is half the round trip.
+// - Waits spin briefly, then yield, so oversubscribed machines still finish;
+//   absolute numbers are only meaningful with a core per thread.
+//
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t CAPACITY = 1 << 14;
+constexpr size_t LATENCY_ROUNDS = 100'000;
+
+struct Item {
+    uint64_t producer;
+    uint64_t seq;
+};
+
+struct Backoff {
+    unsigned spins = 0;
+    void pause() noexcept {
+        if (++spins > 64) {
+            std::this_thread::yield();
+            spins = 0;
+        }
+    }
+    void reset() noexcept { spins = 0; }
+};
+
+void report(const std::string& name, size_t producers, size_t consumers, uint64_t ops, double seconds, bool ok,
+            const std::string& extra = {}) {
+    std::cout << std::left << std::setw(10) << name
+              << " P=" << producers << " C=" << consumers
+              << "  ops=" << ops
+              << "  " << std::fixed << std::setprecision(1) << (static_cast<double>(ops) / seconds / 1e6) << " Mops/s"
+              << (ok ? "  ok" : "  FAILED")
+              << extra << '\n';
+}
+
+// Single consumer: checks each producer's items arrive in order.
+template <typename Queue>
+bool run_single_consumer(const std::string& name, size_t producers, uint64_t ops_per_producer) {
+    auto q = std::make_unique<Queue>();
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            while (!go.load(std::memory_order_acquire)) {}
+            Backoff backoff;
+            for (uint64_t i = 0; i < ops_per_producer; ++i) {
+                while (!q->try_push(Item{p, i})) backoff.pause();
+                backoff.reset();
+            }
+        });
+    }
+
+    std::vector<uint64_t> next(producers, 0);
+    bool ok = true;
+    const uint64_t total = producers * ops_per_producer;
+
+    const auto start = Clock::now();
+    go.store(true, std::memory_order_release);
+    Backoff backoff;
+    for (uint64_t received = 0; received < total;) {
+        Item item;
+        if (!q->try_pop(item)) {
+            backoff.pause();
+            continue;
+        }
+        backoff.reset();
+        ok &= item.producer < producers && item.seq == next[item.producer]++;
+        ++received;
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (auto& t : threads) t.join();
+
+    report(name, producers, 1, total, seconds, ok);
+    return ok;
+}
+
+bool run_mpmc(size_t producers, size_t consumers, uint64_t ops_per_producer) {
+    auto q = std::make_unique<MPMCQueue<Item, CAPACITY>>();
+    std::atomic<bool> go{false};
+    std::atomic<uint64_t> remaining{producers * ops_per_producer};
+    std::atomic<uint64_t> sum{0};
+    std::vector<std::thread> threads;
+
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            while (!go.load(std::memory_order_acquire)) {}
+            Backoff backoff;
+            for (uint64_t i = 0; i < ops_per_producer; ++i) {
+                while (!q->try_push(Item{p, i})) backoff.pause();
+                backoff.reset();
+            }
+        });
+    }
+    for (size_t c = 0; c < consumers; ++c) {
+        threads.emplace_back([&] {
+            while (!go.load(std::memory_order_acquire)) {}
+            Backoff backoff;
+            uint64_t local = 0;
+            while (remaining.load(std::memory_order_relaxed) > 0) {
+                Item item;
+                if (!q->try_pop(item)) {
+                    backoff.pause();
+                    continue;
+                }
+                backoff.reset();
+                local += item.seq;
+                remaining.fetch_sub(1, std::memory_order_relaxed);
+            }
+            sum.fetch_add(local, std::memory_order_relaxed);
+        });
+    }
+
+    const auto start = Clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& t : threads) t.join();
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    const uint64_t expected = producers * (ops_per_producer * (ops_per_producer - 1) / 2);
+    const bool ok = sum.load() == expected;
+    report("mpmc", producers, consumers, producers * ops_per_producer, seconds, ok);
+    return ok;
+}
+
+bool run_broadcast(size_t readers, uint64_t ops) {
+    auto ring = std::make_unique<BroadcastRing<Item, CAPACITY>>();
+    using Ring = BroadcastRing<Item, CAPACITY>;
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> ok{true};
+    std::atomic<uint64_t> overruns{0};
+    std::vector<std::thread> threads;
+
+    for (size_t r = 0; r < readers; ++r) {
+        threads.emplace_back([&] {
+            Ring::Cursor cursor = ring->subscribe();
+            ready.fetch_add(1, std::memory_order_acq_rel);
+            Backoff backoff;
+            uint64_t expect = 0;
+            while (expect < ops) {
+                Item item;
+                switch (ring->try_read(cursor, item)) {
+                    case Ring::ReadResult::OK:
+                        backoff.reset();
+                        if (item.seq != expect) ok.store(false);
+                        expect = item.seq + 1;
+                        break;
+                    case Ring::ReadResult::OVERRUN:
+                        expect = cursor.next;
+                        break;
+                    case Ring::ReadResult::EMPTY:
+                        backoff.pause();
+                        break;
+                }
+            }
+            overruns.fetch_add(cursor.overruns, std::memory_order_relaxed);
+        });
+    }
+    while (ready.load(std::memory_order_acquire) < readers) std::this_thread::yield();
+
+    const auto start = Clock::now();
+    for (uint64_t i = 0; i < ops; ++i) {
+        ring->publish(Item{0, i});
+    }
+    for (auto& t : threads) t.join();
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    report("broadcast", 1, readers, ops, seconds, ok.load(),
+           "  overrun_items=" + std::to_string(overruns.load()));
+    return ok.load();
+}
+
+// Ping-pong over two queues; returns sorted one-way latencies in ns.
+template <typename PushPing, typename PopPing, typename PushPong, typename PopPong>
+std::vector<double> ping_pong(PushPing push_ping, PopPing pop_ping, PushPong push_pong, PopPong pop_pong) {
+    std::vector<double> one_way;
+    one_way.reserve(LATENCY_ROUNDS);
+
+    std::thread echo([&] {
+        Backoff backoff;
+        for (size_t i = 0; i < LATENCY_ROUNDS; ++i) {
+            Item item;
+            while (!pop_ping(item)) backoff.pause();
+            backoff.reset();
+            while (!push_pong(item)) backoff.pause();
+        }
+    });
+
+    Backoff backoff;
+    for (size_t i = 0; i < LATENCY_ROUNDS; ++i) {
+        const auto t0 = Clock::now();
+        while (!push_ping(Item{0, i})) backoff.pause();
+        Item item;
+        while (!pop_pong(item)) backoff.pause();
+        backoff.reset();
+        one_way.push_back(std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / 2.0);
+    }
+    echo.join();
+
+    std::sort(one_way.begin(), one_way.end());
+    return one_way;
+}
+
+void report_latency(const std::string& name, const std::vector<double>& sorted_ns) {
+    auto pct = [&](double p) { return sorted_ns[static_cast<size_t>(p * (sorted_ns.size() - 1))]; };
+    std::cout << std::left << std::setw(10) << name
+              << " one-way ns  p50=" << std::fixed << std::setprecision(0) << pct(0.50)
+              << " p99=" << pct(0.99)
+              << " p99.9=" << pct(0.999) << '\n';
+}
+
+template <typename Queue>
+void run_latency(const std::string& name) {
+    auto ping = std::make_unique<Queue>();
+    auto pong = std::make_unique<Queue>();
+    auto push_ping = [&](const Item& i) { return ping->try_push(i); };
+    auto push_pong = [&](const Item& i) { return pong->try_push(i); };
+    auto pop_ping = [&](Item& i) { return ping->try_pop(i); };
+    auto pop_pong = [&](Item& i) { return pong->try_pop(i); };
+    report_latency(name, ping_pong(push_ping, pop_ping, push_pong, pop_pong));
+}
+
+void run_broadcast_latency() {
+    using Ring = BroadcastRing<Item, CAPACITY>;
+    auto ping = std::make_unique<Ring>();
+    auto pong = std::make_unique<Ring>();
+    Ring::Cursor ping_cursor = ping->subscribe();
+    Ring::Cursor pong_cursor = pong->subscribe();
+    auto publish = [](Ring& ring) { return [&ring](const Item& i) { ring.publish(i); return true; }; };
+    auto read = [](Ring& ring, Ring::Cursor& c) {
+        return [&ring, &c](Item& i) { return ring.try_read(c, i) == Ring::ReadResult::OK; };
+    };
+    report_latency("broadcast", ping_pong(publish(*ping), read(*ping, ping_cursor), publish(*pong), read(*pong, pong_cursor)));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const uint64_t ops = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2'000'000;
+    const size_t hw = std::max<size_t>(2, std::thread::hardware_concurrency());
+    const size_t max_threads = argc > 2 ? std::max<size_t>(2, std::strtoul(argv[2], nullptr, 10)) : hw;
+
+    std::cout << "ops_per_producer=" << ops << " max_threads=" << max_threads
+              << " hardware_threads=" << std::thread::hardware_concurrency() << "\n\n";
+
+    bool ok = true;
+    std::cout << "# throughput\n";
+    ok &= run_single_consumer<SPSCQueue<Item, CAPACITY>>("spsc", 1, ops);
+    for (size_t p = 1; p < max_threads; p *= 2) {
+        ok &= run_single_consumer<MPSCQueue<Item, CAPACITY>>("mpsc", p, ops);
+    }
+    for (size_t n = 1; 2 * n <= max_threads; n *= 2) {
+        ok &= run_mpmc(n, n, ops);
+    }
+    for (size_t r = 1; r < max_threads; r *= 2) {
+        ok &= run_broadcast(r, ops);
+    }
+
+    std::cout << "\n# latency (" << LATENCY_ROUNDS << " round trips)\n";
+    run_latency<SPSCQueue<Item, CAPACITY>>("spsc");
+    run_latency<MPSCQueue<Item, CAPACITY>>("mpsc");
+    run_latency<MPMCQueue<Item, CAPACITY>>("mpmc");
+    run_broadcast_latency();
+
+    return ok ? 0 : 1;
+}
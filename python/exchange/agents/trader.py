@@ -27,11 +27,22 @@ def _recv_exact(sock: socket.socket, n: int):
         data += chunk
     return data
 
+def _connect(host: str, port: int) -> socket.socket:
+    """Connects over TCP, or to a Unix domain socket when host is "unix:<path>"."""
+    if host.startswith("unix:"):
+        sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        sock.connect(host[len("unix:"):])
+        return sock
+    sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    # Small order messages must not wait behind Nagle / delayed acks.
+    sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    sock.connect((host, port))
+    return sock
+
 class Trader(abc.ABC):
-    def __init__(self, name: str, host: str, port: int):
+    def __init__(self, name: str, host: str, port: int = 0):
         self.name = name
-        self.sock: socket.socket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
-        self.sock.connect((host, port))
+        self.sock: socket.socket = _connect(host, port)
         self.next_request_id = 1
         self.running = True
 
@@ -47,6 +58,7 @@ class Trader(abc.ABC):
         self._asks: dict[int, int] = dict()
         self._open_orders: dict[int, Order] = dict()
         self._partial_fill_buffer: list[dict] = []
+        self._depth_reports: dict[int, dict] = dict()
 
         self._verbose: bool = False
 
@@ -87,6 +99,8 @@ class Trader(abc.ABC):
                 self._on_confirm_order_cancelled(fields)
             case MessageType.CONFIRM_ORDER_AMENDED:
                 self._on_confirm_order_amended(fields)
+            case MessageType.DEPTH_REPORT:
+                self._on_depth_report(fields)
             case MessageType.ERROR_MSG:
                 self._on_error_message(fields)
 
@@ -175,6 +189,17 @@ class Trader(abc.ABC):
             print(f"[{self.name}] Processed confirm order amended.")
         return
 
+    def _on_depth_report(self, fields: dict):
+        with self.lock:
+            self._depth_reports[fields["client_request_id"]] = fields
+        if self._verbose:
+            print(f"[{self.name}] Processed depth report.")
+        return
+
+    def get_depth_report(self, request_id: int) -> dict | None:
+        with self.lock:
+            return self._depth_reports.get(request_id)
+
     def insert_order(self, price: int, quantity: int, side: Side):
         self._send(MessageType.INSERT_ORDER, self.next_request_id, side, price, quantity, Lifespan.GOOD_FOR_DAY)
         if self._verbose:
@@ -193,6 +218,15 @@ class Trader(abc.ABC):
             print(f"[{self.name}] Sent order amendment request.")
         self.next_request_id += 1
 
+    def query_depth(self, side: Side, ticks: int, quantity: int) -> int:
+        """Asks for the depth of the resting side (BUY: bids). Returns the request id to look the report up by."""
+        request_id = self.next_request_id
+        self._send(MessageType.DEPTH_QUERY, request_id, side, ticks, quantity)
+        if self._verbose:
+            print(f"[{self.name}] Sent depth query.")
+        self.next_request_id += 1
+        return request_id
+
     def subscribe(self):
         self._send(MessageType.SUBSCRIBE, self.next_request_id)
         self.next_request_id += 1
@@ -1,11 +1,38 @@
-from exchange.agents.trader import Trader
-from exchange.util import Side
+from exchange.agents.trader import Trader, _recv_exact
+from exchange.util import Side, MessageType, HEADER_STRUCT, Lifespan, get_codec
 import time
 import subprocess
 import os
+import socket
+import struct
+import tempfile
 import tqdm
 import threading
 
+# marker u8, body_size u16, count u8, base_sequence u64, base_timestamp u64 (protocol_v2.hpp)
+V2_PACKET_HEADER = struct.Struct("<BHBQQ")
+V2_PACKET_MARKER = 0xB2
+# Leading fields of V2ConfirmOrderInserted, up to its int32 price offset.
+V2_CONFIRM_INSERTED_PREFIX = struct.Struct("<IIBi")
+
+
+def _stop_exchange(proc: subprocess.Popen):
+    proc.terminate()
+    try:
+        proc.wait(timeout=1.0)
+    except subprocess.TimeoutExpired:
+        proc.kill()
+        proc.wait()
+
+
+def _wait_for(condition, timeout: float = 1.0) -> bool:
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        if condition():
+            return True
+        time.sleep(0.005)
+    return condition()
+
 def test_cancel_vs_match(iters: int = 1000):
     port_base = 15000
     exchange_path = os.path.join("build", "FinancialExchange.exe")
@@ -17,7 +44,7 @@ def test_cancel_vs_match(iters: int = 1000):
         print("=" * 5 + f" {idx} " + "=" * 5)
         port = port_base + idx
         proc = subprocess.Popen(
-            [exchange_path, f"{port}", f"{n_exchange_threads}"],
+            [exchange_path, f"port={port}", f"threads={n_exchange_threads}"],
             stdout=subprocess.DEVNULL,
             stderr=subprocess.DEVNULL,
         )
@@ -105,7 +132,7 @@ def test_double_match(iters: int = 1000):
         print("=" * 5 + f" {idx} " + "=" * 5)
         port = port_base + idx
         proc = subprocess.Popen(
-            [exchange_path, f"{port}", f"{n_exchange_threads}"],
+            [exchange_path, f"port={port}", f"threads={n_exchange_threads}"],
             stdout=subprocess.DEVNULL,
             stderr=subprocess.DEVNULL,
         )
@@ -187,7 +214,7 @@ def test_amend_vs_match(iters: int = 1000):
         print("=" * 5 + f" {idx} " + "=" * 5)
         port = port_base + idx
         proc = subprocess.Popen(
-            [exchange_path, f"{port}", f"{n_exchange_threads}"],
+            [exchange_path, f"port={port}", f"threads={n_exchange_threads}"],
             stdout=subprocess.DEVNULL,
             stderr=subprocess.DEVNULL,
         )
@@ -255,12 +282,186 @@ def test_amend_vs_match(iters: int = 1000):
     print("Amend vs. match test passed.")
 
 
+
+def test_unix_socket_round_trip(port: int = 15500):
+    exchange_path = os.path.join("build", "FinancialExchange.exe")
+    socket_dir = tempfile.mkdtemp()
+    socket_path = os.path.join(socket_dir, "exchange.sock")
+
+    # Something other than a socket at the path must stop startup, untouched.
+    with open(socket_path, "w") as f:
+        f.write("not a socket")
+    proc = subprocess.Popen(
+        [exchange_path, f"port={port}", f"unix={socket_path}"],
+        stdout=subprocess.DEVNULL,
+        stderr=subprocess.DEVNULL,
+    )
+    assert proc.wait(timeout=5.0) != 0, "Exchange replaced a regular file at the Unix socket path."
+    with open(socket_path) as f:
+        assert f.read() == "not a socket"
+    os.remove(socket_path)
+
+    # A socket left behind by an earlier run is replaced.
+    stale = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    stale.bind(socket_path)
+    stale.close()
+
+    proc = subprocess.Popen(
+        [exchange_path, f"port={port}", f"unix={socket_path}"],
+        stdout=subprocess.DEVNULL,
+        stderr=subprocess.DEVNULL,
+    )
+    time.sleep(0.1)
+    try:
+        # A second exchange must not take over the live socket: it exits, and
+        # the file stays the one the first exchange listens on.
+        inode = os.stat(socket_path).st_ino
+        second = subprocess.Popen(
+            [exchange_path, f"port={port + 1}", f"unix={socket_path}"],
+            stdout=subprocess.DEVNULL,
+            stderr=subprocess.DEVNULL,
+        )
+        try:
+            assert second.wait(timeout=5.0) != 0, "Second exchange started on a live Unix socket."
+        except subprocess.TimeoutExpired:
+            _stop_exchange(second)
+            raise AssertionError("Second exchange took over a live Unix socket.")
+        assert os.stat(socket_path).st_ino == inode, "Live Unix socket file was replaced."
+
+        # A Unix domain maker and a TCP taker trade on the same book.
+        trader_maker = Trader("TRADER1", f"unix:{socket_path}")
+        trader_taker = Trader("TRADER2", "127.0.0.1", port)
+
+        trader_maker.insert_order(100, 10, Side.SELL)
+        assert _wait_for(lambda: len(trader_maker.get_open_orders()) == 1), "No insert confirmation over the Unix socket."
+        order = next(iter(trader_maker.get_open_orders().values()))
+        assert order.quantity_remaining == 10
+
+        trader_taker.insert_order(100, 10, Side.BUY)
+        assert _wait_for(lambda: len(trader_maker.get_open_orders()) == 0), "No fill over the Unix socket."
+        assert len(trader_taker.get_open_orders()) == 0
+    finally:
+        _stop_exchange(proc)
+    assert not os.path.exists(socket_path), "Socket file left behind on shutdown."
+    os.rmdir(socket_dir)
+    print("Unix socket round trip test passed.")
+
+
+def test_depth_query(port: int = 15501):
+    exchange_path = os.path.join("build", "FinancialExchange.exe")
+    proc = subprocess.Popen(
+        [exchange_path, f"port={port}", "threads=1"],
+        stdout=subprocess.DEVNULL,
+        stderr=subprocess.DEVNULL,
+    )
+    time.sleep(0.1)
+    try:
+        trader = Trader("TRADER1", "127.0.0.1", port)
+        for price, qty in ((100, 10), (101, 20), (105, 5)):
+            trader.insert_order(price, qty, Side.SELL)
+        assert _wait_for(lambda: len(trader.get_open_orders()) == 3)
+
+        def query(side: Side, ticks: int, quantity: int) -> dict:
+            request_id = trader.query_depth(side, ticks, quantity)
+            assert _wait_for(lambda: trader.get_depth_report(request_id) is not None), "No depth report."
+            return trader.get_depth_report(request_id)
+
+        # Partial sweep: all of 100 and 15 of 101.
+        report = query(Side.SELL, 1, 25)
+        assert report["side"] == Side.SELL
+        assert report["best_price"] == 100
+        assert report["depth_volume"] == 30
+        assert report["total_volume"] == 35
+        assert report["sweep_filled"] == 25
+        assert report["sweep_price"] == 101
+        assert report["sweep_notional"] == 100 * 10 + 101 * 15
+
+        # The side runs out before the quantity does.
+        report = query(Side.SELL, 10, 50)
+        assert report["depth_volume"] == 35
+        assert report["sweep_filled"] == 35
+        assert report["sweep_price"] == 105
+        assert report["sweep_notional"] == 100 * 10 + 101 * 20 + 105 * 5
+
+        # Nothing rests on the bid side.
+        report = query(Side.BUY, 10, 50)
+        assert report["best_price"] == 0
+        assert report["total_volume"] == 0
+        assert report["sweep_filled"] == 0
+        assert report["sweep_price"] == 0
+
+        # Queries are read-only.
+        assert len(trader.get_open_orders()) == 3
+    finally:
+        _stop_exchange(proc)
+    print("Depth query test passed.")
+
+
+def _connect_with_version(port: int, version: int) -> tuple[socket.socket, dict]:
+    codec = get_codec()
+    sock = socket.create_connection(("127.0.0.1", port))
+    sock.settimeout(2.0)
+    sock.sendall(codec.encode(MessageType.CONNECT, 1, version))
+    # CONFIRM_CONNECTED itself is always a v1 frame.
+    message_type, size = HEADER_STRUCT.unpack(_recv_exact(sock, HEADER_STRUCT.size))
+    assert message_type == MessageType.CONFIRM_CONNECTED
+    return sock, codec.decode_from_header(message_type, size, _recv_exact(sock, size))["payload"]
+
+
+def test_protocol_negotiation(port: int = 15502):
+    exchange_path = os.path.join("build", "FinancialExchange.exe")
+    proc = subprocess.Popen(
+        [exchange_path, f"port={port}", "threads=1"],
+        stdout=subprocess.DEVNULL,
+        stderr=subprocess.DEVNULL,
+    )
+    time.sleep(0.1)
+    codec = get_codec()
+    try:
+        # Asking for v2 gets v2; everything after the confirmation is v2 packets.
+        sock, confirm = _connect_with_version(port, 2)
+        assert confirm["client_request_id"] == 1
+        assert confirm["protocol_version"] == 2
+        assert confirm["price_base"] == 1  # MINIMUM_BID
+        sock.sendall(codec.encode(MessageType.INSERT_ORDER, 2, Side.SELL, 100, 10, Lifespan.GOOD_FOR_DAY))
+        marker, body_size, count, _, _ = V2_PACKET_HEADER.unpack(_recv_exact(sock, V2_PACKET_HEADER.size))
+        assert marker == V2_PACKET_MARKER
+        assert count >= 1
+        body = _recv_exact(sock, body_size)
+        assert body[0] == MessageType.CONFIRM_ORDER_INSERTED
+        # client_request_id u32, exchange_order_id u32, side u8, then the price as a tick offset.
+        _, _, _, price_offset = V2_CONFIRM_INSERTED_PREFIX.unpack_from(body, 2)
+        assert price_offset == 100 - confirm["price_base"]
+        sock.close()
+
+        # A newer client is answered with the highest version the exchange speaks.
+        sock, confirm = _connect_with_version(port, 7)
+        assert confirm["protocol_version"] == 2
+        sock.close()
+
+        # A v1 client keeps v1 frames.
+        sock, confirm = _connect_with_version(port, 1)
+        assert confirm["protocol_version"] == 1
+        sock.sendall(codec.encode(MessageType.INSERT_ORDER, 2, Side.SELL, 101, 10, Lifespan.GOOD_FOR_DAY))
+        message_type, size = HEADER_STRUCT.unpack(_recv_exact(sock, HEADER_STRUCT.size))
+        assert message_type == MessageType.CONFIRM_ORDER_INSERTED
+        payload = codec.decode_from_header(message_type, size, _recv_exact(sock, size))["payload"]
+        assert payload["client_request_id"] == 2
+        sock.close()
+    finally:
+        _stop_exchange(proc)
+    print("Protocol negotiation test passed.")
+
+
 def main():
     # test_cancel_vs_match(iters=10)
     # time.sleep(1.0)
     # test_double_match(iters=10)
     # time.sleep(1.0)
     test_amend_vs_match(iters=10)
+    test_unix_socket_round_trip()
+    test_depth_query()
+    test_protocol_negotiation()
 
 
 if __name__ == "__main__":
@@ -21,6 +21,7 @@ class MessageType(IntEnum):
     SUBSCRIBE = 6
     UNSUBSCRIBE = 7
     ORDER_STATUS_REQUEST = 8
+    DEPTH_QUERY = 9
 
     CONFIRM_CONNECTED = 11
     CONFIRM_ORDER_INSERTED = 12
@@ -29,6 +30,7 @@ class MessageType(IntEnum):
     PARTIAL_FILL_ORDER = 15
     ORDER_STATUS = 16
     ERROR_MSG = 17
+    DEPTH_REPORT = 18
 
     ORDER_BOOK_SNAPSHOT = 21
     TRADE_TICKS = 22
@@ -76,6 +78,7 @@ class PayloadSchema:
 # ----------------------------
 
 MESSAGE_TO_PAYLOAD = {
+    "CONNECT": "PayloadConnect",
     "DISCONNECT": "PayloadDisconnect",
     "INSERT_ORDER": "PayloadInsertOrder",
     "CANCEL_ORDER": "PayloadCancelOrder",
@@ -83,13 +86,16 @@ MESSAGE_TO_PAYLOAD = {
     "SUBSCRIBE": "PayloadSubscribe",
     "UNSUBSCRIBE": "PayloadUnsubscribe",
     "ORDER_STATUS_REQUEST": "PayloadOrderStatusRequest",
+    "DEPTH_QUERY": "PayloadDepthQuery",
 
+    "CONFIRM_CONNECTED": "PayloadConfirmConnected",
     "CONFIRM_ORDER_INSERTED": "PayloadConfirmOrderInserted",
     "CONFIRM_ORDER_CANCELLED": "PayloadConfirmOrderCancelled",
     "CONFIRM_ORDER_AMENDED": "PayloadConfirmOrderAmended",
     "PARTIAL_FILL_ORDER": "PayloadPartialFill",
     "ORDER_STATUS": "PayloadOrderStatus",
     "ERROR_MSG": "PayloadError",
+    "DEPTH_REPORT": "PayloadDepthReport",
 
     "ORDER_BOOK_SNAPSHOT": "PayloadOrderBookSnapshot",
     "TRADE_TICKS": "PayloadTradeTicks",
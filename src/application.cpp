@@ -1,14 +1,90 @@
 #include "application.hpp"
+#include <iomanip>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
 #include <stdio.h>
 
+#include "io_backend.hpp"
+#include "thread_affinity.hpp"
+
+namespace {
+
+ApplicationOptions default_options(uint16_t port, size_t num_threads) {
+    ApplicationOptions options;
+    options.port = port;
+    options.num_threads = num_threads;
+    return options;
+}
+
+// One "bid|ask price volume" line per level, best first.
+std::string format_book_depth(const Seqlock<BookDepth>& published) {
+    auto depth = std::make_unique<BookDepth>();
+    if (published.load(*depth) == 0) return "no book published yet\n";
+    std::ostringstream out;
+    for (uint32_t i = 0; i < depth->bid_levels; ++i) {
+        out << "bid " << depth->bid_prices[i] << ' ' << depth->bid_volumes[i] << '\n';
+    }
+    for (uint32_t i = 0; i < depth->ask_levels; ++i) {
+        out << "ask " << depth->ask_prices[i] << ' ' << depth->ask_volumes[i] << '\n';
+    }
+    return out.str();
+}
+
+} // namespace
+
 Application::Application(uint16_t port, size_t num_threads)
-    : io_context_(),
+    : Application(default_options(port, num_threads)) {}
+
+Application::Application(const ApplicationOptions& options)
+    : io_context_(options.io_model == IoModel::PER_CORE ? 1 : BOOST_ASIO_CONCURRENCY_HINT_DEFAULT),
     signals_(io_context_, SIGINT, SIGTERM),
-    port_(port) {
+    port_(options.port),
+    admin_port_(options.admin_port),
+    socket_profile_(options.socket_profile),
+    io_model_(options.io_model),
+    io_thread_mode_(options.io_thread_mode),
+    num_threads_(options.num_threads ? options.num_threads : 1),
+    shm_socket_path_(options.shm_socket_path),
+    unix_socket_path_(options.unix_socket_path),
+    warmup_(options.warmup) {
+        // Shared-model threads all run one io_context; spinning N of them on
+        // poll() would burn N CPUs contending for its one queue.
+        if (io_thread_mode_ == IoThreadMode::BUSY_POLL && io_model_ != IoModel::PER_CORE) {
+            throw std::invalid_argument("busy_poll requires the per_core IO model");
+        }
+        // Before the Exchange exists: its logger thread applies it on start.
+        set_thread_topology(options.thread_topology);
         work_guard_.emplace(io_context_.get_executor());
-        exchange_ = std::make_unique<Exchange>(io_context_, port);
-        threads_.reserve(num_threads);
+
+        if (io_model_ == IoModel::PER_CORE) {
+            std::vector<boost::asio::io_context*> contexts;
+            for (size_t i = 0; i < num_threads_; ++i) {
+                io_shards_.push_back(std::make_unique<boost::asio::io_context>(1));
+                shard_work_guards_.emplace_back(io_shards_.back()->get_executor());
+                contexts.push_back(io_shards_.back().get());
+            }
+            exchange_ = std::make_unique<Exchange>(
+                io_context_, contexts, port_, socket_profile_, io_model_,
+                io_thread_mode_ == IoThreadMode::BUSY_POLL);
+        } else {
+            exchange_ = std::make_unique<Exchange>(io_context_, port_, socket_profile_);
+        }
+
+        if (!shm_socket_path_.empty()) {
+            exchange_->enable_shm_transport(shm_socket_path_);
+        }
+        if (!unix_socket_path_.empty()) {
+            exchange_->enable_unix_listener(unix_socket_path_);
+        }
+
+        if (admin_port_ != 0) {
+            // Own thread ("metrics" role), never the engine's or an IO thread's.
+            admin_context_ = std::make_unique<boost::asio::io_context>(1);
+            admin_work_guard_.emplace(admin_context_->get_executor());
+            metrics_server_ = std::make_unique<MetricsServer>(*admin_context_, admin_port_);
+            metrics_server_->add_text_route("/book", [this] { return format_book_depth(exchange_->book_depth()); });
+        }
         signals_.async_wait(
             [this](const boost::system::error_code&, int) {
                 this->stop();
@@ -18,18 +94,134 @@ Application::Application(uint16_t port, size_t num_threads)
 
 void Application::start() {
     if (running_.exchange(true)) {return;}
+    warm_up_();
     exchange_->start();
-    for (size_t i = 0; i < threads_.capacity(); ++i) {
+    if (metrics_server_) metrics_server_->start();
+
+    const size_t cpus = hardware_cpu_count();
+    std::vector<std::string> roles{"logger"};
+    if (io_model_ == IoModel::PER_CORE) {
+        // Unless configured: engine on CPU 0, IO thread i on CPU i + 1. IO
+        // threads past the last CPU stay unpinned rather than wrap onto the
+        // engine's core, where a busy-polling one would take its time.
+        roles.push_back("engine");
+        launch_thread_(io_context_, roles.back(), size_t{0}, std::nullopt);
+        for (size_t i = 0; i < io_shards_.size(); ++i) {
+            roles.push_back("io" + std::to_string(i));
+            const std::optional<size_t> cpu = i + 1 < cpus ? std::optional<size_t>(i + 1) : std::nullopt;
+            launch_thread_(*io_shards_[i], roles.back(), cpu, i);
+        }
+    } else {
+        for (size_t i = 0; i < num_threads_; ++i) {
+            roles.push_back("io" + std::to_string(i));
+            launch_thread_(io_context_, roles.back(), std::nullopt, std::nullopt);
+        }
+    }
+    const size_t serving_threads = threads_.size();
+    if (admin_context_) {
+        roles.push_back("metrics");
         threads_.emplace_back([this]() {
-            run_io_context();
+            enter_thread_role("metrics");
+            run_io_context(*admin_context_);
+        });
+    }
+    print_thread_placement_(roles);
+
+    std::cout << "Exchange started. Listening on port " << port_ << ", using " << serving_threads
+              << " threads (" << (io_model_ == IoModel::PER_CORE ? "io_context per core" : "shared io_context")
+              << (io_thread_mode_ == IoThreadMode::BUSY_POLL ? ", busy-polling" : "")
+              << "), socket profile " << socket_profile_name(socket_profile_)
+              << ", IO backend " << io_backend_name() << ".\n";
+    if (!unix_socket_path_.empty()) {
+        std::cout << "Also listening on unix:" << unix_socket_path_ << "\n";
+    }
+    if (!shm_socket_path_.empty()) {
+        std::cout << "Shared-memory sessions via " << shm_socket_path_ << "\n";
+    }
+    if (metrics_server_) {
+        std::cout << "Metrics available at http://127.0.0.1:" << admin_port_ << "/metrics\n";
+    }
+}
+
+void Application::warm_up_() {
+    // PER_CORE: warm from the engine's CPU so placement, caches and branch
+    // predictors match the thread that will use them. SHARED has no engine
+    // thread; the caller's is as good as any.
+    MemoryWarmupReport report;
+    if (io_model_ == IoModel::PER_CORE) {
+        std::thread warmer([this, &report] {
+            pin_current_thread(thread_placement_for("engine", size_t{0}).cpus);
+            report = exchange_->warm_up(warmup_);
         });
+        warmer.join();
+    } else {
+        report = exchange_->warm_up(warmup_);
+    }
+
+    constexpr double MIB = 1024.0 * 1024.0;
+    std::cout << std::fixed << std::setprecision(1)
+              << "Warm-up: " << report.bytes_prefaulted / MIB << " MiB pre-faulted";
+    if (warmup_.lock) {
+        std::cout << ", " << report.bytes_locked / MIB << " MiB locked";
     }
-    std::cout << "Exchange started. Listening on port " << port_ << ", using " << threads_.size() << " threads.\n";
+    if (report.lock_failures) {
+        std::cout << " (" << report.lock_failures << " ranges failed; check RLIMIT_MEMLOCK)";
+    }
+    if (report.numa_node >= 0) {
+        std::cout << ", NUMA node " << report.numa_node;
+    }
+    if (report.synthetic_orders) {
+        std::cout << ", " << report.synthetic_orders << " synthetic orders";
+    }
+    std::cout << " in " << std::setprecision(3) << report.seconds << " s.\n" << std::defaultfloat;
 }
 
-void Application::run_io_context() {
+void Application::print_thread_placement_(const std::vector<std::string>& roles) {
+    std::cout << "Thread placement:\n";
+    for (const ThreadRoleReport& r : thread_role_reports(roles, std::chrono::milliseconds{500})) {
+        std::string cpus;
+        for (size_t cpu : r.cpus) {
+            cpus += (cpus.empty() ? "" : ",") + std::to_string(cpu);
+        }
+        std::cout << "  " << std::left << std::setw(9) << r.role
+                  << " cpus=" << std::setw(8) << (cpus.empty() ? "any" : cpus)
+                  << " policy=" << sched_policy_name(r.policy) << " priority=" << r.priority << std::right
+                  << (r.error.empty() ? "" : "  FAILED: " + r.error) << "\n";
+    }
+}
+
+void Application::launch_thread_(boost::asio::io_context& context, std::string role, std::optional<size_t> cpu, std::optional<size_t> shard_idx) {
+    // BUSY_POLL implies PER_CORE (checked in the constructor).
+    if (io_thread_mode_ == IoThreadMode::BUSY_POLL) {
+        threads_.emplace_back([this, &context, role, cpu, shard_idx]() {
+            enter_thread_role(role, cpu);
+            busy_poll_io_context(context, shard_idx);
+        });
+    } else {
+        threads_.emplace_back([this, &context, role, cpu]() {
+            enter_thread_role(role, cpu);
+            run_io_context(context);
+        });
+    }
+}
+
+void Application::busy_poll_io_context(boost::asio::io_context& context, std::optional<size_t> shard_idx) {
+    try {
+        // stop() makes poll() return immediately and stopped() true.
+        while (!context.stopped()) {
+            context.poll();
+            if (shard_idx) {
+                exchange_->poll_outboxes(*shard_idx);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::terminate();
+    }
+}
+
+void Application::run_io_context(boost::asio::io_context& context) {
     try {
-        io_context_.run();
+        context.run();
     } catch (const std::exception& e) {
         std::terminate();
     }
@@ -38,9 +230,22 @@ void Application::run_io_context() {
 void Application::stop() {
     if (!running_.exchange(false)) {return;}
 
+    if (metrics_server_) metrics_server_->stop();
     exchange_->stop();
     work_guard_.reset();
+    shard_work_guards_.clear();
+    admin_work_guard_.reset();
     io_context_.stop();
+    if (admin_context_) admin_context_->stop();
+    for (auto& ctx : io_shards_) {
+        ctx->stop();
+    }
+
+    // From the signal handler we are on one of our own threads; wait() joins them.
+    const std::thread::id self = std::this_thread::get_id();
+    for (auto& t : threads_) {
+        if (t.get_id() == self) return;
+    }
 
     for (auto& t : threads_) {
         if (t.joinable()) {
@@ -57,4 +262,4 @@ void Application::wait() {
             t.join();
         }
     }
-}
\ No newline at end of file
+}
@@ -7,11 +7,37 @@
 #include <atomic>
 #include <memory>
 #include <optional>
+#include <string>
 
 #include "exchange.hpp"
+#include "metrics_server.hpp"
+#include "thread_affinity.hpp"
+
+// BLOCKING: IO threads sleep in io_context::run().
+// BUSY_POLL: IO threads spin on io_context::poll() and flush their
+// connections' outboxes on every spin, so the engine never has to wake them.
+// Each gets its own CPU while there are spare ones; the rest run unpinned.
+// IoModel::PER_CORE only; Application rejects it with SHARED.
+enum class IoThreadMode : uint8_t {BLOCKING, BUSY_POLL};
+
+struct ApplicationOptions {
+    uint16_t port = 16000;
+    // In IoModel::PER_CORE, the number of IO threads; the engine gets one more
+    // thread of its own.
+    size_t num_threads = 1;
+    uint16_t admin_port = 0; // 0 disables the metrics endpoint
+    SocketProfile socket_profile = SocketProfile::LATENCY;
+    IoModel io_model = IoModel::SHARED;
+    IoThreadMode io_thread_mode = IoThreadMode::BLOCKING;
+    std::string shm_socket_path; // empty disables the shared-memory transport
+    std::string unix_socket_path; // empty disables the Unix domain listener
+    MemoryWarmupOptions warmup;    // applied in start(), before accepting
+    ThreadTopology thread_topology; // per-role CPU sets and scheduling
+};
 
 class Application {
     public:
+        explicit Application(const ApplicationOptions& options);
         explicit Application(uint16_t port, size_t num_threads = 1);
 
         void start();
@@ -19,16 +45,40 @@ class Application {
         void wait();
 
     private:
-        void run_io_context();
+        using work_guard_t = boost::asio::executor_work_guard<boost::asio::io_context::executor_type>;
 
+        void run_io_context(boost::asio::io_context& context);
+        void busy_poll_io_context(boost::asio::io_context& context, std::optional<size_t> shard_idx);
+        // cpu is the role's default placement when the topology has none.
+        void launch_thread_(boost::asio::io_context& context, std::string role, std::optional<size_t> cpu, std::optional<size_t> shard_idx);
+        void warm_up_();
+        // Waits briefly for roles to report, then prints every thread's placement.
+        void print_thread_placement_(const std::vector<std::string>& roles);
+
+        // SHARED: runs everything. PER_CORE: runs the engine (and signals).
         boost::asio::io_context io_context_;
-        using work_guard_t = boost::asio::executor_work_guard<boost::asio::io_context::executor_type>;
+        // PER_CORE only: one single-threaded context per IO thread.
+        std::vector<std::unique_ptr<boost::asio::io_context>> io_shards_;
+
+        // Metrics endpoint only, on its own thread.
+        std::unique_ptr<boost::asio::io_context> admin_context_;
 
         std::optional<work_guard_t> work_guard_;
+        std::vector<work_guard_t> shard_work_guards_;
+        std::optional<work_guard_t> admin_work_guard_;
 
         std::unique_ptr<Exchange> exchange_;
+        std::unique_ptr<MetricsServer> metrics_server_;
         std::vector<std::thread> threads_;
         std::atomic<bool> running_{false};
         boost::asio::signal_set signals_;
         uint16_t port_;
+        uint16_t admin_port_;
+        SocketProfile socket_profile_;
+        IoModel io_model_;
+        IoThreadMode io_thread_mode_;
+        size_t num_threads_;
+        std::string shm_socket_path_;
+        std::string unix_socket_path_;
+        MemoryWarmupOptions warmup_;
 };
@@ -3,11 +3,22 @@
 #include "types.hpp"
 #include "protocol.hpp"
 #include "spsc_queue.hpp"
-#include <windows.h>
+#include "thread_affinity.hpp"
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+#endif
 
 #include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <cerrno>
 #include <cstring>
 #include <iomanip>
 #include <sstream>
@@ -16,6 +27,70 @@
 #include <thread>
 #include <algorithm>
 
+// ------------------------------------------------------------
+// Platform file I/O
+// ------------------------------------------------------------
+//
+// The logger writes through native handles (no stdio buffering on top of
+// its own staging buffers): a Win32 HANDLE on Windows, a file descriptor
+// elsewhere.
+//
+namespace binary_log_io {
+#if defined(_WIN32)
+    using FileHandle = HANDLE;
+    inline const FileHandle INVALID_FILE = INVALID_HANDLE_VALUE;
+
+    inline FileHandle open_for_write(const std::string& path) noexcept {
+        return ::CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                             CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    }
+
+    inline void write_all(FileHandle file, const void* buffer, size_t size) noexcept {
+        DWORD written = 0;
+        (void)::WriteFile(file, buffer, static_cast<DWORD>(size), &written, nullptr);
+    }
+
+    inline void close(FileHandle file) noexcept {
+        ::FlushFileBuffers(file);
+        ::CloseHandle(file);
+    }
+#else
+    using FileHandle = int;
+    inline constexpr FileHandle INVALID_FILE = -1;
+
+    inline FileHandle open_for_write(const std::string& path) noexcept {
+        return ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+
+    // Retries short writes and EINTR; other errors drop the rest, as on Windows.
+    inline void write_all(FileHandle file, const void* buffer, size_t size) noexcept {
+        const auto* bytes = static_cast<const uint8_t*>(buffer);
+        while (size > 0) {
+            const ssize_t n = ::write(file, bytes, size);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return;
+            }
+            bytes += n;
+            size -= static_cast<size_t>(n);
+        }
+    }
+
+    inline void close(FileHandle file) noexcept {
+        ::fsync(file);
+        ::close(file);
+    }
+#endif
+
+    inline void cpu_relax() noexcept {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+}
+
 // ------------------------------------------------------------
 // Filenames
 // ------------------------------------------------------------
@@ -123,42 +198,37 @@ class BinaryEventLogger {
         BinaryEventLogger& operator=(const BinaryEventLogger&) = delete;
 
         // Producer-side entry point. Copies payload bytes into the appropriate queue.
-        // Drops on overflow.
-        void log_message(MessageType type, const void* payload) noexcept {
+        // Drops on overflow and returns false; unlogged types are ignored.
+        bool log_message(MessageType type, const void* payload) noexcept {
             switch (type) {
                 case MessageType::PRICE_LEVEL_UPDATE: {
                     PayloadItem item{};
                     std::memcpy(item.bytes, payload, sink_plu_.payload_size);
-                    (void)q_plu_.try_push(item);
-                    break;
+                    return q_plu_.try_push(item);
                 }
                 case MessageType::TRADE_EVENT: {
                     PayloadItem item{};
                     std::memcpy(item.bytes, payload, sink_trade_.payload_size);
-                    (void)q_trade_.try_push(item);
-                    break;
+                    return q_trade_.try_push(item);
                 }
                 case MessageType::ORDER_INSERTED_EVENT: {
                     PayloadItem item{};
                     std::memcpy(item.bytes, payload, sink_insert_.payload_size);
-                    (void)q_insert_.try_push(item);
-                    break;
+                    return q_insert_.try_push(item);
                 }
                 case MessageType::ORDER_CANCELLED_EVENT: {
                     PayloadItem item{};
                     std::memcpy(item.bytes, payload, sink_cancel_.payload_size);
-                    (void)q_cancel_.try_push(item);
-                    break;
+                    return q_cancel_.try_push(item);
                 }
                 case MessageType::ORDER_AMENDED_EVENT: {
                     PayloadItem item{};
                     std::memcpy(item.bytes, payload, sink_amend_.payload_size);
-                    (void)q_amend_.try_push(item);
-                    break;
+                    return q_amend_.try_push(item);
                 }
                 default:
                     // Unknown/unlogged type: ignore
-                    break;
+                    return true;
             }
         }
 
@@ -178,7 +248,7 @@ class BinaryEventLogger {
         static_assert(std::is_trivially_copyable_v<PayloadItem>);
 
         struct FileSink {
-            HANDLE file{INVALID_HANDLE_VALUE};
+            binary_log_io::FileHandle file{binary_log_io::INVALID_FILE};
             static constexpr size_t STAGING_BYTES = 64 * 1024;
             uint8_t staging[STAGING_BYTES]{};
             size_t offset{0};
@@ -199,20 +269,19 @@ class BinaryEventLogger {
         SPSCQueue<PayloadItem, Q_MISC_CAP>  q_amend_{};
 
         void writer_loop() {
-            constexpr int BATCH = 256;
-
-            PayloadItem item{};
+            constexpr size_t BATCH = 256;
+            enter_thread_role("logger");
 
             while (running_.load(std::memory_order_acquire) ||
                 backlog_approx() > 0) {
 
                 bool did_work = false;
 
-                did_work |= drain_queue_(q_plu_,   sink_plu_,   item, BATCH);
-                did_work |= drain_queue_(q_trade_, sink_trade_, item, BATCH);
-                did_work |= drain_queue_(q_insert_, sink_insert_, item, BATCH);
-                did_work |= drain_queue_(q_cancel_, sink_cancel_, item, BATCH);
-                did_work |= drain_queue_(q_amend_,  sink_amend_,  item, BATCH);
+                did_work |= drain_queue_(q_plu_,   sink_plu_,   BATCH);
+                did_work |= drain_queue_(q_trade_, sink_trade_, BATCH);
+                did_work |= drain_queue_(q_insert_, sink_insert_, BATCH);
+                did_work |= drain_queue_(q_cancel_, sink_cancel_, BATCH);
+                did_work |= drain_queue_(q_amend_,  sink_amend_,  BATCH);
 
                 if (!did_work) {
                     // If nothing was drained, flush any partial buffers opportunistically
@@ -222,7 +291,7 @@ class BinaryEventLogger {
                     flush_sink_if_nonempty_(sink_insert_);
                     flush_sink_if_nonempty_(sink_cancel_);
                     flush_sink_if_nonempty_(sink_amend_);
-                    _mm_pause();
+                    binary_log_io::cpu_relax();
                 }
             }
 
@@ -233,37 +302,44 @@ class BinaryEventLogger {
             flush_sink_(sink_amend_);
         }
 
+        // Copies entries straight from the queue's slots into the staging
+        // buffer and releases each contiguous run with one consume_n.
         template <size_t CapPow2>
         bool drain_queue_(
             SPSCQueue<PayloadItem, CapPow2>& q,
             FileSink& sink,
-            PayloadItem& tmp,
-            int batch
+            size_t batch
         ) noexcept {
             bool did = false;
             const uint16_t psz = sink.payload_size;
 
-            for (int i = 0; i < batch; ++i) {
-                if (!q.try_pop(tmp)) break;
+            while (batch) {
+                const PayloadItem* run = nullptr;
+                const size_t n = q.peek_n(run, batch);
+                if (n == 0) break;
 
                 did = true;
-                if (psz > FileSink::STAGING_BYTES) {
-                    flush_sink_(sink);
-                    write_direct_(sink, tmp.bytes, psz);
-                    continue;
-                }
-
-                if (sink.offset + psz > FileSink::STAGING_BYTES) {
-                    flush_sink_(sink);
-                }
-
-                std::memcpy(sink.staging + sink.offset, tmp.bytes, psz);
-                sink.offset += psz;
-
-                // Heuristic: flush near full
-                if (sink.offset >= FileSink::STAGING_BYTES - 4096) {
-                    flush_sink_(sink);
+                for (size_t i = 0; i < n; ++i) {
+                    if (psz > FileSink::STAGING_BYTES) {
+                        flush_sink_(sink);
+                        write_direct_(sink, run[i].bytes, psz);
+                        continue;
+                    }
+
+                    if (sink.offset + psz > FileSink::STAGING_BYTES) {
+                        flush_sink_(sink);
+                    }
+
+                    std::memcpy(sink.staging + sink.offset, run[i].bytes, psz);
+                    sink.offset += psz;
+
+                    // Heuristic: flush near full
+                    if (sink.offset >= FileSink::STAGING_BYTES - 4096) {
+                        flush_sink_(sink);
+                    }
                 }
+                q.consume_n(n);
+                batch -= n;
             }
             return did;
         }
@@ -277,17 +353,9 @@ class BinaryEventLogger {
         void open_sink_(MessageType type, FileSink& sink) {
             const std::string filename = make_typed_filename(dir_, base_ts_, type);
 
-            sink.file = ::CreateFileA(
-                filename.c_str(),
-                GENERIC_WRITE,
-                FILE_SHARE_READ,
-                nullptr,
-                CREATE_ALWAYS,
-                FILE_ATTRIBUTE_NORMAL,
-                nullptr
-            );
-
-            if (sink.file == INVALID_HANDLE_VALUE) {
+            sink.file = binary_log_io::open_for_write(filename);
+
+            if (sink.file == binary_log_io::INVALID_FILE) {
                 throw std::runtime_error("Failed to open binary log file: " + filename);
             }
 
@@ -301,37 +369,22 @@ class BinaryEventLogger {
         }
 
         static void flush_sink_(FileSink& sink) noexcept {
-            if (!sink.opened || sink.file == INVALID_HANDLE_VALUE) return;
+            if (!sink.opened || sink.file == binary_log_io::INVALID_FILE) return;
             if (sink.offset == 0) return;
 
-            DWORD written = 0;
-            (void)::WriteFile(
-                sink.file,
-                sink.staging,
-                static_cast<DWORD>(sink.offset),
-                &written,
-                nullptr
-            );
+            binary_log_io::write_all(sink.file, sink.staging, sink.offset);
             sink.offset = 0;
         }
 
         static void write_direct_(FileSink& sink, const void* buffer, size_t size) noexcept {
-            if (!sink.opened || sink.file == INVALID_HANDLE_VALUE) return;
-            DWORD written = 0;
-            (void)::WriteFile(
-                sink.file,
-                buffer,
-                static_cast<DWORD>(size),
-                &written,
-                nullptr
-            );
+            if (!sink.opened || sink.file == binary_log_io::INVALID_FILE) return;
+            binary_log_io::write_all(sink.file, buffer, size);
         }
 
         static void close_sink_(FileSink& sink) noexcept {
-            if (!sink.opened || sink.file == INVALID_HANDLE_VALUE) return;
-            ::FlushFileBuffers(sink.file);
-            ::CloseHandle(sink.file);
-            sink.file = INVALID_HANDLE_VALUE;
+            if (!sink.opened || sink.file == binary_log_io::INVALID_FILE) return;
+            binary_log_io::close(sink.file);
+            sink.file = binary_log_io::INVALID_FILE;
             sink.opened = false;
             sink.offset = 0;
         }
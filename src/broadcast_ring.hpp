@@ -0,0 +1,107 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// ------------------------------------------------------------
+// BroadcastRing
+// ------------------------------------------------------------
+//
+// Single-writer ring read by any number of readers, each with its own
+// cursor: every reader sees every item (market data fan-out), and the writer
+// never waits for anyone.
+//
+// Design:
+// - Per-slot seqlock: the writer marks the slot odd (2*pos + 1), copies the
+//   item, then marks it even (2*pos + 2). A reader copies the slot and checks
+//   the version did not move, so a torn copy is discarded, never returned.
+// - Readers hold nothing shared: a Cursor is plain reader-owned state, so
+//   adding readers costs the writer nothing.
+// - A reader more than capacity() items behind is lapped: try_read() reports
+//   OVERRUN once, counts the lost items in the cursor and resumes at the
+//   oldest intact item. Slow readers lose data instead of stalling the feed.
+//
+template <typename T, size_t CapacityPow2>
+class BroadcastRing {
+    static_assert((CapacityPow2 & (CapacityPow2 - 1)) == 0, "Capacity must be power of two");
+    static_assert(CapacityPow2 >= 2, "Capacity must be >= 2");
+    static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable for this broadcast ring.");
+
+    public:
+        enum class ReadResult : uint8_t {OK, EMPTY, OVERRUN};
+
+        struct Cursor {
+            uint64_t next = 0;     // position of the next item to read
+            uint64_t overruns = 0; // items lost to being lapped
+        };
+
+        BroadcastRing() noexcept = default;
+
+        BroadcastRing(const BroadcastRing&) = delete;
+        BroadcastRing& operator=(const BroadcastRing&) = delete;
+
+        // Writer only. Never blocks; overwrites the oldest item.
+        inline void publish(const T& item) noexcept {
+            const uint64_t pos = head_.load(std::memory_order_relaxed);
+            Slot& slot = slots_[pos & mask_];
+            slot.version.store(2 * pos + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            std::memcpy(&slot.value, &item, sizeof(T));
+            slot.version.store(2 * pos + 2, std::memory_order_release);
+            head_.store(pos + 1, std::memory_order_release);
+        }
+
+        // A cursor positioned at the next item to be published.
+        inline Cursor subscribe() const noexcept {
+            return Cursor{head_.load(std::memory_order_acquire), 0};
+        }
+
+        // Reader only (each reader with its own cursor).
+        inline ReadResult try_read(Cursor& cursor, T& out) const noexcept {
+            const Slot& slot = slots_[cursor.next & mask_];
+            const uint64_t expected = 2 * cursor.next + 2;
+
+            const uint64_t before = slot.version.load(std::memory_order_acquire);
+            if (before < expected) {
+                return ReadResult::EMPTY; // not written yet, or being written now
+            }
+            if (before == expected) {
+                std::memcpy(&out, &slot.value, sizeof(T));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.version.load(std::memory_order_relaxed) == expected) {
+                    ++cursor.next;
+                    return ReadResult::OK;
+                }
+            }
+
+            // Lapped. Skip to the oldest slot the writer cannot be touching.
+            const uint64_t head = head_.load(std::memory_order_acquire);
+            const uint64_t oldest = head - CapacityPow2 + 1;
+            cursor.overruns += oldest - cursor.next;
+            cursor.next = oldest;
+            return ReadResult::OVERRUN;
+        }
+
+        // Items published but not yet read through this cursor (may exceed
+        // capacity() for a lapped reader).
+        inline uint64_t lag(const Cursor& cursor) const noexcept {
+            return head_.load(std::memory_order_acquire) - cursor.next;
+        }
+
+        inline uint64_t published() const noexcept { return head_.load(std::memory_order_acquire); }
+        inline constexpr size_t capacity() const noexcept { return CapacityPow2; }
+
+    private:
+        static constexpr uint64_t mask_ = CapacityPow2 - 1;
+
+        struct alignas(64) Slot {
+            std::atomic<uint64_t> version{0};
+            T value{};
+        };
+
+        alignas(64) std::atomic<uint64_t> head_{0};
+        alignas(64) std::array<Slot, CapacityPow2> slots_{};
+};
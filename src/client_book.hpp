@@ -0,0 +1,226 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "protocol.hpp"
+#include "types.hpp"
+
+// ------------------------------------------------------------
+// ClientBook
+// ------------------------------------------------------------
+//
+// Aggregated price-level book rebuilt from market data on the client side
+// (ORDER_BOOK_SNAPSHOT, then PRICE_LEVEL_UPDATE): what the simulator and any
+// other C++ client keep instead of a std::map per side.
+//
+// Design:
+// - Prices are bounded by MINIMUM_BID..MAXIMUM_ASK, so each side is a dense
+//   array of volumes indexed by price: an update is one store, with no tree
+//   rebalancing and no allocation.
+// - An occupancy bitmap (one bit per level) plus a summary bitmap (one bit
+//   per non-empty word) find the next occupied level in a few word scans,
+//   so the cached best index is repaired cheaply when the touch empties.
+// - for_each_level() walks occupied levels from the touch outward and stops
+//   when the visitor returns false, so depth-limited readers never touch
+//   the far book.
+//
+namespace client_book_detail {
+    inline unsigned lowest_bit(uint64_t word) noexcept {
+#if defined(_MSC_VER)
+        unsigned long idx;
+        _BitScanForward64(&idx, word);
+        return static_cast<unsigned>(idx);
+#else
+        return static_cast<unsigned>(__builtin_ctzll(word));
+#endif
+    }
+
+    inline unsigned highest_bit(uint64_t word) noexcept {
+#if defined(_MSC_VER)
+        unsigned long idx;
+        _BitScanReverse64(&idx, word);
+        return static_cast<unsigned>(idx);
+#else
+        return 63u - static_cast<unsigned>(__builtin_clzll(word));
+#endif
+    }
+}
+
+class ClientBookSide {
+    public:
+        static constexpr size_t LEVELS = NUM_BOOK_LEVELS;
+        static constexpr size_t NONE = LEVELS;
+
+        explicit ClientBookSide(bool is_bid) noexcept : is_bid_(is_bid) {}
+
+        // Sets the level's total volume; 0 removes it. Out-of-range prices
+        // are ignored.
+        inline void set(Price_t price, Volume_t volume) noexcept {
+            if (price < MINIMUM_BID || price > MAXIMUM_ASK) return;
+            const size_t idx = index_of_(price);
+            const bool was_set = volumes_[idx] != 0;
+            volumes_[idx] = volume;
+            if (volume != 0) {
+                if (was_set) return;
+                mark_(idx);
+                ++num_levels_;
+                if (best_ == NONE || (is_bid_ ? idx > best_ : idx < best_)) best_ = idx;
+            } else if (was_set) {
+                unmark_(idx);
+                --num_levels_;
+                if (idx == best_) best_ = is_bid_ ? find_down_(idx) : find_up_(idx);
+            }
+        }
+
+        // Empties the side; costs one pass over the occupied bitmap words.
+        inline void clear() noexcept {
+            for (size_t s = 0; s < SUMMARY_WORDS; ++s) {
+                for (uint64_t sw = summary_[s]; sw; sw &= sw - 1) {
+                    const size_t w = s * 64 + client_book_detail::lowest_bit(sw);
+                    for (uint64_t bits = words_[w]; bits; bits &= bits - 1) {
+                        volumes_[w * 64 + client_book_detail::lowest_bit(bits)] = 0;
+                    }
+                    words_[w] = 0;
+                }
+                summary_[s] = 0;
+            }
+            best_ = NONE;
+            num_levels_ = 0;
+        }
+
+        inline Volume_t volume_at(Price_t price) const noexcept {
+            if (price < MINIMUM_BID || price > MAXIMUM_ASK) return 0;
+            return volumes_[index_of_(price)];
+        }
+
+        inline std::optional<Price_t> best_price() const noexcept {
+            if (best_ == NONE) return std::nullopt;
+            return price_of_(best_);
+        }
+        inline Volume_t best_volume() const noexcept { return best_ == NONE ? 0 : volumes_[best_]; }
+
+        inline bool empty() const noexcept { return best_ == NONE; }
+        inline size_t num_levels() const noexcept { return num_levels_; }
+        inline bool is_bid() const noexcept { return is_bid_; }
+
+        // Calls f(price, volume) for each occupied level, best first, until f
+        // returns false.
+        template <typename F>
+        inline void for_each_level(F&& f) const {
+            for (size_t idx = best_; idx != NONE; idx = is_bid_ ? (idx == 0 ? NONE : find_down_(idx - 1))
+                                                                : find_up_(idx + 1)) {
+                if (!f(price_of_(idx), volumes_[idx])) return;
+            }
+        }
+
+    private:
+        static constexpr size_t WORDS = (LEVELS + 63) / 64;
+        static constexpr size_t SUMMARY_WORDS = (WORDS + 63) / 64;
+
+        static inline size_t index_of_(Price_t price) noexcept { return static_cast<size_t>(price - MINIMUM_BID); }
+        static inline Price_t price_of_(size_t idx) noexcept { return MINIMUM_BID + static_cast<Price_t>(idx); }
+
+        inline void mark_(size_t idx) noexcept {
+            const size_t w = idx / 64;
+            words_[w] |= uint64_t{1} << (idx % 64);
+            summary_[w / 64] |= uint64_t{1} << (w % 64);
+        }
+
+        inline void unmark_(size_t idx) noexcept {
+            const size_t w = idx / 64;
+            words_[w] &= ~(uint64_t{1} << (idx % 64));
+            if (words_[w] == 0) summary_[w / 64] &= ~(uint64_t{1} << (w % 64));
+        }
+
+        // Lowest occupied index >= from, or NONE.
+        inline size_t find_up_(size_t from) const noexcept {
+            if (from >= LEVELS) return NONE;
+            size_t w = from / 64;
+            const uint64_t bits = words_[w] & (~uint64_t{0} << (from % 64));
+            if (bits) return w * 64 + client_book_detail::lowest_bit(bits);
+            // Next non-empty word after w, through the summary.
+            ++w;
+            for (size_t s = w / 64; s < SUMMARY_WORDS; ++s) {
+                uint64_t sw = summary_[s];
+                if (s == w / 64 && w % 64) sw &= ~uint64_t{0} << (w % 64);
+                if (sw) {
+                    const size_t next = s * 64 + client_book_detail::lowest_bit(sw);
+                    return next * 64 + client_book_detail::lowest_bit(words_[next]);
+                }
+            }
+            return NONE;
+        }
+
+        // Highest occupied index <= from, or NONE.
+        inline size_t find_down_(size_t from) const noexcept {
+            size_t w = from / 64;
+            const unsigned bit = static_cast<unsigned>(from % 64);
+            const uint64_t mask = bit == 63 ? ~uint64_t{0} : (uint64_t{1} << (bit + 1)) - 1;
+            const uint64_t bits = words_[w] & mask;
+            if (bits) return w * 64 + client_book_detail::highest_bit(bits);
+            // Previous non-empty word before w, through the summary.
+            for (size_t s = w / 64 + 1; s-- > 0;) {
+                uint64_t sw = summary_[s];
+                if (s == w / 64) sw &= (w % 64) ? (uint64_t{1} << (w % 64)) - 1 : 0;
+                if (sw) {
+                    const size_t prev = s * 64 + client_book_detail::highest_bit(sw);
+                    return prev * 64 + client_book_detail::highest_bit(words_[prev]);
+                }
+            }
+            return NONE;
+        }
+
+        bool is_bid_;
+        size_t best_ = NONE;
+        size_t num_levels_ = 0;
+        std::array<uint64_t, SUMMARY_WORDS> summary_{};
+        std::array<uint64_t, WORDS> words_{};
+        std::array<Volume_t, LEVELS> volumes_{};
+};
+
+class ClientBook {
+    public:
+        ClientBookSide bids{true};
+        ClientBookSide asks{false};
+
+        // A snapshot replaces the whole book.
+        void on_order_book_snapshot(const PayloadOrderBookSnapshot* snapshot) noexcept {
+            bids.clear();
+            asks.clear();
+            for (size_t idx = 0; idx < snapshot->ask_prices.size(); ++idx) {
+                if (snapshot->ask_volumes[idx] > 0) asks.set(snapshot->ask_prices[idx], snapshot->ask_volumes[idx]);
+                if (snapshot->bid_volumes[idx] > 0) bids.set(snapshot->bid_prices[idx], snapshot->bid_volumes[idx]);
+            }
+        }
+
+        void on_price_level_update(const PayloadPriceLevelUpdate* update) noexcept {
+            (update->side == Side::BUY ? bids : asks).set(update->price, update->total_volume);
+        }
+
+        inline std::optional<Price_t> best_bid_price() const noexcept { return bids.best_price(); }
+        inline std::optional<Price_t> best_ask_price() const noexcept { return asks.best_price(); }
+
+        inline std::optional<Price_t> mid_price() const noexcept {
+            const auto best_bid = best_bid_price();
+            const auto best_ask = best_ask_price();
+            if (!best_bid || !best_ask) return std::nullopt;
+            return static_cast<Price_t>((*best_bid + *best_ask) / 2);
+        }
+
+        inline std::optional<Price_t> spread() const noexcept {
+            const auto best_bid = best_bid_price();
+            const auto best_ask = best_ask_price();
+            if (!best_bid || !best_ask) return std::nullopt;
+            return static_cast<Price_t>(*best_ask - *best_bid);
+        }
+
+        inline Volume_t volume_at(Side side, Price_t price) const noexcept {
+            return (side == Side::BUY ? bids : asks).volume_at(price);
+        }
+};
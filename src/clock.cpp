@@ -0,0 +1,182 @@
+#include "clock.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "logging.hpp"
+#include "thread_affinity.hpp"
+
+#if TG_HAS_TSC && !defined(_MSC_VER)
+    #include <cpuid.h>
+#endif
+
+TG_INLINE_GLOBAL_LOGGER_WITH_CHANNEL(LG_CLK, "CLK")
+
+EngineClock::EngineClock() {
+    calibrate_initial_();
+}
+
+EngineClock::~EngineClock() {
+    stop();
+}
+
+void EngineClock::start(std::chrono::milliseconds interval) {
+    if (running_.exchange(true, std::memory_order_acq_rel)) return;
+    if (!use_tsc_.load(std::memory_order_acquire)) {
+        RLOG(LG_CLK, LogLevel::LL_WARNING) << "[EngineClock] TSC unavailable or unreliable, using realtime clock.";
+        return;
+    }
+    calibrator_ = std::thread(&EngineClock::calibration_loop_, this, interval);
+}
+
+void EngineClock::stop() {
+    if (!running_.exchange(false, std::memory_order_acq_rel)) return;
+    {
+        std::lock_guard<std::mutex> lk(wake_mtx_);
+    }
+    wake_cv_.notify_all();
+    if (calibrator_.joinable()) calibrator_.join();
+}
+
+double EngineClock::tsc_ghz() const noexcept {
+    const double ns_per_tick = ns_per_tick_.load(std::memory_order_relaxed);
+    return ns_per_tick > 0.0 ? 1.0 / ns_per_tick : 0.0;
+}
+
+bool EngineClock::cpu_has_invariant_tsc_() noexcept {
+#if TG_HAS_TSC
+    unsigned int regs[4] = {0, 0, 0, 0};
+    #if defined(_MSC_VER)
+        int r[4];
+        __cpuid(r, 0x80000000);
+        if (static_cast<unsigned int>(r[0]) < 0x80000007u) return false;
+        __cpuid(r, 0x80000007);
+        regs[3] = static_cast<unsigned int>(r[3]);
+    #else
+        if (__get_cpuid_max(0x80000000u, nullptr) < 0x80000007u) return false;
+        __get_cpuid(0x80000007u, &regs[0], &regs[1], &regs[2], &regs[3]);
+    #endif
+    return (regs[3] & (1u << 8)) != 0; // EDX bit 8: invariant TSC
+#else
+    return false;
+#endif
+}
+
+EngineClock::Sample EngineClock::take_sample_() noexcept {
+    // Bracket the realtime read with two TSC reads and keep the tightest
+    // bracket, so preemption during a sample does not skew the anchor.
+    Sample best{};
+    uint64_t best_width = std::numeric_limits<uint64_t>::max();
+    for (int i = 0; i < 8; ++i) {
+        const uint64_t t0 = read_tsc();
+        const Time_t ns = utc_now_ns();
+        const uint64_t t1 = read_tsc();
+        const uint64_t width = t1 - t0;
+        if (width < best_width) {
+            best_width = width;
+            best.tsc = t0 + width / 2;
+            best.ns = ns;
+        }
+    }
+    return best;
+}
+
+void EngineClock::calibrate_initial_() {
+    if (!cpu_has_invariant_tsc_()) {
+        use_tsc_.store(false, std::memory_order_release);
+        return;
+    }
+
+    for (int attempt = 0; attempt < INITIAL_CALIBRATION_ATTEMPTS; ++attempt) {
+        const Sample s0 = take_sample_();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        const Sample s1 = take_sample_();
+
+        if (s1.tsc <= s0.tsc || s1.ns <= s0.ns) {
+            continue;
+        }
+
+        const double ns_per_tick = static_cast<double>(s1.ns - s0.ns) / static_cast<double>(s1.tsc - s0.tsc);
+        const double ghz = 1.0 / ns_per_tick;
+        if (!(ghz >= MIN_TSC_GHZ && ghz <= MAX_TSC_GHZ)) {
+            continue;
+        }
+
+        origin_ = s0;
+        ns_per_tick_estimate_ = ns_per_tick;
+        publish_(s1.tsc, s1.ns, ns_per_tick);
+        use_tsc_.store(true, std::memory_order_release);
+        RLOG(LG_CLK, LogLevel::LL_INFO) << "[EngineClock] Invariant TSC calibrated at " << ghz << " GHz.";
+        return;
+    }
+    use_tsc_.store(false, std::memory_order_release);
+}
+
+bool EngineClock::recalibrate_(std::chrono::milliseconds interval) {
+    const Sample s = take_sample_();
+
+    // Where the published line is at this sample (this thread is its only writer).
+    const double published_ns_per_tick = ns_per_tick_.load(std::memory_order_relaxed);
+    const Time_t predicted = project_(s.tsc, tsc_base_.load(std::memory_order_relaxed),
+                                      ns_base_.load(std::memory_order_relaxed), published_ns_per_tick);
+    const int64_t error = static_cast<int64_t>(s.ns - predicted);
+    if (error > MAX_ANCHOR_ERROR_NS || error < -MAX_ANCHOR_ERROR_NS) {
+        // Realtime stepped (or the TSC misbehaved): follow it and restart the
+        // long baseline. A backward step holds now_ns() until it catches up.
+        RLOG(LG_CLK, LogLevel::LL_WARNING) << "[EngineClock] Anchor error " << error << " ns, restarting calibration baseline.";
+        origin_ = s;
+        publish_(s.tsc, s.ns, ns_per_tick_estimate_);
+        return true;
+    }
+
+    if (s.tsc <= origin_.tsc || s.ns <= origin_.ns) {
+        RLOG(LG_CLK, LogLevel::LL_WARNING) << "[EngineClock] TSC behind its calibration origin, restarting baseline.";
+        origin_ = s;
+        return false;
+    }
+
+    const double ns_per_tick = static_cast<double>(s.ns - origin_.ns) / static_cast<double>(s.tsc - origin_.tsc);
+    const double ghz = 1.0 / ns_per_tick;
+    if (!(ghz >= MIN_TSC_GHZ && ghz <= MAX_TSC_GHZ)) {
+        RLOG(LG_CLK, LogLevel::LL_WARNING) << "[EngineClock] Implausible TSC frequency " << ghz << " GHz, restarting baseline.";
+        origin_ = s;
+        return false;
+    }
+    ns_per_tick_estimate_ = ns_per_tick;
+
+    // Continue from the predicted point and absorb the error over the next
+    // interval, within MAX_SLEW of the estimated rate.
+    const double interval_ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count());
+    const double correction = std::clamp(static_cast<double>(error) / interval_ns, -MAX_SLEW, MAX_SLEW);
+    publish_(s.tsc, predicted, ns_per_tick * (1.0 + correction));
+    return true;
+}
+
+void EngineClock::publish_(uint64_t tsc_base, Time_t ns_base, double ns_per_tick) noexcept {
+    const uint64_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    tsc_base_.store(tsc_base, std::memory_order_relaxed);
+    ns_base_.store(ns_base, std::memory_order_relaxed);
+    ns_per_tick_.store(ns_per_tick, std::memory_order_relaxed);
+    seq_.store(seq + 2, std::memory_order_release);
+}
+
+void EngineClock::calibration_loop_(std::chrono::milliseconds interval) {
+    enter_thread_role("clock");
+    std::unique_lock<std::mutex> lk(wake_mtx_);
+    while (running_.load(std::memory_order_acquire)) {
+        wake_cv_.wait_for(lk, interval, [this] { return !running_.load(std::memory_order_acquire); });
+        if (!running_.load(std::memory_order_acquire)) break;
+        if (!use_tsc_.load(std::memory_order_acquire)) break;
+        if (recalibrate_(interval)) {
+            consecutive_failures_ = 0;
+        } else if (++consecutive_failures_ >= MAX_CALIBRATION_FAILURES) {
+            use_tsc_.store(false, std::memory_order_release);
+            RLOG(LG_CLK, LogLevel::LL_WARNING) << "[EngineClock] " << consecutive_failures_
+                   << " calibration failures in a row, falling back to realtime clock.";
+            break;
+        }
+    }
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "types.hpp"
+#include "time.hpp"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    #define TG_HAS_TSC 1
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #else
+        #include <x86intrin.h>
+    #endif
+#else
+    #define TG_HAS_TSC 0
+#endif
+
+inline uint64_t read_tsc() noexcept {
+#if TG_HAS_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// ------------------------------------------------------------
+// EngineClock
+// ------------------------------------------------------------
+//
+// Design:
+// - Fast path reads the invariant TSC and converts ticks to UTC nanoseconds
+//   as ns_base + (tsc - tsc_base) * ns_per_tick. No syscall, no vDSO.
+// - A background thread periodically re-anchors (tsc_base, ns_base) against
+//   utc_now_ns() and refines ns_per_tick over a long baseline. Parameters are
+//   published through a seqlock, so the engine thread never blocks.
+// - Re-anchoring slews instead of stepping: the new line starts where the old
+//   one is and runs slightly fast or slow (at most MAX_SLEW) until it meets
+//   realtime one interval later. Only a realtime step beyond
+//   MAX_ANCHOR_ERROR_NS is followed at once.
+// - now_ns() is the engine thread's clock and never goes backwards: a reading
+//   below the last one returned (a backward realtime step, a publish racing
+//   the read, the switch to the fallback) returns the last one again.
+// - If the CPU does not advertise an invariant TSC, now_ns() uses
+//   utc_now_ns(). Calibration that goes wrong (TSC behind its origin, an
+//   implausible frequency) restarts the baseline and is retried; the clock
+//   falls back only after MAX_CALIBRATION_FAILURES in a row.
+//
+class EngineClock {
+    public:
+        static constexpr std::chrono::milliseconds DEFAULT_RECALIBRATION_INTERVAL{100};
+
+        EngineClock();
+        ~EngineClock();
+
+        EngineClock(const EngineClock&) = delete;
+        EngineClock& operator=(const EngineClock&) = delete;
+
+        // Starts the background recalibration thread. now_ns() is usable before
+        // start() using the initial calibration done in the constructor.
+        void start(std::chrono::milliseconds interval = DEFAULT_RECALIBRATION_INTERVAL);
+        void stop();
+
+        // Single caller (the engine thread).
+        inline Time_t now_ns() const noexcept {
+            const Time_t t = read_ns_();
+            if (t > last_ns_) last_ns_ = t;
+            return last_ns_;
+        }
+
+        bool using_tsc() const noexcept { return use_tsc_.load(std::memory_order_relaxed); }
+        double tsc_ghz() const noexcept;
+
+    private:
+        struct Sample {
+            uint64_t tsc;
+            Time_t ns;
+        };
+
+        inline Time_t read_ns_() const noexcept {
+            if (!use_tsc_.load(std::memory_order_relaxed)) {
+                return utc_now_ns();
+            }
+
+            uint64_t seq;
+            uint64_t tsc_base;
+            Time_t ns_base;
+            double ns_per_tick;
+            do {
+                seq = seq_.load(std::memory_order_acquire);
+                tsc_base = tsc_base_.load(std::memory_order_relaxed);
+                ns_base = ns_base_.load(std::memory_order_relaxed);
+                ns_per_tick = ns_per_tick_.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+            } while ((seq & 1) || seq != seq_.load(std::memory_order_relaxed));
+
+            return project_(read_tsc(), tsc_base, ns_base, ns_per_tick);
+        }
+
+        static inline Time_t project_(uint64_t tsc, uint64_t tsc_base, Time_t ns_base, double ns_per_tick) noexcept {
+            const int64_t delta = static_cast<int64_t>(tsc - tsc_base);
+            return ns_base + static_cast<Time_t>(static_cast<int64_t>(static_cast<double>(delta) * ns_per_tick));
+        }
+
+        static bool cpu_has_invariant_tsc_() noexcept;
+        static Sample take_sample_() noexcept;
+
+        void calibrate_initial_();
+        // False when the sample was unusable; the baseline restarts from it.
+        bool recalibrate_(std::chrono::milliseconds interval);
+        void publish_(uint64_t tsc_base, Time_t ns_base, double ns_per_tick) noexcept;
+        void calibration_loop_(std::chrono::milliseconds interval);
+
+        // Accepted TSC frequency range; anything outside means the counter is not usable.
+        static constexpr double MIN_TSC_GHZ = 0.2;
+        static constexpr double MAX_TSC_GHZ = 10.0;
+        // Prediction error beyond which the long calibration baseline is restarted
+        // (e.g. after an NTP step of the realtime clock).
+        static constexpr int64_t MAX_ANCHOR_ERROR_NS = 1'000'000;
+        // Largest rate correction applied while slewing (500 ppm).
+        static constexpr double MAX_SLEW = 500e-6;
+        static constexpr int MAX_CALIBRATION_FAILURES = 5;
+        static constexpr int INITIAL_CALIBRATION_ATTEMPTS = 3;
+
+        alignas(64) std::atomic<uint64_t> seq_{0};
+        std::atomic<uint64_t> tsc_base_{0};
+        std::atomic<Time_t> ns_base_{0};
+        std::atomic<double> ns_per_tick_{0.0};
+        std::atomic<bool> use_tsc_{false};
+
+        // Calibration thread only.
+        Sample origin_{};
+        double ns_per_tick_estimate_ = 0.0; // unslewed, from the baseline
+        int consecutive_failures_ = 0;
+
+        // Engine thread only.
+        mutable Time_t last_ns_ = 0;
+
+        std::atomic<bool> running_{false};
+        std::mutex wake_mtx_;
+        std::condition_variable wake_cv_;
+        std::thread calibrator_;
+};
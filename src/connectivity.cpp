@@ -1,26 +1,33 @@
 #include "connectivity.hpp"
 #include <boost/asio/write.hpp>
 #include <algorithm>
+#include <limits>
+#include <optional>
 #include "logging.hpp"
+#include "metrics.hpp"
 
 TG_INLINE_GLOBAL_LOGGER_WITH_CHANNEL(LG_CON, "CON")
 
 Connection::Connection(
     boost::asio::io_context& context,
-    tcp::socket&& socket,
+    StreamSocket&& socket,
     Id_t id,
     InboundQueue& inbound_to_engine,
-    OutboundQueue& outbound_from_engine
+    OutboundQueue& outbound_from_engine,
+    bool use_strand,
+    ConnectionRole role
 )
-  : context_(context)
+  : Session(id)
+  , context_(context)
   , socket_(std::move(socket))
-  , id_(id)
-  , io_strand_(socket_.get_executor())
+  , io_executor_(use_strand
+        ? boost::asio::any_io_executor(boost::asio::make_strand(socket_.get_executor()))
+        : socket_.get_executor())
   , inbound_to_engine_(inbound_to_engine)
-  , outbound_from_engine_(outbound_from_engine) {
-        in_accum_.resize(READ_SIZE * 2);
-        in_used_ = 0;
-    }
+  , outbound_from_engine_(outbound_from_engine)
+  , in_ring_(READ_SIZE * 2)
+  , role_(role)
+  , cork_timer_(socket_.get_executor()) {}
 
 Connection::~Connection() {
     close();
@@ -36,6 +43,26 @@ void Connection::close() {
     }
 }
 
+void Connection::retire(std::function<void()> on_retired) {
+    // Posted rather than dispatched: it queues behind any wakeup the engine
+    // posted before it stopped sending.
+    boost::asio::post(io_executor_, [this, on_retired = std::move(on_retired)]() mutable {
+        retiring_ = true;
+        on_retired_ = std::move(on_retired);
+        close();
+        cork_timer_.cancel();
+        finish_retire_if_idle_();
+    });
+}
+
+void Connection::finish_retire_if_idle_() {
+    if (!retiring_ || outstanding_ != 0 || !on_retired_) return;
+    // Last touch of this object: the callback may hand it off for destruction.
+    std::function<void()> done = std::move(on_retired_);
+    on_retired_ = nullptr;
+    done();
+}
+
 void Connection::notify_disconnect_once_(const boost::system::error_code& ec) {
     bool expected = false;
     if (!disconnect_notified_.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
@@ -52,32 +79,69 @@ void Connection::notify_disconnect_once_(const boost::system::error_code& ec) {
 }
 
 void Connection::notify_inbound_ready_() noexcept {
-    if (!inbound_ready) return;
+    if (!inbound_ready || retiring_) return;
 
     bool expected = false;
     if (!inbound_ready_pending_.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
         return; // already scheduled
     }
 
-    boost::asio::post(io_strand_, [this] {
+    // Posted from the I/O executor, so it may land behind a retire().
+    ++outstanding_;
+    boost::asio::post(io_executor_, [this] {
+        --outstanding_;
         inbound_ready_pending_.store(false, std::memory_order_release);
-        if (inbound_ready && !disconnect_notified_.load(std::memory_order_acquire)) {
+        if (inbound_ready && !retiring_ && !disconnect_notified_.load(std::memory_order_acquire)) {
             inbound_ready();
         }
+        finish_retire_if_idle_();
     });
 }
 
+void Connection::set_socket_profile(SocketProfile profile) noexcept {
+    const SocketTuning t = socket_tuning(profile);
+    set_send_policy(t.send_mode, std::chrono::microseconds(t.cork_window_us), static_cast<size_t>(t.cork_bytes));
+    if (!is_tcp_socket(socket_)) return;
+    apply_socket_profile(socket_, profile);
+    quick_ack_ = t.quick_ack;
+}
+
+void Connection::set_send_policy(SendMode mode, std::chrono::microseconds window, size_t flush_bytes) noexcept {
+    send_mode_ = mode;
+    cork_window_ = window;
+    cork_bytes_ = flush_bytes;
+}
+
 void Connection::async_read() {
-    boost::asio::dispatch(io_strand_, [this] { start_read_(); });
+    boost::asio::dispatch(io_executor_, [this] { start_read_(); });
 }
 
 void Connection::start_read_() {
+  // Complete frames are always consumed, so only a partial frame or packet is
+  // left unread. A v1 frame is at most WIRE_HEADER_SIZE + MAX_PAYLOAD_SIZE and a
+  // v2 packet at most its header plus 64 KiB, both within the ring's capacity,
+  // but on the compacting fallback the partial one may sit too far along the
+  // buffer to complete. Compact it to the front; a zero-length read would
+  // complete at once and spin this thread.
+  if (in_ring_.writable() == 0) {
+      in_ring_.compact();
+      if (in_ring_.writable() == 0) {
+          RLOG(LG_CON, LogLevel::LL_WARNING) << "conn=" << id_
+                 << " protocol violation: frame larger than the read buffer; closing\n";
+          metrics_thread_shard().count_drop(DropReason::PROTOCOL_VIOLATION);
+          notify_disconnect_once_(boost::asio::error::fault);
+          return;
+      }
+  }
+  ++outstanding_;
   socket_.async_read_some(
-      boost::asio::buffer(read_tmp_.data(), read_tmp_.size()),
+      boost::asio::buffer(in_ring_.write_ptr(), in_ring_.writable()),
       boost::asio::bind_executor(
-          io_strand_,
+          io_executor_,
           [this](const boost::system::error_code& ec, size_t n) {
+            --outstanding_;
             handle_read_(ec, n);
+            finish_retire_if_idle_();
           }
       )
   );
@@ -91,113 +155,167 @@ void Connection::handle_read_(const boost::system::error_code& ec, size_t n) {
         return;
     }
 
-    if (in_used_ + n > in_accum_.size()) {
-        size_t new_sz = in_accum_.size();
-        while (new_sz < in_used_ + n) {
-            new_sz *= 2;
-        }
-        in_accum_.resize(new_sz);
+    if (quick_ack_) {
+        rearm_quick_ack(socket_);
+    }
+
+    if (retiring_) {
+        return; // the engine has let go of this session; drop what arrived
     }
 
-    std::memcpy(in_accum_.data() + in_used_, read_tmp_.data(), n);
-    in_used_ += n;
+    in_ring_.commit(n);
 
-    parse_accumulator_();
+    parse_inbound_();
     if (!disconnect_notified_.load(std::memory_order_acquire)) {
         start_read_();
     }
 }
 
-void Connection::parse_accumulator_() {
-    size_t offset = 0;
+void Connection::parse_inbound_() {
+    if (in_v2_) {
+        parse_inbound_v2_();
+        return;
+    }
 
     while (true) {
-        if (in_used_ - offset < WIRE_HEADER_SIZE) {
+        const size_t available = in_ring_.readable();
+        if (available < WIRE_HEADER_SIZE) {
             break;
         }
 
-        const uint8_t type_u8 = in_accum_[offset + 0];
-        const uint16_t payload_size = read_u16_be(in_accum_.data() + offset + 1);
-
-        const size_t frame_sz = WIRE_HEADER_SIZE + payload_size;
-        if (in_used_ - offset < frame_sz) {
-            break; // partial frame, wait for more bytes
-        }
+        const uint8_t* frame = in_ring_.read_ptr();
+        const uint8_t type_u8 = frame[0];
+        const uint16_t payload_size = read_u16_le(frame + 1);
 
+        // Checked on the header alone: waiting for an oversized payload would
+        // let the peer fill the read buffer first.
         if (payload_size > MAX_PAYLOAD_SIZE) {
             RLOG(LG_CON, LogLevel::LL_WARNING) << "conn=" << id_
                    << " protocol violation: payload_size=" << payload_size
                    << " > MAX_PAYLOAD_SIZE=" << MAX_PAYLOAD_SIZE
                    << " (type_u8=" << static_cast<unsigned>(type_u8)
                    << "); closing\n";
+            metrics_thread_shard().count_drop(DropReason::PROTOCOL_VIOLATION);
             notify_disconnect_once_(boost::asio::error::fault);
             return;
         }
 
+        const size_t frame_sz = WIRE_HEADER_SIZE + payload_size;
+        if (available < frame_sz) {
+            break; // partial frame, wait for more bytes
+        }
+
         const Message_t message_type = static_cast<Message_t>(static_cast<MessageType>(type_u8));
-        const uint8_t* payload_ptr = in_accum_.data() + offset + WIRE_HEADER_SIZE;
-
-        if (payload_size <= MAX_PAYLOAD_SIZE_BUFFER) {
-            InboundMessage msg{};
-            msg.connection_id = id_;
-            msg.message_type = message_type;
-            msg.payload_size = payload_size;
-            if (payload_size) {
-                std::memcpy(msg.payload.data(), payload_ptr, payload_size);
-            }
+        const uint8_t* payload_ptr = frame + WIRE_HEADER_SIZE;
 
-            if (!inbound_to_engine_.try_push(msg)) {
-                // Backpressure policy: disconnect on sustained overload.
-                RLOG(LG_CON, LogLevel::LL_WARNING) << "conn=" << id_
-                       << " inbound queue backpressure: try_push failed "
-                       << "(type_u8=" << static_cast<unsigned>(type_u8)
-                       << " payload_size=" << payload_size
-                       << "); closing\n";
-                notify_disconnect_once_(boost::asio::error::no_buffer_space);
-                return;
-            }
-            notify_inbound_ready_();
-            RLOG(LG_CON, LogLevel::LL_DEBUG) << "conn=" << id_
-                   << " inbound frame queued: type_u8=" << static_cast<unsigned>(type_u8)
-                   << " payload_size=" << payload_size
-                   << " frame_sz=" << frame_sz
-                   << '\n';
-            offset += frame_sz;
-        } else {
-            if (large_message_received) {
-                RLOG(LG_CON, LogLevel::LL_DEBUG) << "conn=" << id_
-                   << " large inbound frame: type_u8=" << static_cast<unsigned>(type_u8)
-                   << " payload_size=" << payload_size
-                   << " (unbuffered callback path)\n";
-                auto buf = std::make_shared<std::vector<uint8_t>>(payload_size);
-                if (payload_size) std::memcpy(buf->data(), payload_ptr, payload_size);
-                large_message_received(id_, message_type, std::move(buf));
-            }
-            offset += frame_sz;
+        if (role_ == ConnectionRole::SERVER && static_cast<MessageType>(type_u8) == MessageType::CONFIRM_CONNECTED) {
+            RLOG(LG_CON, LogLevel::LL_WARNING) << "conn=" << id_
+                   << " protocol violation: CONFIRM_CONNECTED from a client; closing\n";
+            metrics_thread_shard().count_drop(DropReason::PROTOCOL_VIOLATION);
+            notify_disconnect_once_(boost::asio::error::fault);
+            return;
+        }
+
+        if (!deliver_inbound_(message_type, payload_ptr, payload_size)) {
+            return;
+        }
+        const bool switch_to_v2 = role_ == ConnectionRole::CLIENT
+            && confirms_v2_(message_type, payload_ptr, payload_size, in_price_base_);
+        in_ring_.consume(frame_sz);
+
+        if (switch_to_v2) {
+            RLOG(LG_CON, LogLevel::LL_INFO) << "conn=" << id_ << " inbound switched to protocol v2\n";
+            in_v2_ = true;
+            parse_inbound_v2_();
+            return;
         }
+    }
+}
 
+void Connection::parse_inbound_v2_() {
+    while (true) {
+        bool keep_open = true;
+        const size_t packet_sz = v2_read_packet(in_ring_.read_ptr(), in_ring_.readable(), in_price_base_,
+            [this, &keep_open](Message_t type, const uint8_t* payload, uint16_t payload_size) {
+                if (keep_open) keep_open = deliver_inbound_(type, payload, payload_size);
+            });
+
+        if (packet_sz == 0) {
+            break; // partial packet, wait for more bytes
+        }
+        if (packet_sz == std::numeric_limits<size_t>::max()) {
+            RLOG(LG_CON, LogLevel::LL_WARNING) << "conn=" << id_ << " protocol violation: malformed v2 packet; closing\n";
+            metrics_thread_shard().count_drop(DropReason::PROTOCOL_VIOLATION);
+            notify_disconnect_once_(boost::asio::error::fault);
+            return;
+        }
+        if (!keep_open) {
+            return;
+        }
+        in_ring_.consume(packet_sz);
     }
+}
 
-    if (offset > 0) {
-        const size_t remaining = in_used_ - offset;
-        if (remaining) {
-            std::memmove(in_accum_.data(), in_accum_.data() + offset, remaining);
+bool Connection::deliver_inbound_(Message_t message_type, const uint8_t* payload, uint16_t payload_size) {
+    if (payload_size > MAX_PAYLOAD_SIZE_BUFFER) {
+        if (large_message_received) {
+            RLOG(LG_CON, LogLevel::LL_DEBUG) << "conn=" << id_
+               << " large inbound frame: type_u8=" << static_cast<unsigned>(message_type)
+               << " payload_size=" << payload_size
+               << " (unbuffered callback path)\n";
+            // Borrowed straight from the read ring; nothing is copied.
+            large_message_received(id_, message_type, payload, payload_size);
         }
-        RLOG(LG_CON, LogLevel::LL_DEBUG) << "conn=" << id_
-               << " parse consumed " << offset
-               << " bytes; remaining=" << remaining
-               << '\n';
-        in_used_ = remaining;
+        return true;
+    }
+
+    InboundMessage msg{};
+    msg.connection_id = id_;
+    msg.message_type = message_type;
+    msg.payload_size = payload_size;
+    if (payload_size) {
+        std::memcpy(msg.payload.data(), payload, payload_size);
     }
+
+    if (!inbound_to_engine_.try_push(msg)) {
+        // Backpressure policy: disconnect on sustained overload.
+        RLOG(LG_CON, LogLevel::LL_WARNING) << "conn=" << id_
+               << " inbound queue backpressure: try_push failed "
+               << "(type_u8=" << static_cast<unsigned>(message_type)
+               << " payload_size=" << payload_size
+               << "); closing\n";
+        metrics_thread_shard().count_drop(DropReason::INBOUND_BACKPRESSURE);
+        notify_disconnect_once_(boost::asio::error::no_buffer_space);
+        return false;
+    }
+    notify_inbound_ready_();
+    RLOG(LG_CON, LogLevel::LL_DEBUG) << "conn=" << id_
+           << " inbound frame queued: type_u8=" << static_cast<unsigned>(message_type)
+           << " payload_size=" << payload_size
+           << '\n';
+    return true;
+}
+
+bool Connection::confirms_v2_(Message_t type, const uint8_t* payload, uint16_t payload_size, Price_t& price_base) noexcept {
+    if (static_cast<MessageType>(type) != MessageType::CONFIRM_CONNECTED || payload_size != sizeof(PayloadConfirmConnected)) {
+        return false;
+    }
+    PayloadConfirmConnected confirm;
+    std::memcpy(&confirm, payload, sizeof(confirm));
+    if (confirm.protocol_version != PROTOCOL_V2) {
+        return false;
+    }
+    price_base = confirm.price_base;
+    return true;
 }
 
-void Connection::send_message(Message_t type, const void* payload) noexcept {
+bool Connection::send_message(Message_t type, const void* payload) noexcept {
     const uint16_t payload_size =
         payload_size_for_type(static_cast<MessageType>(type));
 
-    // Enforce buffered size (order book snapshot excluded by design)
+    // Larger payloads (order book snapshot) go through send_message_unbuffered.
     if (payload_size > MAX_PAYLOAD_SIZE_BUFFER) {
-        return;
+        return false;
     }
 
     OutboundMessage msg{};
@@ -213,7 +331,7 @@ void Connection::send_message(Message_t type, const void* payload) noexcept {
                << " outbound queue backpressure: try_push failed "
                << "(type=" << static_cast<unsigned>(type)
                << " payload_size=" << payload_size << ")\n";
-        return;
+        return false;
     }
 
     RLOG(LG_CON, LogLevel::LL_DEBUG) << "conn=" << id_
@@ -221,118 +339,224 @@ void Connection::send_message(Message_t type, const void* payload) noexcept {
            << " payload_size=" << payload_size
            << '\n';
 
-    schedule_drain_writes_();
+    wake_writer_(WIRE_HEADER_SIZE + payload_size);
+    return true;
 }
 
-void Connection::send_message_unbuffered(Message_t type, const void* payload, uint16_t payload_size) noexcept {
+bool Connection::send_message_unbuffered(Message_t type, const void* payload, uint16_t payload_size) noexcept {
     if (payload_size == 0 || payload == nullptr) {
-        return;
+        return false;
+    }
+    if (payload_size <= MAX_PAYLOAD_SIZE_BUFFER) {
+        return send_message(type, payload);
+    }
+    if (payload_size > LargeFramePool::slot_bytes()) {
+        return false;
     }
 
-    constexpr size_t header_size = 1 + 2;
-    const size_t frame_size = header_size + static_cast<size_t>(payload_size);
-
-    // Allocate heap buffer so it stays alive until async_write completes.
-    auto buffer = std::make_shared<std::vector<uint8_t>>(frame_size);
-    (*buffer)[0] = static_cast<uint8_t>(static_cast<MessageType>(type));
+    const size_t slot = large_frames_.acquire();
+    if (slot == LargeFramePool::NONE) {
+        RLOG(LG_CON, LogLevel::LL_WARNING) << "conn=" << id_
+               << " large frame pool exhausted, dropped frame (type=" << static_cast<unsigned>(type)
+               << " payload_size=" << payload_size << ")\n";
+        return false;
+    }
+    std::memcpy(large_frames_.data(slot), payload, payload_size);
 
-    // Serialize payload size as little-endian u16
-    (*buffer)[1] = static_cast<uint8_t>((payload_size >> 8) & 0xFF);
-    (*buffer)[2] = static_cast<uint8_t>(payload_size & 0xFF);
+    // Queued in order with everything else; the element carries the slot index.
+    OutboundMessage msg{};
+    msg.connection_id = id_;
+    msg.message_type = type;
+    msg.payload_size = payload_size;
+    const uint32_t slot_u32 = static_cast<uint32_t>(slot);
+    std::memcpy(msg.payload.data(), &slot_u32, sizeof(slot_u32));
 
+    if (!outbound_from_engine_.try_push(msg)) {
+        large_frames_.release(slot);
+        RLOG(LG_CON, LogLevel::LL_WARNING) << "conn=" << id_
+               << " outbound queue backpressure: dropped large frame (type=" << static_cast<unsigned>(type)
+               << " payload_size=" << payload_size << ")\n";
+        return false;
+    }
 
-    std::memcpy(buffer->data() + header_size, payload, payload_size);
+    wake_writer_(WIRE_HEADER_SIZE + payload_size);
+    return true;
+}
 
-    RLOG(LG_CON, LogLevel::LL_DEBUG) << "conn=" << id_
-           << " send_message_unbuffered scheduled: type=" << static_cast<unsigned>(type)
-           << " payload_size=" << payload_size
-           << " frame_size=" << frame_size
-           << '\n';
+void Connection::wake_writer_(size_t frame_bytes) noexcept {
+    if (poll_driven_writes_) {
+        // The owning IO thread flushes on its next spin.
+    } else if (send_mode_ == SendMode::SOON) {
+        cork_(frame_bytes);
+    } else {
+        schedule_drain_writes_();
+    }
+}
 
-    boost::asio::post(io_strand_, [this, buffer]() {
-    if (!socket_.is_open()) return;
+const uint8_t* Connection::outbound_body_(const OutboundMessage& m) const noexcept {
+    if (m.payload_size <= MAX_PAYLOAD_SIZE_BUFFER) {
+        return m.payload.data();
+    }
+    uint32_t slot;
+    std::memcpy(&slot, m.payload.data(), sizeof(slot));
+    return large_frames_.data(slot);
+}
 
-    boost::asio::async_write(
-        socket_,
-        boost::asio::buffer(*buffer),
-        boost::asio::bind_executor(
-            io_strand_,
-            [this, buffer](const boost::system::error_code& ec, size_t /*n*/) {
-                if (ec) {
-                    RLOG(LG_CON, LogLevel::LL_ERROR) << "conn=" << id_
-                               << " unbuffered write error/disconnect: "
-                               << ec.message() << "\n";
-                    notify_disconnect_once_(ec);
-                }
-            }));
-    });
-    RLOG(LG_CON, LogLevel::LL_DEBUG) << "conn=" << id_
-                           << " unbuffered write complete: bytes_written=" << frame_size
-                           << " (type=" << type
-                           << " payload_size=" << payload_size << ")\n";
+void Connection::release_large_frame_(const OutboundMessage& m) noexcept {
+    if (m.payload_size > MAX_PAYLOAD_SIZE_BUFFER) {
+        uint32_t slot;
+        std::memcpy(&slot, m.payload.data(), sizeof(slot));
+        large_frames_.release(slot);
+    }
 }
 
 
+void Connection::poll_writes() {
+    if (write_in_progress_ || retiring_ || disconnect_notified_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (outbound_from_engine_.peek() == nullptr) {
+        return;
+    }
+    drain_writes_();
+}
+
 void Connection::schedule_drain_writes_() noexcept {
     bool expected = false;
     if (write_wakeup_pending_.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
-        boost::asio::post(io_strand_, [this] { drain_writes_(); });
+        boost::asio::post(io_executor_, [this] { drain_writes_(); });
     }
 }
 
+void Connection::cork_(size_t frame_bytes) noexcept {
+    bool expected = false;
+    if (cork_armed_.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+        // Previous window has closed: everything counted so far was flushed.
+        corked_bytes_ = 0;
+        boost::asio::post(io_executor_, [this] { arm_cork_timer_(); });
+    }
+
+    corked_bytes_ += frame_bytes;
+    if (corked_bytes_ >= cork_bytes_) {
+        corked_bytes_ = 0;
+        schedule_drain_writes_();
+    }
+}
+
+void Connection::arm_cork_timer_() {
+    if (retiring_) return;
+    cork_timer_.expires_after(cork_window_);
+    ++outstanding_;
+    cork_timer_.async_wait(boost::asio::bind_executor(
+        io_executor_,
+        [this](const boost::system::error_code& ec) {
+            --outstanding_;
+            // Disarm before draining so a message queued from here on opens a
+            // new window rather than relying on this drain.
+            cork_armed_.store(false, std::memory_order_release);
+            if (!ec && !disconnect_notified_.load(std::memory_order_acquire)) {
+                drain_writes_();
+            }
+            finish_retire_if_idle_();
+        }));
+}
+
 void Connection::drain_writes_() {
     write_wakeup_pending_.store(false, std::memory_order_release);
 
-    if (write_in_progress_) {
+    if (write_in_progress_ || retiring_) {
         return;
     }
 
     out_batch_len_ = 0;
     out_batch_sent_ = 0;
 
-    while (true) {
-        const OutboundMessage* m = outbound_from_engine_.peek();
-        if (!m) break;
-
-        const uint16_t psz = m->payload_size;
-        const size_t frame_sz = WIRE_HEADER_SIZE + psz;
-
-        if (out_batch_len_ + frame_sz > out_batch_.size()) {
-            RLOG(LG_CON, LogLevel::LL_DEBUG) << "conn=" << id_
-                   << " drain_writes_: batch full at len=" << out_batch_len_
-                   << " next_frame_sz=" << frame_sz
-                   << " batch_capacity=" << out_batch_.size()
-                   << '\n';
-            break;
-        }
+    // v2 messages are packed by a writer over the rest of the batch.
+    std::optional<V2PacketWriter> v2_writer;
+    size_t v2_offset = 0;
+    if (out_v2_) {
+        v2_writer.emplace(out_batch_.data(), out_batch_.size(), out_price_base_);
+    }
 
-        out_batch_[out_batch_len_ + 0] = static_cast<uint8_t>(static_cast<MessageType>(m->message_type));
-        write_u16_be(out_batch_.data() + out_batch_len_ + 1, psz);
-        if (psz) {
-            std::memcpy(out_batch_.data() + out_batch_len_ + WIRE_HEADER_SIZE, m->payload.data(), psz);
+    // Encode straight out of the queue's slots; one consume_n per
+    // contiguous run hands the slots back to the engine.
+    bool batch_full = false;
+    while (!batch_full) {
+        const OutboundMessage* run = nullptr;
+        const size_t n = outbound_from_engine_.peek_n(run, OUTBOUND_Q_CAP);
+        if (n == 0) break;
+
+        size_t taken = 0;
+        for (; taken < n; ++taken) {
+            if (!encode_outbound_(run[taken], v2_writer, v2_offset)) {
+                batch_full = true;
+                break;
+            }
+            release_large_frame_(run[taken]);
         }
+        outbound_from_engine_.consume_n(taken);
+    }
 
-        out_batch_len_ += frame_sz;
-        outbound_from_engine_.consume_one();
-        }
+    if (v2_writer) {
+        out_batch_len_ = v2_offset + v2_writer->finish();
+    }
 
-        if (out_batch_len_ == 0) {
+    if (out_batch_len_ == 0) {
         return;
     }
 
     start_write_();
 }
 
+bool Connection::encode_outbound_(const OutboundMessage& m, std::optional<V2PacketWriter>& v2_writer, size_t& v2_offset) noexcept {
+    const uint16_t psz = m.payload_size;
+
+    if (v2_writer) {
+        return v2_writer->append(m.message_type, outbound_body_(m), psz);
+    }
+
+    const size_t frame_sz = WIRE_HEADER_SIZE + psz;
+
+    if (out_batch_len_ + frame_sz > out_batch_.size()) {
+        RLOG(LG_CON, LogLevel::LL_DEBUG) << "conn=" << id_
+               << " drain_writes_: batch full at len=" << out_batch_len_
+               << " next_frame_sz=" << frame_sz
+               << " batch_capacity=" << out_batch_.size()
+               << '\n';
+        return false;
+    }
+
+    out_batch_[out_batch_len_ + 0] = static_cast<uint8_t>(static_cast<MessageType>(m.message_type));
+    write_u16_le(out_batch_.data() + out_batch_len_ + 1, psz);
+    if (psz) {
+        std::memcpy(out_batch_.data() + out_batch_len_ + WIRE_HEADER_SIZE, outbound_body_(m), psz);
+    }
+
+    out_batch_len_ += frame_sz;
+
+    // Everything after the CONFIRM_CONNECTED that agrees on v2 is v2.
+    if (role_ == ConnectionRole::SERVER && confirms_v2_(m.message_type, m.payload.data(), psz, out_price_base_)) {
+        RLOG(LG_CON, LogLevel::LL_INFO) << "conn=" << id_ << " outbound switched to protocol v2\n";
+        out_v2_ = true;
+        v2_offset = out_batch_len_;
+        v2_writer.emplace(out_batch_.data() + v2_offset, out_batch_.size() - v2_offset, out_price_base_);
+    }
+    return true;
+}
+
 void Connection::start_write_() {
     write_in_progress_ = true;
 
     const size_t remaining = out_batch_len_ - out_batch_sent_;
+    ++outstanding_;
     socket_.async_write_some(
         boost::asio::buffer(out_batch_.data() + out_batch_sent_, remaining),
         boost::asio::bind_executor(
-            io_strand_,
+            io_executor_,
             [this](const boost::system::error_code& ec, size_t n) {
+            --outstanding_;
             handle_write_(ec, n);
+            finish_retire_if_idle_();
             }
         )
     );
@@ -2,9 +2,11 @@
 
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <cstring>
 #include <functional>
+#include <optional>
 #include <type_traits>
 #include <vector>
 
@@ -13,12 +15,19 @@
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/system/error_code.hpp>
 
 #include "types.hpp"
 #include "protocol.hpp"
+#include "protocol_v2.hpp"
 #include "spsc_queue.hpp" // your SPSCQueue<T, N>
+#include "mpsc_queue.hpp"
+#include "socket_options.hpp"
+#include "session.hpp"
+#include "mirror_ring.hpp"
+#include "frame_pool.hpp"
 
 using boost::asio::ip::tcp;
 
@@ -50,86 +59,159 @@ static_assert(std::is_trivially_copyable_v<OutboundMessage>);
 constexpr size_t INBOUND_Q_CAP  = 16384;
 constexpr size_t OUTBOUND_Q_CAP = 65536;
 
-using InboundQueue  = SPSCQueue<InboundMessage, INBOUND_Q_CAP>;
+// Inbound is multi-producer: with the shared io_context every IO thread
+// pushes into the same shard inbox (and disconnects arrive from any of them).
+using InboundQueue  = MPSCQueue<InboundMessage, INBOUND_Q_CAP>;
 using OutboundQueue = SPSCQueue<OutboundMessage, OUTBOUND_Q_CAP>;
 
-class Connection {
+// Payloads above MAX_PAYLOAD_SIZE_BUFFER (snapshots) wait in a pool slot; the
+// queue element carries the slot index, so they keep their place in order.
+constexpr size_t LARGE_FRAME_SLOTS = 64;
+using LargeFramePool = FramePool<MAX_PAYLOAD_SIZE, LARGE_FRAME_SLOTS>;
+
+// Which end of the session a Connection is. The exchange's connections are
+// SERVER: they send CONFIRM_CONNECTED and switch outbound to v2 after it.
+// Client connections switch inbound to v2 when they receive it instead.
+enum class ConnectionRole : uint8_t {SERVER, CLIENT};
+
+class Connection final : public Session {
 public:
     Connection(
         boost::asio::io_context& context,
-        tcp::socket&& socket,
+        StreamSocket&& socket, // TCP or Unix domain
         Id_t id,
-        InboundQueue& inbound_to_engine, // produced by IO thread, consumed by engine thread
-        OutboundQueue& outbound_from_engine // produced by engine thread, consumed by IO thread
+        InboundQueue& inbound_to_engine, // produced by IO threads, consumed by engine thread
+        OutboundQueue& outbound_from_engine, // produced by engine thread, consumed by IO thread
+        // false when the socket's io_context is run by exactly one thread.
+        bool use_strand = true,
+        ConnectionRole role = ConnectionRole::SERVER
     );
 
-    ~Connection();
+    ~Connection() override;
 
     void async_read();
+    void start() override { async_read(); }
 
-    void send_message(Message_t type, const void* payload) noexcept;
-    void send_message_unbuffered(Message_t type, const void* payload, uint16_t payload_size) noexcept;
+    // Applies the profile's send policy and, for TCP sockets, its socket
+    // options; call before async_read().
+    void set_socket_profile(SocketProfile profile) noexcept;
 
-    void close();
-    Id_t id() const noexcept { return id_; }
+    // ASAP: every send_message() wakes the writer. SOON: the first message
+    // opens a window of `window`; the batch is written when it closes or once
+    // `flush_bytes` of frames are queued, whichever comes first.
+    void set_send_policy(SendMode mode, std::chrono::microseconds window, size_t flush_bytes) noexcept;
 
-public:
-    std::function<void(Connection*)> disconnected;
-    // Rare-path hook for payloads larger than MAX_PAYLOAD_SIZE_BUFFER.
-    std::function<void(Id_t, Message_t, std::shared_ptr<std::vector<uint8_t>>)> large_message_received;
-    std::function<void()> inbound_ready;
+    // Returns false if the message was dropped (outbound queue full).
+    bool send_message(Message_t type, const void* payload) noexcept override;
+    // Returns false if the frame was dropped (pool exhausted or queue full).
+    bool send_message_unbuffered(Message_t type, const void* payload, uint16_t payload_size) noexcept override;
+
+    // Busy-poll mode: send_message() no longer posts a write wakeup; the
+    // owning IO thread calls poll_writes() on every spin instead.
+    void set_poll_driven_writes(bool enabled) noexcept { poll_driven_writes_ = enabled; }
+    void poll_writes(); // I/O executor only
 
+    void close() override;
 
+    // Closes the connection on its I/O executor and calls on_retired there
+    // once no operation or handler of it is outstanding; from then on the
+    // owner may destroy it on any thread. Call once, after the producer of
+    // the outbound queue has stopped sending to it.
+    void retire(std::function<void()> on_retired);
+
+    size_t outbound_depth() const noexcept override { return outbound_from_engine_.size_approx(); }
+    size_t outbound_capacity() const noexcept override { return OUTBOUND_Q_CAP; }
+    uint8_t max_protocol_version() const noexcept override { return PROTOCOL_V2; }
 
 private:
-    // I/O strand only
+    // I/O executor only
     void start_read_();
     void handle_read_(const boost::system::error_code& ec, size_t n);
-    void parse_accumulator_();
+    void parse_inbound_();
+    void parse_inbound_v2_();
+    // False if the session must be closed (inbound queue full).
+    bool deliver_inbound_(Message_t message_type, const uint8_t* payload, uint16_t payload_size);
 
+    void wake_writer_(size_t frame_bytes) noexcept; // producer only
     void schedule_drain_writes_() noexcept; // may be called cross-thread
-    void drain_writes_(); // I/O strand only
-    void start_write_(); // I/O strand only
+    void cork_(size_t frame_bytes) noexcept; // producer only
+    void arm_cork_timer_(); // I/O executor only
+    void drain_writes_(); // I/O executor only
+    void start_write_(); // I/O executor only
+    // Appends one message to out_batch_ (switching to v2 after the confirming
+    // CONFIRM_CONNECTED); false if the batch is full.
+    bool encode_outbound_(const OutboundMessage& m, std::optional<V2PacketWriter>& v2_writer, size_t& v2_offset) noexcept;
+    const uint8_t* outbound_body_(const OutboundMessage& m) const noexcept;
+    void release_large_frame_(const OutboundMessage& m) noexcept;
     void handle_write_(const boost::system::error_code& ec, size_t n);
 
     void notify_inbound_ready_() noexcept;
     void notify_disconnect_once_(const boost::system::error_code& ec);
+    void finish_retire_if_idle_(); // I/O executor only
     inline void on_disconnect_() {
         if (disconnected) disconnected(this);
     }
 
     static constexpr size_t WIRE_HEADER_SIZE = 1 + 2; // type (u8) + size (u16)
 
-    static inline void write_u16_be(uint8_t* dst, uint16_t v) noexcept {
-        dst[0] = static_cast<uint8_t>((v >> 8) & 0xFF);
-        dst[1] = static_cast<uint8_t>(v & 0xFF);
+    static inline void write_u16_le(uint8_t* dst, uint16_t v) noexcept {
+        dst[0] = static_cast<uint8_t>(v & 0xFF);
+        dst[1] = static_cast<uint8_t>((v >> 8) & 0xFF);
     }
 
-    static inline uint16_t read_u16_be(const uint8_t* src) noexcept {
-        return (static_cast<uint16_t>(src[0]) << 8) | static_cast<uint16_t>(src[1]);
+    static inline uint16_t read_u16_le(const uint8_t* src) noexcept {
+        return static_cast<uint16_t>(src[0]) | (static_cast<uint16_t>(src[1]) << 8);
     }
 
+    // Protocol version switch, if msg is a CONFIRM_CONNECTED agreeing on v2.
+    static bool confirms_v2_(Message_t type, const uint8_t* payload, uint16_t payload_size, Price_t& price_base) noexcept;
+
 
 private:
     boost::asio::io_context& context_;
-    tcp::socket socket_;
-    Id_t id_;
+    StreamSocket socket_;
 
-    boost::asio::strand<boost::asio::any_io_executor> io_strand_;
+    // A strand over the socket executor, or the executor itself when its
+    // io_context is single-threaded.
+    boost::asio::any_io_executor io_executor_;
 
     InboundQueue& inbound_to_engine_;
     OutboundQueue& outbound_from_engine_;
+    LargeFramePool large_frames_; // acquired by the producer, released on drain
 
-    std::array<uint8_t, READ_SIZE> read_tmp_{};
-
-    std::vector<uint8_t> in_accum_;
-    size_t in_used_ = 0;
+    // Sockets read straight into this ring; frames are parsed in place.
+    MirrorRing in_ring_;
 
     std::array<uint8_t, 64 * 1024> out_batch_{};
     size_t out_batch_len_ = 0;
     size_t out_batch_sent_ = 0;
 
+    // Protocol v2 is entered after the CONFIRM_CONNECTED that agrees on it:
+    // outbound once a SERVER has written it, inbound once a CLIENT has parsed
+    // it. A SERVER never receives one; it closes a peer that sends it.
+    const ConnectionRole role_;
+    bool out_v2_ = false;
+    bool in_v2_ = false;
+    Price_t out_price_base_ = 0;
+    Price_t in_price_base_ = 0;
+
+    SendMode send_mode_ = SendMode::ASAP;
+    std::chrono::microseconds cork_window_{0};
+    size_t cork_bytes_ = 0;
+    boost::asio::steady_timer cork_timer_;
+    size_t corked_bytes_ = 0; // producer only; frames queued in the open window
+    std::atomic<bool> cork_armed_{false};
+
     bool write_in_progress_ = false;
+    bool quick_ack_ = false;
+    bool poll_driven_writes_ = false;
+
+    // I/O executor only. Reads, writes, cork waits and inbound wakeups in
+    // flight; once retiring_, no new work starts and on_retired_ fires when
+    // this reaches zero.
+    size_t outstanding_ = 0;
+    bool retiring_ = false;
+    std::function<void()> on_retired_;
 
     std::atomic<bool> write_wakeup_pending_{false};
     std::atomic<bool> disconnect_notified_{false};
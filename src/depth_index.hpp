@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "types.hpp"
+
+// ------------------------------------------------------------
+// DepthIndex
+// ------------------------------------------------------------
+//
+// Prefix sums of resting volume and notional (volume x price) over one
+// side's price levels, so depth and sweep questions cost O(log levels)
+// instead of a walk over levels_.
+//
+// Design:
+// - A Fenwick tree over level indices; the side applies every change to a
+//   level's total_quantity_ here as well (add_order, matching, cancel,
+//   amend). Sums are unsigned and wrap, so removals are added as negatives.
+// - Each node carries the generation it was written in, like the levels:
+//   reset() bumps the generation and the index is empty in O(1).
+// - descend() finds the level where a running total crosses a target in one
+//   top-down pass, accumulating the sums of the levels before it.
+//
+class DepthIndex {
+    public:
+        static constexpr size_t SIZE = NUM_BOOK_LEVELS;
+
+        struct Sums {
+            uint64_t volume = 0;
+            uint64_t notional = 0;
+        };
+
+        // Level idx changed by delta (negative for removals).
+        inline void add(size_t idx, int64_t delta) noexcept {
+            const uint64_t volume = static_cast<uint64_t>(delta);
+            const uint64_t notional = volume * static_cast<uint64_t>(MINIMUM_BID + static_cast<Price_t>(idx));
+            for (size_t i = idx + 1; i <= SIZE; i += i & (~i + 1)) {
+                Node& n = node_(i);
+                n.volume += volume;
+                n.notional += notional;
+            }
+            total_.volume += volume;
+            total_.notional += notional;
+        }
+
+        // Sums over levels [0, end).
+        inline Sums prefix(size_t end) const noexcept {
+            Sums s;
+            for (size_t i = end < SIZE ? end : SIZE; i > 0; i &= i - 1) {
+                const Node& n = nodes_[i];
+                if (n.generation != generation_) continue;
+                s.volume += n.volume;
+                s.notional += n.notional;
+            }
+            return s;
+        }
+
+        inline const Sums& total() const noexcept { return total_; }
+
+        // Largest pos with prefix(pos).volume < target (or <= target when
+        // inclusive); before receives prefix(pos). With target <= total
+        // (< total when inclusive), level pos holds volume and is where the
+        // running total reaches (passes) target.
+        inline size_t descend(uint64_t target, bool inclusive, Sums& before) const noexcept {
+            size_t pos = 0;
+            before = Sums{};
+            for (size_t step = TOP_STEP; step > 0; step >>= 1) {
+                const size_t next = pos + step;
+                if (next > SIZE) continue;
+                const Node& n = nodes_[next];
+                const uint64_t volume = n.generation == generation_ ? n.volume : 0;
+                const uint64_t reached = before.volume + volume;
+                if (inclusive ? reached <= target : reached < target) {
+                    pos = next;
+                    before.volume = reached;
+                    before.notional += n.generation == generation_ ? n.notional : 0;
+                }
+            }
+            return pos;
+        }
+
+        // Empties the index in O(1).
+        inline void reset() noexcept {
+            if (++generation_ == 0) {
+                // Wrapped: stale stamps could match again, so clear for real.
+                for (Node& n : nodes_) n.generation = 0;
+                generation_ = 1;
+            }
+            total_ = Sums{};
+        }
+
+    private:
+        struct Node {
+            uint64_t volume;
+            uint64_t notional;
+            uint32_t generation; // 0 never matches: generation_ starts at 1
+        };
+
+        // Largest power of two <= SIZE: the first step of descend().
+        static constexpr size_t TOP_STEP = []() {
+            size_t step = 1;
+            while (step * 2 <= SIZE) step *= 2;
+            return step;
+        }();
+
+        inline Node& node_(size_t i) noexcept {
+            Node& n = nodes_[i];
+            if (n.generation != generation_) n = Node{0, 0, generation_};
+            return n;
+        }
+
+        Node nodes_[SIZE + 1]{}; // 1-based
+        Sums total_;
+        uint32_t generation_ = 1;
+};
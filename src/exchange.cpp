@@ -2,54 +2,311 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <stdexcept>
 #include <utility>
 
-#include "time.hpp"
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    #include <unistd.h>
+#endif
+
 
 TG_INLINE_GLOBAL_LOGGER_WITH_CHANNEL(LG_CON, "CON")
 
-Exchange::Exchange(boost::asio::io_context& context, uint16_t port)
-    : context_(context)
-    , accept_strand_(context_.get_executor())
-    , engine_strand_(context_.get_executor())
-    , acceptor_(context_, tcp::endpoint(tcp::v4(), port))
-    , event_logger_("logs") 
+namespace {
+
+// Swallows a scratch book's events; keeps the ids of resting orders so the
+// workload can cancel and amend them.
+struct WarmupBookCallbacks final : OrderBookCallbacks {
+    std::vector<Id_t> resting;
+
+    void on_trade(const Order& maker_order, Id_t, Id_t, Price_t, Volume_t, Volume_t, Volume_t, Time_t) override {
+        if (maker_order.quantity_remaining_ != 0) return;
+        // Filled makers leave the book; without this later cancels and amends
+        // would hit unknown ids and only exercise the error path.
+        const auto it = std::find(resting.begin(), resting.end(), maker_order.order_id_);
+        if (it != resting.end()) {
+            *it = resting.back();
+            resting.pop_back();
+        }
+    }
+    void on_order_inserted(Id_t, const Order& order, Time_t) override { resting.push_back(order.order_id_); }
+    void on_order_cancelled(Id_t, const Order&, Time_t) override {}
+    void on_order_amended(Id_t, Volume_t, const Order&, Time_t) override {}
+    void on_level_update(Side, PriceLevel const&, Time_t) override {}
+    void on_error(Id_t, Id_t, uint16_t, std::string_view, Time_t) override {}
+};
+
+// Inserts, crosses, amends and cancels around the middle of the price range,
+// exercising the same code the engine runs without touching the real book.
+void run_synthetic_orders(size_t count) {
+    auto book = std::make_unique<OrderBook>();
+    WarmupBookCallbacks callbacks;
+    callbacks.resting.reserve(MAX_ORDERS);
+    book->set_callbacks(&callbacks);
+
+    constexpr Price_t MID = MINIMUM_BID + (MAXIMUM_ASK - MINIMUM_BID) / 2;
+    constexpr Id_t CLIENT = 0;
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    auto next = [&state]() noexcept {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    };
+
+    for (size_t i = 0; i < count; ++i) {
+        const uint64_t r = next();
+        const Time_t ts = static_cast<Time_t>(i);
+        const unsigned action = static_cast<unsigned>(r % 10);
+        if (action < 6 || callbacks.resting.empty()) {
+            const bool is_bid = (r >> 8) & 1;
+            // Mostly passive, sometimes crossing by a tick or two.
+            const Price_t offset = static_cast<Price_t>((r >> 16) % 12) - 2;
+            const Price_t price = is_bid ? MID - offset : MID + 1 + offset;
+            const Volume_t qty = static_cast<Volume_t>(1 + (r >> 32) % 50);
+            book->submit_order(price, qty, is_bid, CLIENT, i, ts);
+        } else {
+            const size_t pick = static_cast<size_t>((r >> 16) % callbacks.resting.size());
+            const Id_t order_id = callbacks.resting[pick];
+            callbacks.resting[pick] = callbacks.resting.back();
+            callbacks.resting.pop_back();
+            if (action < 9) {
+                book->cancel_order(CLIENT, i, order_id, ts);
+            } else {
+                book->amend_order(CLIENT, i, order_id, static_cast<Volume_t>(1 + (r >> 32) % 20), ts);
+                if (book->find_order(order_id)) callbacks.resting.push_back(order_id);
+            }
+        }
+    }
+}
+
+} // namespace
+
+Exchange::Exchange(boost::asio::io_context& context, uint16_t port, SocketProfile socket_profile)
+    : Exchange(context, {&context}, port, socket_profile, IoModel::SHARED) {}
+
+Exchange::Exchange(
+    boost::asio::io_context& engine_context,
+    const std::vector<boost::asio::io_context*>& io_contexts,
+    uint16_t port,
+    SocketProfile socket_profile,
+    IoModel io_model,
+    bool poll_driven_writes
+)
+    : engine_strand_(engine_context.get_executor())
+    , socket_profile_(socket_profile)
+    , io_model_(io_model)
+    , poll_driven_writes_(poll_driven_writes && io_model == IoModel::PER_CORE)
+    , event_logger_("logs")
+    , profiler_("logs")
+    , metrics_(metrics_registry().register_shard("engine"))
     {
+        assert(!io_contexts.empty());
+        for (boost::asio::io_context* ctx : io_contexts) {
+            shards_.push_back(std::make_unique<IoShard>(*ctx));
+            inboxes_.push_back(&shards_.back()->inbox);
+        }
+
+        const tcp::endpoint endpoint(tcp::v4(), port);
+#if defined(__linux__) && defined(SO_REUSEPORT)
+        // Every shard binds its own acceptor; the kernel spreads connections.
+        const bool acceptor_per_shard = io_model_ == IoModel::PER_CORE;
+#else
+        const bool acceptor_per_shard = false;
+#endif
+        if (acceptor_per_shard) {
+            for (auto& shard : shards_) {
+                open_listening_acceptor(shard->acceptor, endpoint, /*reuse_port=*/true);
+            }
+        } else {
+            open_listening_acceptor(shards_.front()->acceptor, endpoint);
+            distribute_accepts_ = shards_.size() > 1;
+        }
+
         order_book_.set_callbacks(this);
-        conn_by_id_ = std::make_unique<std::atomic<Connection*>[]>(MAX_CONNECTIONS);
+        conn_by_id_ = std::make_unique<std::atomic<Session*>[]>(MAX_CONNECTIONS);
+        conn_shard_ = std::make_unique<std::atomic<uint16_t>[]>(MAX_CONNECTIONS);
+        pending_disconnects_ = std::make_unique<std::atomic<Id_t>[]>(MAX_CONNECTIONS);
         for (size_t i = 0; i < MAX_CONNECTIONS; ++i) {
             conn_by_id_[i].store(nullptr, std::memory_order_relaxed);
+            conn_shard_[i].store(0, std::memory_order_relaxed);
+            pending_disconnects_[i].store(NO_CONNECTION_ID, std::memory_order_relaxed);
         }
 
     }
 
 Exchange::~Exchange() {
     stop();
+    // IO threads are joined by now; connections can be destroyed safely.
+    for (auto& shard : shards_) {
+        shard->clients.clear();
+    }
+#if defined(__linux__)
+    shm_.reset();
+#endif
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    if (unix_acceptor_) {
+        unix_acceptor_.reset();
+        ::unlink(unix_path_.c_str());
+    }
+#endif
+}
+
+void Exchange::enable_shm_transport(const std::string& socket_path) {
+#if defined(__linux__)
+    assert(!running_.load(std::memory_order_acquire) && !shm_);
+    shm_ = std::make_unique<ShmTransportServer>(
+        socket_path,
+        [this] { return allocate_connection_id_(); },
+        [this](Id_t id) { release_connection_id_(id); });
+    shm_->session_opened = [this](ShmSession* session) {
+        const size_t slot = connection_slot(session->id());
+        conn_shard_[slot].store(SHM_SHARD, std::memory_order_relaxed);
+        conn_by_id_[slot].store(session, std::memory_order_release);
+    };
+    shm_->inbound_ready = [this] {
+        if (!running_.load(std::memory_order_acquire)) return;
+        schedule_engine_drain();
+    };
+    inboxes_.push_back(&shm_->inbox());
+#else
+    (void)socket_path;
+    throw std::runtime_error("shared-memory transport is only available on Linux");
+#endif
+}
+
+void Exchange::enable_unix_listener(const std::string& path) {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    using local_stream = boost::asio::local::stream_protocol;
+    assert(!running_.load(std::memory_order_acquire) && !unix_acceptor_);
+    remove_stale_socket_file(path);
+    unix_acceptor_ = std::make_unique<local_stream::acceptor>(shards_.front()->context, local_stream::endpoint(path));
+    unix_path_ = path;
+#else
+    (void)path;
+    throw std::runtime_error("Unix domain sockets are not available on this platform");
+#endif
+}
+
+Id_t Exchange::allocate_connection_id_() {
+    std::lock_guard<std::mutex> lock(connection_ids_mutex_);
+    size_t slot;
+    if (next_connection_slot_ < MAX_CONNECTIONS) {
+        slot = next_connection_slot_++;
+    } else if (!free_connection_slots_.empty()) {
+        slot = free_connection_slots_.front();
+        free_connection_slots_.pop_front();
+    } else {
+        return NO_CONNECTION_ID;
+    }
+    Id_t id = static_cast<Id_t>(connection_generation_[slot] * MAX_CONNECTIONS + slot);
+    if (id == NO_CONNECTION_ID) {
+        // One slot in 2^27 generations; skip the sentinel.
+        ++connection_generation_[slot];
+        id = static_cast<Id_t>(connection_generation_[slot] * MAX_CONNECTIONS + slot);
+    }
+    return id;
+}
+
+void Exchange::release_connection_id_(Id_t id) {
+    const size_t slot = connection_slot(id);
+    std::lock_guard<std::mutex> lock(connection_ids_mutex_);
+    ++connection_generation_[slot];
+    free_connection_slots_.push_back(slot);
+}
+
+MemoryWarmupReport Exchange::warm_up(const MemoryWarmupOptions& options) {
+    assert(!running_.load(std::memory_order_acquire));
+    const auto started = std::chrono::steady_clock::now();
+    MemoryWarmup warmup(options);
+
+    // Book sides and pools, logger queues and staging buffers live inline.
+    warmup.add_object(*this);
+    order_book_.for_each_heap_buffer([&warmup](void* data, size_t bytes) { warmup.add(data, bytes); });
+    for (auto& shard : shards_) {
+        warmup.add_object(*shard);
+    }
+#if defined(__linux__)
+    if (shm_) warmup.add_object(shm_->inbox());
+#endif
+    warmup.add(conn_by_id_.get(), MAX_CONNECTIONS * sizeof(conn_by_id_[0]));
+    warmup.add(conn_shard_.get(), MAX_CONNECTIONS * sizeof(conn_shard_[0]));
+    warmup.add(pending_disconnects_.get(), MAX_CONNECTIONS * sizeof(pending_disconnects_[0]));
+
+    market_data_subscribers_.reserve(MAX_CONNECTIONS);
+    warmup.add(market_data_subscribers_.data(), market_data_subscribers_.capacity() * sizeof(Id_t));
+
+    {
+        std::lock_guard<std::mutex> lock(spare_outboxes_mutex_);
+        const size_t spares = std::min(options.spare_outboxes, MAX_CONNECTIONS);
+        while (spare_outboxes_.size() < spares) {
+            spare_outboxes_.push_back(std::make_unique<OutboundQueue>());
+            warmup.add_object(*spare_outboxes_.back());
+        }
+    }
+
+    if (options.synthetic_orders) {
+        run_synthetic_orders(options.synthetic_orders);
+        warmup.report().synthetic_orders = options.synthetic_orders;
+    }
+
+    warmup.report().seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return warmup.report();
 }
 
 void Exchange::start() {
     running_.store(true, std::memory_order_release);
-    boost::asio::dispatch(accept_strand_, [this] { do_accept_(); });
+    clock_.start();
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (!shards_[i]->acceptor.is_open()) continue;
+        boost::asio::dispatch(shards_[i]->accept_strand, [this, i] { do_accept_(i); });
+    }
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    if (unix_acceptor_) {
+        boost::asio::dispatch(shards_.front()->accept_strand, [this] { do_accept_unix_(); });
+    }
+#endif
+#if defined(__linux__)
+    if (shm_) shm_->start();
+#endif
 }
 
 void Exchange::stop() {
     const bool was_running = running_.exchange(false, std::memory_order_acq_rel);
-
-    boost::asio::dispatch(accept_strand_, [this] {
-    boost::system::error_code ec;
-    acceptor_.close(ec);
-    for (auto& [id, state] : clients_) {
-        if (state.conn) {
-            state.conn->close();
+    clock_.stop();
+
+    for (auto& shard_ptr : shards_) {
+        IoShard* shard = shard_ptr.get();
+        boost::asio::dispatch(shard->accept_strand, [shard] {
+        boost::system::error_code ec;
+        shard->acceptor.close(ec);
+        for (auto& [id, state] : shard->clients) {
+            if (state.conn) {
+                state.conn->close();
+            }
         }
+        });
     }
-    });
-
-    for (size_t i = 0; i < MAX_CONNECTIONS; ++i) {
-        conn_by_id_[i].store(nullptr, std::memory_order_relaxed);
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    if (unix_acceptor_) {
+        boost::asio::dispatch(shards_.front()->accept_strand, [this] {
+            boost::system::error_code ec;
+            unix_acceptor_->close(ec);
+        });
     }
-    clients_.clear();
-    market_data_subscribers_.clear();
+#endif
+#if defined(__linux__)
+    if (shm_) shm_->stop();
+#endif
+
+    // Engine state: cleared on the engine strand, behind any drain in flight.
+    boost::asio::dispatch(engine_strand_, [this] {
+        for (size_t i = 0; i < MAX_CONNECTIONS; ++i) {
+            conn_by_id_[i].store(nullptr, std::memory_order_relaxed);
+        }
+        market_data_subscribers_.clear();
+    });
 }
 
 void Exchange::schedule_engine_drain() {
@@ -60,54 +317,166 @@ void Exchange::schedule_engine_drain() {
     boost::asio::post(engine_strand_, [this] {
         engine_drain_scheduled_.store(false, std::memory_order_release);
 
-        InboundMessage msg{};
-        std::size_t budget = 10000; // tune
-        while (budget-- && inbox_.try_pop(msg)) {
-            dispatch_(msg);
+        const std::size_t budget = 10000 / inboxes_.size() + 1; // tune; per inbox so none starves
+        std::size_t drained = 0;
+        bool pending = false;
+        for (InboundQueue* inbox : inboxes_) {
+            std::size_t inbox_budget = budget;
+            // Dispatch in place, releasing slots to the IO thread once per run.
+            while (inbox_budget) {
+                const InboundMessage* run = nullptr;
+                const std::size_t n = inbox->peek_n(run, std::min(inbox_budget, ENGINE_DRAIN_RUN));
+                if (n == 0) break;
+                for (std::size_t i = 0; i < n; ++i) {
+                    dispatch_(run[i]);
+                }
+                inbox->consume_n(n);
+                inbox_budget -= n;
+                drained += n;
+            }
+            pending |= inbox->size_approx() != 0;
         }
+        remove_pending_disconnects_();
+        publish_gauges_(drained);
 
-        if (running_.load(std::memory_order_acquire) && inbox_.size_approx() != 0) {
+        if (running_.load(std::memory_order_acquire) && pending) {
             schedule_engine_drain();
         }
     });
 }
 
+void Exchange::remove_pending_disconnects_() {
+    if (!disconnects_pending_.exchange(false, std::memory_order_acq_rel)) return;
+    for (size_t i = 0; i < MAX_CONNECTIONS; ++i) {
+        const Id_t id = pending_disconnects_[i].exchange(NO_CONNECTION_ID, std::memory_order_acq_rel);
+        if (id != NO_CONNECTION_ID) {
+            remove_connection_(id);
+        }
+    }
+}
+
+void Exchange::publish_gauges_(size_t drained) noexcept {
+    metrics_.drain_batch.record(drained);
 
-void Exchange::do_accept_() {
-  acceptor_.async_accept(
+    if (book_changed_) {
+        order_book_.build_depth(depth_scratch_);
+        book_depth_.store(depth_scratch_);
+        book_changed_ = false;
+    }
+
+    size_t inbox_depth = 0;
+    for (InboundQueue* inbox : inboxes_) inbox_depth += inbox->size_approx();
+
+    EngineGauges& g = metrics_registry().gauges();
+    g.inbox_depth.store(inbox_depth, std::memory_order_relaxed);
+    g.logger_backlog.store(event_logger_.backlog_approx(), std::memory_order_relaxed);
+    g.book_levels[0].store(order_book_.bids.num_active_levels_, std::memory_order_relaxed);
+    g.book_levels[1].store(order_book_.asks.num_active_levels_, std::memory_order_relaxed);
+    g.pool_in_use[0].store(order_book_.bids.pool_.in_use_, std::memory_order_relaxed);
+    g.pool_in_use[1].store(order_book_.asks.pool_.in_use_, std::memory_order_relaxed);
+    g.pool_capacity.store(MAX_ORDERS, std::memory_order_relaxed);
+    for (size_t i = 0; i < MAX_CONNECTIONS; ++i) {
+        Session* c = conn_by_id_[i].load(std::memory_order_acquire);
+        g.connected[i].store(c != nullptr, std::memory_order_relaxed);
+        g.outbox_depth[i].store(c ? c->outbound_depth() : 0, std::memory_order_relaxed);
+    }
+}
+
+void Exchange::do_accept_(size_t shard_idx) {
+  IoShard& shard = *shards_[shard_idx];
+  const size_t target_idx = distribute_accepts_ ? next_accept_shard_++ % shards_.size() : shard_idx;
+  // The accepted socket is created on the target shard's io_context.
+  shard.acceptor.async_accept(
+      shards_[target_idx]->context,
       boost::asio::bind_executor(
-          accept_strand_,
-          [this](boost::system::error_code ec, tcp::socket socket) {
-            on_accepted_(ec, std::move(socket));
+          shard.accept_strand,
+          [this, shard_idx, target_idx](boost::system::error_code ec, tcp::socket socket) {
+            on_accepted_(shard_idx, target_idx, ec, std::move(socket));
           }
         )
     );
 }
 
-void Exchange::on_accepted_(boost::system::error_code ec, tcp::socket socket) {
+void Exchange::on_accepted_(size_t shard_idx, size_t target_idx, boost::system::error_code ec, tcp::socket socket) {
+    IoShard& shard = *shards_[shard_idx];
     if (ec) {
         if (ec == boost::asio::error::operation_aborted) return;
         RLOG(LG_CON, LogLevel::LL_ERROR) << "[Exchange] accept error: " << ec.message();
-        if (acceptor_.is_open()) do_accept_();
+        if (shard.acceptor.is_open()) do_accept_(shard_idx);
         return;
     }
 
-    const Id_t id = next_connection_id_++;
+    if (target_idx == shard_idx) {
+        register_connection_(target_idx, std::move(socket));
+    } else {
+        boost::asio::post(shards_[target_idx]->accept_strand,
+            [this, target_idx, s = StreamSocket(std::move(socket))]() mutable {
+                register_connection_(target_idx, std::move(s));
+            });
+    }
+
+    if (shard.acceptor.is_open()) {
+        do_accept_(shard_idx);
+    }
+}
+
+void Exchange::do_accept_unix_() {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    using local_stream = boost::asio::local::stream_protocol;
+    const size_t target_idx = next_accept_shard_++ % shards_.size();
+    unix_acceptor_->async_accept(
+        shards_[target_idx]->context,
+        boost::asio::bind_executor(
+            shards_.front()->accept_strand,
+            [this, target_idx](boost::system::error_code ec, local_stream::socket socket) {
+                if (ec) {
+                    if (ec == boost::asio::error::operation_aborted) return;
+                    RLOG(LG_CON, LogLevel::LL_ERROR) << "[Exchange] unix accept error: " << ec.message();
+                } else {
+                    boost::asio::post(shards_[target_idx]->accept_strand,
+                        [this, target_idx, s = StreamSocket(std::move(socket))]() mutable {
+                            register_connection_(target_idx, std::move(s));
+                        });
+                }
+                if (unix_acceptor_->is_open()) do_accept_unix_();
+            }
+        )
+    );
+#endif
+}
+
+void Exchange::register_connection_(size_t shard_idx, StreamSocket socket) {
+    IoShard& shard = *shards_[shard_idx];
+    const Id_t id = allocate_connection_id_();
+    if (id == NO_CONNECTION_ID) {
+        RLOG(LG_CON, LogLevel::LL_WARNING) << "[Exchange] connection limit reached, rejecting.";
+        boost::system::error_code ignored;
+        socket.close(ignored);
+        return;
+    }
+    conn_shard_[connection_slot(id)].store(static_cast<uint16_t>(shard_idx), std::memory_order_relaxed);
 
     ClientState state;
-    state.outbox = std::make_unique<OutboundQueue>();
-    state.conn = std::make_unique<Connection>(context_, std::move(socket), id, inbox_, *state.outbox);
+    state.outbox = take_outbox_();
+    state.conn = std::make_unique<Connection>(
+        shard.context, std::move(socket), id, shard.inbox, *state.outbox,
+        io_model_ == IoModel::SHARED);
+    state.conn->set_socket_profile(socket_profile_);
+    state.conn->set_poll_driven_writes(poll_driven_writes_);
 
     Connection* ptr = state.conn.get();
 
-    ptr->disconnected = [this](Connection* c) {
+    ptr->disconnected = [this, &shard](Session* c) {
         InboundMessage m{};
         m.connection_id = c->id();
         m.message_type = static_cast<Message_t>(MessageType::DISCONNECT);
         m.payload_size = 0;
-        if (inbox_.try_push(m)) {
-            schedule_engine_drain();
+        if (!shard.inbox.try_push(m)) {
+            // Closed because the inbox is full: the next drain removes it instead.
+            pending_disconnects_[connection_slot(m.connection_id)].store(m.connection_id, std::memory_order_release);
+            disconnects_pending_.store(true, std::memory_order_release);
         }
+        schedule_engine_drain();
     };
     ptr->inbound_ready = [this] {
         if (!running_.load(std::memory_order_acquire)) return;
@@ -115,22 +484,38 @@ void Exchange::on_accepted_(boost::system::error_code ec, tcp::socket socket) {
     };
 
     ptr->async_read();
-    publish_connection_(id, std::move(state));
-    if (acceptor_.is_open()) {
-        do_accept_();
+    publish_connection_(shard, id, std::move(state));
+}
+
+std::unique_ptr<OutboundQueue> Exchange::take_outbox_() {
+    {
+        std::lock_guard<std::mutex> lock(spare_outboxes_mutex_);
+        if (!spare_outboxes_.empty()) {
+            std::unique_ptr<OutboundQueue> outbox = std::move(spare_outboxes_.back());
+            spare_outboxes_.pop_back();
+            return outbox;
+        }
     }
+    return std::make_unique<OutboundQueue>();
 }
 
-void Exchange::publish_connection_(Id_t id, ClientState&& state) {
-    if (id >= MAX_CONNECTIONS) {
-        return;
+void Exchange::poll_outboxes(size_t shard_idx) {
+    for (auto& [id, state] : shards_[shard_idx]->clients) {
+        state.conn->poll_writes();
     }
+}
+
+void Exchange::publish_connection_(IoShard& shard, Id_t id, ClientState&& state) {
     Connection* ptr = state.conn.get();
-    clients_.emplace(id, std::move(state));
-    conn_by_id_[id].store(ptr, std::memory_order_release);
+    shard.clients.emplace(id, std::move(state));
+    conn_by_id_[connection_slot(id)].store(ptr, std::memory_order_release);
 }
 
 void Exchange::dispatch_(const InboundMessage& msg) {
+  // One engine timestamp per command: every event it produces shares this time.
+  const Time_t now = clock_.now_ns();
+  metrics_.count_in(msg.message_type);
+  profiler_.begin(msg.message_type);
   switch (static_cast<MessageType>(msg.message_type)) {
     case MessageType::INSERT_ORDER: {
       const auto* m = reinterpret_cast<const PayloadInsertOrder*>(msg.payload.data());
@@ -139,17 +524,48 @@ void Exchange::dispatch_(const InboundMessage& msg) {
           m->quantity,
           m->side == Side::BUY,
           msg.connection_id,
-          m->client_request_id);
+          m->client_request_id,
+          now);
       break;
     }
     case MessageType::CANCEL_ORDER: {
       const auto* m = reinterpret_cast<const PayloadCancelOrder*>(msg.payload.data());
-      order_book_.cancel_order(msg.connection_id, m->client_request_id, m->exchange_order_id);
+      order_book_.cancel_order(msg.connection_id, m->client_request_id, m->exchange_order_id, now);
       break;
     }
     case MessageType::AMEND_ORDER: {
       const auto* m = reinterpret_cast<const PayloadAmendOrder*>(msg.payload.data());
-      order_book_.amend_order(msg.connection_id, m->client_request_id, m->exchange_order_id, m->new_total_quantity);
+      order_book_.amend_order(msg.connection_id, m->client_request_id, m->exchange_order_id, m->new_total_quantity, now);
+      break;
+    }
+    case MessageType::DEPTH_QUERY: {
+      const auto* m = reinterpret_cast<const PayloadDepthQuery*>(msg.payload.data());
+      const bool is_bid = m->side == Side::BUY;
+      const OrderBookSide& side = is_bid ? order_book_.bids : order_book_.asks;
+      const Price_t best = side.best_price_index_ == NUM_BOOK_LEVELS
+          ? 0 : MINIMUM_BID + static_cast<Price_t>(side.best_price_index_);
+      const BookSweep sweep = order_book_.sweep(is_bid, m->quantity);
+      const PayloadDepthReport report = make_depth_report(
+          m->client_request_id,
+          m->side,
+          best,
+          order_book_.volume_within(is_bid, m->ticks),
+          side.depth_.total().volume,
+          static_cast<Volume_t>(sweep.filled),
+          sweep.worst_price,
+          sweep.notional,
+          now);
+      if (Session* c = conn_ptr_(msg.connection_id)) {
+        // Larger than a queue slot; goes through the large-frame pool.
+        if (c->send_message_unbuffered(
+                static_cast<Message_t>(MessageType::DEPTH_REPORT),
+                &report,
+                static_cast<uint16_t>(sizeof(report)))) {
+            metrics_.count_out(static_cast<Message_t>(MessageType::DEPTH_REPORT));
+        } else {
+            metrics_.count_drop(DropReason::OUTBOUND_BACKPRESSURE);
+        }
+      }
       break;
     }
     case MessageType::SUBSCRIBE: {
@@ -160,6 +576,17 @@ void Exchange::dispatch_(const InboundMessage& msg) {
       unsubscribe_market_feed_(msg.connection_id);
       break;
     }
+    case MessageType::CONNECT: {
+      const auto* m = reinterpret_cast<const PayloadConnect*>(msg.payload.data());
+      Session* session = conn_ptr_(msg.connection_id);
+      if (!session) break;
+      // Agree on the highest version both ends speak; v2 prices are offsets from V2_PRICE_BASE.
+      const uint8_t requested = m->protocol_version ? m->protocol_version : PROTOCOL_V1;
+      const uint8_t version = std::min(requested, session->max_protocol_version());
+      const PayloadConfirmConnected confirm = make_confirm_connected(m->client_request_id, version, V2_PRICE_BASE);
+      send_to_(msg.connection_id, static_cast<Message_t>(MessageType::CONFIRM_CONNECTED), &confirm);
+      break;
+    }
     case MessageType::DISCONNECT: {
       remove_connection_(msg.connection_id);
       break;
@@ -167,28 +594,47 @@ void Exchange::dispatch_(const InboundMessage& msg) {
     default:
       break;
   }
+  profiler_.end(now);
 }
 
-Connection* Exchange::conn_ptr_(Id_t id) noexcept {
-    if (static_cast<size_t>(id) >= MAX_CONNECTIONS) return nullptr;
-    return conn_by_id_[id].load(std::memory_order_acquire);
+Session* Exchange::conn_ptr_(Id_t id) noexcept {
+    Session* session = conn_by_id_[connection_slot(id)].load(std::memory_order_acquire);
+    // A slot's earlier occupant (a stale id) no longer has a session.
+    return session && session->id() == id ? session : nullptr;
 }
 
 void Exchange::send_to_(Id_t client_id, Message_t message_type, const void* payload) noexcept {
-    if (Connection* c = conn_ptr_(client_id)) {
-        c->send_message(message_type, payload);
+    if (Session* c = conn_ptr_(client_id)) {
+        if (c->send_message(message_type, payload)) {
+            metrics_.count_out(message_type);
+        } else {
+            metrics_.count_drop(DropReason::OUTBOUND_BACKPRESSURE);
+        }
     }
 }
 
 void Exchange::broadcast_to_subscribers_(Message_t message_type, const void* payload) noexcept {
     for (Id_t cid : market_data_subscribers_) {
-        if (Connection* c = conn_ptr_(cid)) {
-            c->send_message(message_type, payload);
+        if (Session* c = conn_ptr_(cid)) {
+            if (c->send_message(message_type, payload)) {
+                metrics_.count_out(message_type);
+            } else {
+                metrics_.count_drop(DropReason::OUTBOUND_BACKPRESSURE);
+            }
         }
     }
 }
 
+void Exchange::log_event_(MessageType message_type, const void* payload) noexcept {
+    if (!event_logger_.log_message(message_type, payload)) {
+        metrics_.count_drop(DropReason::LOGGER_OVERFLOW);
+    }
+}
+
 void Exchange::subscribe_market_feed_(Id_t connection_id) {
+  if (!conn_ptr_(connection_id)) {
+    return; // queued before its session was removed
+  }
   market_data_subscribers_.push_back(connection_id);
 
   // Snapshot (slow-path, larger than MAX_PAYLOAD_SIZE_BUFFER).
@@ -204,13 +650,16 @@ void Exchange::subscribe_market_feed_(Id_t connection_id) {
         ask_prices, ask_volumes, bid_prices, bid_volumes, sequence_number
     );
 
-  if (Connection* c = conn_ptr_(connection_id)) {
-    // Assumed to exist as you specified (unbuffered / bulk path).
-    c->send_message_unbuffered(
-        static_cast<Message_t>(MessageType::ORDER_BOOK_SNAPSHOT),
-        &snapshot,
-        static_cast<uint16_t>(sizeof(snapshot))
-    );
+  if (Session* c = conn_ptr_(connection_id)) {
+    // Pooled large-frame path; ordered with the incremental updates that follow.
+    if (c->send_message_unbuffered(
+            static_cast<Message_t>(MessageType::ORDER_BOOK_SNAPSHOT),
+            &snapshot,
+            static_cast<uint16_t>(sizeof(snapshot)))) {
+        metrics_.count_out(static_cast<Message_t>(MessageType::ORDER_BOOK_SNAPSHOT));
+    } else {
+        metrics_.count_drop(DropReason::OUTBOUND_BACKPRESSURE);
+    }
   }
 }
 
@@ -225,19 +674,59 @@ void Exchange::unsubscribe_market_feed_(Id_t connection_id) {
 void Exchange::remove_connection_(Id_t connection_id) {
     unsubscribe_market_feed_(connection_id);
 
-    if (static_cast<size_t>(connection_id) < MAX_CONNECTIONS) {
-        conn_by_id_[connection_id].store(nullptr, std::memory_order_release);
+    // Engine strand only, so the lookup and the clear cannot race another removal.
+    Session* session = conn_ptr_(connection_id);
+    if (!session) {
+        return; // already removed (a DISCONNECT message, then the socket closing)
     }
-
-    boost::asio::dispatch(accept_strand_, [this, connection_id] {
-    auto it = clients_.find(connection_id);
-    if (it != clients_.end()) {
-        if (it->second.conn) it->second.conn->close();
-        clients_.erase(it);
+    const size_t slot = connection_slot(connection_id);
+    conn_by_id_[slot].store(nullptr, std::memory_order_release);
+
+    const uint16_t shard_idx = conn_shard_[slot].load(std::memory_order_relaxed);
+#if defined(__linux__)
+    if (shard_idx == SHM_SHARD) {
+        // Destroyed on the shm handshake thread once its poller has let go
+        // too; the id is released there.
+        session->close();
+        shm_->release_session(static_cast<ShmSession*>(session));
+        return;
     }
+#endif
+
+    // The engine no longer sends to it. Once the connection is closed and idle
+    // on its own executor it is destroyed on its shard's accept strand, which
+    // owns the clients map, and the slot becomes reusable.
+    IoShard* shard = shards_[shard_idx].get();
+    static_cast<Connection*>(session)->retire([this, shard, connection_id] {
+        boost::asio::post(shard->accept_strand, [this, shard, connection_id] {
+            destroy_connection_(*shard, connection_id);
+        });
     });
 }
 
+void Exchange::destroy_connection_(IoShard& shard, Id_t connection_id) {
+    auto it = shard.clients.find(connection_id);
+    if (it == shard.clients.end()) {
+        return;
+    }
+    ClientState state = std::move(it->second);
+    shard.clients.erase(it);
+    state.conn.reset();
+
+    // Hand the outbox to the next session instead of freeing it; whatever the
+    // engine queued that was never written is dropped.
+    const OutboundMessage* run = nullptr;
+    while (const size_t n = state.outbox->peek_n(run, OUTBOUND_Q_CAP)) {
+        state.outbox->consume_n(n);
+    }
+    {
+        std::lock_guard<std::mutex> lock(spare_outboxes_mutex_);
+        spare_outboxes_.push_back(std::move(state.outbox));
+    }
+
+    release_connection_id_(connection_id);
+}
+
 void Exchange::on_trade(
     const Order& maker_order,
     Id_t taker_client_id,
@@ -248,6 +737,7 @@ void Exchange::on_trade(
     Volume_t traded_quantity,
     Time_t timestamp
 ) {
+    profiler_.note_trade(price);
 
     const Id_t trade_id = trade_id_++;
     const Id_t sequence_number = sequence_number_++;
@@ -286,10 +776,11 @@ void Exchange::on_trade(
     );
 
     broadcast_to_subscribers_(static_cast<Message_t>(MessageType::TRADE_EVENT), &trade_message);
-    event_logger_.log_message(MessageType::TRADE_EVENT, &trade_message);
+    log_event_(MessageType::TRADE_EVENT, &trade_message);
 }
 
 void Exchange::on_order_inserted(Id_t client_request_id, const Order& order, Time_t timestamp) {
+    profiler_.note_rested();
     const Id_t sequence_number = sequence_number_++;
 
     PayloadConfirmOrderInserted confirmation_message = make_confirm_order_inserted(
@@ -314,10 +805,11 @@ void Exchange::on_order_inserted(Id_t client_request_id, const Order& order, Tim
     );
 
     broadcast_to_subscribers_(static_cast<Message_t>(MessageType::ORDER_INSERTED_EVENT), &insert_message);
-    event_logger_.log_message(MessageType::ORDER_INSERTED_EVENT, &insert_message);
+    log_event_(MessageType::ORDER_INSERTED_EVENT, &insert_message);
 }
 
 void Exchange::on_order_cancelled(Id_t client_request_id, const Order& order, Time_t timestamp) {
+    profiler_.note_cancelled();
     const Id_t sequence_number = sequence_number_++;
 
     PayloadConfirmOrderCancelled confirmation_message = make_confirm_order_cancelled(
@@ -339,10 +831,11 @@ void Exchange::on_order_cancelled(Id_t client_request_id, const Order& order, Ti
     );
 
     broadcast_to_subscribers_(static_cast<Message_t>(MessageType::ORDER_CANCELLED_EVENT), &cancel_message);
-    event_logger_.log_message(MessageType::ORDER_CANCELLED_EVENT, &cancel_message);
+    log_event_(MessageType::ORDER_CANCELLED_EVENT, &cancel_message);
 }
 
 void Exchange::on_order_amended(Id_t client_request_id, Volume_t quantity_old, const Order& order, Time_t timestamp) {
+    profiler_.note_amended();
     const Id_t sequence_number = sequence_number_++;
 
     PayloadConfirmOrderAmended confirmation_message = make_confirm_order_amended(
@@ -365,10 +858,11 @@ void Exchange::on_order_amended(Id_t client_request_id, Volume_t quantity_old, c
     );
 
     broadcast_to_subscribers_(static_cast<Message_t>(MessageType::ORDER_AMENDED_EVENT), &amended_message);
-    event_logger_.log_message(MessageType::ORDER_AMENDED_EVENT, &amended_message);
+    log_event_(MessageType::ORDER_AMENDED_EVENT, &amended_message);
 }
 
 void Exchange::on_level_update(Side side, PriceLevel const& level, Time_t timestamp) {
+    book_changed_ = true;
     const Id_t sequence_number = sequence_number_++;
 
     PayloadPriceLevelUpdate message = make_price_level_update(
@@ -380,10 +874,12 @@ void Exchange::on_level_update(Side side, PriceLevel const& level, Time_t timest
     );
 
     broadcast_to_subscribers_(static_cast<Message_t>(MessageType::PRICE_LEVEL_UPDATE), &message);
-    event_logger_.log_message(MessageType::PRICE_LEVEL_UPDATE, &message);
+    log_event_(MessageType::PRICE_LEVEL_UPDATE, &message);
 }
 
 void Exchange::on_error(Id_t client_id, Id_t client_request_id, uint16_t code, std::string_view message, Time_t timestamp) {
+  profiler_.note_rejected();
+  metrics_.count_reject(code);
   PayloadError error_message = make_error(client_request_id, code, message, timestamp);
   send_to_(client_id, static_cast<Message_t>(MessageType::ERROR_MSG), &error_message);
 }
@@ -4,36 +4,86 @@
 #include <boost/asio.hpp>
 #include <boost/asio/strand.hpp>
 
+#include <array>
 #include <atomic>
 #include <cstdint>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <thread>
 #include <unordered_map>
 #include <vector>
 
 #include "binary_logger.hpp"
+#include "clock.hpp"
 #include "connectivity.hpp"
 #include "types.hpp"
 #include "protocol.hpp"
 #include "order_book.hpp"
+#include "seqlock.hpp"
+#include "perf_counters.hpp"
 #include "callbacks.hpp"
 #include "logging.hpp"
 #include "connectivity.hpp"
+#include "memory_warmup.hpp"
+#include "metrics.hpp"
+#include "socket_options.hpp"
+#include "session.hpp"
+#include "shm_transport.hpp"
 
-constexpr size_t MAX_CONNECTIONS = 1 << 5;
+// SHARED: one io_context run by N threads; connections are serialised by strands.
+// PER_CORE: one single-threaded io_context per IO thread, each with its own
+// acceptor; connections stay on the accepting thread and use no strands.
+enum class IoModel : uint8_t {SHARED, PER_CORE};
 
 class Exchange final : public OrderBookCallbacks {
     public:
         using tcp = boost::asio::ip::tcp;
 
-        Exchange(boost::asio::io_context& context, uint16_t port);
+        Exchange(boost::asio::io_context& context, uint16_t port, SocketProfile socket_profile = SocketProfile::LATENCY);
+        // The engine runs on engine_context; connections are spread over io_contexts.
+        Exchange(
+            boost::asio::io_context& engine_context,
+            const std::vector<boost::asio::io_context*>& io_contexts,
+            uint16_t port,
+            SocketProfile socket_profile,
+            IoModel io_model,
+            bool poll_driven_writes = false
+        );
         ~Exchange();
 
         void start();
         void stop();
 
+        // Prefaults, locks and places the engine's memory (book, inboxes,
+        // logger queues, connection tables), builds spare outboxes and runs
+        // the synthetic workload, all per options. Call before start(), from
+        // the thread (CPU) the engine will run on.
+        MemoryWarmupReport warm_up(const MemoryWarmupOptions& options);
+
         void print_book() { order_book_.print_book(); }
 
+        // Top of book, republished after every engine drain that changed it.
+        // Safe to read from any thread; fork it (OrderBookFork) for what-if
+        // evaluation off the engine thread.
+        const Seqlock<BookDepth>& book_depth() const noexcept { return book_depth_; }
+
+        // Also serves shared-memory sessions, discovered through a Unix socket
+        // at socket_path. Call before start(). Throws std::runtime_error where
+        // the transport is unavailable (non-Linux).
+        void enable_shm_transport(const std::string& socket_path);
+
+        // Also accepts Connections on a Unix domain stream socket at path,
+        // replacing a stale socket file (see remove_stale_socket_file). Call
+        // before start(). Throws std::runtime_error where Unix sockets are
+        // unavailable.
+        void enable_unix_listener(const std::string& path);
+
+        // Busy-poll mode: flushes outboxes of the shard's connections. Must be
+        // called from the (single) thread running that shard's io_context.
+        void poll_outboxes(size_t shard_idx);
+
         void on_trade(
             const Order& maker_order,
             Id_t taker_client_id,
@@ -56,10 +106,35 @@ class Exchange final : public OrderBookCallbacks {
             std::unique_ptr<Connection> conn;
         };
 
+        // Everything owned by one IO io_context. In PER_CORE mode only that
+        // context's thread touches it, so the inbox has a single producer.
+        struct IoShard {
+            explicit IoShard(boost::asio::io_context& ctx)
+                : context(ctx)
+                , accept_strand(ctx.get_executor())
+                , acceptor(ctx) {}
+
+            boost::asio::io_context& context;
+            boost::asio::strand<boost::asio::any_io_executor> accept_strand;
+            tcp::acceptor acceptor;
+            InboundQueue inbox;
+            std::unordered_map<Id_t, ClientState> clients;
+        };
+
+        // conn_shard_ value of shared-memory sessions.
+        static constexpr uint16_t SHM_SHARD = 0xFFFF;
+        // Inbound messages dispatched between consume_n calls on an inbox.
+        static constexpr size_t ENGINE_DRAIN_RUN = 64;
+
     private:
-        void do_accept_();
-        void on_accepted_(boost::system::error_code ec, tcp::socket socket);
-        void publish_connection_(Id_t id, ClientState&& st);
+        Id_t allocate_connection_id_();
+        void release_connection_id_(Id_t id);
+        void do_accept_(size_t shard_idx);
+        void on_accepted_(size_t shard_idx, size_t target_idx, boost::system::error_code ec, tcp::socket socket);
+        void do_accept_unix_();
+        void register_connection_(size_t shard_idx, StreamSocket socket);
+        void publish_connection_(IoShard& shard, Id_t id, ClientState&& st);
+        std::unique_ptr<OutboundQueue> take_outbox_();
 
         void run_engine_();
         void dispatch_(const InboundMessage& msg);
@@ -67,34 +142,76 @@ class Exchange final : public OrderBookCallbacks {
         void subscribe_market_feed_(Id_t connection_id);
         void unsubscribe_market_feed_(Id_t connection_id);
         void remove_connection_(Id_t connection_id);
+        void destroy_connection_(IoShard& shard, Id_t connection_id);
         void schedule_engine_drain();
+        void remove_pending_disconnects_();
+        void publish_gauges_(size_t drained) noexcept;
 
-        inline Connection* conn_ptr_(Id_t id) noexcept;
+        inline Session* conn_ptr_(Id_t id) noexcept;
         inline void send_to_(Id_t client_id, Message_t message_type, const void* payload) noexcept;
         inline void broadcast_to_subscribers_(Message_t message_type, const void* payload) noexcept;
+        inline void log_event_(MessageType message_type, const void* payload) noexcept;
 
         private:
-        boost::asio::io_context& context_;
-        boost::asio::strand<boost::asio::any_io_executor> accept_strand_;
         boost::asio::strand<boost::asio::io_context::executor_type> engine_strand_;
-        tcp::acceptor acceptor_;
-
-        InboundQueue inbox_;
+        SocketProfile socket_profile_;
+        IoModel io_model_;
+        bool poll_driven_writes_;
+
+        std::vector<std::unique_ptr<IoShard>> shards_;
+        // Every queue the engine drains: the shards' inboxes, then the
+        // shared-memory poller's.
+        std::vector<InboundQueue*> inboxes_;
+#if defined(__linux__)
+        std::unique_ptr<ShmTransportServer> shm_;
+#endif
+        // Single acceptor handing sockets round-robin to the shards (PER_CORE
+        // without SO_REUSEPORT).
+        bool distribute_accepts_{false};
+        size_t next_accept_shard_{0};
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+        // Runs on shard 0's accept strand and shares next_accept_shard_.
+        std::unique_ptr<boost::asio::local::stream_protocol::acceptor> unix_acceptor_;
+        std::string unix_path_;
+#endif
 
         std::atomic<bool> running_{false};
         std::atomic<bool> engine_drain_scheduled_{false};
 
-        std::unordered_map<Id_t, ClientState> clients_;
-
-        std::unique_ptr<std::atomic<Connection*>[]> conn_by_id_;
+        // Both indexed by connection_slot(id); conn_ptr_ checks the full id.
+        std::unique_ptr<std::atomic<Session*>[]> conn_by_id_;
+        // Owning shard of each slot, written before the connection exists.
+        std::unique_ptr<std::atomic<uint16_t>[]> conn_shard_;
+        // Connections closed while their inbox was full, so their DISCONNECT
+        // could not be queued; removed by the next engine drain.
+        std::unique_ptr<std::atomic<Id_t>[]> pending_disconnects_;
+        std::atomic<bool> disconnects_pending_{false};
 
         std::vector<Id_t> market_data_subscribers_;
 
-        OrderBook order_book_;
+        // Outboxes built by warm_up(), handed to the first sessions accepted.
+        std::mutex spare_outboxes_mutex_;
+        std::vector<std::unique_ptr<OutboundQueue>> spare_outboxes_;
 
-        Id_t next_connection_id_{0};
+        OrderBook order_book_;
+        EngineClock clock_;
+
+        Seqlock<BookDepth> book_depth_;
+        BookDepth depth_scratch_;
+        bool book_changed_{true}; // publish once even if nothing ever trades
+
+        // Slots are handed out in order, then reused oldest-freed first once
+        // their connection has been destroyed; each reuse bumps the slot's
+        // generation. Taken by accept strands and the shm handshake thread.
+        std::mutex connection_ids_mutex_;
+        size_t next_connection_slot_{0};
+        std::deque<size_t> free_connection_slots_;
+        std::array<Id_t, MAX_CONNECTIONS> connection_generation_{};
         Id_t trade_id_{0};
         Id_t sequence_number_{0};
 
         BinaryEventLogger event_logger_;
+        CommandProfiler profiler_;
+        // Engine-strand counters; gauges are published once per drain.
+        MetricsShard& metrics_;
 };
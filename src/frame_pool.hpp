@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// ------------------------------------------------------------
+// FramePool
+// ------------------------------------------------------------
+//
+// Fixed set of byte slots for frames too large for a queue element, handed
+// from one producer thread to one consumer thread by slot index.
+//
+// Design:
+// - No heap traffic after construction: a subscribe storm reuses the same
+//   SLOTS buffers instead of allocating one per snapshot.
+// - acquire() is producer-only and scans from a private cursor, so in steady
+//   state (slots released in order) it finds a free slot on the first probe.
+// - release() may be called from either side; ownership moves with the index.
+// - Exhaustion is reported, never waited on: the caller drops the frame just
+//   as it would on a full queue.
+//
+template <size_t SLOT_BYTES, size_t SLOTS>
+class FramePool {
+    public:
+        static constexpr size_t NONE = SLOTS;
+
+        // Returns NONE when every slot is in use.
+        size_t acquire() noexcept {
+            for (size_t probe = 0; probe < SLOTS; ++probe) {
+                const size_t i = cursor_;
+                cursor_ = (cursor_ + 1 == SLOTS) ? 0 : cursor_ + 1;
+                if (!slots_[i].busy.load(std::memory_order_acquire)) {
+                    slots_[i].busy.store(true, std::memory_order_relaxed);
+                    return i;
+                }
+            }
+            return NONE;
+        }
+
+        void release(size_t slot) noexcept {
+            slots_[slot].busy.store(false, std::memory_order_release);
+        }
+
+        uint8_t* data(size_t slot) noexcept { return slots_[slot].bytes.data(); }
+        const uint8_t* data(size_t slot) const noexcept { return slots_[slot].bytes.data(); }
+
+        static constexpr size_t slot_bytes() noexcept { return SLOT_BYTES; }
+
+    private:
+        struct alignas(64) Slot {
+            std::atomic<bool> busy{false};
+            std::array<uint8_t, SLOT_BYTES> bytes;
+        };
+
+        std::array<Slot, SLOTS> slots_{};
+        size_t cursor_ = 0; // producer only
+};
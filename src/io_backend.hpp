@@ -0,0 +1,27 @@
+#pragma once
+
+#include <boost/asio/detail/config.hpp>
+#include <boost/version.hpp>
+
+// Asio picks its reactor at compile time; TG_ENABLE_IO_URING (CMake) defines
+// BOOST_ASIO_HAS_IO_URING and BOOST_ASIO_DISABLE_EPOLL so sockets are driven
+// by io_uring instead of epoll.
+#if defined(BOOST_ASIO_HAS_IO_URING) && BOOST_VERSION < 107800
+    #error "The io_uring backend needs Boost 1.78 or newer."
+#endif
+
+inline const char* io_backend_name() noexcept {
+#if defined(BOOST_ASIO_HAS_IOCP)
+    return "iocp";
+#elif defined(BOOST_ASIO_HAS_IO_URING_AS_DEFAULT)
+    return "io_uring";
+#elif defined(BOOST_ASIO_HAS_EPOLL)
+    return "epoll";
+#elif defined(BOOST_ASIO_HAS_KQUEUE)
+    return "kqueue";
+#elif defined(BOOST_ASIO_HAS_DEV_POLL)
+    return "/dev/poll";
+#else
+    return "select";
+#endif
+}
@@ -0,0 +1,188 @@
+#include "memory_warmup.hpp"
+
+#include <charconv>
+
+#include "logging.hpp"
+
+#if defined(_WIN32)
+    #ifndef NOMINMAX
+    #define NOMINMAX
+    #endif
+    #include <windows.h>
+#elif defined(__linux__)
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+    #include <cerrno>
+#endif
+
+TG_INLINE_GLOBAL_LOGGER_WITH_CHANNEL(LG_MEM, "MEM")
+
+namespace {
+
+#if defined(__linux__)
+// Kernel ABI values, so <numaif.h> (libnuma-devel) is not needed.
+constexpr int MPOL_PREFERRED_ = 1;
+constexpr unsigned MPOL_MF_MOVE_ = 1u << 1;
+constexpr size_t MAX_NUMA_NODES = 1024;
+#endif
+
+// [begin, end) widened to whole pages.
+struct PageRange {
+    uintptr_t begin;
+    size_t bytes;
+};
+
+PageRange page_range(const void* data, size_t bytes) noexcept {
+    const uintptr_t page = memory_page_size();
+    const uintptr_t start = reinterpret_cast<uintptr_t>(data);
+    const uintptr_t begin = start & ~(page - 1);
+    const uintptr_t end = (start + bytes + page - 1) & ~(page - 1);
+    return PageRange{begin, static_cast<size_t>(end - begin)};
+}
+
+bool parse_count(std::string_view text, size_t& out) noexcept {
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), out);
+    return result.ec == std::errc{} && result.ptr == text.data() + text.size();
+}
+
+} // namespace
+
+size_t memory_page_size() noexcept {
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize ? static_cast<size_t>(info.dwPageSize) : 4096;
+#elif defined(__linux__)
+    const long p = ::sysconf(_SC_PAGESIZE);
+    return p > 0 ? static_cast<size_t>(p) : 4096;
+#else
+    return 4096;
+#endif
+}
+
+void prefault_memory(void* data, size_t bytes) noexcept {
+    if (!data || bytes == 0) return;
+    const PageRange range = page_range(data, bytes);
+#if defined(__linux__) && defined(MADV_POPULATE_WRITE)
+    // Linux >= 5.14: faults the pages in without touching their contents.
+    if (::madvise(reinterpret_cast<void*>(range.begin), range.bytes, MADV_POPULATE_WRITE) == 0) {
+        return;
+    }
+#endif
+    // Fallback: read one byte per page, never write. Ranges may hold atomics
+    // other threads already update (the logger's queue indices), and a plain
+    // read-modify-write there could lose their store. A read leaves untouched
+    // anonymous pages on the shared zero page; `lock` faults them in for real.
+    // Only the caller's own bytes are touched, never the widened edges.
+    const size_t page = memory_page_size();
+    const volatile uint8_t* first = static_cast<const uint8_t*>(data);
+    const volatile uint8_t* last = first + bytes - 1;
+    for (const volatile uint8_t* p = first; p <= last;) {
+        (void)*p;
+        const uintptr_t next = (reinterpret_cast<uintptr_t>(p) & ~(page - 1)) + page;
+        if (next > reinterpret_cast<uintptr_t>(last)) break;
+        p = reinterpret_cast<const volatile uint8_t*>(next);
+    }
+}
+
+bool lock_memory(const void* data, size_t bytes) noexcept {
+    if (!data || bytes == 0) return true;
+    const PageRange range = page_range(data, bytes);
+#if defined(_WIN32)
+    return VirtualLock(reinterpret_cast<LPVOID>(range.begin), range.bytes) != 0;
+#elif defined(__linux__)
+    return ::mlock(reinterpret_cast<const void*>(range.begin), range.bytes) == 0;
+#else
+    (void)range;
+    return false;
+#endif
+}
+
+int current_numa_node() noexcept {
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (::syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+        return static_cast<int>(node);
+    }
+#endif
+    return -1;
+}
+
+bool bind_memory_to_node(void* data, size_t bytes, int node) noexcept {
+#if defined(__linux__) && defined(SYS_mbind)
+    if (!data || bytes == 0 || node < 0 || static_cast<size_t>(node) >= MAX_NUMA_NODES) return false;
+    const PageRange range = page_range(data, bytes);
+    constexpr size_t BITS = sizeof(unsigned long) * 8;
+    unsigned long mask[MAX_NUMA_NODES / BITS] = {};
+    mask[node / BITS] = 1ul << (node % BITS);
+    // maxnode counts one past the last bit, as the kernel expects.
+    return ::syscall(SYS_mbind, range.begin, range.bytes, MPOL_PREFERRED_, mask,
+                     MAX_NUMA_NODES + 1, MPOL_MF_MOVE_) == 0;
+#else
+    (void)data;
+    (void)bytes;
+    (void)node;
+    return false;
+#endif
+}
+
+MemoryWarmup::MemoryWarmup(const MemoryWarmupOptions& options) noexcept
+    : options_(options) {
+    if (options_.numa_local) {
+        report_.numa_node = current_numa_node();
+    }
+}
+
+void MemoryWarmup::add(void* data, size_t bytes) noexcept {
+    if (!data || bytes == 0) return;
+    // Place first so prefaulting allocates on the right node.
+    if (report_.numa_node >= 0 && !bind_memory_to_node(data, bytes, report_.numa_node)) {
+        RLOG(LG_MEM, LogLevel::LL_WARNING) << "[MemoryWarmup] NUMA placement failed for " << bytes
+                                           << " bytes; keeping first-touch placement.";
+        report_.numa_node = -1;
+    }
+    if (options_.prefault) {
+        prefault_memory(data, bytes);
+        report_.bytes_prefaulted += bytes;
+    }
+    if (options_.lock) {
+        if (lock_memory(data, bytes)) {
+            report_.bytes_locked += bytes;
+        } else {
+            ++report_.lock_failures;
+        }
+    }
+}
+
+bool parse_memory_warmup(std::string_view spec, MemoryWarmupOptions& out) noexcept {
+    if (spec == "-") return true;
+    MemoryWarmupOptions parsed;
+    parsed.prefault = false;
+    if (spec == "none") {
+        out = parsed;
+        return true;
+    }
+    while (!spec.empty()) {
+        const size_t comma = spec.find(',');
+        const std::string_view item = spec.substr(0, comma);
+        spec = comma == std::string_view::npos ? std::string_view{} : spec.substr(comma + 1);
+
+        if (item == "prefault") {
+            parsed.prefault = true;
+        } else if (item == "lock") {
+            parsed.lock = true;
+        } else if (item == "numa") {
+            parsed.numa_local = true;
+        } else if (item.substr(0, 9) == "outboxes=") {
+            if (!parse_count(item.substr(9), parsed.spare_outboxes)) return false;
+        } else if (item.substr(0, 7) == "orders=") {
+            if (!parse_count(item.substr(7), parsed.synthetic_orders)) return false;
+        } else {
+            return false;
+        }
+    }
+    out = parsed;
+    return true;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// ------------------------------------------------------------
+// Memory warm-up
+// ------------------------------------------------------------
+//
+// Moves page faults and cold misses out of the trading path and into
+// startup, before the exchange accepts its first session.
+//
+// Design:
+// - Prefault: every page of a range is made resident and writable up front
+//   (MADV_POPULATE_WRITE on Linux, a read of one byte per page elsewhere),
+//   so the first order never waits on the kernel. The fallback never writes:
+//   a warmed range may already be in use by another thread.
+// - Lock: mlock / VirtualLock keeps the range resident. Limits
+//   (RLIMIT_MEMLOCK, the working-set quota) make this fail on default
+//   setups; failures are counted and reported, never thrown.
+// - NUMA (Linux): the range is bound to the node of the calling thread and
+//   pages already faulted elsewhere are migrated (raw mbind, no libnuma).
+//   Warming from the thread that owns the memory gives the same placement
+//   through first touch on platforms without it.
+// - Ranges are widened to whole pages; neighbouring objects sharing those
+//   pages are warmed too, which is harmless.
+//
+struct MemoryWarmupOptions {
+    bool prefault = true;
+    bool lock = false;
+    bool numa_local = false;
+    // Outbound queues built (and warmed) up front for the first sessions.
+    size_t spare_outboxes = 0;
+    // Orders run through a scratch book to warm caches and branch predictors.
+    size_t synthetic_orders = 0;
+};
+
+struct MemoryWarmupReport {
+    size_t bytes_prefaulted = 0;
+    size_t bytes_locked = 0;
+    size_t lock_failures = 0;
+    int numa_node = -1; // -1: placement not requested or unavailable
+    size_t synthetic_orders = 0;
+    double seconds = 0.0;
+};
+
+size_t memory_page_size() noexcept;
+
+// Safe on memory other threads are using: never writes the range.
+void prefault_memory(void* data, size_t bytes) noexcept;
+bool lock_memory(const void* data, size_t bytes) noexcept;
+
+// NUMA node of the CPU the calling thread runs on, or -1 where unknown.
+int current_numa_node() noexcept;
+bool bind_memory_to_node(void* data, size_t bytes, int node) noexcept;
+
+// Applies the options to each range added and accumulates the report.
+class MemoryWarmup {
+    public:
+        explicit MemoryWarmup(const MemoryWarmupOptions& options) noexcept;
+
+        void add(void* data, size_t bytes) noexcept;
+
+        template <typename T>
+        void add_object(T& object) noexcept { add(&object, sizeof(T)); }
+
+        MemoryWarmupReport& report() noexcept { return report_; }
+
+    private:
+        MemoryWarmupOptions options_;
+        MemoryWarmupReport report_;
+};
+
+// "-" keeps the defaults, "none" disables everything; otherwise a comma
+// separated list of prefault, lock, numa, outboxes=N, orders=N.
+bool parse_memory_warmup(std::string_view spec, MemoryWarmupOptions& out) noexcept;
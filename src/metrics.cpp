@@ -0,0 +1,198 @@
+#include "metrics.hpp"
+
+#include <sstream>
+#include <thread>
+
+MetricsShard& MetricsRegistry::register_shard(const std::string& name) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    MetricsShard& shard = shards_.emplace_back();
+    shard.name = name;
+    return shard;
+}
+
+MetricsSnapshot MetricsRegistry::snapshot() const {
+    MetricsSnapshot s{};
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        for (const MetricsShard& shard : shards_) {
+            for (size_t i = 0; i < NUM_METRIC_MESSAGE_TYPES; ++i) {
+                s.messages_in[i] += shard.messages_in[i].load(std::memory_order_relaxed);
+                s.messages_out[i] += shard.messages_out[i].load(std::memory_order_relaxed);
+            }
+            for (size_t i = 0; i < NUM_DROP_REASONS; ++i) {
+                s.drops[i] += shard.drops[i].load(std::memory_order_relaxed);
+            }
+            for (size_t i = 0; i < NUM_METRIC_ERROR_TYPES; ++i) {
+                s.rejects[i] += shard.rejects[i].load(std::memory_order_relaxed);
+            }
+            for (size_t i = 0; i < LogHistogram::NUM_BUCKETS; ++i) {
+                s.drain_batch_buckets[i] += shard.drain_batch.buckets[i].load(std::memory_order_relaxed);
+            }
+            s.drain_batch_sum += shard.drain_batch.sum.load(std::memory_order_relaxed);
+            s.drain_batch_count += shard.drain_batch.count.load(std::memory_order_relaxed);
+        }
+    }
+
+    s.inbox_depth = gauges_.inbox_depth.load(std::memory_order_relaxed);
+    s.logger_backlog = gauges_.logger_backlog.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < 2; ++i) {
+        s.book_levels[i] = gauges_.book_levels[i].load(std::memory_order_relaxed);
+        s.pool_in_use[i] = gauges_.pool_in_use[i].load(std::memory_order_relaxed);
+    }
+    s.pool_capacity = gauges_.pool_capacity.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < MAX_CONNECTIONS; ++i) {
+        s.connected[i] = gauges_.connected[i].load(std::memory_order_relaxed);
+        s.outbox_depth[i] = gauges_.outbox_depth[i].load(std::memory_order_relaxed);
+    }
+    return s;
+}
+
+MetricsRegistry& metrics_registry() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsShard& metrics_thread_shard() {
+    thread_local MetricsShard* shard = nullptr;
+    if (!shard) {
+        std::ostringstream oss;
+        oss << "thread_" << std::this_thread::get_id();
+        shard = &metrics_registry().register_shard(oss.str());
+    }
+    return *shard;
+}
+
+namespace {
+
+constexpr const char* SIDE_LABELS[] = {"bid", "ask"};
+
+void write_family(std::ostringstream& out, const char* name, const char* type, const char* help) {
+    out << "# HELP " << name << ' ' << help << '\n';
+    out << "# TYPE " << name << ' ' << type << '\n';
+}
+
+void put_u16(std::vector<uint8_t>& buf, uint16_t v) {
+    buf.push_back(static_cast<uint8_t>(v & 0xFF));
+    buf.push_back(static_cast<uint8_t>((v >> 8) & 0xFF));
+}
+
+void put_u32(std::vector<uint8_t>& buf, uint32_t v) {
+    for (int i = 0; i < 4; ++i) buf.push_back(static_cast<uint8_t>((v >> (8 * i)) & 0xFF));
+}
+
+void put_u64(std::vector<uint8_t>& buf, uint64_t v) {
+    for (int i = 0; i < 8; ++i) buf.push_back(static_cast<uint8_t>((v >> (8 * i)) & 0xFF));
+}
+
+} // namespace
+
+std::string format_metrics_prometheus(const MetricsSnapshot& s) {
+    std::ostringstream out;
+
+    write_family(out, "tg_messages_in_total", "counter", "Inbound messages dispatched by the engine, by type.");
+    for (size_t t = 0; t < NUM_METRIC_MESSAGE_TYPES; ++t) {
+        if (s.messages_in[t] == 0) continue;
+        out << "tg_messages_in_total{type=\"" << message_type_name(static_cast<MessageType>(t)) << "\"} " << s.messages_in[t] << '\n';
+    }
+
+    write_family(out, "tg_messages_out_total", "counter", "Outbound messages queued by the engine, by type.");
+    for (size_t t = 0; t < NUM_METRIC_MESSAGE_TYPES; ++t) {
+        if (s.messages_out[t] == 0) continue;
+        out << "tg_messages_out_total{type=\"" << message_type_name(static_cast<MessageType>(t)) << "\"} " << s.messages_out[t] << '\n';
+    }
+
+    write_family(out, "tg_drops_total", "counter", "Messages dropped, by reason.");
+    for (size_t i = 0; i < NUM_DROP_REASONS; ++i) {
+        out << "tg_drops_total{reason=\"" << DROP_REASON_NAMES[i] << "\"} " << s.drops[i] << '\n';
+    }
+
+    write_family(out, "tg_rejects_total", "counter", "Commands rejected by the book, by error type.");
+    for (size_t i = 1; i < NUM_METRIC_ERROR_TYPES; ++i) {
+        out << "tg_rejects_total{error=\"" << ERROR_TYPE_NAMES[i] << "\"} " << s.rejects[i] << '\n';
+    }
+
+    write_family(out, "tg_engine_drain_batch_size", "histogram", "Messages dispatched per engine drain.");
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < LogHistogram::NUM_BUCKETS; ++i) {
+        cumulative += s.drain_batch_buckets[i];
+        out << "tg_engine_drain_batch_size_bucket{le=\"" << LogHistogram::bucket_upper_bound(i) << "\"} " << cumulative << '\n';
+    }
+    out << "tg_engine_drain_batch_size_bucket{le=\"+Inf\"} " << s.drain_batch_count << '\n';
+    out << "tg_engine_drain_batch_size_sum " << s.drain_batch_sum << '\n';
+    out << "tg_engine_drain_batch_size_count " << s.drain_batch_count << '\n';
+
+    write_family(out, "tg_inbox_depth", "gauge", "Approximate depth of the engine inbox.");
+    out << "tg_inbox_depth " << s.inbox_depth << '\n';
+
+    write_family(out, "tg_outbox_depth", "gauge", "Approximate depth of each connection outbox.");
+    for (size_t i = 0; i < MAX_CONNECTIONS; ++i) {
+        if (!s.connected[i]) continue;
+        out << "tg_outbox_depth{connection=\"" << i << "\"} " << s.outbox_depth[i] << '\n';
+    }
+
+    write_family(out, "tg_logger_backlog", "gauge", "Approximate number of events waiting for the binary logger.");
+    out << "tg_logger_backlog " << s.logger_backlog << '\n';
+
+    write_family(out, "tg_book_levels", "gauge", "Non-empty price levels per side.");
+    for (size_t i = 0; i < 2; ++i) {
+        out << "tg_book_levels{side=\"" << SIDE_LABELS[i] << "\"} " << s.book_levels[i] << '\n';
+    }
+
+    write_family(out, "tg_order_pool_in_use", "gauge", "Orders allocated from each side's pool.");
+    for (size_t i = 0; i < 2; ++i) {
+        out << "tg_order_pool_in_use{side=\"" << SIDE_LABELS[i] << "\"} " << s.pool_in_use[i] << '\n';
+    }
+
+    write_family(out, "tg_order_pool_capacity", "gauge", "Capacity of each side's order pool.");
+    out << "tg_order_pool_capacity " << s.pool_capacity << '\n';
+
+    return out.str();
+}
+
+std::vector<uint8_t> format_metrics_binary(const MetricsSnapshot& s) {
+    struct Record {
+        MetricId id;
+        uint16_t label;
+        uint64_t value;
+    };
+    std::vector<Record> records;
+    records.reserve(128);
+
+    for (size_t t = 0; t < NUM_METRIC_MESSAGE_TYPES; ++t) {
+        if (s.messages_in[t]) records.push_back({MetricId::MESSAGES_IN, static_cast<uint16_t>(t), s.messages_in[t]});
+        if (s.messages_out[t]) records.push_back({MetricId::MESSAGES_OUT, static_cast<uint16_t>(t), s.messages_out[t]});
+    }
+    for (size_t i = 0; i < NUM_DROP_REASONS; ++i) {
+        records.push_back({MetricId::DROPS, static_cast<uint16_t>(i), s.drops[i]});
+    }
+    for (size_t i = 1; i < NUM_METRIC_ERROR_TYPES; ++i) {
+        records.push_back({MetricId::REJECTS, static_cast<uint16_t>(i), s.rejects[i]});
+    }
+    for (size_t i = 0; i < LogHistogram::NUM_BUCKETS; ++i) {
+        if (s.drain_batch_buckets[i]) records.push_back({MetricId::DRAIN_BATCH_BUCKET, static_cast<uint16_t>(i), s.drain_batch_buckets[i]});
+    }
+    records.push_back({MetricId::DRAIN_BATCH_SUM, 0, s.drain_batch_sum});
+    records.push_back({MetricId::DRAIN_BATCH_COUNT, 0, s.drain_batch_count});
+    records.push_back({MetricId::INBOX_DEPTH, 0, s.inbox_depth});
+    records.push_back({MetricId::LOGGER_BACKLOG, 0, s.logger_backlog});
+    for (uint16_t i = 0; i < 2; ++i) {
+        records.push_back({MetricId::BOOK_LEVELS, i, s.book_levels[i]});
+        records.push_back({MetricId::POOL_IN_USE, i, s.pool_in_use[i]});
+    }
+    records.push_back({MetricId::POOL_CAPACITY, 0, s.pool_capacity});
+    for (size_t i = 0; i < MAX_CONNECTIONS; ++i) {
+        if (s.connected[i]) records.push_back({MetricId::OUTBOX_DEPTH, static_cast<uint16_t>(i), s.outbox_depth[i]});
+    }
+
+    std::vector<uint8_t> buf;
+    buf.reserve(8 + records.size() * 12);
+    put_u32(buf, METRICS_BINARY_MAGIC);
+    put_u16(buf, METRICS_BINARY_VERSION);
+    put_u16(buf, static_cast<uint16_t>(records.size()));
+    for (const Record& r : records) {
+        put_u16(buf, static_cast<uint16_t>(r.id));
+        put_u16(buf, r.label);
+        put_u64(buf, r.value);
+    }
+    return buf;
+}
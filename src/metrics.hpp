@@ -0,0 +1,196 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "types.hpp"
+#include "protocol.hpp"
+
+// Message types are dense below this bound (see MessageType).
+constexpr size_t NUM_METRIC_MESSAGE_TYPES = 32;
+// Indexed by ErrorType code; slot 0 is unused.
+constexpr size_t NUM_METRIC_ERROR_TYPES = 6;
+
+enum class DropReason : uint8_t {
+    INBOUND_BACKPRESSURE,
+    OUTBOUND_BACKPRESSURE,
+    LOGGER_OVERFLOW,
+    PROTOCOL_VIOLATION
+};
+
+constexpr size_t NUM_DROP_REASONS = 4;
+
+constexpr const char* DROP_REASON_NAMES[] = {
+    "inbound_backpressure",
+    "outbound_backpressure",
+    "logger_overflow",
+    "protocol_violation"
+};
+
+constexpr const char* ERROR_TYPE_NAMES[] = {
+    "none",
+    "order_book_full",
+    "invalid_volume",
+    "order_not_found",
+    "unauthorised",
+    "invalid_price"
+};
+
+// Single-writer increment: the owning thread is the only writer, so a relaxed
+// load/store pair is enough and avoids a locked read-modify-write.
+inline void metric_add(std::atomic<uint64_t>& counter, uint64_t n = 1) noexcept {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// ------------------------------------------------------------
+// LogHistogram
+// ------------------------------------------------------------
+//
+// Power-of-two buckets: bucket 0 holds 0, bucket i holds [2^(i-1), 2^i - 1].
+// Single writer; readers see a slightly torn but monotone view.
+//
+struct LogHistogram {
+    static constexpr size_t NUM_BUCKETS = 24;
+
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets{};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> count{0};
+
+    static constexpr uint64_t bucket_upper_bound(size_t i) noexcept {
+        return i == 0 ? 0 : (uint64_t{1} << i) - 1;
+    }
+
+    inline void record(uint64_t v) noexcept {
+        size_t idx = 0;
+        while (idx + 1 < NUM_BUCKETS && v > bucket_upper_bound(idx)) ++idx;
+        metric_add(buckets[idx]);
+        metric_add(sum, v);
+        metric_add(count);
+    }
+};
+
+// ------------------------------------------------------------
+// MetricsShard
+// ------------------------------------------------------------
+//
+// Counters written by exactly one thread (or one strand). Shards are
+// cache-line aligned so writers on different threads never share a line.
+//
+struct alignas(64) MetricsShard {
+    std::string name;
+
+    std::array<std::atomic<uint64_t>, NUM_METRIC_MESSAGE_TYPES> messages_in{};
+    std::array<std::atomic<uint64_t>, NUM_METRIC_MESSAGE_TYPES> messages_out{};
+    std::array<std::atomic<uint64_t>, NUM_DROP_REASONS> drops{};
+    std::array<std::atomic<uint64_t>, NUM_METRIC_ERROR_TYPES> rejects{};
+    LogHistogram drain_batch;
+
+    inline void count_in(Message_t type) noexcept {
+        if (type < NUM_METRIC_MESSAGE_TYPES) metric_add(messages_in[type]);
+    }
+    inline void count_out(Message_t type) noexcept {
+        if (type < NUM_METRIC_MESSAGE_TYPES) metric_add(messages_out[type]);
+    }
+    inline void count_drop(DropReason reason) noexcept {
+        metric_add(drops[static_cast<size_t>(reason)]);
+    }
+    inline void count_reject(uint16_t code) noexcept {
+        if (code < NUM_METRIC_ERROR_TYPES) metric_add(rejects[code]);
+    }
+};
+
+// ------------------------------------------------------------
+// EngineGauges
+// ------------------------------------------------------------
+//
+// Point-in-time values published by the engine at the end of each drain.
+//
+struct alignas(64) EngineGauges {
+    std::atomic<uint64_t> inbox_depth{0};
+    std::atomic<uint64_t> logger_backlog{0};
+    std::array<std::atomic<uint64_t>, 2> book_levels{};   // [bid, ask]
+    std::array<std::atomic<uint64_t>, 2> pool_in_use{};   // [bid, ask]
+    std::atomic<uint64_t> pool_capacity{0};               // per side
+    std::array<std::atomic<uint64_t>, MAX_CONNECTIONS> outbox_depth{};
+    std::array<std::atomic<bool>, MAX_CONNECTIONS> connected{};
+};
+
+struct MetricsSnapshot {
+    std::array<uint64_t, NUM_METRIC_MESSAGE_TYPES> messages_in{};
+    std::array<uint64_t, NUM_METRIC_MESSAGE_TYPES> messages_out{};
+    std::array<uint64_t, NUM_DROP_REASONS> drops{};
+    std::array<uint64_t, NUM_METRIC_ERROR_TYPES> rejects{};
+    std::array<uint64_t, LogHistogram::NUM_BUCKETS> drain_batch_buckets{};
+    uint64_t drain_batch_sum = 0;
+    uint64_t drain_batch_count = 0;
+
+    uint64_t inbox_depth = 0;
+    uint64_t logger_backlog = 0;
+    std::array<uint64_t, 2> book_levels{};
+    std::array<uint64_t, 2> pool_in_use{};
+    uint64_t pool_capacity = 0;
+    std::array<uint64_t, MAX_CONNECTIONS> outbox_depth{};
+    std::array<bool, MAX_CONNECTIONS> connected{};
+};
+
+// ------------------------------------------------------------
+// MetricsRegistry
+// ------------------------------------------------------------
+//
+// Owns all shards. Registration and snapshots take a mutex; updates never do.
+// The engine registers its shard once at construction, io threads register a
+// thread-local shard on first use (see metrics_thread_shard()).
+//
+class MetricsRegistry {
+    public:
+        MetricsShard& register_shard(const std::string& name);
+
+        EngineGauges& gauges() noexcept { return gauges_; }
+
+        MetricsSnapshot snapshot() const;
+
+    private:
+        mutable std::mutex mtx_;
+        std::deque<MetricsShard> shards_;
+        EngineGauges gauges_;
+};
+
+MetricsRegistry& metrics_registry();
+
+// Shard of the calling thread, registered on first use.
+MetricsShard& metrics_thread_shard();
+
+// Prometheus text exposition format (version 0.0.4).
+std::string format_metrics_prometheus(const MetricsSnapshot& snapshot);
+
+// Compact binary form, all fields little-endian:
+//   header { u32 magic = 'TGM1', u16 version = 1, u16 record_count }
+//   record { u16 metric_id, u16 label, u64 value } * record_count
+// where label is the message type, drop reason, error code, histogram bucket,
+// side (0 = bid, 1 = ask) or connection id depending on the metric.
+enum class MetricId : uint16_t {
+    MESSAGES_IN = 1,
+    MESSAGES_OUT = 2,
+    DROPS = 3,
+    REJECTS = 4,
+    DRAIN_BATCH_BUCKET = 5,
+    DRAIN_BATCH_SUM = 6,
+    DRAIN_BATCH_COUNT = 7,
+    INBOX_DEPTH = 8,
+    LOGGER_BACKLOG = 9,
+    BOOK_LEVELS = 10,
+    POOL_IN_USE = 11,
+    POOL_CAPACITY = 12,
+    OUTBOX_DEPTH = 13
+};
+
+constexpr uint32_t METRICS_BINARY_MAGIC = 0x314D4754; // "TGM1"
+constexpr uint16_t METRICS_BINARY_VERSION = 1;
+
+std::vector<uint8_t> format_metrics_binary(const MetricsSnapshot& snapshot);
@@ -0,0 +1,122 @@
+#include "metrics_server.hpp"
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "logging.hpp"
+#include "metrics.hpp"
+
+TG_INLINE_GLOBAL_LOGGER_WITH_CHANNEL(LG_MET, "MET")
+
+namespace {
+
+constexpr size_t MAX_REQUEST_SIZE = 8 * 1024;
+
+std::string make_header(const char* status, const char* content_type, size_t length) {
+    std::string h;
+    h.reserve(128);
+    h += "HTTP/1.0 ";
+    h += status;
+    h += "\r\nContent-Type: ";
+    h += content_type;
+    h += "\r\nContent-Length: ";
+    h += std::to_string(length);
+    h += "\r\nConnection: close\r\n\r\n";
+    return h;
+}
+
+} // namespace
+
+class MetricsServer::Session : public std::enable_shared_from_this<MetricsServer::Session> {
+    public:
+        Session(tcp::socket socket, const std::map<std::string, Renderer>& routes)
+            : socket_(std::move(socket))
+            , request_(MAX_REQUEST_SIZE)
+            , routes_(routes) {}
+
+        void start() {
+            auto self = shared_from_this();
+            boost::asio::async_read_until(socket_, request_, "\r\n\r\n",
+                [self](const boost::system::error_code& ec, size_t) {
+                    if (ec) return;
+                    self->respond_();
+                });
+        }
+
+    private:
+        void respond_() {
+            std::istream is(&request_);
+            std::string method, target;
+            is >> method >> target;
+
+            if (method == "GET" && target == "/metrics") {
+                body_ = format_metrics_prometheus(metrics_registry().snapshot());
+                header_ = make_header("200 OK", "text/plain; version=0.0.4", body_.size());
+            } else if (method == "GET" && target == "/metrics/binary") {
+                const std::vector<uint8_t> bin = format_metrics_binary(metrics_registry().snapshot());
+                body_.assign(bin.begin(), bin.end());
+                header_ = make_header("200 OK", "application/octet-stream", body_.size());
+            } else if (const auto route = routes_.find(target); method == "GET" && route != routes_.end()) {
+                body_ = route->second();
+                header_ = make_header("200 OK", "text/plain", body_.size());
+            } else {
+                body_ = "not found\n";
+                header_ = make_header("404 Not Found", "text/plain", body_.size());
+            }
+
+            const std::array<boost::asio::const_buffer, 2> buffers{
+                boost::asio::buffer(header_),
+                boost::asio::buffer(body_)
+            };
+            auto self = shared_from_this();
+            boost::asio::async_write(socket_, buffers,
+                [self](const boost::system::error_code&, size_t) {
+                    boost::system::error_code ignored;
+                    self->socket_.shutdown(tcp::socket::shutdown_both, ignored);
+                    self->socket_.close(ignored);
+                });
+        }
+
+        tcp::socket socket_;
+        boost::asio::streambuf request_;
+        std::string header_;
+        std::string body_;
+        const std::map<std::string, Renderer>& routes_;
+};
+
+MetricsServer::MetricsServer(boost::asio::io_context& context, uint16_t port)
+    : strand_(context.get_executor())
+    , acceptor_(context, tcp::endpoint(boost::asio::ip::address_v4::loopback(), port)) {}
+
+void MetricsServer::add_text_route(const std::string& path, Renderer render) {
+    routes_[path] = std::move(render);
+}
+
+void MetricsServer::start() {
+    boost::asio::dispatch(strand_, [this] { do_accept_(); });
+}
+
+void MetricsServer::stop() {
+    boost::asio::dispatch(strand_, [this] {
+        boost::system::error_code ec;
+        acceptor_.close(ec);
+    });
+}
+
+void MetricsServer::do_accept_() {
+    acceptor_.async_accept(
+        boost::asio::bind_executor(
+            strand_,
+            [this](boost::system::error_code ec, tcp::socket socket) {
+                if (ec) {
+                    if (ec == boost::asio::error::operation_aborted) return;
+                    RLOG(LG_MET, LogLevel::LL_ERROR) << "[MetricsServer] accept error: " << ec.message();
+                } else {
+                    std::make_shared<Session>(std::move(socket), routes_)->start();
+                }
+                if (acceptor_.is_open()) do_accept_();
+            }
+        )
+    );
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <boost/asio/strand.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+// ------------------------------------------------------------
+// MetricsServer
+// ------------------------------------------------------------
+//
+// Design:
+// - Minimal HTTP/1.0 responder bound to 127.0.0.1:<port>, one request per
+//   connection, closed after the response.
+// - GET /metrics          -> Prometheus text exposition.
+// - GET /metrics/binary   -> compact binary snapshot (see metrics.hpp).
+// - Snapshots are taken on the io thread serving the request; the engine
+//   never waits on the admin port.
+// - Extra plain-text routes (e.g. GET /book) can be registered before
+//   start(); their renderers run on the same thread and must not block.
+//
+class MetricsServer {
+    public:
+        using tcp = boost::asio::ip::tcp;
+
+        using Renderer = std::function<std::string()>;
+
+        MetricsServer(boost::asio::io_context& context, uint16_t port);
+
+        // GET path -> text/plain body from render(). Call before start().
+        void add_text_route(const std::string& path, Renderer render);
+
+        void start();
+        void stop();
+
+    private:
+        class Session;
+
+        void do_accept_();
+
+        boost::asio::strand<boost::asio::io_context::executor_type> strand_;
+        tcp::acceptor acceptor_;
+        std::map<std::string, Renderer> routes_;
+};
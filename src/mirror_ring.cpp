@@ -0,0 +1,106 @@
+#include "mirror_ring.hpp"
+
+#include <cstring>
+
+#include "logging.hpp"
+
+#if defined(__linux__)
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+TG_INLINE_GLOBAL_LOGGER_WITH_CHANNEL(LG_MRG, "MRG")
+
+namespace {
+
+size_t page_size() noexcept {
+#if defined(__linux__)
+    const long p = ::sysconf(_SC_PAGESIZE);
+    return p > 0 ? static_cast<size_t>(p) : 4096;
+#else
+    return 4096;
+#endif
+}
+
+size_t round_up_pow2(size_t v) noexcept {
+    size_t p = 1;
+    while (p < v) p <<= 1;
+    return p;
+}
+
+} // namespace
+
+MirrorRing::MirrorRing(size_t min_capacity, bool mirror)
+    : capacity_(round_up_pow2(min_capacity < page_size() ? page_size() : min_capacity)) {
+        if (mirror && map_mirror_()) {
+            mirrored_ = true;
+            mask_ = capacity_ - 1;
+        } else {
+            fallback_.resize(capacity_);
+            base_ = fallback_.data();
+            mask_ = ~uint64_t{0};
+        }
+    }
+
+MirrorRing::~MirrorRing() {
+#if defined(__linux__)
+    if (mirrored_) ::munmap(base_, 2 * capacity_);
+#endif
+}
+
+void MirrorRing::consume(size_t n) noexcept {
+    tail_ += n;
+    if (mirrored_) return;
+
+    if (tail_ == head_) {
+        head_ = tail_ = 0;
+    } else if (tail_ >= capacity_ / 2) {
+        compact();
+    }
+}
+
+void MirrorRing::compact() noexcept {
+    if (mirrored_ || tail_ == 0) return;
+    const size_t remaining = static_cast<size_t>(head_ - tail_);
+    std::memmove(base_, base_ + tail_, remaining);
+    tail_ = 0;
+    head_ = remaining;
+}
+
+bool MirrorRing::map_mirror_() noexcept {
+#if defined(__linux__)
+    const int fd = ::memfd_create("tg_mirror_ring", MFD_CLOEXEC);
+    if (fd < 0) {
+        RLOG(LG_MRG, LogLevel::LL_WARNING) << "[MirrorRing] memfd_create failed; using compacting buffer.";
+        return false;
+    }
+    if (::ftruncate(fd, static_cast<off_t>(capacity_)) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    // Reserve both halves first so the two views are guaranteed adjacent.
+    void* reserved = ::mmap(nullptr, 2 * capacity_, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (reserved == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+    uint8_t* base = static_cast<uint8_t*>(reserved);
+    const int prot = PROT_READ | PROT_WRITE;
+    // Populated now so the session's first reads do not fault.
+    const int flags = MAP_SHARED | MAP_FIXED | MAP_POPULATE;
+    const bool ok =
+        ::mmap(base, capacity_, prot, flags, fd, 0) != MAP_FAILED &&
+        ::mmap(base + capacity_, capacity_, prot, flags, fd, 0) != MAP_FAILED;
+    ::close(fd);
+    if (!ok) {
+        ::munmap(reserved, 2 * capacity_);
+        RLOG(LG_MRG, LogLevel::LL_WARNING) << "[MirrorRing] double mapping failed; using compacting buffer.";
+        return false;
+    }
+    base_ = base;
+    return true;
+#else
+    return false;
+#endif
+}
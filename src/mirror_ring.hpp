@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ------------------------------------------------------------
+// MirrorRing
+// ------------------------------------------------------------
+//
+// Single-threaded byte ring whose readable and writable regions are always
+// contiguous, so a socket can read straight into it and frames can be parsed
+// in place with no wrap handling.
+//
+// Design:
+// - Linux: the same memfd is mapped twice back to back, so bytes past the end
+//   of the first mapping alias the start of the buffer ("mirror"). Reads and
+//   writes address up to capacity() bytes from any offset.
+// - Elsewhere, or if mapping fails: a linear buffer that is compacted
+//   (leftover bytes moved to the front) once half of it has been consumed,
+//   so the copy is amortised over many reads instead of paid on each.
+// - capacity() is a power of two, at least one page.
+//
+class MirrorRing {
+    public:
+        // mirror = false always uses the compacting buffer (for tests).
+        explicit MirrorRing(size_t min_capacity, bool mirror = true);
+        ~MirrorRing();
+
+        MirrorRing(const MirrorRing&) = delete;
+        MirrorRing& operator=(const MirrorRing&) = delete;
+
+        // Writable region; call commit() with the bytes actually written.
+        uint8_t* write_ptr() noexcept { return base_ + (head_ & mask_); }
+        size_t writable() const noexcept {
+            return mirrored_ ? capacity_ - static_cast<size_t>(head_ - tail_) : capacity_ - static_cast<size_t>(head_);
+        }
+        void commit(size_t n) noexcept { head_ += n; }
+
+        const uint8_t* read_ptr() const noexcept { return base_ + (tail_ & mask_); }
+        size_t readable() const noexcept { return static_cast<size_t>(head_ - tail_); }
+        void consume(size_t n) noexcept;
+        // Fallback buffer only (no-op when mirrored): moves unread bytes to the
+        // front so writable() covers everything not yet consumed.
+        void compact() noexcept;
+
+        size_t capacity() const noexcept { return capacity_; }
+        bool mirrored() const noexcept { return mirrored_; }
+
+    private:
+        bool map_mirror_() noexcept;
+
+        uint8_t* base_ = nullptr;
+        size_t capacity_ = 0;
+        uint64_t mask_ = 0;
+        // Free-running when mirrored; offsets into fallback_ otherwise.
+        uint64_t head_ = 0;
+        uint64_t tail_ = 0;
+        bool mirrored_ = false;
+        std::vector<uint8_t> fallback_;
+};
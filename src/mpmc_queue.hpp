@@ -0,0 +1,108 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// ------------------------------------------------------------
+// MPMCQueue
+// ------------------------------------------------------------
+//
+// Bounded multi-producer / multi-consumer queue (Vyukov's bounded queue).
+//
+// Design:
+// - One sequence number per slot tells both sides whose turn it is: pos for
+//   the producer claiming pos, pos + 1 for the consumer claiming pos, and
+//   pos + capacity once that consumer is done. Each side claims positions
+//   with a CAS on its own cache-line-aligned counter.
+// - Slots are cache-line aligned, so neighbouring producers / consumers never
+//   write the same line.
+// - Lock-free but not wait-free: a thread preempted between claiming and
+//   publishing a slot holds up that slot (only) until it resumes.
+//
+template <typename T, size_t CapacityPow2>
+class MPMCQueue {
+    static_assert((CapacityPow2 & (CapacityPow2 - 1)) == 0, "Capacity must be power of two");
+    static_assert(CapacityPow2 >= 2, "Capacity must be >= 2");
+    static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable for this MPMC queue.");
+
+    public:
+        MPMCQueue() noexcept {
+            for (size_t i = 0; i < CapacityPow2; ++i) {
+                slots_[i].seq.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        MPMCQueue(const MPMCQueue&) = delete;
+        MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+        inline bool try_push(const T& item) noexcept {
+            size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+            Slot* slot;
+            for (;;) {
+                slot = &slots_[pos & mask_];
+                const size_t seq = slot->seq.load(std::memory_order_acquire);
+                const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+                if (diff == 0) {
+                    if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (diff < 0) {
+                    return false; // full
+                } else {
+                    pos = enqueue_pos_.load(std::memory_order_relaxed);
+                }
+            }
+            slot->value = item;
+            slot->seq.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        inline bool try_push(T&& item) noexcept {
+            return try_push(static_cast<const T&>(item));
+        }
+
+        inline bool try_pop(T& out) noexcept {
+            size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+            Slot* slot;
+            for (;;) {
+                slot = &slots_[pos & mask_];
+                const size_t seq = slot->seq.load(std::memory_order_acquire);
+                const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+                if (diff == 0) {
+                    if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (diff < 0) {
+                    return false; // empty
+                } else {
+                    pos = dequeue_pos_.load(std::memory_order_relaxed);
+                }
+            }
+            out = slot->value;
+            slot->seq.store(pos + CapacityPow2, std::memory_order_release);
+            return true;
+        }
+
+        inline size_t size_approx() const noexcept {
+            const size_t enq = enqueue_pos_.load(std::memory_order_acquire);
+            const size_t deq = dequeue_pos_.load(std::memory_order_acquire);
+            return enq >= deq ? enq - deq : 0;
+        }
+
+        inline constexpr size_t capacity() const noexcept { return CapacityPow2; }
+
+    private:
+        static constexpr size_t mask_ = CapacityPow2 - 1;
+
+        struct alignas(64) Slot {
+            std::atomic<size_t> seq;
+            T value;
+        };
+
+        alignas(64) std::atomic<size_t> enqueue_pos_{0};
+        alignas(64) std::atomic<size_t> dequeue_pos_{0};
+
+        alignas(64) std::array<Slot, CapacityPow2> slots_;
+};
@@ -0,0 +1,135 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// ------------------------------------------------------------
+// MPSCQueue
+// ------------------------------------------------------------
+//
+// Bounded multi-producer / single-consumer queue (Vyukov's bounded queue
+// with the consumer side simplified to plain loads and stores).
+//
+// Design:
+// - Each slot has a sequence number: pos when free for the producer that
+//   claims pos, pos + 1 once published. Producers claim a position with one
+//   CAS on enqueue_pos_ and publish with a release store on the slot, so
+//   producers never wait on each other's copies.
+// - Sequence numbers live in their own array so the values stay contiguous:
+//   peek_n() hands out runs in place like SPSCQueue, and the engine's drain
+//   works unchanged on either queue.
+// - Same interface as SPSCQueue for the operations both support.
+//
+template <typename T, size_t CapacityPow2>
+class MPSCQueue {
+    static_assert((CapacityPow2 & (CapacityPow2 - 1)) == 0, "Capacity must be power of two");
+    static_assert(CapacityPow2 >= 2, "Capacity must be >= 2");
+    static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable for this MPSC queue.");
+
+    public:
+        MPSCQueue() noexcept {
+            for (size_t i = 0; i < CapacityPow2; ++i) {
+                seq_[i].store(i, std::memory_order_relaxed);
+            }
+        }
+
+        MPSCQueue(const MPSCQueue&) = delete;
+        MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+        // Any thread.
+        inline bool try_push(const T& item) noexcept {
+            size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+            for (;;) {
+                const size_t seq = seq_[pos & mask_].load(std::memory_order_acquire);
+                const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+                if (diff == 0) {
+                    if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (diff < 0) {
+                    return false; // full: the consumer has not freed this slot yet
+                } else {
+                    pos = enqueue_pos_.load(std::memory_order_relaxed);
+                }
+            }
+            buffer_[pos & mask_] = item;
+            seq_[pos & mask_].store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        inline bool try_push(T&& item) noexcept {
+            return try_push(static_cast<const T&>(item));
+        }
+
+        // Consumer only from here on.
+        inline bool try_pop(T& out) noexcept {
+            const size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+            if (!ready_(pos)) return false;
+            out = buffer_[pos & mask_];
+            free_(pos);
+            dequeue_pos_.store(pos + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        inline const T* peek() const noexcept {
+            const size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+            return ready_(pos) ? &buffer_[pos & mask_] : nullptr;
+        }
+
+        // Up to max published items starting at first, contiguous in memory
+        // (stops at the wrap point or at a slot still being written).
+        inline size_t peek_n(const T*& first, size_t max) const noexcept {
+            const size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+            const size_t to_end = CapacityPow2 - (pos & mask_);
+            const size_t limit = max < to_end ? max : to_end;
+            size_t n = 0;
+            while (n < limit && ready_(pos + n)) ++n;
+            first = &buffer_[pos & mask_];
+            return n;
+        }
+
+        inline bool consume_one() noexcept {
+            return consume_n(1) == 1;
+        }
+
+        // Releases up to n items previously seen through peek / peek_n.
+        inline size_t consume_n(size_t n) noexcept {
+            const size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+            size_t done = 0;
+            while (done < n && ready_(pos + done)) {
+                free_(pos + done);
+                ++done;
+            }
+            if (done) dequeue_pos_.store(pos + done, std::memory_order_relaxed);
+            return done;
+        }
+
+        // Any thread; counts claimed positions, including ones mid-copy.
+        inline size_t size_approx() const noexcept {
+            const size_t enq = enqueue_pos_.load(std::memory_order_acquire);
+            const size_t deq = dequeue_pos_.load(std::memory_order_acquire);
+            return enq >= deq ? enq - deq : 0;
+        }
+
+        inline constexpr size_t capacity() const noexcept { return CapacityPow2; }
+
+    private:
+        static constexpr size_t mask_ = CapacityPow2 - 1;
+
+        inline bool ready_(size_t pos) const noexcept {
+            return seq_[pos & mask_].load(std::memory_order_acquire) == pos + 1;
+        }
+
+        // Hands the slot to the producer that will claim pos + capacity.
+        inline void free_(size_t pos) noexcept {
+            seq_[pos & mask_].store(pos + CapacityPow2, std::memory_order_release);
+        }
+
+        alignas(64) std::atomic<size_t> enqueue_pos_{0};   // CAS'd by producers
+        alignas(64) std::atomic<size_t> dequeue_pos_{0};   // written by the consumer only
+
+        alignas(64) std::array<std::atomic<size_t>, CapacityPow2> seq_;
+        alignas(64) std::array<T, CapacityPow2> buffer_{};
+};
@@ -14,34 +14,44 @@ struct Order {
     bool is_bid_;
 };
 
+// Free list over a fixed array. Slots past high_water_ have never been
+// handed out and are linked lazily, so construction and reset() are O(1).
 struct OrderPool {
     Order pool_[MAX_ORDERS];
-    Order* next_free_;
-
-    OrderPool() {
-        for (size_t i = 0; i < MAX_ORDERS - 1; ++i) {
-            pool_[i].next_ = &pool_[i + 1];
-            pool_[i].order_handle_ = i;
-        }
-        pool_[MAX_ORDERS - 1].next_ = nullptr;
-        pool_[MAX_ORDERS - 1].order_handle_ = MAX_ORDERS - 1;
-        next_free_ = &pool_[0];
-    };
+    Order* next_free_ = nullptr;
+    size_t high_water_ = 0;
+    size_t in_use_ = 0;
 
     inline Order* allocate() noexcept {
-        if (!next_free_) return nullptr;
         Order* order = next_free_;
-        next_free_ = next_free_->next_;
+        if (order) {
+            next_free_ = order->next_;
+        } else if (high_water_ < MAX_ORDERS) {
+            order = &pool_[high_water_];
+            order->order_handle_ = static_cast<Id_t>(high_water_);
+            ++high_water_;
+        } else {
+            return nullptr;
+        }
         order->next_ = nullptr;
+        ++in_use_;
         return order;
     };
 
     inline void deallocate(Order* order) noexcept {
         order->next_ = next_free_;
         next_free_ = order;
+        --in_use_;
+    }
+
+    // Forgets every order; their slots are re-handed out from the start.
+    inline void reset() noexcept {
+        next_free_ = nullptr;
+        high_water_ = 0;
+        in_use_ = 0;
     }
 
     inline Order* from_handle(Id_t order_handle) noexcept {
         return &pool_[order_handle];
     }
-};
\ No newline at end of file
+};
@@ -1,7 +1,6 @@
 #pragma once
 #include <array>
 #include "order_book.hpp"
-#include "time.hpp"
 #include "logging.hpp"
 
 TG_INLINE_GLOBAL_LOGGER_WITH_CHANNEL(LG_CON, "CON")
@@ -24,8 +23,8 @@ inline void _debug_check_level_integrity(const OrderBook& order_book) {
     if (order_book.asks.best_price_index_ == NUM_BOOK_LEVELS) {
         return;
     }
-    const Price_t best_bid = order_book.bids.levels_[order_book.bids.best_price_index_].price_;
-    const Price_t best_ask = order_book.asks.levels_[order_book.asks.best_price_index_].price_;
+    const Price_t best_bid = order_book.bids.live_level(order_book.bids.best_price_index_)->price_;
+    const Price_t best_ask = order_book.asks.live_level(order_book.asks.best_price_index_)->price_;
     assert(best_bid < best_ask);
     return;
 #endif
@@ -37,10 +36,11 @@ inline void _debug_print_orders(const OrderBook& order_book) {
         std::cout << "==== " << side_name << " ====\n";
 
         for (std::size_t i = 0; i < NUM_BOOK_LEVELS; ++i) {
-            const PriceLevel& level = side.levels_[i];
+            const PriceLevel* live = side.live_level(i);
 
-            if (!level.first_)
+            if (!live || !live->first_)
                 continue;
+            const PriceLevel& level = *live;
 
             std::cout << "PriceLevel[" << i << "] price=" << level.price_
                       << " total_qty=" << level.total_quantity_ << "\n";
@@ -79,28 +79,90 @@ inline void _debug_print_orders(const OrderBook& order_book) {
 
 OrderBookSide::OrderBookSide(bool is_bid) : is_bid_(is_bid) {
     best_price_index_ = NUM_BOOK_LEVELS;
-    for (size_t i = 0; i < NUM_BOOK_LEVELS; ++i) {
-        levels_[i].idx_ = i;
-        levels_[i].price_ = MINIMUM_BID + i;
-        levels_[i].total_quantity_ = 0;
-        levels_[i].first_ = nullptr;
-        levels_[i].last_ = nullptr;
+}
+
+void OrderBookSide::reset() noexcept {
+    if (++generation_ == 0) {
+        // Wrapped: stale stamps could match again, so clear for real.
+        for (PriceLevel& l : levels_) l.generation_ = 0;
+        generation_ = 1;
     }
+    pool_.reset();
+    depth_.reset();
+    best_price_index_ = NUM_BOOK_LEVELS;
+    num_active_levels_ = 0;
+}
+
+void OrderBookSide::init_level_(PriceLevel& level, size_t idx) noexcept {
+    level.first_ = nullptr;
+    level.last_ = nullptr;
+    level.total_quantity_ = 0;
+    level.generation_ = generation_;
+    level.price_ = MINIMUM_BID + static_cast<Price_t>(idx);
+    level.idx_ = idx;
 }
 
 size_t OrderBookSide::price_to_index(Price_t price) const noexcept {
     return static_cast<size_t>((price - MINIMUM_BID));
 }
 
+uint64_t OrderBookSide::volume_within(size_t ticks) const noexcept {
+    if (best_price_index_ == NUM_BOOK_LEVELS) return 0;
+    // Nothing rests beyond the best price, so one prefix sum covers it.
+    if (is_bid_) {
+        const size_t from = best_price_index_ >= ticks ? best_price_index_ - ticks : 0;
+        return depth_.total().volume - depth_.prefix(from).volume;
+    }
+    return depth_.prefix(best_price_index_ + ticks + 1).volume;
+}
+
+uint64_t OrderBookSide::volume_crossing(Price_t price) const noexcept {
+    if (price < MINIMUM_BID) return is_bid_ ? depth_.total().volume : 0;
+    if (price > MAXIMUM_ASK) return is_bid_ ? 0 : depth_.total().volume;
+    const size_t idx = price_to_index(price);
+    if (is_bid_) return depth_.total().volume - depth_.prefix(idx).volume;
+    return depth_.prefix(idx + 1).volume;
+}
+
+BookSweep OrderBookSide::sweep(uint64_t quantity) const noexcept {
+    BookSweep result;
+    const DepthIndex::Sums& total = depth_.total();
+    if (quantity == 0 || total.volume == 0) return result;
+    if (quantity > total.volume) quantity = total.volume;
+
+    DepthIndex::Sums below;
+    size_t idx;
+    uint64_t beyond_volume;   // taken from levels better than idx
+    uint64_t beyond_notional;
+    if (is_bid_) {
+        // Bids fill from the top: idx is the lowest level still needed,
+        // the last one whose prefix leaves at least quantity above it.
+        idx = depth_.descend(total.volume - quantity, true, below);
+        const uint64_t level_volume = level_quantity(idx);
+        const uint64_t level_notional = level_volume * static_cast<uint64_t>(MINIMUM_BID + static_cast<Price_t>(idx));
+        beyond_volume = total.volume - below.volume - level_volume;
+        beyond_notional = total.notional - below.notional - level_notional;
+    } else {
+        idx = depth_.descend(quantity, false, below);
+        beyond_volume = below.volume;
+        beyond_notional = below.notional;
+    }
+
+    result.worst_price = MINIMUM_BID + static_cast<Price_t>(idx);
+    result.filled = quantity;
+    result.notional = beyond_notional + (quantity - beyond_volume) * static_cast<uint64_t>(result.worst_price);
+    return result;
+}
+
 Order* OrderBookSide::add_order(
     Price_t price, 
     Volume_t quantity, 
     Volume_t quantity_remaining, 
     Id_t order_id, 
     Id_t client_id,
-    Id_t client_request_id
+    Id_t client_request_id,
+    Time_t timestamp
 ) noexcept {
-    Time_t now = utc_now_ns();
     size_t idx = price_to_index(price);
     Order* order = pool_.allocate();
     if (!order) {
@@ -109,12 +171,12 @@ Order* OrderBookSide::add_order(
             client_request_id, 
             static_cast<uint16_t>(ErrorType::ORDER_BOOK_FULL),
             "Order book is full.",
-            now
+            timestamp
         );
         return nullptr;
     }
 
-    PriceLevel& level = levels_[idx];
+    PriceLevel& level = this->level(idx);
 
     _debug_check_level_invariant(level);
 
@@ -134,10 +196,12 @@ Order* OrderBookSide::add_order(
         last->next_ = order;
     } else {
         first = order;  
+        ++num_active_levels_;
     }
     last = order;
     level.total_quantity_ += quantity_remaining;
-    callbacks_->on_level_update(is_bid_ ? Side::BUY : Side::SELL, level, now);
+    depth_.add(idx, quantity_remaining);
+    callbacks_->on_level_update(is_bid_ ? Side::BUY : Side::SELL, level, timestamp);
     if (is_bid_)
         update_best_bid_after_order(idx);
     else
@@ -163,7 +227,7 @@ void OrderBookSide::update_best_ask_after_order(size_t price_idx) {
 void OrderBookSide::update_best_bid_after_empty() noexcept {
     size_t old_idx = best_price_index_;
     for (size_t i = old_idx; i-- > 0; ) {
-        if (levels_[i].total_quantity_ > 0) {
+        if (level_quantity(i) > 0) {
             best_price_index_ = i;
             RLOG(LG_CON, LogLevel::LL_DEBUG) << "[OrderBookSide] Updating best bid after empty to p=" << levels_[i].price_ << ".";
             return;
@@ -176,7 +240,7 @@ void OrderBookSide::update_best_bid_after_empty() noexcept {
 void OrderBookSide::update_best_ask_after_empty() noexcept {
     size_t old_idx = best_price_index_;
     for (size_t i = old_idx + 1; i < NUM_BOOK_LEVELS; ++i) {
-        if (levels_[i].total_quantity_ > 0) {
+        if (level_quantity(i) > 0) {
             best_price_index_ = i;
             RLOG(LG_CON, LogLevel::LL_DEBUG) << "[OrderBookSide] Updating best ask after empty to p=" << levels_[i].price_ << ".";
             return;
@@ -195,12 +259,12 @@ Volume_t OrderBookSide::match_loop(
     Side maker_side,
     PriceCrossFn crosses,
     BestPriceFn advance_best,
-    std::vector<Order*>& order_by_handle,
-    std::unordered_map<Id_t, Id_t>& order_id_to_handle
+    Order** order_by_handle,
+    OrderIdIndex& order_id_to_handle,
+    Time_t timestamp
 ) noexcept {
     RLOG(LG_CON, LogLevel::LL_DEBUG) << "[OrderBookSide] Order from " << client_id << " with id=" << order_id 
     << ", qty=" << incoming_quantity << ", p=" << incoming_price << " entering matching process.";
-    Time_t now = utc_now_ns();
     Volume_t total_incoming_quantity = incoming_quantity;
     auto* cb = callbacks_;
 
@@ -210,7 +274,7 @@ Volume_t OrderBookSide::match_loop(
         if (best_price_index_ == NUM_BOOK_LEVELS)
             break;
 
-        PriceLevel* level = &levels_[best_price_index_];
+        PriceLevel* level = &this->level(best_price_index_);
 
         _debug_check_level_invariant(*level);
 
@@ -221,6 +285,7 @@ Volume_t OrderBookSide::match_loop(
         << ", qty=" << incoming_quantity << ", p=" << incoming_price << " being matched at level p=" << level->price_ <<
         ", qty=" << level->total_quantity_ << ".";
 
+        const Volume_t level_quantity_before = level->total_quantity_;
         while (incoming_quantity > 0 && level->first_) {
             Order* maker = level->first_;
 
@@ -241,7 +306,7 @@ Volume_t OrderBookSide::match_loop(
                 total_incoming_quantity,
                 total_incoming_quantity - incoming_quantity,
                 trade_quantity,
-                now
+                timestamp
             );
 
             if (maker->quantity_remaining_ == 0) {
@@ -251,6 +316,7 @@ Volume_t OrderBookSide::match_loop(
                     next->previous_ = nullptr;
                 } else {
                     level->last_ = nullptr;
+                    --num_active_levels_;
                     advance_best();
                 }
                 order_id_to_handle.erase(maker->order_id_);
@@ -260,7 +326,8 @@ Volume_t OrderBookSide::match_loop(
             }
             _debug_check_level_invariant(*level);
         }
-        cb->on_level_update(maker_side, *level, now);
+        depth_.add(level->idx_, -static_cast<int64_t>(level_quantity_before - level->total_quantity_));
+        cb->on_level_update(maker_side, *level, timestamp);
     }
     return incoming_quantity;
 }
@@ -271,8 +338,9 @@ Volume_t OrderBookSide::match_buy(
     Volume_t incoming_quantity,
     Id_t order_id,
     Id_t client_id,
-    std::vector<Order*>& order_by_handle,
-    std::unordered_map<Id_t, Id_t>& order_id_to_handle
+    Order** order_by_handle,
+    OrderIdIndex& order_id_to_handle,
+    Time_t timestamp
 ) noexcept {
     return match_loop(
         incoming_price,
@@ -283,7 +351,8 @@ Volume_t OrderBookSide::match_buy(
         [](Price_t level_price, Price_t incoming) {return level_price <= incoming;},
         [this]() {update_best_ask_after_empty();},
         order_by_handle,
-        order_id_to_handle
+        order_id_to_handle,
+        timestamp
     );
 }
 
@@ -292,8 +361,9 @@ Volume_t OrderBookSide::match_sell(
     Volume_t incoming_quantity,
     Id_t order_id,
     Id_t client_id,
-    std::vector<Order*>& order_by_handle,
-    std::unordered_map<Id_t, Id_t>& order_id_to_handle
+    Order** order_by_handle,
+    OrderIdIndex& order_id_to_handle,
+    Time_t timestamp
 ) noexcept {
     return match_loop(
         incoming_price,
@@ -304,15 +374,17 @@ Volume_t OrderBookSide::match_sell(
         [](Price_t level_price, Price_t incoming) {return level_price >= incoming;},
         [this]() {update_best_bid_after_empty();},
         order_by_handle,
-        order_id_to_handle
+        order_id_to_handle,
+        timestamp
     );
 }
 
 void OrderBookSide::print_side(const char* name) const {
     std::cout << "=== " << name << " ===\n";
     for (size_t i = 0; i < NUM_BOOK_LEVELS; ++i) {
-        const PriceLevel& level = levels_[i];
-        if (level.total_quantity_ == 0) continue;
+        const PriceLevel* live = live_level(i);
+        if (!live || live->total_quantity_ == 0) continue;
+        const PriceLevel& level = *live;
 
         std::cout << "Price " << level.price_ << " -> ";
         Order* cur = level.first_;
@@ -326,29 +398,39 @@ void OrderBookSide::print_side(const char* name) const {
     std::cout << "\n";
 }
 
-OrderBook::OrderBook() : bids(true), asks(false), order_id_(0), trade_id_(0) {
-    order_by_handle_.resize(2 * MAX_ORDERS, nullptr);
-    order_id_to_handle_.reserve(2 * MAX_ORDERS);
+OrderBook::OrderBook()
+    : bids(true)
+    , asks(false)
+    , order_id_(0)
+    , trade_id_(0)
+    , order_by_handle_(new Order*[ORDER_HANDLES]) {
     asks.set_callbacks(callbacks_);
     bids.set_callbacks(callbacks_);
 }
 
+void OrderBook::reset() noexcept {
+    bids.reset();
+    asks.reset();
+    order_id_to_handle_.reset();
+    order_id_ = 0;
+    trade_id_ = 0;
+}
+
 void OrderBook::set_callbacks(OrderBookCallbacks* callbacks) {
     callbacks_ = callbacks;
     asks.set_callbacks(callbacks);
     bids.set_callbacks(callbacks);
 }
 
-void OrderBook::submit_order(Price_t price, Volume_t quantity, bool is_bid, Id_t client_id, Id_t client_request_id) {
+void OrderBook::submit_order(Price_t price, Volume_t quantity, bool is_bid, Id_t client_id, Id_t client_request_id, Time_t timestamp) {
     RLOG(LG_CON, LogLevel::LL_DEBUG) << "[OrderBook] Order from " << client_id << " with request ID " << client_request_id << " submitted into order book.";
-    Time_t now = utc_now_ns();
     if (quantity == 0) {
         callbacks_->on_error(
             client_id, 
             client_request_id,
             static_cast<uint16_t>(ErrorType::INVALID_VOLUME),
             "Invalid order size.",
-            now
+            timestamp
         );
         return;
     }
@@ -358,7 +440,7 @@ void OrderBook::submit_order(Price_t price, Volume_t quantity, bool is_bid, Id_t
             client_request_id,
             static_cast<uint16_t>(ErrorType::INVALID_PRICE),
             "Invalid price.",
-            now
+            timestamp
         );
         return;
     }
@@ -366,25 +448,25 @@ void OrderBook::submit_order(Price_t price, Volume_t quantity, bool is_bid, Id_t
     Volume_t remaining = quantity;
 
     if (is_bid) {
-        remaining = asks.match_buy(price, quantity, order_id, client_id, order_by_handle_, order_id_to_handle_);
+        remaining = asks.match_buy(price, quantity, order_id, client_id, order_by_handle_.get(), order_id_to_handle_, timestamp);
         if (remaining > 0) {
-            Order* resting_order = bids.add_order(price, quantity, remaining, order_id, client_id, client_request_id);
+            Order* resting_order = bids.add_order(price, quantity, remaining, order_id, client_id, client_request_id, timestamp);
             if (resting_order) {
                 Id_t encoded_handle = resting_order->order_handle_ * 2;
                 order_by_handle_[encoded_handle] = resting_order;
-                order_id_to_handle_.emplace(order_id, encoded_handle);
-                callbacks_->on_order_inserted(client_request_id, *resting_order, now);
+                order_id_to_handle_.insert(order_id, encoded_handle);
+                callbacks_->on_order_inserted(client_request_id, *resting_order, timestamp);
             }
         }
     } else {
-        remaining = bids.match_sell(price, quantity, order_id, client_id, order_by_handle_, order_id_to_handle_);
+        remaining = bids.match_sell(price, quantity, order_id, client_id, order_by_handle_.get(), order_id_to_handle_, timestamp);
         if (remaining > 0) {
-            Order* resting_order = asks.add_order(price, quantity, remaining, order_id, client_id, client_request_id);
+            Order* resting_order = asks.add_order(price, quantity, remaining, order_id, client_id, client_request_id, timestamp);
             if (resting_order) {
                 Id_t encoded_handle = resting_order->order_handle_ * 2 + 1;
                 order_by_handle_[encoded_handle] = resting_order;
-                order_id_to_handle_.emplace(order_id, encoded_handle);
-                callbacks_->on_order_inserted(client_request_id, *resting_order, now);
+                order_id_to_handle_.insert(order_id, encoded_handle);
+                callbacks_->on_order_inserted(client_request_id, *resting_order, timestamp);
             }
         }
     }
@@ -398,20 +480,18 @@ void OrderBook::print_book() const {
     asks.print_side("ASKS");
 }
 
-void OrderBook::cancel_order(Id_t client_id, Id_t client_request_id, Id_t order_id) noexcept {
-    Time_t now = utc_now_ns();
-    auto it = order_id_to_handle_.find(order_id);
-    if (it == order_id_to_handle_.end()) {
+void OrderBook::cancel_order(Id_t client_id, Id_t client_request_id, Id_t order_id, Time_t timestamp) noexcept {
+    const Id_t order_handle = order_id_to_handle_.find(order_id);
+    if (order_handle == OrderIdIndex::NONE) {
         callbacks_->on_error(
             client_id,
             client_request_id,
             static_cast<uint16_t>(ErrorType::ORDER_NOT_FOUND),
             "Order ID not found.",
-            now
+            timestamp
         );
         return;
     }
-    Id_t order_handle = it->second;
     Order* order = order_by_handle_[order_handle];
     if (!order) {
         callbacks_->on_error(
@@ -419,7 +499,7 @@ void OrderBook::cancel_order(Id_t client_id, Id_t client_request_id, Id_t order_
             client_request_id,
             static_cast<uint16_t>(ErrorType::ORDER_NOT_FOUND),
             "Order ID not found.",
-            now
+            timestamp
         );
         return;
     } 
@@ -430,18 +510,19 @@ void OrderBook::cancel_order(Id_t client_id, Id_t client_request_id, Id_t order_
             client_request_id,
             static_cast<uint16_t>(ErrorType::UNAUTHORISED),
             "Unauthorised request.",
-            now
+            timestamp
         );
         return;
     }
 
     OrderBookSide& side = order->is_bid_ ? bids : asks;
     size_t idx = side.price_to_index(order->price_);
-    PriceLevel& level = side.levels_[idx];
+    PriceLevel& level = side.level(idx);
 
     _debug_check_level_invariant(level);
 
     level.total_quantity_ -= order->quantity_remaining_;
+    side.depth_.add(idx, -static_cast<int64_t>(order->quantity_remaining_));
 
     Order order_snapshot = *order;
     remove_order(order, side, level);
@@ -453,26 +534,24 @@ void OrderBook::cancel_order(Id_t client_id, Id_t client_request_id, Id_t order_
             side.update_best_ask_after_empty();
     }
 
-    callbacks_->on_level_update(order_snapshot.is_bid_ ? Side::BUY : Side::SELL, level, now);
-    callbacks_->on_order_cancelled(client_request_id, order_snapshot, now);
+    callbacks_->on_level_update(order_snapshot.is_bid_ ? Side::BUY : Side::SELL, level, timestamp);
+    callbacks_->on_order_cancelled(client_request_id, order_snapshot, timestamp);
     
     _debug_check_level_invariant(level);
 }
 
-void OrderBook::amend_order(Id_t client_id, Id_t client_request_id, Id_t order_id, Volume_t quantity_new) noexcept {
-    Time_t now = utc_now_ns();
-    auto it = order_id_to_handle_.find(order_id);
-    if (it == order_id_to_handle_.end()) {
+void OrderBook::amend_order(Id_t client_id, Id_t client_request_id, Id_t order_id, Volume_t quantity_new, Time_t timestamp) noexcept {
+    const Id_t order_handle = order_id_to_handle_.find(order_id);
+    if (order_handle == OrderIdIndex::NONE) {
         callbacks_->on_error(
             client_id,
             client_request_id,
             static_cast<uint16_t>(ErrorType::ORDER_NOT_FOUND),
             "Order ID not found.",
-            now
+            timestamp
         );
         return;
     }
-    Id_t order_handle = it->second;
     Order* order = order_by_handle_[order_handle];
     if (!order) {
         callbacks_->on_error(
@@ -480,7 +559,7 @@ void OrderBook::amend_order(Id_t client_id, Id_t client_request_id, Id_t order_i
             client_request_id,
             static_cast<uint16_t>(ErrorType::ORDER_NOT_FOUND),
             "Order ID not found.",
-            now
+            timestamp
         );
         return;
     } 
@@ -491,7 +570,7 @@ void OrderBook::amend_order(Id_t client_id, Id_t client_request_id, Id_t order_i
             client_request_id,
             static_cast<uint16_t>(ErrorType::UNAUTHORISED),
             "Unauthorised request.",
-            now
+            timestamp
         );
         return;
     }
@@ -502,7 +581,7 @@ void OrderBook::amend_order(Id_t client_id, Id_t client_request_id, Id_t order_i
             client_request_id,
             static_cast<uint16_t>(ErrorType::INVALID_VOLUME),
             "Invalid order size.",
-            now
+            timestamp
         );
         return;
     }
@@ -519,7 +598,7 @@ void OrderBook::amend_order(Id_t client_id, Id_t client_request_id, Id_t order_i
             client_request_id,
             static_cast<uint16_t>(ErrorType::INVALID_VOLUME),
             "Invalid order size.",
-            now
+            timestamp
         );
         return;
     }
@@ -531,14 +610,14 @@ void OrderBook::amend_order(Id_t client_id, Id_t client_request_id, Id_t order_i
             client_request_id,
             quantity_old_total,
             *order,
-            now
+            timestamp
         );
         return;
     }
 
     OrderBookSide& side = order->is_bid_ ? bids : asks;
     size_t idx = side.price_to_index(order->price_);
-    PriceLevel& level = side.levels_[idx];
+    PriceLevel& level = side.level(idx);
 
     _debug_check_level_invariant(level);
 
@@ -548,17 +627,19 @@ void OrderBook::amend_order(Id_t client_id, Id_t client_request_id, Id_t order_i
     order->quantity_ = quantity_new_total;
     order->quantity_remaining_ = quantity_new_remaining;
     level.total_quantity_ -= delta;
+    side.depth_.add(idx, -static_cast<int64_t>(delta));
 
     RLOG(LG_CON, LogLevel::LL_DEBUG) << "(Post amend update) level_qty=" << level.total_quantity_ << ", delta=" << delta << "\n";
 
     Order order_snapshot = *order;
 
-    if (level.total_quantity_ == 0) {
+    // Only the best level emptying moves the best price (as in cancel).
+    if (level.total_quantity_ == 0 && side.best_price_index_ == idx) {
         order_snapshot.is_bid_ ? side.update_best_bid_after_empty() : side.update_best_ask_after_empty();
     }
 
-    callbacks_->on_order_amended(client_request_id, quantity_old_total, order_snapshot, now);
-    callbacks_->on_level_update(order_snapshot.is_bid_ ? Side::BUY : Side::SELL, level, now);
+    callbacks_->on_order_amended(client_request_id, quantity_old_total, order_snapshot, timestamp);
+    callbacks_->on_level_update(order_snapshot.is_bid_ ? Side::BUY : Side::SELL, level, timestamp);
     if (quantity_new_remaining == 0) {
         remove_order(order, side, level);
     }
@@ -577,6 +658,9 @@ void OrderBook::remove_order(Order* order, OrderBookSide& side, PriceLevel& leve
     } else {
         level.last_ = order->previous_;
     }
+    if (!level.first_) {
+        --side.num_active_levels_;
+    }
     const Id_t order_id = order->order_id_;
     const Id_t encoded = order->order_handle_ * 2 + (order->is_bid_ ? 0 : 1);
     order_by_handle_[encoded] = nullptr;
@@ -584,12 +668,43 @@ void OrderBook::remove_order(Order* order, OrderBookSide& side, PriceLevel& leve
     side.pool_.deallocate(order);
 }
 
+void OrderBook::build_depth(BookDepth& out) const noexcept {
+    out.next_order_id = order_id_;
+
+    // Occupied levels come from the depth index, O(log levels) each, so a
+    // sparse book costs no more than a dense one. Bids: the level where the
+    // running total from the bottom reaches target is the highest occupied
+    // one at or below it.
+    uint32_t n = 0;
+    DepthIndex::Sums before;
+    for (uint64_t target = bids.depth_.total().volume; target > 0 && n < BookDepth::LEVELS; ++n) {
+        const size_t idx = bids.depth_.descend(target, false, before);
+        out.bid_prices[n] = MINIMUM_BID + static_cast<Price_t>(idx);
+        out.bid_volumes[n] = bids.level_quantity(idx);
+        target = before.volume;
+    }
+    out.bid_levels = n;
+
+    // Asks: the level where the running total passes target is the lowest
+    // occupied one above everything already taken.
+    n = 0;
+    const uint64_t ask_total = asks.depth_.total().volume;
+    for (uint64_t target = 0; target < ask_total && n < BookDepth::LEVELS; ++n) {
+        const size_t idx = asks.depth_.descend(target, true, before);
+        const Volume_t q = asks.level_quantity(idx);
+        out.ask_prices[n] = MINIMUM_BID + static_cast<Price_t>(idx);
+        out.ask_volumes[n] = q;
+        target = before.volume + q;
+    }
+    out.ask_levels = n;
+}
+
 void OrderBook::build_snapshot(
     std::array<Volume_t, ORDER_BOOK_MESSAGE_DEPTH>& bid_volumes,
     std::array<Price_t, ORDER_BOOK_MESSAGE_DEPTH>& bid_prices,
     std::array<Volume_t, ORDER_BOOK_MESSAGE_DEPTH>& ask_volumes,
     std::array<Price_t, ORDER_BOOK_MESSAGE_DEPTH>& ask_prices
-) {
+) const {
     bid_volumes.fill(0);
     bid_prices.fill(0);
     ask_volumes.fill(0);
@@ -600,11 +715,11 @@ void OrderBook::build_snapshot(
         size_t idx = bids.best_price_index_;
 
         while (idx < NUM_BOOK_LEVELS && depth < ORDER_BOOK_MESSAGE_DEPTH) {
-            const PriceLevel& level = bids.levels_[idx];
+            const PriceLevel* level = bids.live_level(idx);
 
-            if (level.total_quantity_ > 0) {
-                bid_prices[depth]  = level.price_;
-                bid_volumes[depth] = level.total_quantity_;
+            if (level && level->total_quantity_ > 0) {
+                bid_prices[depth]  = level->price_;
+                bid_volumes[depth] = level->total_quantity_;
                 ++depth;
             }
 
@@ -618,11 +733,11 @@ void OrderBook::build_snapshot(
         size_t idx = asks.best_price_index_;
 
         while (idx < NUM_BOOK_LEVELS && depth < ORDER_BOOK_MESSAGE_DEPTH) {
-            const PriceLevel& level = asks.levels_[idx];
+            const PriceLevel* level = asks.live_level(idx);
 
-            if (level.total_quantity_ > 0) {
-                ask_prices[depth]  = level.price_;
-                ask_volumes[depth] = level.total_quantity_;
+            if (level && level->total_quantity_ > 0) {
+                ask_prices[depth]  = level->price_;
+                ask_volumes[depth] = level->total_quantity_;
                 ++depth;
             }
 
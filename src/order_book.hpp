@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <cassert>
 #include <algorithm>
+#include <array>
 #include <vector>
 #include <iostream>
 #include <iomanip>
@@ -10,34 +11,78 @@
 #include "order.hpp"
 #include "pricelevel.hpp"
 #include "callbacks.hpp"
+#include "order_id_index.hpp"
+#include "depth_index.hpp"
 
+// Outcome of taking volume from one side, best level first.
+struct BookSweep {
+    uint64_t filled = 0;     // below the request when the side runs out
+    uint64_t notional = 0;   // sum of price x quantity over the fills
+    Price_t worst_price = 0; // last level reached; 0 if nothing filled
+};
+
+// Levels are initialised on first use in each generation: a level whose
+// generation_ differs from the side's is empty, whatever it still holds.
+// reset() therefore only bumps the generation.
 struct OrderBookSide {
-    PriceLevel levels_[NUM_BOOK_LEVELS];
+    PriceLevel levels_[NUM_BOOK_LEVELS]{};
     OrderPool pool_;
     bool is_bid_;
     size_t best_price_index_;
+    size_t num_active_levels_ = 0;
+    uint32_t generation_ = 1;
+    DepthIndex depth_; // kept in step with every level's total_quantity_
 
     OrderBookSide(bool is_bid);
 
+    // Empties the side in O(1).
+    void reset() noexcept;
+
+    // Level at idx, initialised if it is stale. For writers.
+    inline PriceLevel& level(size_t idx) noexcept {
+        PriceLevel& l = levels_[idx];
+        if (l.generation_ != generation_) init_level_(l, idx);
+        return l;
+    }
+    // Level at idx, or nullptr if stale (empty). For readers.
+    inline const PriceLevel* live_level(size_t idx) const noexcept {
+        const PriceLevel& l = levels_[idx];
+        return l.generation_ == generation_ ? &l : nullptr;
+    }
+    inline Volume_t level_quantity(size_t idx) const noexcept {
+        const PriceLevel* l = live_level(idx);
+        return l ? l->total_quantity_ : 0;
+    }
+
+    // Depth queries, O(log levels) through depth_.
+    // Volume within ticks of the best price (0: the best level alone).
+    uint64_t volume_within(size_t ticks) const noexcept;
+    // Volume an incoming order limited at price would trade against.
+    uint64_t volume_crossing(Price_t price) const noexcept;
+    // Fills for taking quantity; worst_price is the price that fills it.
+    BookSweep sweep(uint64_t quantity) const noexcept;
+
     inline size_t price_to_index(Price_t price) const noexcept;
     Volume_t match_buy(
         Price_t incoming_price, 
         Volume_t incoming_quantity, 
         Id_t order_id, 
         Id_t client_id, 
-        std::vector<Order*>& order_index,
-        std::unordered_map<Id_t, Id_t>& order_id_to_handle
+        Order** order_by_handle,
+        OrderIdIndex& order_id_to_handle,
+        Time_t timestamp
     ) noexcept;
     Volume_t match_sell(
         Price_t incoming_price, 
         Volume_t incoming_quantity, 
         Id_t order_id, 
         Id_t client_id, 
-        std::vector<Order*>& order_index,
-        std::unordered_map<Id_t, Id_t>& order_id_to_handle
+        Order** order_by_handle,
+        OrderIdIndex& order_id_to_handle,
+        Time_t timestamp
     ) noexcept;
     void print_side(const char* name) const;
-    Order* add_order(Price_t price, Volume_t quantity, Volume_t quantity_remaining, Id_t id, Id_t client_id, Id_t client_request_id) noexcept;
+    Order* add_order(Price_t price, Volume_t quantity, Volume_t quantity_remaining, Id_t id, Id_t client_id, Id_t client_request_id, Time_t timestamp) noexcept;
     void update_best_bid_after_order(size_t price_idx);
     void update_best_ask_after_order(size_t price_idx);
     void update_best_bid_after_empty() noexcept;
@@ -56,36 +101,87 @@ struct OrderBookSide {
             Side maker_side,
             PriceCrossFn crosses,
             BestPriceFn advance_best,
-            std::vector<Order*>& order_index,
-            std::unordered_map<Id_t, Id_t>& order_id_to_handle
+            Order** order_by_handle,
+            OrderIdIndex& order_id_to_handle,
+            Time_t timestamp
         ) noexcept;
+        void init_level_(PriceLevel& level, size_t idx) noexcept;
         OrderBookCallbacks* callbacks_;
 };
 
+// Aggregated top of book, best level first, for readers off the engine
+// thread (published through a Seqlock).
+struct BookDepth {
+    static constexpr size_t LEVELS = 64;
+    uint32_t bid_levels = 0;
+    uint32_t ask_levels = 0;
+    Id_t next_order_id = 0;
+    std::array<Price_t, LEVELS> bid_prices{};
+    std::array<Volume_t, LEVELS> bid_volumes{};
+    std::array<Price_t, LEVELS> ask_prices{};
+    std::array<Volume_t, LEVELS> ask_volumes{};
+};
+
 struct OrderBook {
     OrderBookSide bids;
     OrderBookSide asks;
 
     OrderBook();
 
-    void submit_order(Price_t price, Volume_t quantity, bool is_bid, Id_t client_id, Id_t client_request_id);
+    // Empties the book in O(1) for reuse between simulation episodes: order
+    // and trade ids restart from 0, callbacks are kept, no events are sent.
+    void reset() noexcept;
+
+    void submit_order(Price_t price, Volume_t quantity, bool is_bid, Id_t client_id, Id_t client_request_id, Time_t timestamp);
     void print_book() const;
-    void cancel_order(Id_t client_id, Id_t client_request_id, Id_t order_id) noexcept;
-    void amend_order(Id_t client_id, Id_t client_request_id, Id_t order_id, Volume_t quantity_new) noexcept;
+    void cancel_order(Id_t client_id, Id_t client_request_id, Id_t order_id, Time_t timestamp) noexcept;
+    void amend_order(Id_t client_id, Id_t client_request_id, Id_t order_id, Volume_t quantity_new, Time_t timestamp) noexcept;
     void set_callbacks(OrderBookCallbacks* callbacks);
     void remove_order(Order* order, OrderBookSide& side, PriceLevel& level);
+    void build_depth(BookDepth& out) const noexcept;
+
+    // Depth queries on the resting side (is_bid: the bids).
+    uint64_t volume_within(bool is_bid, size_t ticks) const noexcept {
+        return (is_bid ? bids : asks).volume_within(ticks);
+    }
+    uint64_t volume_crossing(bool is_bid, Price_t price) const noexcept {
+        return (is_bid ? bids : asks).volume_crossing(price);
+    }
+    BookSweep sweep(bool is_bid, uint64_t quantity) const noexcept {
+        return (is_bid ? bids : asks).sweep(quantity);
+    }
+
+    // Resting order with this id, or nullptr.
+    const Order* find_order(Id_t order_id) const noexcept {
+        const Id_t handle = order_id_to_handle_.find(order_id);
+        return handle == OrderIdIndex::NONE ? nullptr : order_by_handle_[handle];
+    }
+    // Id the next accepted order will get.
+    Id_t next_order_id() const noexcept { return order_id_; }
+
     void build_snapshot(
         std::array<Volume_t, ORDER_BOOK_MESSAGE_DEPTH>& bid_volumes,
         std::array<Price_t, ORDER_BOOK_MESSAGE_DEPTH>& bid_prices,
         std::array<Volume_t, ORDER_BOOK_MESSAGE_DEPTH>& ask_volumes,
         std::array<Price_t, ORDER_BOOK_MESSAGE_DEPTH>& ask_prices
-    );
+    ) const;
+
+    // Calls f(data, bytes) for each heap buffer the book owns (the sides
+    // live inline), so startup can prefault and lock them.
+    template <typename F>
+    void for_each_heap_buffer(F&& f) {
+        f(static_cast<void*>(order_by_handle_.get()), ORDER_HANDLES * sizeof(Order*));
+        f(order_id_to_handle_.data(), OrderIdIndex::bytes());
+    }
 
     private:
         Id_t order_id_;
         Id_t trade_id_;
-        std::vector<Order*> order_by_handle_;
-        std::unordered_map<Id_t, Id_t> order_id_to_handle_;
+        static constexpr size_t ORDER_HANDLES = 2 * MAX_ORDERS;
+        // Left uninitialised: an entry is written whenever its order rests and
+        // only read through order_id_to_handle_, which never outlives it.
+        std::unique_ptr<Order*[]> order_by_handle_;
+        OrderIdIndex order_id_to_handle_;
         OrderBookCallbacks* callbacks_ = nullptr;
 };
 
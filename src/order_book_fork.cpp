@@ -0,0 +1,217 @@
+#include "order_book_fork.hpp"
+
+#include <algorithm>
+
+OrderBookFork::OrderBookFork(const OrderBook& base)
+    : base_(&base)
+    , next_order_id_(base.next_order_id()) {
+    bids_.base = &base.bids;
+    bids_.is_bid = true;
+    asks_.base = &base.asks;
+    asks_.is_bid = false;
+}
+
+OrderBookFork::OrderBookFork(const BookDepth& depth)
+    : next_order_id_(depth.next_order_id) {
+    bids_.is_bid = true;
+    asks_.is_bid = false;
+    auto copy_side = [](ForkSide& side, uint32_t count, const auto& prices, const auto& volumes) {
+        for (uint32_t i = 0; i < count && i < BookDepth::LEVELS; ++i) {
+            if (prices[i] < MINIMUM_BID || prices[i] > MAXIMUM_ASK || volumes[i] == 0) continue;
+            ForkLevel& level = side.levels[index_of_(prices[i])];
+            level.orders.push_back(ForkOrder{NONE, NONE, volumes[i], volumes[i]});
+            level.total = volumes[i];
+        }
+    };
+    copy_side(bids_, depth.bid_levels, depth.bid_prices, depth.bid_volumes);
+    copy_side(asks_, depth.ask_levels, depth.ask_prices, depth.ask_volumes);
+}
+
+Volume_t OrderBookFork::quantity_(const ForkSide& side, size_t idx) noexcept {
+    const auto it = side.levels.find(idx);
+    if (it != side.levels.end()) return it->second.total;
+    return side.base ? side.base->level_quantity(idx) : 0;
+}
+
+size_t OrderBookFork::best_index_(const ForkSide& side) noexcept {
+    // Best copied level still holding volume.
+    size_t best = NUM_BOOK_LEVELS;
+    if (side.is_bid) {
+        for (auto it = side.levels.rbegin(); it != side.levels.rend(); ++it) {
+            if (it->second.total > 0) { best = it->first; break; }
+        }
+    } else {
+        for (auto it = side.levels.begin(); it != side.levels.end(); ++it) {
+            if (it->second.total > 0) { best = it->first; break; }
+        }
+    }
+    if (!side.base) return best;
+
+    // The base's best may have been emptied in the fork: walk away from it
+    // until a level has volume or we pass the best copied level.
+    const size_t base_best = side.base->best_price_index_;
+    if (base_best == NUM_BOOK_LEVELS) return best;
+    if (side.is_bid) {
+        for (size_t idx = base_best + 1; idx-- > 0;) {
+            if (best != NUM_BOOK_LEVELS && idx <= best) return best;
+            if (quantity_(side, idx) > 0) return idx;
+        }
+    } else {
+        for (size_t idx = base_best; idx < NUM_BOOK_LEVELS; ++idx) {
+            if (best != NUM_BOOK_LEVELS && idx >= best) return best;
+            if (quantity_(side, idx) > 0) return idx;
+        }
+    }
+    return best;
+}
+
+OrderBookFork::ForkLevel& OrderBookFork::touch_(ForkSide& side, size_t idx) {
+    const auto [it, inserted] = side.levels.try_emplace(idx);
+    ForkLevel& level = it->second;
+    if (inserted && side.base) {
+        if (const PriceLevel* live = side.base->live_level(idx)) {
+            for (const Order* o = live->first_; o; o = o->next_) {
+                level.orders.push_back(ForkOrder{o->order_id_, o->client_id_, o->quantity_, o->quantity_remaining_});
+            }
+            level.total = live->total_quantity_;
+        }
+    }
+    return level;
+}
+
+OrderBookFork::ForkOrder* OrderBookFork::find_(Id_t order_id, ForkLevel*& level) {
+    level = nullptr;
+    if (const auto own = own_orders_.find(order_id); own != own_orders_.end()) {
+        ForkSide& side = own->second.first ? bids_ : asks_;
+        level = &side.levels[own->second.second];
+    } else if (base_) {
+        const Order* order = base_->find_order(order_id);
+        if (!order) return nullptr;
+        level = &touch_(order->is_bid_ ? bids_ : asks_, index_of_(order->price_));
+    } else {
+        return nullptr;
+    }
+    for (size_t i = level->head; i < level->orders.size(); ++i) {
+        ForkOrder& o = level->orders[i];
+        if (o.order_id == order_id) return o.remaining > 0 ? &o : nullptr;
+    }
+    return nullptr; // filled or cancelled in the fork
+}
+
+OrderBookFork::SubmitResult OrderBookFork::submit_order(Price_t price, Volume_t quantity, bool is_bid, Id_t client_id) {
+    SubmitResult result;
+    if (quantity == 0 || price < MINIMUM_BID || price > MAXIMUM_ASK) return result;
+    result.order_id = next_order_id_++;
+
+    ForkSide& opposite = is_bid ? asks_ : bids_;
+    Volume_t remaining = quantity;
+    while (remaining > 0) {
+        const size_t best = best_index_(opposite);
+        if (best == NUM_BOOK_LEVELS) break;
+        const Price_t level_price = price_of_(best);
+        if (is_bid ? level_price > price : level_price < price) break;
+
+        ForkLevel& level = touch_(opposite, best);
+        while (remaining > 0 && level.head < level.orders.size()) {
+            ForkOrder& maker = level.orders[level.head];
+            const Volume_t traded = std::min(maker.remaining, remaining);
+            maker.remaining -= traded;
+            remaining -= traded;
+            level.total -= traded;
+            fills_.push_back(Fill{result.order_id, maker.order_id, maker.client_id, level_price, traded});
+            if (maker.remaining == 0) {
+                own_orders_.erase(maker.order_id);
+                ++level.head;
+            }
+        }
+    }
+    result.filled = quantity - remaining;
+
+    if (remaining > 0) {
+        const size_t idx = index_of_(price);
+        ForkLevel& level = touch_(is_bid ? bids_ : asks_, idx);
+        level.orders.push_back(ForkOrder{result.order_id, client_id, quantity, remaining});
+        level.total += remaining;
+        own_orders_.emplace(result.order_id, std::make_pair(is_bid, idx));
+        result.resting = remaining;
+    }
+    return result;
+}
+
+bool OrderBookFork::cancel_order(Id_t client_id, Id_t order_id) {
+    ForkLevel* level = nullptr;
+    ForkOrder* order = find_(order_id, level);
+    if (!order || order->client_id != client_id) return false;
+
+    level->total -= order->remaining;
+    level->orders.erase(level->orders.begin() + (order - level->orders.data()));
+    own_orders_.erase(order_id);
+    return true;
+}
+
+bool OrderBookFork::amend_order(Id_t client_id, Id_t order_id, Volume_t quantity_new) {
+    ForkLevel* level = nullptr;
+    ForkOrder* order = find_(order_id, level);
+    if (!order || order->client_id != client_id) return false;
+
+    const Volume_t cumulative = order->quantity - order->remaining;
+    if (quantity_new < cumulative) return false;
+    const Volume_t remaining_new = quantity_new - cumulative;
+    if (remaining_new > order->remaining) return false; // the real book only reduces
+    if (remaining_new == order->remaining) return true;
+
+    level->total -= order->remaining - remaining_new;
+    order->quantity = quantity_new;
+    order->remaining = remaining_new;
+    if (remaining_new == 0) {
+        level->orders.erase(level->orders.begin() + (order - level->orders.data()));
+        own_orders_.erase(order_id);
+    }
+    return true;
+}
+
+Volume_t OrderBookFork::level_quantity(bool is_bid, Price_t price) const noexcept {
+    if (price < MINIMUM_BID || price > MAXIMUM_ASK) return 0;
+    return quantity_(is_bid ? bids_ : asks_, index_of_(price));
+}
+
+Price_t OrderBookFork::best_bid() const noexcept {
+    const size_t idx = best_index_(bids_);
+    return idx == NUM_BOOK_LEVELS ? 0 : price_of_(idx);
+}
+
+Price_t OrderBookFork::best_ask() const noexcept {
+    const size_t idx = best_index_(asks_);
+    return idx == NUM_BOOK_LEVELS ? 0 : price_of_(idx);
+}
+
+void OrderBookFork::build_snapshot(
+    std::array<Volume_t, ORDER_BOOK_MESSAGE_DEPTH>& bid_volumes,
+    std::array<Price_t, ORDER_BOOK_MESSAGE_DEPTH>& bid_prices,
+    std::array<Volume_t, ORDER_BOOK_MESSAGE_DEPTH>& ask_volumes,
+    std::array<Price_t, ORDER_BOOK_MESSAGE_DEPTH>& ask_prices
+) const {
+    bid_volumes.fill(0);
+    bid_prices.fill(0);
+    ask_volumes.fill(0);
+    ask_prices.fill(0);
+
+    size_t depth = 0;
+    for (size_t idx = best_index_(bids_); idx < NUM_BOOK_LEVELS && depth < ORDER_BOOK_MESSAGE_DEPTH; --idx) {
+        if (const Volume_t q = quantity_(bids_, idx)) {
+            bid_prices[depth] = price_of_(idx);
+            bid_volumes[depth] = q;
+            ++depth;
+        }
+        if (idx == 0) break;
+    }
+
+    depth = 0;
+    for (size_t idx = best_index_(asks_); idx < NUM_BOOK_LEVELS && depth < ORDER_BOOK_MESSAGE_DEPTH; ++idx) {
+        if (const Volume_t q = quantity_(asks_, idx)) {
+            ask_prices[depth] = price_of_(idx);
+            ask_volumes[depth] = q;
+            ++depth;
+        }
+    }
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "order_book.hpp"
+#include "types.hpp"
+
+// ------------------------------------------------------------
+// OrderBookFork
+// ------------------------------------------------------------
+//
+// A throwaway copy of a book for "what if I sent this?" questions: runs
+// hypothetical submits, cancels and amends with the real book's matching
+// rules, reports the fills and the resulting book, and is then discarded.
+//
+// Design:
+// - Copy-on-write per price level: forking is O(1). A level is copied (its
+//   FIFO of orders) the first time a command touches it; every other level
+//   is read straight from the base book.
+// - Forking a live OrderBook borrows it: use the fork on the engine thread,
+//   before the book changes again. Fills then name the real maker orders.
+// - Forking a BookDepth (read through Seqlock from any thread) copies its
+//   levels up front, one aggregate maker per level (maker ids NONE), and
+//   sees nothing beyond the published depth. Fill prices and quantities
+//   match the live book as of that snapshot.
+// - Order ids continue from the base book's next id, as the engine would
+//   assign them if the same commands arrived next.
+//
+class OrderBookFork {
+    public:
+        static constexpr Id_t NONE = ~Id_t{0};
+
+        struct Fill {
+            Id_t taker_order_id;
+            Id_t maker_order_id;  // NONE for aggregate (depth) makers
+            Id_t maker_client_id; // NONE for aggregate (depth) makers
+            Price_t price;
+            Volume_t quantity;
+        };
+
+        struct SubmitResult {
+            Id_t order_id = NONE; // NONE: rejected (zero size or bad price)
+            Volume_t filled = 0;
+            Volume_t resting = 0; // left on the fork's book
+        };
+
+        explicit OrderBookFork(const OrderBook& base);
+        explicit OrderBookFork(const BookDepth& depth);
+
+        SubmitResult submit_order(Price_t price, Volume_t quantity, bool is_bid, Id_t client_id);
+        // Same checks as the real book; false where it would report an error.
+        bool cancel_order(Id_t client_id, Id_t order_id);
+        bool amend_order(Id_t client_id, Id_t order_id, Volume_t quantity_new);
+
+        // Every fill since the fork was made, in order.
+        const std::vector<Fill>& fills() const noexcept { return fills_; }
+
+        // Resulting book. best_* return 0 when the side is empty.
+        Volume_t level_quantity(bool is_bid, Price_t price) const noexcept;
+        Price_t best_bid() const noexcept;
+        Price_t best_ask() const noexcept;
+        void build_snapshot(
+            std::array<Volume_t, ORDER_BOOK_MESSAGE_DEPTH>& bid_volumes,
+            std::array<Price_t, ORDER_BOOK_MESSAGE_DEPTH>& bid_prices,
+            std::array<Volume_t, ORDER_BOOK_MESSAGE_DEPTH>& ask_volumes,
+            std::array<Price_t, ORDER_BOOK_MESSAGE_DEPTH>& ask_prices
+        ) const;
+
+        // Levels copied so far (the fork's cost).
+        size_t levels_copied() const noexcept { return bids_.levels.size() + asks_.levels.size(); }
+
+    private:
+        struct ForkOrder {
+            Id_t order_id;
+            Id_t client_id;
+            Volume_t quantity;
+            Volume_t remaining;
+        };
+
+        struct ForkLevel {
+            std::vector<ForkOrder> orders; // FIFO from head
+            size_t head = 0;
+            Volume_t total = 0;
+        };
+
+        struct ForkSide {
+            const OrderBookSide* base = nullptr; // nullptr for depth forks
+            bool is_bid;
+            std::map<size_t, ForkLevel> levels;  // copied levels by index
+        };
+
+        static size_t index_of_(Price_t price) noexcept { return static_cast<size_t>(price - MINIMUM_BID); }
+        static Price_t price_of_(size_t idx) noexcept { return MINIMUM_BID + static_cast<Price_t>(idx); }
+
+        static Volume_t quantity_(const ForkSide& side, size_t idx) noexcept;
+        static size_t best_index_(const ForkSide& side) noexcept; // NUM_BOOK_LEVELS when empty
+        ForkLevel& touch_(ForkSide& side, size_t idx);
+        // Finds a resting order; copies its level. nullptr if unknown.
+        ForkOrder* find_(Id_t order_id, ForkLevel*& level);
+
+        const OrderBook* base_ = nullptr;
+        ForkSide bids_;
+        ForkSide asks_;
+        Id_t next_order_id_ = 0;
+        // Orders resting in the fork that the base never had: id -> (is_bid, idx).
+        std::unordered_map<Id_t, std::pair<bool, size_t>> own_orders_;
+        std::vector<Fill> fills_;
+};
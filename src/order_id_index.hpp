@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+
+#include "types.hpp"
+
+// ------------------------------------------------------------
+// OrderIdIndex
+// ------------------------------------------------------------
+//
+// Order id -> encoded order handle for resting orders; replaces an
+// unordered_map that allocated a node per order and took milliseconds to
+// reserve and clear.
+//
+// Design:
+// - Open addressing with linear probing over a fixed power-of-two table,
+//   sized for both sides' pools at under 40% load. Order ids are sequential,
+//   so the identity hash lays recent orders out contiguously.
+// - Deletion shifts the following cluster back instead of leaving
+//   tombstones, so probe lengths do not grow over a long session.
+// - Each slot carries the generation it was written in; reset() bumps the
+//   generation, which empties the table in O(1). The table comes from
+//   calloc, so untouched pages cost nothing until first use.
+//
+class OrderIdIndex {
+    public:
+        static constexpr Id_t NONE = ~Id_t{0};
+        static constexpr size_t CAPACITY = size_t{1} << 19;
+        static_assert(CAPACITY >= 5 * MAX_ORDERS, "keep the load factor under 40% with both pools full");
+
+        OrderIdIndex()
+            : slots_(static_cast<Slot*>(std::calloc(CAPACITY, sizeof(Slot)))) {
+            if (!slots_) throw std::bad_alloc();
+        }
+
+        OrderIdIndex(const OrderIdIndex&) = delete;
+        OrderIdIndex& operator=(const OrderIdIndex&) = delete;
+
+        // Encoded handle of order_id, or NONE.
+        inline Id_t find(Id_t order_id) const noexcept {
+            for (size_t i = home_(order_id);; i = (i + 1) & MASK) {
+                const Slot& slot = slots_[i];
+                if (slot.generation != generation_) return NONE;
+                if (slot.order_id == order_id) return slot.handle;
+            }
+        }
+
+        // order_id must not be present. Cannot fill up: the pools run out first.
+        inline void insert(Id_t order_id, Id_t handle) noexcept {
+            size_t i = home_(order_id);
+            while (slots_[i].generation == generation_) i = (i + 1) & MASK;
+            slots_[i] = Slot{order_id, handle, generation_};
+            ++size_;
+        }
+
+        inline void erase(Id_t order_id) noexcept {
+            size_t hole = home_(order_id);
+            for (;; hole = (hole + 1) & MASK) {
+                const Slot& slot = slots_[hole];
+                if (slot.generation != generation_) return;
+                if (slot.order_id == order_id) break;
+            }
+            // Pull back later entries of the cluster whose home is not
+            // between the hole and their current slot.
+            for (size_t next = (hole + 1) & MASK;; next = (next + 1) & MASK) {
+                const Slot& slot = slots_[next];
+                if (slot.generation != generation_) break;
+                const size_t home = home_(slot.order_id);
+                const bool stays = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+                if (!stays) {
+                    slots_[hole] = slot;
+                    hole = next;
+                }
+            }
+            slots_[hole].generation = generation_ - 1;
+            --size_;
+        }
+
+        // Empties the index in O(1).
+        inline void reset() noexcept {
+            if (++generation_ == 0) {
+                // Wrapped: stale stamps could match again, so clear for real.
+                std::memset(slots_.get(), 0, CAPACITY * sizeof(Slot));
+                generation_ = 1;
+            }
+            size_ = 0;
+        }
+
+        inline size_t size() const noexcept { return size_; }
+
+        // Backing table, for warm-up.
+        void* data() noexcept { return slots_.get(); }
+        static constexpr size_t bytes() noexcept { return CAPACITY * sizeof(Slot); }
+
+    private:
+        static constexpr size_t MASK = CAPACITY - 1;
+
+        struct Slot {
+            Id_t order_id;
+            Id_t handle;
+            uint32_t generation; // 0 never matches: generation_ starts at 1
+        };
+
+        struct FreeDeleter {
+            void operator()(Slot* p) const noexcept { std::free(p); }
+        };
+
+        static inline size_t home_(Id_t order_id) noexcept { return static_cast<size_t>(order_id) & MASK; }
+
+        std::unique_ptr<Slot[], FreeDeleter> slots_;
+        uint32_t generation_ = 1;
+        size_t size_ = 0;
+};
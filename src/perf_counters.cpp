@@ -0,0 +1,273 @@
+#include "perf_counters.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+#include "binary_logger.hpp"
+#include "clock.hpp"
+#include "logging.hpp"
+#include "thread_affinity.hpp"
+
+#if defined(__linux__)
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+TG_INLINE_GLOBAL_LOGGER_WITH_CHANNEL(LG_PRF, "PRF")
+
+#if defined(__linux__)
+
+namespace {
+
+struct PerfEventSpec {
+    uint32_t type;
+    uint64_t config;
+};
+
+constexpr PerfEventSpec PERF_EVENT_SPECS[NUM_PERF_EVENTS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+                         | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                         | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL
+                         | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                         | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+int open_perf_event(const PerfEventSpec& spec, int group_fd) noexcept {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = spec.type;
+    attr.config = spec.config;
+    attr.disabled = group_fd < 0 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    // pid = 0, cpu = -1: the calling thread, on whichever CPU it runs.
+    return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+} // namespace
+
+PerfCounterGroup::PerfCounterGroup() {
+    fds_.fill(-1);
+    slot_.fill(-1);
+
+    leader_fd_ = open_perf_event(PERF_EVENT_SPECS[0], -1);
+    if (leader_fd_ < 0) {
+        RLOG(LG_PRF, LogLevel::LL_WARNING) << "[PerfCounterGroup] perf_event_open unavailable (check perf_event_paranoid).";
+        return;
+    }
+    fds_[0] = leader_fd_;
+    slot_[0] = static_cast<int>(num_opened_++);
+
+    for (size_t i = 1; i < NUM_PERF_EVENTS; ++i) {
+        const int fd = open_perf_event(PERF_EVENT_SPECS[i], leader_fd_);
+        if (fd < 0) {
+            RLOG(LG_PRF, LogLevel::LL_WARNING) << "[PerfCounterGroup] event " << PERF_EVENT_NAMES[i] << " unavailable.";
+            continue;
+        }
+        fds_[i] = fd;
+        slot_[i] = static_cast<int>(num_opened_++);
+    }
+
+    ::ioctl(leader_fd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ::ioctl(leader_fd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+PerfCounterGroup::~PerfCounterGroup() {
+    for (int fd : fds_) {
+        if (fd >= 0) ::close(fd);
+    }
+}
+
+bool PerfCounterGroup::read(PerfReading& out) const noexcept {
+    out.tsc = read_tsc();
+    if (leader_fd_ < 0) return false;
+
+    // PERF_FORMAT_GROUP layout: { u64 nr; u64 values[nr]; }
+    uint64_t buf[1 + NUM_PERF_EVENTS];
+    const ssize_t n = ::read(leader_fd_, buf, sizeof(uint64_t) * (1 + num_opened_));
+    if (n < static_cast<ssize_t>(sizeof(uint64_t) * (1 + num_opened_))) return false;
+
+    for (size_t i = 0; i < NUM_PERF_EVENTS; ++i) {
+        out.values[i] = slot_[i] >= 0 ? buf[1 + slot_[i]] : 0;
+    }
+    return true;
+}
+
+#else
+
+PerfCounterGroup::PerfCounterGroup() {
+    fds_.fill(-1);
+    slot_.fill(-1);
+}
+
+PerfCounterGroup::~PerfCounterGroup() = default;
+
+bool PerfCounterGroup::read(PerfReading& out) const noexcept {
+    out.tsc = read_tsc();
+    return false;
+}
+
+#endif
+
+#if TG_ENABLE_PERF_COUNTERS
+
+namespace {
+
+PerfCounterGroup& thread_counter_group() {
+    thread_local PerfCounterGroup group;
+    return group;
+}
+
+} // namespace
+
+CommandProfiler::CommandProfiler(const std::string& dir, Time_t dump_interval_ns)
+    : path_(dir + "/" + make_timestamp_string() + "_perf.txt")
+    , dump_interval_ns_(dump_interval_ns) {
+    writer_ = std::thread(&CommandProfiler::writer_loop_, this);
+}
+
+CommandProfiler::~CommandProfiler() {
+    {
+        std::lock_guard<std::mutex> lk(wake_mtx_);
+        running_.store(false, std::memory_order_release);
+    }
+    wake_cv_.notify_all();
+    if (writer_.joinable()) writer_.join();
+
+    // The engine has stopped: write the partial interval directly.
+    Snapshot& last = scratch_;
+    last.interval_end = last_command_;
+    last.interval_ns = last_command_ - last_dump_;
+    last.aggregates = aggregates_;
+    write_(last);
+}
+
+void CommandProfiler::begin(Message_t message_type) noexcept {
+    message_type_ = message_type;
+    levels_matched_ = 0;
+    last_trade_price_ = 0;
+    rejected_ = false;
+    rested_ = false;
+    cancelled_ = false;
+    amended_ = false;
+    start_ok_ = thread_counter_group().read(start_);
+}
+
+CommandOutcome CommandProfiler::classify_() const noexcept {
+    if (rejected_) return CommandOutcome::REJECTED;
+    if (levels_matched_ > 0) {
+        switch (levels_matched_) {
+            case 1: return CommandOutcome::MATCHED_1;
+            case 2: return CommandOutcome::MATCHED_2;
+            case 3: return CommandOutcome::MATCHED_3;
+            default: return CommandOutcome::MATCHED_4_PLUS;
+        }
+    }
+    if (rested_) return CommandOutcome::RESTED;
+    if (cancelled_) return CommandOutcome::CANCELLED;
+    if (amended_) return CommandOutcome::AMENDED;
+    return CommandOutcome::OTHER;
+}
+
+void CommandProfiler::end(Time_t now) noexcept {
+    PerfReading stop{};
+    const bool stop_ok = thread_counter_group().read(stop);
+
+    // A failed read leaves zeros behind; its delta would wrap around.
+    if (start_ok_ && stop_ok && message_type_ < NUM_PROFILED_MESSAGE_TYPES) {
+        Aggregate& agg = aggregates_[message_type_][static_cast<size_t>(classify_())];
+        ++agg.count;
+        for (size_t i = 0; i < NUM_PERF_EVENTS; ++i) {
+            agg.sums[i] += stop.values[i] - start_.values[i];
+        }
+        const uint64_t ticks = stop.tsc - start_.tsc;
+        agg.tsc_sum += ticks;
+        agg.tsc_max = std::max(agg.tsc_max, ticks);
+    }
+
+    last_command_ = now;
+    if (last_dump_ == 0) {
+        last_dump_ = now;
+    } else if (now - last_dump_ >= dump_interval_ns_) {
+        dump(now);
+    }
+}
+
+bool CommandProfiler::dump(Time_t now) noexcept {
+    scratch_.interval_end = now;
+    scratch_.interval_ns = now - last_dump_;
+    scratch_.aggregates = aggregates_;
+    if (!snapshots_.try_push(scratch_)) return false;
+
+    aggregates_ = Aggregates{};
+    last_dump_ = now;
+    return true;
+}
+
+void CommandProfiler::writer_loop_() {
+    enter_thread_role("perf");
+    Snapshot snapshot;
+    std::unique_lock<std::mutex> lk(wake_mtx_);
+    for (;;) {
+        wake_cv_.wait_for(lk, std::chrono::milliseconds{100},
+                          [this] { return !running_.load(std::memory_order_acquire); });
+        const bool running = running_.load(std::memory_order_acquire);
+        lk.unlock();
+        while (snapshots_.try_pop(snapshot)) write_(snapshot);
+        lk.lock();
+        if (!running) break;
+    }
+}
+
+void CommandProfiler::write_(const Snapshot& snapshot) {
+    bool any = false;
+    for (const auto& row : snapshot.aggregates) {
+        for (const Aggregate& agg : row) any |= agg.count != 0;
+    }
+    if (!any) return;
+
+    std::ofstream out(path_, std::ios::app);
+    if (!out) {
+        RLOG(LG_PRF, LogLevel::LL_ERROR) << "[CommandProfiler] Failed to open " << path_;
+        return;
+    }
+
+    out << "# interval_end_ns=" << snapshot.interval_end << " interval_ns=" << snapshot.interval_ns << '\n';
+    out << "type,outcome,count,avg_tsc,max_tsc";
+    for (const char* name : PERF_EVENT_NAMES) out << ",avg_" << name;
+    out << ",ipc\n";
+
+    out << std::fixed << std::setprecision(1);
+    for (size_t t = 0; t < NUM_PROFILED_MESSAGE_TYPES; ++t) {
+        for (size_t o = 0; o < NUM_COMMAND_OUTCOMES; ++o) {
+            const Aggregate& agg = snapshot.aggregates[t][o];
+            if (agg.count == 0) continue;
+
+            const double n = static_cast<double>(agg.count);
+            out << message_type_name(static_cast<MessageType>(t)) << ','
+                << COMMAND_OUTCOME_NAMES[o] << ','
+                << agg.count << ','
+                << static_cast<double>(agg.tsc_sum) / n << ','
+                << agg.tsc_max;
+            for (size_t i = 0; i < NUM_PERF_EVENTS; ++i) {
+                out << ',' << static_cast<double>(agg.sums[i]) / n;
+            }
+            const uint64_t cycles = agg.sums[static_cast<size_t>(PerfEvent::CYCLES)];
+            const uint64_t instructions = agg.sums[static_cast<size_t>(PerfEvent::INSTRUCTIONS)];
+            out << ',' << std::setprecision(3)
+                << (cycles ? static_cast<double>(instructions) / static_cast<double>(cycles) : 0.0)
+                << std::setprecision(1) << '\n';
+        }
+    }
+    out << '\n';
+}
+
+#endif
@@ -0,0 +1,214 @@
+#pragma once
+
+#ifndef TG_ENABLE_PERF_COUNTERS
+    #define TG_ENABLE_PERF_COUNTERS 0
+#endif
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "types.hpp"
+#include "protocol.hpp"
+#include "spsc_queue.hpp"
+
+enum class PerfEvent : uint8_t {
+    CYCLES,
+    INSTRUCTIONS,
+    L1D_MISSES,
+    LLC_MISSES,
+    BRANCH_MISSES
+};
+
+constexpr size_t NUM_PERF_EVENTS = 5;
+
+constexpr const char* PERF_EVENT_NAMES[] = {
+    "cycles",
+    "instructions",
+    "l1d_misses",
+    "llc_misses",
+    "branch_misses"
+};
+
+// Outcome of one engine command, as observed through the book callbacks.
+enum class CommandOutcome : uint8_t {
+    REJECTED,
+    RESTED,
+    MATCHED_1,
+    MATCHED_2,
+    MATCHED_3,
+    MATCHED_4_PLUS,
+    CANCELLED,
+    AMENDED,
+    OTHER
+};
+
+constexpr size_t NUM_COMMAND_OUTCOMES = 9;
+
+constexpr const char* COMMAND_OUTCOME_NAMES[] = {
+    "rejected",
+    "rested",
+    "matched_1",
+    "matched_2",
+    "matched_3",
+    "matched_4+",
+    "cancelled",
+    "amended",
+    "other"
+};
+
+// Message types are dense below this bound (see MessageType).
+constexpr size_t NUM_PROFILED_MESSAGE_TYPES = 32;
+
+struct PerfReading {
+    std::array<uint64_t, NUM_PERF_EVENTS> values{};
+    uint64_t tsc = 0;
+};
+
+// ------------------------------------------------------------
+// PerfCounterGroup
+// ------------------------------------------------------------
+//
+// One perf_event_open group (cycles as leader) counting user-space events of
+// the calling thread. Events the kernel or PMU refuses are skipped and read
+// back as zero; on non-Linux platforms the group is never available.
+//
+class PerfCounterGroup {
+    public:
+        PerfCounterGroup();
+        ~PerfCounterGroup();
+
+        PerfCounterGroup(const PerfCounterGroup&) = delete;
+        PerfCounterGroup& operator=(const PerfCounterGroup&) = delete;
+
+        bool available() const noexcept { return leader_fd_ >= 0; }
+        bool event_available(PerfEvent e) const noexcept { return slot_[static_cast<size_t>(e)] >= 0; }
+
+        // Fills out.values (and out.tsc); returns false if the group is unavailable.
+        bool read(PerfReading& out) const noexcept;
+
+    private:
+        int leader_fd_ = -1;
+        std::array<int, NUM_PERF_EVENTS> fds_{};
+        // Position of each event in the group read buffer, or -1 if not opened.
+        std::array<int, NUM_PERF_EVENTS> slot_{};
+        size_t num_opened_ = 0;
+};
+
+#if TG_ENABLE_PERF_COUNTERS
+
+// ------------------------------------------------------------
+// CommandProfiler
+// ------------------------------------------------------------
+//
+// Design:
+// - begin() / end() bracket one engine command on the engine thread and read
+//   the counter group of the current thread (groups are opened lazily per
+//   thread, since the engine strand may run on any io thread).
+// - Book callbacks report what happened via note_*; end() classifies the
+//   command and accumulates counter deltas per (MessageType, CommandOutcome).
+//   A command whose begin or end read failed is not counted.
+// - Every dump interval (engine time) end() copies the aggregates into a
+//   small SPSC queue and resets them, so each block covers one interval. A
+//   "perf" writer thread appends the blocks to <dir>/<timestamp>_perf.txt;
+//   the engine thread never opens files or allocates. If the writer falls
+//   behind, the interval is extended instead of dropped.
+// - The destructor stops the writer and writes what is left.
+//
+class CommandProfiler {
+    public:
+        explicit CommandProfiler(const std::string& dir, Time_t dump_interval_ns = 10'000'000'000ULL);
+        ~CommandProfiler();
+
+        CommandProfiler(const CommandProfiler&) = delete;
+        CommandProfiler& operator=(const CommandProfiler&) = delete;
+
+        void begin(Message_t message_type) noexcept;
+        void end(Time_t now) noexcept;
+
+        inline void note_rejected() noexcept { rejected_ = true; }
+        inline void note_rested() noexcept { rested_ = true; }
+        inline void note_cancelled() noexcept { cancelled_ = true; }
+        inline void note_amended() noexcept { amended_ = true; }
+        inline void note_trade(Price_t price) noexcept {
+            // The match loop walks levels monotonically, so a new price is a new level.
+            if (levels_matched_ == 0 || price != last_trade_price_) {
+                ++levels_matched_;
+                last_trade_price_ = price;
+            }
+        }
+
+        // Hands the current interval to the writer; false if its queue is full.
+        bool dump(Time_t now) noexcept;
+
+    private:
+        struct Aggregate {
+            uint64_t count = 0;
+            std::array<uint64_t, NUM_PERF_EVENTS> sums{};
+            uint64_t tsc_sum = 0;
+            uint64_t tsc_max = 0;
+        };
+
+        using Aggregates = std::array<std::array<Aggregate, NUM_COMMAND_OUTCOMES>, NUM_PROFILED_MESSAGE_TYPES>;
+
+        struct Snapshot {
+            Time_t interval_end = 0;
+            Time_t interval_ns = 0;
+            Aggregates aggregates{};
+        };
+
+        CommandOutcome classify_() const noexcept;
+        void writer_loop_();
+        void write_(const Snapshot& snapshot);
+
+        std::string path_;
+        Time_t dump_interval_ns_;
+        Time_t last_dump_ = 0;
+        Time_t last_command_ = 0;
+
+        Aggregates aggregates_{};
+
+        SPSCQueue<Snapshot, 4> snapshots_;
+        Snapshot scratch_;  // staging for dump(), kept off the engine stack
+        std::atomic<bool> running_{true};
+        std::mutex wake_mtx_;
+        std::condition_variable wake_cv_;
+        std::thread writer_;
+
+        // Current command.
+        PerfReading start_{};
+        bool start_ok_ = false;
+        Message_t message_type_ = 0;
+        size_t levels_matched_ = 0;
+        Price_t last_trade_price_ = 0;
+        bool rejected_ = false;
+        bool rested_ = false;
+        bool cancelled_ = false;
+        bool amended_ = false;
+};
+
+#else
+
+// Instrumentation compiled out: every hook is an empty inline.
+class CommandProfiler {
+    public:
+        explicit CommandProfiler(const std::string&, Time_t = 0) {}
+
+        inline void begin(Message_t) noexcept {}
+        inline void end(Time_t) noexcept {}
+
+        inline void note_rejected() noexcept {}
+        inline void note_rested() noexcept {}
+        inline void note_cancelled() noexcept {}
+        inline void note_amended() noexcept {}
+        inline void note_trade(Price_t) noexcept {}
+
+        inline bool dump(Time_t) noexcept { return true; }
+};
+
+#endif
@@ -6,6 +6,7 @@ struct PriceLevel {
     Order* first_;
     Order* last_;
     Volume_t total_quantity_;
+    uint32_t generation_; // live only when equal to the side's generation
     Price_t price_;
     size_t idx_;
 };
\ No newline at end of file
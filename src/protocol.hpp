@@ -13,6 +13,7 @@ enum class MessageType : Message_t {
     SUBSCRIBE = 6,
     UNSUBSCRIBE = 7,
     ORDER_STATUS_REQUEST = 8,
+    DEPTH_QUERY = 9,
 
     CONFIRM_CONNECTED = 11,
     CONFIRM_ORDER_INSERTED = 12,
@@ -21,6 +22,7 @@ enum class MessageType : Message_t {
     PARTIAL_FILL_ORDER = 15,
     ORDER_STATUS = 16,
     ERROR_MSG = 17,
+    DEPTH_REPORT = 18,
 
     ORDER_BOOK_SNAPSHOT = 21,
     TRADE_EVENT = 23,
@@ -30,6 +32,46 @@ enum class MessageType : Message_t {
     PRICE_LEVEL_UPDATE = 27
 };
 
+inline const char* message_type_name(MessageType t) {
+    switch (t) {
+        case MessageType::CONNECT: return "connect";
+        case MessageType::DISCONNECT: return "disconnect";
+        case MessageType::INSERT_ORDER: return "insert_order";
+        case MessageType::CANCEL_ORDER: return "cancel_order";
+        case MessageType::AMEND_ORDER: return "amend_order";
+        case MessageType::SUBSCRIBE: return "subscribe";
+        case MessageType::UNSUBSCRIBE: return "unsubscribe";
+        case MessageType::ORDER_STATUS_REQUEST: return "order_status_request";
+        case MessageType::DEPTH_QUERY: return "depth_query";
+
+        case MessageType::CONFIRM_CONNECTED: return "confirm_connected";
+        case MessageType::CONFIRM_ORDER_INSERTED: return "confirm_order_inserted";
+        case MessageType::CONFIRM_ORDER_CANCELLED: return "confirm_order_cancelled";
+        case MessageType::CONFIRM_ORDER_AMENDED: return "confirm_order_amended";
+        case MessageType::PARTIAL_FILL_ORDER: return "partial_fill_order";
+        case MessageType::ORDER_STATUS: return "order_status";
+        case MessageType::ERROR_MSG: return "error";
+        case MessageType::DEPTH_REPORT: return "depth_report";
+
+        case MessageType::ORDER_BOOK_SNAPSHOT: return "order_book_snapshot";
+        case MessageType::TRADE_EVENT: return "trade_event";
+        case MessageType::ORDER_INSERTED_EVENT: return "order_inserted_event";
+        case MessageType::ORDER_CANCELLED_EVENT: return "order_cancelled_event";
+        case MessageType::ORDER_AMENDED_EVENT: return "order_amended_event";
+        case MessageType::PRICE_LEVEL_UPDATE: return "price_level_update";
+
+        default: return "unknown";
+    }
+}
+
+// Wire protocol versions, agreed per session: the client names the highest
+// version it speaks in CONNECT, the exchange answers with the one it will use
+// in CONFIRM_CONNECTED. Sessions that never send CONNECT stay on v1.
+// - v1: one frame per message, [type u8][payload size u16 LE][payload].
+// - v2 (exchange -> client only, see protocol_v2.hpp): compact packets.
+constexpr uint8_t PROTOCOL_V1 = 1;
+constexpr uint8_t PROTOCOL_V2 = 2;
+
 #pragma pack(push, 1)
 
 struct MessageHeader {
@@ -37,6 +79,17 @@ struct MessageHeader {
     uint16_t size;
 };
 
+struct PayloadConnect {
+    Id_t client_request_id;
+    uint8_t protocol_version;
+};
+
+struct PayloadConfirmConnected {
+    Id_t client_request_id;
+    uint8_t protocol_version;
+    Price_t price_base;
+};
+
 struct PayloadDisconnect {
     Id_t client_request_id;
 };
@@ -73,6 +126,14 @@ struct PayloadOrderStatusRequest {
     Id_t exchange_order_id;
 };
 
+// Depth of one resting side: side BUY asks about the bids, SELL the asks.
+struct PayloadDepthQuery {
+    Id_t client_request_id;
+    Side side;
+    uint32_t ticks;    // window from the best price for depth_volume
+    Volume_t quantity; // size to price a sweep for
+};
+
 struct PayloadError {
     Id_t client_request_id;
     uint16_t code;
@@ -130,6 +191,18 @@ struct PayloadOrderStatus {
     Time_t timestamp;
 };
 
+struct PayloadDepthReport {
+    Id_t client_request_id;
+    Side side;
+    Price_t best_price;       // 0 when the side is empty
+    uint64_t depth_volume;    // resting within ticks of best_price
+    uint64_t total_volume;    // resting on the whole side
+    Volume_t sweep_filled;    // below quantity when the side runs out
+    Price_t sweep_price;      // worst price reached; 0 if nothing fills
+    uint64_t sweep_notional;  // sum of price x quantity, for the VWAP
+    Time_t timestamp;
+};
+
 struct PayloadOrderBookSnapshot {
     std::array<Price_t, ORDER_BOOK_MESSAGE_DEPTH> ask_prices;
     std::array<Volume_t, ORDER_BOOK_MESSAGE_DEPTH> ask_volumes;
@@ -184,6 +257,8 @@ struct PayloadPriceLevelUpdate {
 
 constexpr size_t MAX_PAYLOAD_SIZE = []() {
     size_t sizes[] = {
+        sizeof(PayloadConnect),
+        sizeof(PayloadConfirmConnected),
         sizeof(PayloadDisconnect),
         sizeof(PayloadInsertOrder),
         sizeof(PayloadCancelOrder),
@@ -191,6 +266,8 @@ constexpr size_t MAX_PAYLOAD_SIZE = []() {
         sizeof(PayloadSubscribe),
         sizeof(PayloadUnsubscribe),
         sizeof(PayloadOrderStatusRequest),
+        sizeof(PayloadDepthQuery),
+        sizeof(PayloadDepthReport),
         sizeof(PayloadError),
         sizeof(PayloadConfirmOrderInserted),
         sizeof(PayloadConfirmOrderCancelled),
@@ -209,15 +286,19 @@ constexpr size_t MAX_PAYLOAD_SIZE = []() {
     return m;
 }();
 
-// Excludes PayloadOrderBookSnapshot because it's a large struct which won't enter the SPSC (or MPSC) queue
+// Excludes PayloadOrderBookSnapshot and PayloadDepthReport: they go through the
+// large-frame pool and never enter the SPSC (or MPSC) queue.
 constexpr size_t MAX_PAYLOAD_SIZE_BUFFER = []() {
     size_t sizes[] = {
+        sizeof(PayloadConnect),
+        sizeof(PayloadConfirmConnected),
         sizeof(PayloadDisconnect),
         sizeof(PayloadInsertOrder),
         sizeof(PayloadCancelOrder),
         sizeof(PayloadAmendOrder),
         sizeof(PayloadSubscribe),
         sizeof(PayloadUnsubscribe),
+        sizeof(PayloadDepthQuery),
         sizeof(PayloadError),
         sizeof(PayloadConfirmOrderInserted),
         sizeof(PayloadConfirmOrderCancelled),
@@ -234,8 +315,12 @@ constexpr size_t MAX_PAYLOAD_SIZE_BUFFER = []() {
     return m;
 }();
 
+// Every queue slot carries this many bytes; new large payloads use the pool.
+static_assert(MAX_PAYLOAD_SIZE_BUFFER == 46, "MAX_PAYLOAD_SIZE_BUFFER grew; send the new payload via the large-frame path.");
+
 inline size_t payload_size_for_type(MessageType t) {
     switch (t) {
+        case MessageType::CONNECT: return sizeof(PayloadConnect);
         case MessageType::DISCONNECT: return sizeof(PayloadDisconnect);
         case MessageType::INSERT_ORDER: return sizeof(PayloadInsertOrder);
         case MessageType::CANCEL_ORDER: return sizeof(PayloadCancelOrder);
@@ -243,13 +328,16 @@ inline size_t payload_size_for_type(MessageType t) {
         case MessageType::SUBSCRIBE: return sizeof(PayloadSubscribe);
         case MessageType::UNSUBSCRIBE: return sizeof(PayloadUnsubscribe);
         case MessageType::ORDER_STATUS_REQUEST: return sizeof(PayloadOrderStatusRequest);
+        case MessageType::DEPTH_QUERY: return sizeof(PayloadDepthQuery);
         case MessageType::ERROR_MSG: return sizeof(PayloadError);
 
+        case MessageType::CONFIRM_CONNECTED: return sizeof(PayloadConfirmConnected);
         case MessageType::CONFIRM_ORDER_INSERTED: return sizeof(PayloadConfirmOrderInserted);
         case MessageType::CONFIRM_ORDER_CANCELLED: return sizeof(PayloadConfirmOrderCancelled);
         case MessageType::CONFIRM_ORDER_AMENDED: return sizeof(PayloadConfirmOrderAmended);
         case MessageType::PARTIAL_FILL_ORDER: return sizeof(PayloadPartialFill);
         case MessageType::ORDER_STATUS: return sizeof(PayloadOrderStatus);
+        case MessageType::DEPTH_REPORT: return sizeof(PayloadDepthReport);
 
         case MessageType::ORDER_BOOK_SNAPSHOT: return sizeof(PayloadOrderBookSnapshot);
         case MessageType::TRADE_EVENT: return sizeof(PayloadTradeEvent);
@@ -315,6 +403,10 @@ inline bool parse_message_full(const uint8_t* buf, size_t len, MessageType& out_
             out_struct = reinterpret_cast<const PayloadOrderStatusRequest*>(payload_ptr);
             return true;
 
+        case MessageType::DEPTH_QUERY:
+            out_struct = reinterpret_cast<const PayloadDepthQuery*>(payload_ptr);
+            return true;
+
         case MessageType::ERROR_MSG:
             out_struct = reinterpret_cast<const PayloadError*>(payload_ptr);
             return true;
@@ -339,6 +431,10 @@ inline bool parse_message_full(const uint8_t* buf, size_t len, MessageType& out_
             out_struct = reinterpret_cast<const PayloadOrderStatus*>(payload_ptr);
             return true;
 
+        case MessageType::DEPTH_REPORT:
+            out_struct = reinterpret_cast<const PayloadDepthReport*>(payload_ptr);
+            return true;
+
         case MessageType::ORDER_BOOK_SNAPSHOT:
             out_struct = reinterpret_cast<const PayloadOrderBookSnapshot*>(payload_ptr);
             return true;
@@ -364,6 +460,21 @@ inline bool parse_message_full(const uint8_t* buf, size_t len, MessageType& out_
     }
 }
 
+inline PayloadConnect make_connect(Id_t client_request_id, uint8_t protocol_version) {
+    PayloadConnect p{};
+    p.client_request_id = client_request_id;
+    p.protocol_version = protocol_version;
+    return p;
+}
+
+inline PayloadConfirmConnected make_confirm_connected(Id_t client_request_id, uint8_t protocol_version, Price_t price_base) {
+    PayloadConfirmConnected p{};
+    p.client_request_id = client_request_id;
+    p.protocol_version = protocol_version;
+    p.price_base = price_base;
+    return p;
+}
+
 inline PayloadDisconnect make_disconnect(Id_t client_request_id) {
     PayloadDisconnect p{};
     p.client_request_id = client_request_id;
@@ -430,6 +541,20 @@ inline PayloadOrderStatusRequest make_order_status_request(
     return p;
 }
 
+inline PayloadDepthQuery make_depth_query(
+    Id_t client_request_id,
+    Side side,
+    uint32_t ticks,
+    Volume_t quantity
+) {
+    PayloadDepthQuery p{};
+    p.client_request_id = client_request_id;
+    p.side = side;
+    p.ticks = ticks;
+    p.quantity = quantity;
+    return p;
+}
+
 inline PayloadError make_error(
     Id_t client_request_id,
     uint16_t code,
@@ -548,6 +673,30 @@ inline PayloadOrderStatus make_order_status(
     return p;
 }
 
+inline PayloadDepthReport make_depth_report(
+    Id_t client_request_id,
+    Side side,
+    Price_t best_price,
+    uint64_t depth_volume,
+    uint64_t total_volume,
+    Volume_t sweep_filled,
+    Price_t sweep_price,
+    uint64_t sweep_notional,
+    Time_t timestamp
+) {
+    PayloadDepthReport p{};
+    p.client_request_id = client_request_id;
+    p.side = side;
+    p.best_price = best_price;
+    p.depth_volume = depth_volume;
+    p.total_volume = total_volume;
+    p.sweep_filled = sweep_filled;
+    p.sweep_price = sweep_price;
+    p.sweep_notional = sweep_notional;
+    p.timestamp = timestamp;
+    return p;
+}
+
 inline PayloadOrderBookSnapshot make_order_book_snapshot(
     const std::array<Price_t, ORDER_BOOK_MESSAGE_DEPTH>& ask_prices,
     const std::array<Volume_t, ORDER_BOOK_MESSAGE_DEPTH>& ask_volumes,
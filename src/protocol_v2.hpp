@@ -0,0 +1,460 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "protocol.hpp"
+#include "types.hpp"
+
+// ------------------------------------------------------------
+// Protocol v2 (exchange -> client)
+// ------------------------------------------------------------
+//
+// Design:
+// - Messages are packed into packets: [V2PacketHeader][entry]..., each entry
+//   being [type u8][body size u8][body]. One header per packet instead of
+//   three bytes per message.
+// - Sequenced market data carries a u16 delta from the packet's
+//   base_sequence, and every timestamp a u32 nanosecond delta from
+//   base_timestamp. A message whose deltas do not fit starts a new packet.
+// - Prices are int32 tick offsets from the price_base announced in
+//   CONFIRM_CONNECTED; the exchange announces V2_PRICE_BASE, the bottom of
+//   its price band.
+// - Types without a compact form (errors, order status, snapshots) carry
+//   their v1 payload verbatim.
+// - Little-endian, like v1. Readers hand messages back in v1 layout, so
+//   everything above the transport is version-agnostic.
+//
+constexpr uint8_t V2_PACKET_MARKER = 0xB2;
+constexpr Price_t V2_PRICE_BASE = MINIMUM_BID;
+
+#pragma pack(push, 1)
+
+struct V2PacketHeader {
+    uint8_t marker;
+    uint16_t body_size;
+    uint8_t count;
+    uint64_t base_sequence;
+    uint64_t base_timestamp;
+};
+
+struct V2PriceLevelUpdate {
+    uint16_t seq_delta;
+    Side side;
+    int32_t price;
+    Volume_t total_volume;
+    uint32_t time_delta;
+};
+
+struct V2TradeEvent {
+    uint16_t seq_delta;
+    Id_t trade_id;
+    int32_t price;
+    Volume_t quantity;
+    Side taker_side;
+    uint32_t time_delta;
+};
+
+struct V2OrderInsertedEvent {
+    uint16_t seq_delta;
+    Id_t order_id;
+    Side side;
+    int32_t price;
+    Volume_t quantity;
+    uint32_t time_delta;
+};
+
+struct V2OrderCancelledEvent {
+    uint16_t seq_delta;
+    Id_t order_id;
+    Volume_t remaining_quantity;
+    uint32_t time_delta;
+};
+
+struct V2OrderAmendedEvent {
+    uint16_t seq_delta;
+    Id_t order_id;
+    Volume_t quantity_new;
+    Volume_t quantity_old;
+    uint32_t time_delta;
+};
+
+struct V2PartialFill {
+    Id_t exchange_order_id;
+    Id_t trade_id;
+    int32_t last_price;
+    Volume_t last_quantity;
+    Volume_t leaves_quantity;
+    Volume_t cumulative_quantity;
+    uint32_t time_delta;
+};
+
+struct V2ConfirmOrderInserted {
+    Id_t client_request_id;
+    Id_t exchange_order_id;
+    Side side;
+    int32_t price;
+    Volume_t total_quantity;
+    Volume_t leaves_quantity;
+    uint32_t time_delta;
+};
+
+struct V2ConfirmOrderCancelled {
+    Id_t client_request_id;
+    Id_t exchange_order_id;
+    Volume_t leaves_quantity;
+    int32_t price;
+    Side side;
+    uint32_t time_delta;
+};
+
+struct V2ConfirmOrderAmended {
+    Id_t client_request_id;
+    Id_t exchange_order_id;
+    Volume_t old_total_quantity;
+    Volume_t new_total_quantity;
+    Volume_t leaves_quantity;
+    uint32_t time_delta;
+};
+
+#pragma pack(pop)
+
+static_assert(MAX_PAYLOAD_SIZE <= 0xFF, "v2 entries carry a one-byte body size.");
+static_assert(MAXIMUM_ASK - V2_PRICE_BASE <= std::numeric_limits<int32_t>::max(), "Tick offsets must fit in int32.");
+
+namespace v2_detail {
+
+struct Stamp {
+    bool has_seq = false;
+    uint64_t seq = 0;
+    bool has_time = false;
+    uint64_t time = 0;
+};
+
+// Sequence / timestamp of a v1 payload, used to pick packet bases.
+inline Stamp stamp_of(MessageType type, const uint8_t* payload) noexcept {
+    Stamp s;
+    auto with_seq = [&s](uint64_t seq, uint64_t time) { s.has_seq = true; s.seq = seq; s.has_time = true; s.time = time; };
+    auto with_time = [&s](uint64_t time) { s.has_time = true; s.time = time; };
+    switch (type) {
+        case MessageType::PRICE_LEVEL_UPDATE: {
+            const auto* p = reinterpret_cast<const PayloadPriceLevelUpdate*>(payload);
+            with_seq(p->sequence_number, p->timestamp);
+            break;
+        }
+        case MessageType::TRADE_EVENT: {
+            const auto* p = reinterpret_cast<const PayloadTradeEvent*>(payload);
+            with_seq(p->sequence_number, p->timestamp);
+            break;
+        }
+        case MessageType::ORDER_INSERTED_EVENT: {
+            const auto* p = reinterpret_cast<const PayloadOrderInsertedEvent*>(payload);
+            with_seq(p->sequence_number, p->timestamp);
+            break;
+        }
+        case MessageType::ORDER_CANCELLED_EVENT: {
+            const auto* p = reinterpret_cast<const PayloadOrderCancelledEvent*>(payload);
+            with_seq(p->sequence_number, p->timestamp);
+            break;
+        }
+        case MessageType::ORDER_AMENDED_EVENT: {
+            const auto* p = reinterpret_cast<const PayloadOrderAmendedEvent*>(payload);
+            with_seq(p->sequence_number, p->timestamp);
+            break;
+        }
+        case MessageType::PARTIAL_FILL_ORDER:
+            with_time(reinterpret_cast<const PayloadPartialFill*>(payload)->timestamp);
+            break;
+        case MessageType::CONFIRM_ORDER_INSERTED:
+            with_time(reinterpret_cast<const PayloadConfirmOrderInserted*>(payload)->timestamp);
+            break;
+        case MessageType::CONFIRM_ORDER_CANCELLED:
+            with_time(reinterpret_cast<const PayloadConfirmOrderCancelled*>(payload)->timestamp);
+            break;
+        case MessageType::CONFIRM_ORDER_AMENDED:
+            with_time(reinterpret_cast<const PayloadConfirmOrderAmended*>(payload)->timestamp);
+            break;
+        default:
+            break;
+    }
+    return s;
+}
+
+} // namespace v2_detail
+
+// Packs v1 messages into v2 packets in a caller-owned buffer.
+class V2PacketWriter {
+    public:
+        V2PacketWriter(uint8_t* buf, size_t capacity, Price_t price_base) noexcept
+            : buf_(buf)
+            , capacity_(capacity)
+            , price_base_(price_base) {}
+
+        // Returns false (nothing written) if the message does not fit in the
+        // remaining buffer; finish() and send what is there first.
+        bool append(Message_t type_u8, const uint8_t* payload, uint16_t payload_size) noexcept {
+            const MessageType type = static_cast<MessageType>(type_u8);
+            const v2_detail::Stamp stamp = v2_detail::stamp_of(type, payload);
+            const size_t body_size = body_size_for_(type, payload_size);
+            const size_t entry_size = 2 + body_size;
+
+            const bool fits_packet = open_
+                && count_ < 0xFF
+                && body_bytes_ + entry_size <= 0xFFFF
+                && (!stamp.has_seq || !seq_base_set_ || (stamp.seq >= base_seq_ && stamp.seq - base_seq_ <= 0xFFFF))
+                && (!stamp.has_time || !time_base_set_ || (stamp.time >= base_time_ && stamp.time - base_time_ <= 0xFFFFFFFFu));
+
+            const size_t needed = entry_size + (fits_packet ? 0 : sizeof(V2PacketHeader));
+            if (len_ + needed > capacity_) {
+                return false;
+            }
+            if (!fits_packet) {
+                close_packet_();
+                open_packet_();
+            }
+            if (stamp.has_seq && !seq_base_set_) { base_seq_ = stamp.seq; seq_base_set_ = true; }
+            if (stamp.has_time && !time_base_set_) { base_time_ = stamp.time; time_base_set_ = true; }
+
+            uint8_t* entry = buf_ + len_;
+            entry[0] = type_u8;
+            entry[1] = static_cast<uint8_t>(body_size);
+            encode_body_(type, payload, payload_size, entry + 2);
+            len_ += entry_size;
+            body_bytes_ += entry_size;
+            ++count_;
+            return true;
+        }
+
+        // Total bytes written, with the open packet closed.
+        size_t finish() noexcept {
+            close_packet_();
+            return len_;
+        }
+
+    private:
+        static size_t body_size_for_(MessageType type, uint16_t payload_size) noexcept {
+            switch (type) {
+                case MessageType::PRICE_LEVEL_UPDATE: return sizeof(V2PriceLevelUpdate);
+                case MessageType::TRADE_EVENT: return sizeof(V2TradeEvent);
+                case MessageType::ORDER_INSERTED_EVENT: return sizeof(V2OrderInsertedEvent);
+                case MessageType::ORDER_CANCELLED_EVENT: return sizeof(V2OrderCancelledEvent);
+                case MessageType::ORDER_AMENDED_EVENT: return sizeof(V2OrderAmendedEvent);
+                case MessageType::PARTIAL_FILL_ORDER: return sizeof(V2PartialFill);
+                case MessageType::CONFIRM_ORDER_INSERTED: return sizeof(V2ConfirmOrderInserted);
+                case MessageType::CONFIRM_ORDER_CANCELLED: return sizeof(V2ConfirmOrderCancelled);
+                case MessageType::CONFIRM_ORDER_AMENDED: return sizeof(V2ConfirmOrderAmended);
+                default: return payload_size;
+            }
+        }
+
+        int32_t tick_(Price_t price) const noexcept { return static_cast<int32_t>(price - price_base_); }
+        uint16_t seq_delta_(uint64_t seq) const noexcept { return static_cast<uint16_t>(seq - base_seq_); }
+        uint32_t time_delta_(uint64_t time) const noexcept { return static_cast<uint32_t>(time - base_time_); }
+
+        void encode_body_(MessageType type, const uint8_t* payload, uint16_t payload_size, uint8_t* dst) const noexcept {
+            switch (type) {
+                case MessageType::PRICE_LEVEL_UPDATE: {
+                    const auto* p = reinterpret_cast<const PayloadPriceLevelUpdate*>(payload);
+                    const V2PriceLevelUpdate c{seq_delta_(p->sequence_number), p->side, tick_(p->price), p->total_volume, time_delta_(p->timestamp)};
+                    std::memcpy(dst, &c, sizeof(c));
+                    return;
+                }
+                case MessageType::TRADE_EVENT: {
+                    const auto* p = reinterpret_cast<const PayloadTradeEvent*>(payload);
+                    const V2TradeEvent c{seq_delta_(p->sequence_number), p->trade_id, tick_(p->price), p->quantity, p->taker_side, time_delta_(p->timestamp)};
+                    std::memcpy(dst, &c, sizeof(c));
+                    return;
+                }
+                case MessageType::ORDER_INSERTED_EVENT: {
+                    const auto* p = reinterpret_cast<const PayloadOrderInsertedEvent*>(payload);
+                    const V2OrderInsertedEvent c{seq_delta_(p->sequence_number), p->order_id, p->side, tick_(p->price), p->quantity, time_delta_(p->timestamp)};
+                    std::memcpy(dst, &c, sizeof(c));
+                    return;
+                }
+                case MessageType::ORDER_CANCELLED_EVENT: {
+                    const auto* p = reinterpret_cast<const PayloadOrderCancelledEvent*>(payload);
+                    const V2OrderCancelledEvent c{seq_delta_(p->sequence_number), p->order_id, p->remaining_quantity, time_delta_(p->timestamp)};
+                    std::memcpy(dst, &c, sizeof(c));
+                    return;
+                }
+                case MessageType::ORDER_AMENDED_EVENT: {
+                    const auto* p = reinterpret_cast<const PayloadOrderAmendedEvent*>(payload);
+                    const V2OrderAmendedEvent c{seq_delta_(p->sequence_number), p->order_id, p->quantity_new, p->quantity_old, time_delta_(p->timestamp)};
+                    std::memcpy(dst, &c, sizeof(c));
+                    return;
+                }
+                case MessageType::PARTIAL_FILL_ORDER: {
+                    const auto* p = reinterpret_cast<const PayloadPartialFill*>(payload);
+                    const V2PartialFill c{p->exchange_order_id, p->trade_id, tick_(p->last_price), p->last_quantity,
+                                          p->leaves_quantity, p->cumulative_quantity, time_delta_(p->timestamp)};
+                    std::memcpy(dst, &c, sizeof(c));
+                    return;
+                }
+                case MessageType::CONFIRM_ORDER_INSERTED: {
+                    const auto* p = reinterpret_cast<const PayloadConfirmOrderInserted*>(payload);
+                    const V2ConfirmOrderInserted c{p->client_request_id, p->exchange_order_id, p->side, tick_(p->price),
+                                                   p->total_quantity, p->leaves_quantity, time_delta_(p->timestamp)};
+                    std::memcpy(dst, &c, sizeof(c));
+                    return;
+                }
+                case MessageType::CONFIRM_ORDER_CANCELLED: {
+                    const auto* p = reinterpret_cast<const PayloadConfirmOrderCancelled*>(payload);
+                    const V2ConfirmOrderCancelled c{p->client_request_id, p->exchange_order_id, p->leaves_quantity,
+                                                    tick_(p->price), p->side, time_delta_(p->timestamp)};
+                    std::memcpy(dst, &c, sizeof(c));
+                    return;
+                }
+                case MessageType::CONFIRM_ORDER_AMENDED: {
+                    const auto* p = reinterpret_cast<const PayloadConfirmOrderAmended*>(payload);
+                    const V2ConfirmOrderAmended c{p->client_request_id, p->exchange_order_id, p->old_total_quantity,
+                                                  p->new_total_quantity, p->leaves_quantity, time_delta_(p->timestamp)};
+                    std::memcpy(dst, &c, sizeof(c));
+                    return;
+                }
+                default:
+                    if (payload_size) std::memcpy(dst, payload, payload_size);
+                    return;
+            }
+        }
+
+        void open_packet_() noexcept {
+            open_ = true;
+            header_off_ = len_;
+            len_ += sizeof(V2PacketHeader);
+            body_bytes_ = 0;
+            count_ = 0;
+            seq_base_set_ = false;
+            time_base_set_ = false;
+            base_seq_ = 0;
+            base_time_ = 0;
+        }
+
+        void close_packet_() noexcept {
+            if (!open_) return;
+            const V2PacketHeader h{V2_PACKET_MARKER, static_cast<uint16_t>(body_bytes_),
+                                   static_cast<uint8_t>(count_), base_seq_, base_time_};
+            std::memcpy(buf_ + header_off_, &h, sizeof(h));
+            open_ = false;
+        }
+
+        uint8_t* buf_;
+        size_t capacity_;
+        Price_t price_base_;
+        size_t len_ = 0;
+
+        bool open_ = false;
+        size_t header_off_ = 0;
+        size_t body_bytes_ = 0;
+        size_t count_ = 0;
+        bool seq_base_set_ = false;
+        bool time_base_set_ = false;
+        uint64_t base_seq_ = 0;
+        uint64_t base_time_ = 0;
+};
+
+// Decodes one v2 packet from buf. Calls on_message(type, v1_payload, size)
+// for every entry, in v1 layout. Returns the bytes consumed, 0 if the packet
+// is incomplete, or SIZE_MAX if it is malformed.
+template <typename OnMessage>
+size_t v2_read_packet(const uint8_t* buf, size_t len, Price_t price_base, OnMessage&& on_message) {
+    if (len < sizeof(V2PacketHeader)) return 0;
+    V2PacketHeader h;
+    std::memcpy(&h, buf, sizeof(h));
+    if (h.marker != V2_PACKET_MARKER) return std::numeric_limits<size_t>::max();
+    const size_t total = sizeof(V2PacketHeader) + h.body_size;
+    if (len < total) return 0;
+
+    const uint8_t* p = buf + sizeof(V2PacketHeader);
+    const uint8_t* end = buf + total;
+    // Large enough for any v1 payload (body size is one byte).
+    alignas(8) uint8_t v1[256];
+
+    for (size_t i = 0; i < h.count; ++i) {
+        if (end - p < 2) return std::numeric_limits<size_t>::max();
+        const Message_t type_u8 = p[0];
+        const size_t body_size = p[1];
+        const uint8_t* body = p + 2;
+        if (static_cast<size_t>(end - body) < body_size) return std::numeric_limits<size_t>::max();
+        p = body + body_size;
+
+        const Price_t pb = price_base;
+        const uint64_t bs = h.base_sequence;
+        const uint64_t bt = h.base_timestamp;
+        const MessageType type = static_cast<MessageType>(type_u8);
+
+        auto emit = [&](const auto& v1_payload) {
+            std::memcpy(v1, &v1_payload, sizeof(v1_payload));
+            on_message(type_u8, v1, static_cast<uint16_t>(sizeof(v1_payload)));
+        };
+        auto compact = [&](auto tag) -> const decltype(tag)* {
+            return body_size == sizeof(decltype(tag)) ? reinterpret_cast<const decltype(tag)*>(body) : nullptr;
+        };
+
+        switch (type) {
+            case MessageType::PRICE_LEVEL_UPDATE: {
+                const auto* c = compact(V2PriceLevelUpdate{});
+                if (!c) return std::numeric_limits<size_t>::max();
+                emit(make_price_level_update(static_cast<Id_t>(bs + c->seq_delta), c->side, pb + c->price, c->total_volume, bt + c->time_delta));
+                break;
+            }
+            case MessageType::TRADE_EVENT: {
+                const auto* c = compact(V2TradeEvent{});
+                if (!c) return std::numeric_limits<size_t>::max();
+                emit(make_trade_event(static_cast<Id_t>(bs + c->seq_delta), c->trade_id, pb + c->price, c->quantity, c->taker_side, bt + c->time_delta));
+                break;
+            }
+            case MessageType::ORDER_INSERTED_EVENT: {
+                const auto* c = compact(V2OrderInsertedEvent{});
+                if (!c) return std::numeric_limits<size_t>::max();
+                emit(make_order_inserted_event(static_cast<Id_t>(bs + c->seq_delta), c->order_id, c->side, pb + c->price, c->quantity, bt + c->time_delta));
+                break;
+            }
+            case MessageType::ORDER_CANCELLED_EVENT: {
+                const auto* c = compact(V2OrderCancelledEvent{});
+                if (!c) return std::numeric_limits<size_t>::max();
+                emit(make_order_cancelled_event(static_cast<Id_t>(bs + c->seq_delta), c->order_id, c->remaining_quantity, bt + c->time_delta));
+                break;
+            }
+            case MessageType::ORDER_AMENDED_EVENT: {
+                const auto* c = compact(V2OrderAmendedEvent{});
+                if (!c) return std::numeric_limits<size_t>::max();
+                emit(make_order_amended_event(static_cast<Id_t>(bs + c->seq_delta), c->order_id, c->quantity_new, c->quantity_old, bt + c->time_delta));
+                break;
+            }
+            case MessageType::PARTIAL_FILL_ORDER: {
+                const auto* c = compact(V2PartialFill{});
+                if (!c) return std::numeric_limits<size_t>::max();
+                emit(make_partial_fill(c->exchange_order_id, c->trade_id, pb + c->last_price, c->last_quantity,
+                                       c->leaves_quantity, c->cumulative_quantity, bt + c->time_delta));
+                break;
+            }
+            case MessageType::CONFIRM_ORDER_INSERTED: {
+                const auto* c = compact(V2ConfirmOrderInserted{});
+                if (!c) return std::numeric_limits<size_t>::max();
+                emit(make_confirm_order_inserted(c->client_request_id, c->exchange_order_id, c->side, pb + c->price,
+                                                 c->total_quantity, c->leaves_quantity, bt + c->time_delta));
+                break;
+            }
+            case MessageType::CONFIRM_ORDER_CANCELLED: {
+                const auto* c = compact(V2ConfirmOrderCancelled{});
+                if (!c) return std::numeric_limits<size_t>::max();
+                emit(make_confirm_order_cancelled(c->client_request_id, c->exchange_order_id, c->leaves_quantity,
+                                                  pb + c->price, c->side, bt + c->time_delta));
+                break;
+            }
+            case MessageType::CONFIRM_ORDER_AMENDED: {
+                const auto* c = compact(V2ConfirmOrderAmended{});
+                if (!c) return std::numeric_limits<size_t>::max();
+                emit(make_confirm_order_amended(c->client_request_id, c->exchange_order_id, c->old_total_quantity,
+                                                c->new_total_quantity, c->leaves_quantity, bt + c->time_delta));
+                break;
+            }
+            default:
+                on_message(type_u8, body, static_cast<uint16_t>(body_size));
+                break;
+        }
+    }
+    return p == end ? total : std::numeric_limits<size_t>::max();
+}
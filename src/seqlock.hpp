@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// ------------------------------------------------------------
+// Seqlock
+// ------------------------------------------------------------
+//
+// One value published by a single writer and read by any number of readers
+// on other threads; the writer never waits for readers.
+//
+// Design:
+// - The version is odd while a store is in progress. A reader copies the
+//   value and retries if the version was odd or moved, so it only ever
+//   returns a copy that was not torn.
+// - Readers only retry while the writer is mid-store; the value should be
+//   small enough (a few KiB) that a copy is much shorter than the interval
+//   between stores.
+//
+template <typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable for this seqlock.");
+
+    public:
+        Seqlock() noexcept = default;
+
+        Seqlock(const Seqlock&) = delete;
+        Seqlock& operator=(const Seqlock&) = delete;
+
+        // Writer only.
+        inline void store(const T& value) noexcept {
+            const uint64_t v = version_.load(std::memory_order_relaxed);
+            version_.store(v + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            std::memcpy(&value_, &value, sizeof(T));
+            version_.store(v + 2, std::memory_order_release);
+        }
+
+        // Any thread. Returns the number of stores so far (0: nothing
+        // published yet, out untouched).
+        inline uint64_t load(T& out) const noexcept {
+            for (;;) {
+                const uint64_t before = version_.load(std::memory_order_acquire);
+                if (before == 0) return 0;
+                if (before & 1) continue;
+                std::memcpy(&out, &value_, sizeof(T));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (version_.load(std::memory_order_relaxed) == before) return before / 2;
+            }
+        }
+
+    private:
+        alignas(64) std::atomic<uint64_t> version_{0};
+        alignas(64) T value_{};
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "types.hpp"
+
+// ------------------------------------------------------------
+// Session
+// ------------------------------------------------------------
+//
+// Transport-neutral view of one client session: what the engine needs to
+// send, and the callbacks the owner of the session wires up.
+//
+// Design:
+// - Connection (TCP) and the shared-memory sessions derive from this; the
+//   engine and the simulator only ever talk to a Session.
+// - Inbound messages still arrive through the InboundQueue given to the
+//   concrete transport; callbacks fire on a transport thread.
+// - outbound_depth() / outbound_capacity() are in the transport's own units
+//   (queued messages for TCP, ring bytes for shared memory); only their ratio
+//   is meaningful across transports.
+//
+class Session {
+public:
+    explicit Session(Id_t id) noexcept : id_(id) {}
+    virtual ~Session() = default;
+
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+
+    // Begins delivering inbound messages.
+    virtual void start() = 0;
+
+    // Returns false if the message was dropped (outbound path full).
+    virtual bool send_message(Message_t type, const void* payload) noexcept = 0;
+    // For payloads above MAX_PAYLOAD_SIZE_BUFFER (snapshots). Delivered in
+    // order with send_message(); returns false if the frame was dropped.
+    virtual bool send_message_unbuffered(Message_t type, const void* payload, uint16_t payload_size) noexcept = 0;
+
+    virtual size_t outbound_depth() const noexcept = 0;
+    virtual size_t outbound_capacity() const noexcept = 0;
+
+    // Highest protocol version the transport can frame (see PROTOCOL_V2).
+    virtual uint8_t max_protocol_version() const noexcept { return 1; }
+
+    // Safe to call more than once and from any thread.
+    virtual void close() = 0;
+
+    Id_t id() const noexcept { return id_; }
+
+public:
+    std::function<void(Session*)> disconnected;
+    // Rare-path hook for payloads larger than MAX_PAYLOAD_SIZE_BUFFER. The
+    // payload is borrowed from the transport's buffer and only valid during
+    // the call; copy it to keep it.
+    std::function<void(Id_t, Message_t, const uint8_t*, uint16_t)> large_message_received;
+    std::function<void()> inbound_ready;
+
+protected:
+    Id_t id_;
+};
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "types.hpp"
+
+// ------------------------------------------------------------
+// Shared-memory frame ring
+// ------------------------------------------------------------
+//
+// Single-producer / single-consumer byte ring carrying wire frames
+// (type u8, payload size u16 little-endian, payload) between two processes.
+//
+// Design:
+// - Control block and data live in the shared segment; ShmRing is a
+//   per-process view over them and keeps cached copies of the peer's index so
+//   the common path touches only its own cache line.
+// - head/tail are free-running byte counters; capacity is a power of two.
+// - Frames are never split: if one does not fit before the end of the buffer
+//   the producer writes a PAD byte and restarts at offset 0, so the consumer
+//   always parses in place.
+// - A frame is published by the release store of head after it is fully
+//   written; a writer that would overflow writes nothing.
+//
+struct ShmRingControl {
+    alignas(64) std::atomic<uint64_t> head{0}; // bytes published by the producer
+    alignas(64) std::atomic<uint64_t> tail{0}; // bytes released by the consumer
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "Shared-memory rings need address-free 64-bit atomics.");
+
+class ShmRing {
+    public:
+        static constexpr size_t FRAME_HEADER_SIZE = 1 + 2;
+        // Never a MessageType: marks the unused tail of the buffer.
+        static constexpr uint8_t PAD = 0;
+
+        ShmRing() noexcept = default;
+        ShmRing(ShmRingControl* control, uint8_t* data, size_t capacity) noexcept
+            : control_(control)
+            , data_(data)
+            , capacity_(capacity)
+            , mask_(capacity - 1) {}
+
+        // Producer only. False (and nothing written) when the frame does not fit.
+        bool try_write_frame(Message_t type, const void* payload, uint16_t payload_size) noexcept {
+            const size_t frame_size = FRAME_HEADER_SIZE + payload_size;
+            const uint64_t head = control_->head.load(std::memory_order_relaxed);
+            const size_t offset = static_cast<size_t>(head & mask_);
+            const size_t to_end = capacity_ - offset;
+            const size_t needed = frame_size <= to_end ? frame_size : to_end + frame_size;
+
+            if (head + needed - cached_tail_ > capacity_) {
+                cached_tail_ = control_->tail.load(std::memory_order_acquire);
+                if (head + needed - cached_tail_ > capacity_) {
+                    return false;
+                }
+            }
+
+            uint8_t* dst = data_ + offset;
+            if (frame_size > to_end) {
+                *dst = PAD;
+                dst = data_;
+            }
+            dst[0] = static_cast<uint8_t>(type);
+            dst[1] = static_cast<uint8_t>(payload_size & 0xFF);
+            dst[2] = static_cast<uint8_t>((payload_size >> 8) & 0xFF);
+            if (payload_size) {
+                std::memcpy(dst + FRAME_HEADER_SIZE, payload, payload_size);
+            }
+            control_->head.store(head + needed, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer only. Calls on_frame(type, payload, payload_size) for up to
+        // max_frames frames (PAD skips count against the budget); a frame is
+        // released only if on_frame returns true, otherwise reading stops and
+        // the frame is offered again next time. The producer may be another,
+        // untrusted process: a head more than capacity ahead, a frame crossing
+        // the end of the buffer or the published bytes, or a PAD the
+        // published bytes do not cover stops reading and sets malformed().
+        template <typename OnFrame>
+        size_t read_frames(size_t max_frames, OnFrame&& on_frame) noexcept {
+            uint64_t tail = control_->tail.load(std::memory_order_relaxed);
+            size_t n = 0;
+            size_t steps = 0;
+            while (steps < max_frames && !malformed_) {
+                if (tail == cached_head_) {
+                    cached_head_ = control_->head.load(std::memory_order_acquire);
+                    if (cached_head_ - tail > capacity_) {
+                        malformed_ = true;
+                        break;
+                    }
+                    if (tail == cached_head_) break;
+                }
+                const uint64_t published = cached_head_ - tail;
+                const size_t offset = static_cast<size_t>(tail & mask_);
+                const size_t to_end = capacity_ - offset;
+                const uint8_t* src = data_ + offset;
+                ++steps;
+                if (*src == PAD) {
+                    if (published < to_end) {
+                        malformed_ = true;
+                        break;
+                    }
+                    tail += to_end;
+                    continue;
+                }
+                if (to_end < FRAME_HEADER_SIZE || published < FRAME_HEADER_SIZE) {
+                    malformed_ = true;
+                    break;
+                }
+                const uint16_t payload_size =
+                    static_cast<uint16_t>(src[1] | (static_cast<uint16_t>(src[2]) << 8));
+                const size_t frame_size = FRAME_HEADER_SIZE + payload_size;
+                if (frame_size > to_end || frame_size > published) {
+                    malformed_ = true;
+                    break;
+                }
+                if (!on_frame(static_cast<Message_t>(src[0]), src + FRAME_HEADER_SIZE, payload_size)) {
+                    break;
+                }
+                tail += frame_size;
+                ++n;
+            }
+            control_->tail.store(tail, std::memory_order_release);
+            return n;
+        }
+
+        // Consumer only. Set once read_frames met a broken ring; it then reads
+        // nothing more.
+        bool malformed() const noexcept { return malformed_; }
+
+        // Consumer only. Releases everything published so far unread; used to
+        // drop the rest of a ring whose producer broke the framing.
+        void discard() noexcept {
+            cached_head_ = control_->head.load(std::memory_order_acquire);
+            control_->tail.store(cached_head_, std::memory_order_release);
+        }
+
+        size_t used_bytes() const noexcept {
+            const uint64_t head = control_->head.load(std::memory_order_acquire);
+            const uint64_t tail = control_->tail.load(std::memory_order_acquire);
+            return static_cast<size_t>(head - tail);
+        }
+
+        bool empty() const noexcept { return used_bytes() == 0; }
+        size_t capacity() const noexcept { return capacity_; }
+
+    private:
+        ShmRingControl* control_ = nullptr;
+        uint8_t* data_ = nullptr;
+        size_t capacity_ = 0;
+        size_t mask_ = 0;
+        uint64_t cached_tail_ = 0; // producer side
+        uint64_t cached_head_ = 0; // consumer side
+        bool malformed_ = false;   // consumer side
+};
@@ -0,0 +1,632 @@
+#include "shm_transport.hpp"
+
+#if defined(__linux__)
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/write.hpp>
+
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <new>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "logging.hpp"
+#include "metrics.hpp"
+#include "socket_options.hpp"
+#include "thread_affinity.hpp"
+
+TG_INLINE_GLOBAL_LOGGER_WITH_CHANNEL(LG_SHM, "SHM")
+
+namespace {
+
+constexpr size_t POLL_BUDGET_PER_SESSION = 256;
+constexpr size_t IDLE_SPINS_BEFORE_YIELD = 4096;
+
+[[noreturn]] void throw_errno(const char* what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+} // namespace
+
+// ------------------------------------------------------------
+// ShmSegment
+// ------------------------------------------------------------
+
+static_assert(sizeof(ShmSegment::Header) <= 4096, "Segment header must fit its page.");
+static_assert((SHM_RING_BYTES & (SHM_RING_BYTES - 1)) == 0, "Ring size must be a power of two.");
+static_assert(SHM_RING_BYTES > ShmRing::FRAME_HEADER_SIZE + 0xFFFF, "Ring must hold the largest frame.");
+
+ShmSegment ShmSegment::create(const std::string& name, size_t ring_bytes) {
+    const int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) throw_errno("shm_open");
+
+    const size_t size = HEADER_BYTES + 2 * ring_bytes;
+    if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        const int err = errno;
+        ::close(fd);
+        ::shm_unlink(name.c_str());
+        throw std::system_error(err, std::generic_category(), "ftruncate");
+    }
+    void* base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const int err = errno;
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        ::shm_unlink(name.c_str());
+        throw std::system_error(err, std::generic_category(), "mmap");
+    }
+
+    ShmSegment segment(base, size);
+    Header* h = new (base) Header{};
+    h->magic = MAGIC;
+    h->version = VERSION;
+    h->ring_bytes = ring_bytes;
+    h->closed.store(0, std::memory_order_release);
+    segment.header_ = h;
+    segment.ring_bytes_ = ring_bytes;
+    return segment;
+}
+
+ShmSegment ShmSegment::open(const std::string& name) {
+    const int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) throw_errno("shm_open");
+
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) {
+        const int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), "fstat");
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    if (size < HEADER_BYTES) {
+        ::close(fd);
+        throw std::system_error(EINVAL, std::generic_category(), "shm segment too small");
+    }
+    void* base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const int err = errno;
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        throw std::system_error(err, std::generic_category(), "mmap");
+    }
+
+    ShmSegment segment(base, size);
+    Header* h = static_cast<Header*>(base);
+    if (h->magic != MAGIC || h->version != VERSION || HEADER_BYTES + 2 * h->ring_bytes != size) {
+        throw std::system_error(EPROTO, std::generic_category(), "shm segment header mismatch");
+    }
+    segment.header_ = h;
+    segment.ring_bytes_ = h->ring_bytes;
+    return segment;
+}
+
+ShmSegment::ShmSegment(void* base, size_t size) noexcept
+    : base_(base)
+    , size_(size) {}
+
+ShmSegment::ShmSegment(ShmSegment&& other) noexcept
+    : base_(std::exchange(other.base_, nullptr))
+    , size_(std::exchange(other.size_, 0))
+    , header_(std::exchange(other.header_, nullptr))
+    , ring_bytes_(std::exchange(other.ring_bytes_, 0)) {}
+
+ShmSegment& ShmSegment::operator=(ShmSegment&& other) noexcept {
+    if (this != &other) {
+        if (base_) ::munmap(base_, size_);
+        base_ = std::exchange(other.base_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        header_ = std::exchange(other.header_, nullptr);
+        ring_bytes_ = std::exchange(other.ring_bytes_, 0);
+    }
+    return *this;
+}
+
+ShmSegment::~ShmSegment() {
+    if (base_) ::munmap(base_, size_);
+}
+
+ShmRing ShmSegment::to_server_ring() const noexcept {
+    uint8_t* data = static_cast<uint8_t*>(base_) + HEADER_BYTES;
+    return ShmRing(&header_->to_server, data, ring_bytes_);
+}
+
+ShmRing ShmSegment::to_client_ring() const noexcept {
+    uint8_t* data = static_cast<uint8_t*>(base_) + HEADER_BYTES + ring_bytes_;
+    return ShmRing(&header_->to_client, data, ring_bytes_);
+}
+
+void ShmSegment::mark_closed() noexcept {
+    if (header_) header_->closed.store(1, std::memory_order_release);
+}
+
+bool ShmSegment::closed() const noexcept {
+    return !header_ || header_->closed.load(std::memory_order_acquire) != 0;
+}
+
+// ------------------------------------------------------------
+// ShmSession (exchange side)
+// ------------------------------------------------------------
+
+ShmSession::ShmSession(Id_t id, ShmSegment&& segment, boost::asio::local::stream_protocol::socket&& socket)
+    : Session(id)
+    , segment_(std::move(segment))
+    , to_server_(segment_.to_server_ring())
+    , to_client_(segment_.to_client_ring())
+    , socket_(std::move(socket)) {}
+
+bool ShmSession::send_message(Message_t type, const void* payload) noexcept {
+    const uint16_t payload_size = payload_size_for_type(static_cast<MessageType>(type));
+    if (payload_size > MAX_PAYLOAD_SIZE_BUFFER) {
+        return false;
+    }
+    if (!to_client_.try_write_frame(type, payload, payload_size)) {
+        RLOG(LG_SHM, LogLevel::LL_WARNING) << "shm=" << id_
+               << " outbound ring full (type=" << static_cast<unsigned>(type) << ")";
+        return false;
+    }
+    return true;
+}
+
+bool ShmSession::send_message_unbuffered(Message_t type, const void* payload, uint16_t payload_size) noexcept {
+    if (payload_size == 0 || payload == nullptr) {
+        return false;
+    }
+    if (!to_client_.try_write_frame(type, payload, payload_size)) {
+        RLOG(LG_SHM, LogLevel::LL_WARNING) << "shm=" << id_
+               << " outbound ring full, dropped unbuffered frame (type=" << static_cast<unsigned>(type)
+               << " payload_size=" << payload_size << ")";
+        return false;
+    }
+    return true;
+}
+
+void ShmSession::close() {
+    segment_.mark_closed();
+    peer_closed_.store(true, std::memory_order_release);
+    // The socket belongs to the handshake thread; its EOF tells the client.
+    boost::asio::post(socket_.get_executor(), [this] {
+        boost::system::error_code ignored;
+        socket_.close(ignored);
+    });
+}
+
+bool ShmSession::peer_gone_() const noexcept {
+    return peer_closed_.load(std::memory_order_acquire) || segment_.closed();
+}
+
+size_t ShmSession::poll_inbound_(InboundQueue& inbox, size_t budget) noexcept {
+    bool violation = false;
+    const size_t n = to_server_.read_frames(budget,
+        [&](Message_t type, const uint8_t* payload, uint16_t payload_size) {
+            if (payload_size > MAX_PAYLOAD_SIZE) {
+                violation = true;
+                return false;
+            }
+            if (payload_size > MAX_PAYLOAD_SIZE_BUFFER) {
+                if (large_message_received) {
+                    // Borrowed from the ring; the frame is released after the call.
+                    large_message_received(id_, type, payload, payload_size);
+                }
+                return true;
+            }
+            InboundMessage msg;
+            msg.connection_id = id_;
+            msg.message_type = type;
+            msg.payload_size = payload_size;
+            if (payload_size) {
+                std::memcpy(msg.payload.data(), payload, payload_size);
+            }
+            // Full inbox: leave the frame in the ring and retry next pass.
+            return inbox.try_push(msg);
+        });
+
+    if (violation || to_server_.malformed()) {
+        // Nothing after a bad frame can be parsed: drop the ring's contents so
+        // the frame is not offered again, and stop polling this session.
+        RLOG(LG_SHM, LogLevel::LL_WARNING) << "shm=" << id_ << " protocol violation: "
+               << (violation ? "oversized frame" : "malformed ring") << "; closing";
+        metrics_thread_shard().count_drop(DropReason::PROTOCOL_VIOLATION);
+        to_server_.discard();
+        violated_ = true;
+        close();
+    }
+    return n;
+}
+
+// ------------------------------------------------------------
+// ShmTransportServer
+// ------------------------------------------------------------
+
+struct ShmTransportServer::Pending {
+    explicit Pending(local_stream::socket&& s) : socket(std::move(s)), deadline(socket.get_executor()) {}
+
+    local_stream::socket socket;
+    boost::asio::steady_timer deadline;
+    Id_t id = 0;
+    std::string name;
+    ShmSegment segment;
+    std::array<uint8_t, 256> hello{};
+    size_t hello_size = 0;
+    std::array<uint8_t, 1> ack{};
+};
+
+ShmTransportServer::ShmTransportServer(std::string socket_path, std::function<Id_t()> allocate_id,
+                                       std::function<void(Id_t)> release_id)
+    : socket_path_(std::move(socket_path))
+    , allocate_id_(std::move(allocate_id))
+    , release_id_(std::move(release_id))
+    , acceptor_(context_) {
+        for (auto& slot : sessions_) {
+            slot.store(nullptr, std::memory_order_relaxed);
+        }
+        free_slots_.reserve(MAX_CONNECTIONS);
+        // A socket file left behind by a previous run would make bind fail.
+        remove_stale_socket_file(socket_path_);
+        const local_stream::endpoint endpoint(socket_path_);
+        acceptor_.open(endpoint.protocol());
+        acceptor_.bind(endpoint);
+        acceptor_.listen();
+    }
+
+ShmTransportServer::~ShmTransportServer() {
+    stop();
+}
+
+void ShmTransportServer::start() {
+    if (running_.exchange(true, std::memory_order_acq_rel)) return;
+    do_accept_();
+    io_thread_ = std::thread([this] {
+        enter_thread_role("shm_io");
+        context_.run();
+    });
+    poll_thread_ = std::thread([this] {
+        enter_thread_role("shm_poll");
+        poll_loop_();
+    });
+}
+
+void ShmTransportServer::stop() {
+    running_.store(false, std::memory_order_release);
+    context_.stop();
+    if (io_thread_.joinable()) io_thread_.join();
+    if (poll_thread_.joinable()) poll_thread_.join();
+
+    // Both threads are gone; tear the sessions down directly.
+    boost::system::error_code ignored;
+    if (acceptor_.is_open()) {
+        acceptor_.close(ignored);
+        ::unlink(socket_path_.c_str());
+    }
+    for (auto& session : owned_) {
+        if (!session) continue;
+        session->segment_.mark_closed();
+        session->socket_.close(ignored);
+    }
+}
+
+void ShmTransportServer::do_accept_() {
+    acceptor_.async_accept([this](boost::system::error_code ec, local_stream::socket socket) {
+        if (ec) {
+            if (ec == boost::asio::error::operation_aborted) return;
+            RLOG(LG_SHM, LogLevel::LL_ERROR) << "[ShmTransport] accept error: " << ec.message();
+        } else {
+            begin_handshake_(std::move(socket));
+        }
+        if (acceptor_.is_open()) do_accept_();
+    });
+}
+
+void ShmTransportServer::begin_handshake_(local_stream::socket socket) {
+    const Id_t id = allocate_id_();
+    if (id == NO_CONNECTION_ID) {
+        RLOG(LG_SHM, LogLevel::LL_WARNING) << "[ShmTransport] connection limit reached, rejecting.";
+        boost::system::error_code ignored;
+        socket.close(ignored);
+        return;
+    }
+
+    auto pending = std::make_shared<Pending>(std::move(socket));
+    pending->id = id;
+    pending->name = "/tg_shm_" + std::to_string(::getpid()) + "_" + std::to_string(id);
+    try {
+        pending->segment = ShmSegment::create(pending->name, SHM_RING_BYTES);
+    } catch (const std::exception& e) {
+        RLOG(LG_SHM, LogLevel::LL_ERROR) << "[ShmTransport] cannot create " << pending->name << ": " << e.what();
+        release_id_(id);
+        return;
+    }
+
+    pending->hello[0] = static_cast<uint8_t>(pending->name.size());
+    std::memcpy(pending->hello.data() + 1, pending->name.data(), pending->name.size());
+    pending->hello_size = 1 + pending->name.size();
+
+    // A client that never acks would hold its id and segment for good;
+    // closing the socket fails whichever handshake step is outstanding.
+    pending->deadline.expires_after(SHM_HANDSHAKE_TIMEOUT);
+    pending->deadline.async_wait([pending](const boost::system::error_code& ec) {
+        if (ec) return; // cancelled: the handshake finished first
+        RLOG(LG_SHM, LogLevel::LL_WARNING) << "[ShmTransport] handshake timed out for " << pending->name;
+        boost::system::error_code ignored;
+        pending->socket.close(ignored);
+    });
+
+    boost::asio::async_write(pending->socket, boost::asio::buffer(pending->hello.data(), pending->hello_size),
+        [this, pending](const boost::system::error_code& ec, size_t) {
+            if (ec) {
+                pending->deadline.cancel();
+                ::shm_unlink(pending->name.c_str());
+                RLOG(LG_SHM, LogLevel::LL_WARNING) << "[ShmTransport] handshake failed: " << ec.message();
+                release_id_(pending->id);
+                return;
+            }
+            boost::asio::async_read(pending->socket, boost::asio::buffer(pending->ack),
+                [this, pending](const boost::system::error_code& ec, size_t) {
+                    pending->deadline.cancel();
+                    ::shm_unlink(pending->name.c_str());
+                    if (ec) {
+                        RLOG(LG_SHM, LogLevel::LL_WARNING) << "[ShmTransport] handshake failed: " << ec.message();
+                        release_id_(pending->id);
+                        return;
+                    }
+                    finish_handshake_(pending);
+                });
+        });
+}
+
+void ShmTransportServer::finish_handshake_(const std::shared_ptr<Pending>& pending) {
+    // Every live session holds a connection id, so a slot is always free.
+    size_t slot;
+    if (!free_slots_.empty()) {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    } else {
+        slot = num_slots_.load(std::memory_order_relaxed);
+        assert(slot < MAX_CONNECTIONS);
+    }
+    owned_[slot] = std::make_unique<ShmSession>(pending->id, std::move(pending->segment), std::move(pending->socket));
+    ShmSession* session = owned_[slot].get();
+    session->poll_slot_ = slot;
+
+    if (session_opened) session_opened(session);
+
+    sessions_[slot].store(session, std::memory_order_release);
+    num_live_.fetch_add(1, std::memory_order_relaxed);
+    if (slot == num_slots_.load(std::memory_order_relaxed)) {
+        num_slots_.store(slot + 1, std::memory_order_release);
+    }
+
+    RLOG(LG_SHM, LogLevel::LL_INFO) << "[ShmTransport] session " << session->id() << " attached";
+    watch_liveness_(session);
+}
+
+void ShmTransportServer::watch_liveness_(ShmSession* session) {
+    boost::asio::async_read(session->socket_, boost::asio::buffer(session->liveness_byte_),
+        [this, session](const boost::system::error_code& ec, size_t) {
+            // Aborted: we closed the socket, and the session may already be gone.
+            if (ec == boost::asio::error::operation_aborted) return;
+            if (!ec) {
+                watch_liveness_(session); // stray byte; keep waiting for EOF
+                return;
+            }
+            session->peer_closed_.store(true, std::memory_order_release);
+        });
+}
+
+void ShmTransportServer::release_session(ShmSession* session) {
+    // Last holder out posts the teardown. close() was posted before either
+    // holder let go, so it runs first on the handshake thread.
+    if (session->holders_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        boost::asio::post(context_, [this, session] { destroy_session_(session); });
+    }
+}
+
+void ShmTransportServer::destroy_session_(ShmSession* session) {
+    const size_t slot = session->poll_slot_;
+    const Id_t id = session->id();
+    assert(owned_[slot].get() == session);
+    boost::system::error_code ignored;
+    session->socket_.close(ignored);
+    owned_[slot].reset();
+    free_slots_.push_back(slot);
+    RLOG(LG_SHM, LogLevel::LL_INFO) << "[ShmTransport] session " << id << " released";
+    release_id_(id);
+}
+
+void ShmTransportServer::poll_loop_() {
+    size_t idle = 0;
+    while (running_.load(std::memory_order_acquire)) {
+        const size_t n = num_slots_.load(std::memory_order_acquire);
+        size_t moved = 0;
+        for (size_t i = 0; i < n; ++i) {
+            ShmSession* s = sessions_[i].load(std::memory_order_acquire);
+            if (!s) continue;
+
+            if (!s->violated_) {
+                moved += s->poll_inbound_(inbox_, POLL_BUDGET_PER_SESSION);
+            }
+
+            // A violating session is disconnected at once; otherwise frames
+            // the peer sent before leaving are delivered first.
+            if (s->violated_ || (s->peer_gone_() && s->to_server_.empty())) {
+                InboundMessage m{};
+                m.connection_id = s->id();
+                m.message_type = static_cast<Message_t>(MessageType::DISCONNECT);
+                m.payload_size = 0;
+                // Out of the poll set before the engine can see the DISCONNECT
+                // and release the session; back in if the inbox is full.
+                sessions_[i].store(nullptr, std::memory_order_release);
+                if (inbox_.try_push(m)) {
+                    num_live_.fetch_sub(1, std::memory_order_relaxed);
+                    release_session(s);
+                    ++moved;
+                } else {
+                    sessions_[i].store(s, std::memory_order_release);
+                }
+            }
+        }
+
+        if (moved) {
+            idle = 0;
+            if (inbound_ready) inbound_ready();
+        } else if (num_live_.load(std::memory_order_relaxed) == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        } else if (++idle >= IDLE_SPINS_BEFORE_YIELD) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// ------------------------------------------------------------
+// ShmClientSession
+// ------------------------------------------------------------
+
+ShmClientSession::ShmClientSession(boost::asio::io_context& context, const std::string& socket_path, InboundQueue& inbound)
+    : Session(0)
+    , context_(context)
+    , socket_(context)
+    , inbound_(inbound) {
+        socket_.connect(boost::asio::local::stream_protocol::endpoint(socket_path));
+
+        uint8_t name_size = 0;
+        boost::asio::read(socket_, boost::asio::buffer(&name_size, 1));
+        std::string name(name_size, '\0');
+        boost::asio::read(socket_, boost::asio::buffer(name.data(), name.size()));
+
+        segment_ = ShmSegment::open(name);
+        to_server_ = segment_.to_server_ring();
+        to_client_ = segment_.to_client_ring();
+
+        const uint8_t ack = 1;
+        boost::asio::write(socket_, boost::asio::buffer(&ack, 1));
+    }
+
+ShmClientSession::~ShmClientSession() {
+    alive_->store(false, std::memory_order_release);
+    close();
+}
+
+template <typename F>
+void ShmClientSession::post_(F&& f) {
+    boost::asio::post(context_, [alive = alive_, f = std::forward<F>(f)]() mutable {
+        if (alive->load(std::memory_order_acquire)) f();
+    });
+}
+
+void ShmClientSession::start() {
+    if (polling_.exchange(true, std::memory_order_acq_rel)) return;
+    watch_liveness_();
+    poll_thread_ = std::thread([this] { poll_loop_(); });
+}
+
+bool ShmClientSession::send_message(Message_t type, const void* payload) noexcept {
+    const uint16_t payload_size = payload_size_for_type(static_cast<MessageType>(type));
+    if (payload_size > MAX_PAYLOAD_SIZE_BUFFER) {
+        return false;
+    }
+    return to_server_.try_write_frame(type, payload, payload_size);
+}
+
+bool ShmClientSession::send_message_unbuffered(Message_t type, const void* payload, uint16_t payload_size) noexcept {
+    if (payload_size == 0 || payload == nullptr) {
+        return false;
+    }
+    if (!to_server_.try_write_frame(type, payload, payload_size)) {
+        RLOG(LG_SHM, LogLevel::LL_WARNING) << "[ShmClient] outbound ring full, dropped frame (type="
+               << static_cast<unsigned>(type) << ")";
+        return false;
+    }
+    return true;
+}
+
+void ShmClientSession::close() {
+    polling_.store(false, std::memory_order_release);
+    if (poll_thread_.joinable() && poll_thread_.get_id() != std::this_thread::get_id()) {
+        poll_thread_.join();
+    }
+    segment_.mark_closed();
+    // The liveness read may be running on context_; close the socket there.
+    post_([this] {
+        boost::system::error_code ignored;
+        socket_.close(ignored);
+    });
+}
+
+void ShmClientSession::watch_liveness_() {
+    boost::asio::async_read(socket_, boost::asio::buffer(liveness_byte_),
+        [this](const boost::system::error_code& ec, size_t) {
+            if (!ec) {
+                watch_liveness_();
+                return;
+            }
+            RLOG(LG_SHM, LogLevel::LL_INFO) << "[ShmClient] session closed: " << ec.message();
+            notify_disconnect_once_();
+        });
+}
+
+void ShmClientSession::notify_disconnect_once_() {
+    if (disconnect_notified_.exchange(true, std::memory_order_acq_rel)) return;
+    polling_.store(false, std::memory_order_release);
+    if (disconnected) disconnected(this);
+}
+
+void ShmClientSession::notify_inbound_ready_() {
+    if (!inbound_ready || inbound_ready_pending_.exchange(true, std::memory_order_acq_rel)) return;
+    post_([this] {
+        inbound_ready_pending_.store(false, std::memory_order_release);
+        if (inbound_ready && !disconnect_notified_.load(std::memory_order_acquire)) inbound_ready();
+    });
+}
+
+void ShmClientSession::poll_loop_() {
+    size_t idle = 0;
+    while (polling_.load(std::memory_order_acquire)) {
+        const size_t n = to_client_.read_frames(POLL_BUDGET_PER_SESSION,
+            [this](Message_t type, const uint8_t* payload, uint16_t payload_size) {
+                if (payload_size > MAX_PAYLOAD_SIZE_BUFFER) {
+                    if (large_message_received) {
+                        // The ring slot is released after this returns.
+                        std::vector<uint8_t> frame(payload, payload + payload_size);
+                        post_([this, type, frame = std::move(frame)] {
+                            large_message_received(id_, type, frame.data(), static_cast<uint16_t>(frame.size()));
+                        });
+                    }
+                    return true;
+                }
+                InboundMessage msg;
+                msg.connection_id = id_;
+                msg.message_type = type;
+                msg.payload_size = payload_size;
+                if (payload_size) {
+                    std::memcpy(msg.payload.data(), payload, payload_size);
+                }
+                return inbound_.try_push(msg);
+            });
+
+        if (n) {
+            idle = 0;
+            notify_inbound_ready_();
+            continue;
+        }
+        if (segment_.closed() || to_client_.malformed()) {
+            // Exchange closed the session (or broke its ring); closing the socket completes the
+            // liveness read on the caller's io_context, which reports it.
+            post_([this] {
+                boost::system::error_code ignored;
+                socket_.close(ignored);
+            });
+            return;
+        }
+        if (++idle >= IDLE_SPINS_BEFORE_YIELD) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+#endif
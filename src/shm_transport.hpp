@@ -0,0 +1,247 @@
+#pragma once
+
+// ------------------------------------------------------------
+// Shared-memory session transport (Linux)
+// ------------------------------------------------------------
+//
+// For clients on the same host as the exchange: each session is a POSIX
+// shared-memory segment holding two ShmRings (client->exchange and
+// exchange->client) carrying the normal wire frames, so a round trip is a few
+// cache-line transfers instead of two trips through the TCP stack.
+//
+// Design:
+// - Discovery: the client connects to a Unix domain stream socket. The server
+//   creates a fresh segment (/tg_shm_<pid>_<id>), sends its name as
+//   [u8 length][name], and unlinks it once the client acks with one byte.
+// - The Unix socket then stays open purely for liveness: EOF on either side
+//   means the peer is gone, even if it crashed without closing the segment.
+// - Server: one poller thread spins over all sessions' inbound rings and
+//   feeds a single InboundQueue the engine drains alongside the TCP shards
+//   (so that queue has exactly one producer). The engine writes outbound
+//   frames straight into the session's ring; there is no IO thread in the
+//   outbound path.
+// - Client: ShmClientSession is a drop-in Session with the same callbacks as
+//   Connection; a poller thread feeds the caller's InboundQueue. Callbacks
+//   are posted to the caller's io_context, never run on the poller, and
+//   large frames are copied out of the ring first.
+// - Pollers spin, then yield once idle; they own a CPU while sessions are
+//   active, which is the price of sub-microsecond delivery.
+// - Back-pressure is natural: a full ring refuses writes (send_message
+//   returns false) and a full InboundQueue leaves frames in the ring.
+// - Teardown: a session is destroyed on the handshake thread once both the
+//   poller (after queueing its DISCONNECT) and the engine (release_session)
+//   are done with it; its poll slot and connection id are then reused. A
+//   client that does not ack within SHM_HANDSHAKE_TIMEOUT is dropped, which
+//   gives back its id and segment.
+//
+#if defined(__linux__)
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "connectivity.hpp"
+#include "session.hpp"
+#include "shm_ring.hpp"
+#include "types.hpp"
+
+constexpr size_t SHM_RING_BYTES = size_t{1} << 21; // per direction
+constexpr auto SHM_HANDSHAKE_TIMEOUT = std::chrono::seconds(5);
+
+// Mapping of one session segment: header page followed by both rings' data.
+class ShmSegment {
+    public:
+        static constexpr uint32_t MAGIC = 0x4D534754; // "TGSM"
+        static constexpr uint32_t VERSION = 1;
+
+        struct Header {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t ring_bytes;
+            std::atomic<uint32_t> closed; // set by whichever side closes first
+            ShmRingControl to_server;
+            ShmRingControl to_client;
+        };
+
+        // Both throw std::system_error on failure; create() fails if name exists.
+        static ShmSegment create(const std::string& name, size_t ring_bytes);
+        static ShmSegment open(const std::string& name);
+
+        ShmSegment() noexcept = default;
+        ShmSegment(ShmSegment&& other) noexcept;
+        ShmSegment& operator=(ShmSegment&& other) noexcept;
+        ~ShmSegment();
+
+        Header* header() const noexcept { return header_; }
+        ShmRing to_server_ring() const noexcept;
+        ShmRing to_client_ring() const noexcept;
+
+        void mark_closed() noexcept;
+        bool closed() const noexcept;
+
+    private:
+        static constexpr size_t HEADER_BYTES = 4096;
+
+        ShmSegment(void* base, size_t size) noexcept;
+
+        void* base_ = nullptr;
+        size_t size_ = 0;
+        Header* header_ = nullptr;
+        // Geometry as create()/open() validated it; the peer can rewrite the
+        // header, so the rings never read it from there.
+        size_t ring_bytes_ = 0;
+};
+
+class ShmTransportServer;
+
+// Exchange-side end of one shared-memory session.
+class ShmSession final : public Session {
+    public:
+        ShmSession(Id_t id, ShmSegment&& segment, boost::asio::local::stream_protocol::socket&& socket);
+
+        void start() override {}
+        // Engine thread only.
+        bool send_message(Message_t type, const void* payload) noexcept override;
+        bool send_message_unbuffered(Message_t type, const void* payload, uint16_t payload_size) noexcept override;
+
+        size_t outbound_depth() const noexcept override { return to_client_.used_bytes(); }
+        size_t outbound_capacity() const noexcept override { return to_client_.capacity(); }
+
+        void close() override;
+
+    private:
+        friend class ShmTransportServer;
+
+        // Poller thread only. Returns the number of frames moved to inbox.
+        size_t poll_inbound_(InboundQueue& inbox, size_t budget) noexcept;
+        bool peer_gone_() const noexcept;
+
+        ShmSegment segment_;
+        ShmRing to_server_; // consumed by the poller
+        ShmRing to_client_; // produced by the engine
+        boost::asio::local::stream_protocol::socket socket_;
+        std::array<uint8_t, 1> liveness_byte_{};
+
+        std::atomic<bool> peer_closed_{false};
+        bool violated_ = false; // poller only; set once a bad frame was seen
+        size_t poll_slot_ = 0;
+        // The poller and the engine each drop one; the last one destroys it.
+        std::atomic<uint8_t> holders_{2};
+};
+
+class ShmTransportServer {
+    public:
+        // allocate_id returns NO_CONNECTION_ID when no slot is left; every id it
+        // hands out comes back through release_id, on the handshake thread.
+        ShmTransportServer(std::string socket_path, std::function<Id_t()> allocate_id,
+                           std::function<void(Id_t)> release_id);
+        ~ShmTransportServer();
+
+        ShmTransportServer(const ShmTransportServer&) = delete;
+        ShmTransportServer& operator=(const ShmTransportServer&) = delete;
+
+        void start();
+        void stop();
+
+        // Produced by the poller thread, consumed by the engine.
+        InboundQueue& inbox() noexcept { return inbox_; }
+        const std::string& socket_path() const noexcept { return socket_path_; }
+
+        // Engine thread, once it no longer sends to the session (after close()).
+        void release_session(ShmSession* session);
+
+    public:
+        // Handshake thread; the session is live (pollable) once this returns.
+        std::function<void(ShmSession*)> session_opened;
+        // Poller thread, after new messages were pushed to inbox().
+        std::function<void()> inbound_ready;
+
+    private:
+        using local_stream = boost::asio::local::stream_protocol;
+
+        struct Pending;
+
+        void do_accept_();
+        void begin_handshake_(local_stream::socket socket);
+        void finish_handshake_(const std::shared_ptr<Pending>& pending);
+        void watch_liveness_(ShmSession* session);
+        void poll_loop_();
+        void destroy_session_(ShmSession* session);
+
+        std::string socket_path_;
+        std::function<Id_t()> allocate_id_;
+        std::function<void(Id_t)> release_id_;
+
+        boost::asio::io_context context_;
+        local_stream::acceptor acceptor_;
+        std::thread io_thread_;
+        std::thread poll_thread_;
+        std::atomic<bool> running_{false};
+
+        InboundQueue inbox_;
+
+        // Poll slots are filled by the handshake thread and read by the poller,
+        // which clears a slot once the session's DISCONNECT is queued. The
+        // poller scans slots below num_slots_ (a high-water mark); freed slots
+        // are reused first. owned_ and free_slots_ are handshake thread only.
+        std::array<std::atomic<ShmSession*>, MAX_CONNECTIONS> sessions_{};
+        std::atomic<size_t> num_slots_{0};
+        std::atomic<size_t> num_live_{0};
+        std::array<std::unique_ptr<ShmSession>, MAX_CONNECTIONS> owned_;
+        std::vector<size_t> free_slots_;
+};
+
+// Client-side end: connects to socket_path and maps the segment the server
+// hands out. Throws if the connection or the handshake fails. Destroy it only
+// once context no longer runs its handlers, as with Connection.
+class ShmClientSession final : public Session {
+    public:
+        ShmClientSession(boost::asio::io_context& context, const std::string& socket_path, InboundQueue& inbound);
+        ~ShmClientSession() override;
+
+        void start() override;
+        // Caller must serialise sends (one producer at a time).
+        bool send_message(Message_t type, const void* payload) noexcept override;
+        bool send_message_unbuffered(Message_t type, const void* payload, uint16_t payload_size) noexcept override;
+
+        size_t outbound_depth() const noexcept override { return to_server_.used_bytes(); }
+        size_t outbound_capacity() const noexcept override { return to_server_.capacity(); }
+
+        void close() override;
+
+    private:
+        void poll_loop_();
+        void watch_liveness_();
+        void notify_disconnect_once_();
+        void notify_inbound_ready_();
+        // Runs f on context_ unless the session has been destroyed by then.
+        template <typename F>
+        void post_(F&& f);
+
+        boost::asio::io_context& context_;
+        boost::asio::local::stream_protocol::socket socket_;
+        ShmSegment segment_;
+        ShmRing to_server_;
+        ShmRing to_client_;
+        InboundQueue& inbound_;
+        std::array<uint8_t, 1> liveness_byte_{};
+
+        std::thread poll_thread_;
+        std::atomic<bool> polling_{false};
+        std::atomic<bool> disconnect_notified_{false};
+        std::atomic<bool> inbound_ready_pending_{false};
+        // Cleared by the destructor; checked by every handler posted to context_.
+        std::shared_ptr<std::atomic<bool>> alive_ = std::make_shared<std::atomic<bool>>(true);
+};
+
+#endif
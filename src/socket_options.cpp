@@ -0,0 +1,160 @@
+#include "socket_options.hpp"
+
+#include <cerrno>
+#include <system_error>
+
+#include "logging.hpp"
+
+#if defined(__linux__)
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <sys/socket.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <cstring>
+    #include <fcntl.h>
+    #include <sys/socket.h>
+    #include <sys/stat.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
+
+TG_INLINE_GLOBAL_LOGGER_WITH_CHANNEL(LG_SOC, "SOC")
+
+using tcp = boost::asio::ip::tcp;
+
+namespace {
+
+#if defined(__linux__)
+bool set_native_option(int fd, int level, int name, int value) noexcept {
+    return ::setsockopt(fd, level, name, &value, sizeof(value)) == 0;
+}
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+// errno of a non-blocking connect() to the Unix socket at path; 0 if accepted.
+int probe_unix_socket(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) return ENAMETOOLONG;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return errno;
+    // Non-blocking so a listener with a full backlog answers EAGAIN instead
+    // of stalling startup.
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    const int result = ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0 ? 0 : errno;
+    ::close(fd);
+    return result;
+}
+#endif
+
+} // namespace
+
+const char* socket_profile_name(SocketProfile profile) noexcept {
+    switch (profile) {
+        case SocketProfile::LATENCY:    return "latency";
+        case SocketProfile::THROUGHPUT: return "throughput";
+        case SocketProfile::BULK:       return "bulk";
+    }
+    return "unknown";
+}
+
+bool parse_socket_profile(std::string_view name, SocketProfile& out) noexcept {
+    if (name == "latency")    { out = SocketProfile::LATENCY;    return true; }
+    if (name == "throughput") { out = SocketProfile::THROUGHPUT; return true; }
+    if (name == "bulk")       { out = SocketProfile::BULK;       return true; }
+    return false;
+}
+
+bool is_tcp_socket(const StreamSocket& socket) noexcept {
+    boost::system::error_code ec;
+    const int family = socket.local_endpoint(ec).protocol().family();
+    return !ec && (family == tcp::v4().family() || family == tcp::v6().family());
+}
+
+void apply_socket_profile(StreamSocket& socket, SocketProfile profile) noexcept {
+    const SocketTuning t = socket_tuning(profile);
+    boost::system::error_code ec;
+
+    socket.set_option(tcp::no_delay(t.no_delay), ec);
+    if (ec) {
+        RLOG(LG_SOC, LogLevel::LL_WARNING) << "[SocketProfile] TCP_NODELAY failed: " << ec.message();
+    }
+    if (t.rcvbuf_bytes > 0) {
+        socket.set_option(boost::asio::socket_base::receive_buffer_size(t.rcvbuf_bytes), ec);
+        if (ec) {
+            RLOG(LG_SOC, LogLevel::LL_WARNING) << "[SocketProfile] SO_RCVBUF failed: " << ec.message();
+        }
+    }
+    if (t.sndbuf_bytes > 0) {
+        socket.set_option(boost::asio::socket_base::send_buffer_size(t.sndbuf_bytes), ec);
+        if (ec) {
+            RLOG(LG_SOC, LogLevel::LL_WARNING) << "[SocketProfile] SO_SNDBUF failed: " << ec.message();
+        }
+    }
+
+#if defined(__linux__)
+    const int fd = socket.native_handle();
+    if (t.quick_ack && !set_native_option(fd, IPPROTO_TCP, TCP_QUICKACK, 1)) {
+        RLOG(LG_SOC, LogLevel::LL_WARNING) << "[SocketProfile] TCP_QUICKACK failed.";
+    }
+    #if defined(SO_BUSY_POLL)
+    // Needs CAP_NET_ADMIN to raise above net.core.busy_read; failure is benign.
+    if (t.busy_poll_us > 0 && !set_native_option(fd, SOL_SOCKET, SO_BUSY_POLL, t.busy_poll_us)) {
+        RLOG(LG_SOC, LogLevel::LL_DEBUG) << "[SocketProfile] SO_BUSY_POLL not permitted.";
+    }
+    #endif
+#endif
+}
+
+void rearm_quick_ack(StreamSocket& socket) noexcept {
+#if defined(__linux__)
+    (void)set_native_option(socket.native_handle(), IPPROTO_TCP, TCP_QUICKACK, 1);
+#else
+    (void)socket;
+#endif
+}
+
+void open_listening_acceptor(tcp::acceptor& acceptor, const tcp::endpoint& endpoint, bool reuse_port) {
+    acceptor.open(endpoint.protocol());
+    acceptor.set_option(tcp::acceptor::reuse_address(true));
+#if defined(__linux__) && defined(SO_REUSEPORT)
+    if (reuse_port && !set_native_option(acceptor.native_handle(), SOL_SOCKET, SO_REUSEPORT, 1)) {
+        RLOG(LG_SOC, LogLevel::LL_WARNING) << "[SocketProfile] SO_REUSEPORT failed.";
+    }
+#else
+    (void)reuse_port;
+#endif
+    acceptor.bind(endpoint);
+    acceptor.listen();
+}
+
+void remove_stale_socket_file(const std::string& path) {
+#if defined(__unix__) || defined(__APPLE__)
+    struct stat st{};
+    if (::lstat(path.c_str(), &st) != 0) {
+        if (errno == ENOENT) return;
+        throw std::system_error(errno, std::generic_category(), "stat " + path);
+    }
+    if (!S_ISSOCK(st.st_mode)) {
+        throw std::system_error(EEXIST, std::generic_category(), path + " exists and is not a socket");
+    }
+    // Only a refused connect proves nobody listens there any more.
+    const int probe = probe_unix_socket(path);
+    if (probe == ENOENT) return; // removed since the lstat
+    if (probe == 0 || probe == EAGAIN || probe == EINPROGRESS) {
+        throw std::system_error(EADDRINUSE, std::generic_category(), path + " is in use by a live listener");
+    }
+    if (probe != ECONNREFUSED) {
+        throw std::system_error(probe, std::generic_category(), "connect " + path);
+    }
+    if (::unlink(path.c_str()) != 0 && errno != ENOENT) {
+        throw std::system_error(errno, std::generic_category(), "unlink " + path);
+    }
+#else
+    (void)path;
+#endif
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <boost/asio/generic/stream_protocol.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "types.hpp"
+
+// ------------------------------------------------------------
+// Socket profiles
+// ------------------------------------------------------------
+//
+// Design:
+// - LATENCY: Nagle off, delayed acks off (TCP_QUICKACK, re-armed after each
+//   read since the kernel clears it), SO_BUSY_POLL on the receive path, OS
+//   default buffers. For order entry and fills.
+// - THROUGHPUT: Nagle off, 1 MiB buffers. For market data fan-out.
+// - BULK: Nagle on, 4 MiB buffers. For snapshots / replay style transfers.
+// - Send policy: LATENCY writes as soon as a message is queued (ASAP).
+//   THROUGHPUT and BULK cork (SOON): the first queued message opens a short
+//   window and the write goes out when it closes or once cork_bytes are
+//   queued, so a burst leaves as one large write instead of many small ones.
+// - Options the platform does not support (QUICKACK, BUSY_POLL, REUSEPORT
+//   outside Linux) are skipped; failures are logged, never thrown.
+//
+enum class SocketProfile : uint8_t {LATENCY, THROUGHPUT, BULK};
+
+// Session sockets are protocol-erased so TCP and Unix domain streams share
+// one Connection; a tcp::socket converts to it by move.
+using StreamSocket = boost::asio::generic::stream_protocol::socket;
+
+// True for TCP (IPv4/IPv6) sockets, the only ones profiles apply to.
+bool is_tcp_socket(const StreamSocket& socket) noexcept;
+
+struct SocketTuning {
+    bool no_delay;
+    bool quick_ack;
+    int busy_poll_us;   // 0 = leave unset
+    int rcvbuf_bytes;   // 0 = OS default
+    int sndbuf_bytes;   // 0 = OS default
+    SendMode send_mode;
+    int cork_window_us; // SOON only
+    int cork_bytes;     // SOON only; flush early once this much is queued
+};
+
+constexpr SocketTuning socket_tuning(SocketProfile profile) noexcept {
+    switch (profile) {
+        case SocketProfile::LATENCY:    return {true,  true,  50, 0,       0,       SendMode::ASAP, 0,  0};
+        case SocketProfile::THROUGHPUT: return {true,  false, 0,  1 << 20, 1 << 20, SendMode::SOON, 5,  16 << 10};
+        case SocketProfile::BULK:       return {false, false, 0,  4 << 20, 4 << 20, SendMode::SOON, 50, 48 << 10};
+    }
+    return {true, false, 0, 0, 0, SendMode::ASAP, 0, 0};
+}
+
+const char* socket_profile_name(SocketProfile profile) noexcept;
+
+// Accepts "latency", "throughput" or "bulk"; returns false otherwise.
+bool parse_socket_profile(std::string_view name, SocketProfile& out) noexcept;
+
+void apply_socket_profile(StreamSocket& socket, SocketProfile profile) noexcept;
+
+// TCP_QUICKACK is not sticky on Linux; call after each read. No-op elsewhere.
+void rearm_quick_ack(StreamSocket& socket) noexcept;
+
+// Opens, configures (SO_REUSEADDR, plus SO_REUSEPORT where available when
+// reuse_port is set), binds and listens. reuse_port is for one acceptor per
+// shard on the same port; without it a second process binding the port fails
+// instead of silently sharing it. Throws boost::system::system_error like the
+// endpoint constructor.
+void open_listening_acceptor(boost::asio::ip::tcp::acceptor& acceptor, const boost::asio::ip::tcp::endpoint& endpoint,
+                             bool reuse_port = false);
+
+// Clears a Unix domain socket path before bind. A socket file is removed only
+// if it is stale: a connect() to it is refused, so nothing listens there. If
+// something accepts (or its backlog is full) this throws std::system_error
+// with EADDRINUSE; anything other than a socket at the path (regular file,
+// directory, symlink) throws EEXIST. Nothing at the path is a no-op.
+void remove_stale_socket_file(const std::string& path);
@@ -17,12 +17,16 @@ class SPSCQueue {
         SPSCQueue(const SPSCQueue&) = delete;
         SPSCQueue& operator=(const SPSCQueue&) = delete;
 
+        // Producer side. The consumer's tail is re-read only when the queue
+        // looks full from the cached copy, so a non-full queue costs no
+        // cross-core traffic beyond publishing head.
         inline bool try_push(const T& item) noexcept {
             const size_t head = head_.load(std::memory_order_relaxed);
-            const size_t tail = tail_.load(std::memory_order_acquire);
-
-            if ((head - tail) >= CapacityPow2) {
-                return false;
+            if ((head - cached_tail_) >= CapacityPow2) {
+                cached_tail_ = tail_.load(std::memory_order_acquire);
+                if ((head - cached_tail_) >= CapacityPow2) {
+                    return false;
+                }
             }
 
             buffer_[head & mask_] = item;
@@ -34,12 +38,30 @@ class SPSCQueue {
             return try_push(static_cast<const T&>(item));
         }
 
+        // Pushes up to n items with a single release store; returns how many.
+        inline size_t try_push_n(const T* items, size_t n) noexcept {
+            const size_t head = head_.load(std::memory_order_relaxed);
+            size_t free_slots = CapacityPow2 - (head - cached_tail_);
+            if (free_slots < n) {
+                cached_tail_ = tail_.load(std::memory_order_acquire);
+                free_slots = CapacityPow2 - (head - cached_tail_);
+            }
+            const size_t count = n < free_slots ? n : free_slots;
+            for (size_t i = 0; i < count; ++i) {
+                buffer_[(head + i) & mask_] = items[i];
+            }
+            if (count) head_.store(head + count, std::memory_order_release);
+            return count;
+        }
+
+        // Consumer side; head is re-read only when the cached copy says empty.
         inline bool try_pop(T& out) noexcept {
             const size_t tail = tail_.load(std::memory_order_relaxed);
-            const size_t head = head_.load(std::memory_order_acquire);
-
-            if (tail == head) {
-                return false;
+            if (tail == cached_head_) {
+                cached_head_ = head_.load(std::memory_order_acquire);
+                if (tail == cached_head_) {
+                    return false;
+                }
             }
 
             out = buffer_[tail & mask_];
@@ -47,20 +69,46 @@ class SPSCQueue {
             return true;
         }
 
-        inline const T* peek() const noexcept {
+        // Pops up to max items into out with a single release store.
+        inline size_t pop_n(T* out, size_t max) noexcept {
             const size_t tail = tail_.load(std::memory_order_relaxed);
-            const size_t head = head_.load(std::memory_order_acquire);
+            const size_t count = available_(tail, max);
+            for (size_t i = 0; i < count; ++i) {
+                out[i] = buffer_[(tail + i) & mask_];
+            }
+            if (count) tail_.store(tail + count, std::memory_order_release);
+            return count;
+        }
 
-            if (tail == head) return nullptr;
+        inline const T* peek() const noexcept {
+            const size_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail == cached_head_) {
+                cached_head_ = head_.load(std::memory_order_acquire);
+                if (tail == cached_head_) return nullptr;
+            }
             return &buffer_[tail & mask_];
         }
 
+        // Up to max readable items starting at first, contiguous in memory
+        // (stops at the wrap point). Release them with consume_n().
+        inline size_t peek_n(const T*& first, size_t max) const noexcept {
+            const size_t tail = tail_.load(std::memory_order_relaxed);
+            const size_t to_end = CapacityPow2 - (tail & mask_);
+            const size_t count = available_(tail, max < to_end ? max : to_end);
+            first = &buffer_[tail & mask_];
+            return count;
+        }
+
         inline bool consume_one() noexcept {
+            return consume_n(1) == 1;
+        }
+
+        // Releases up to n items previously seen through peek / peek_n.
+        inline size_t consume_n(size_t n) noexcept {
             const size_t tail = tail_.load(std::memory_order_relaxed);
-            const size_t head = head_.load(std::memory_order_acquire);
-            if (tail == head) return false;
-            tail_.store(tail + 1, std::memory_order_release);
-            return true;
+            const size_t count = available_(tail, n);
+            if (count) tail_.store(tail + count, std::memory_order_release);
+            return count;
         }
 
         inline size_t size_approx() const noexcept {
@@ -74,8 +122,20 @@ class SPSCQueue {
     private:
         static constexpr size_t mask_ = CapacityPow2 - 1;
 
+        // Consumer only: readable items from tail, capped at max.
+        inline size_t available_(size_t tail, size_t max) const noexcept {
+            if (cached_head_ - tail < max) {
+                cached_head_ = head_.load(std::memory_order_acquire);
+            }
+            const size_t readable = cached_head_ - tail;
+            return readable < max ? readable : max;
+        }
+
+        // Each side's index shares a line with its cached copy of the other's.
         alignas(64) std::atomic<size_t> head_{0}; // written by producer, read by consumer
+        size_t cached_tail_ = 0;                 // producer only
         alignas(64) std::atomic<size_t> tail_{0}; // written by consumer, read by producer
+        mutable size_t cached_head_ = 0;         // consumer only
 
         alignas(64) std::array<T, CapacityPow2> buffer_{};
 };
@@ -0,0 +1,315 @@
+#include "thread_affinity.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+#if defined(_WIN32)
+    #ifndef NOMINMAX
+    #define NOMINMAX
+    #endif
+    #include <windows.h>
+#elif defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/resource.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+    #include <cerrno>
+    #include <cstring>
+#endif
+
+namespace {
+
+struct RoleRegistry {
+    std::mutex mtx;
+    std::condition_variable cv;
+    ThreadTopology topology;
+    std::vector<ThreadRoleReport> reports;
+};
+
+RoleRegistry& role_registry() {
+    static RoleRegistry registry;
+    return registry;
+}
+
+bool parse_number(std::string_view text, long& out) noexcept {
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), out);
+    return !text.empty() && result.ec == std::errc{} && result.ptr == text.data() + text.size();
+}
+
+// "3", "3-5", "1,4,6-7".
+bool parse_cpu_list(std::string_view text, std::vector<size_t>& out) {
+    out.clear();
+    while (!text.empty()) {
+        const size_t comma = text.find(',');
+        const std::string_view item = text.substr(0, comma);
+        text = comma == std::string_view::npos ? std::string_view{} : text.substr(comma + 1);
+
+        const size_t dash = item.find('-');
+        long first = 0;
+        long last = 0;
+        if (dash == std::string_view::npos) {
+            if (!parse_number(item, first)) return false;
+            last = first;
+        } else if (!parse_number(item.substr(0, dash), first) || !parse_number(item.substr(dash + 1), last)) {
+            return false;
+        }
+        if (first < 0 || last < first) return false;
+        for (long cpu = first; cpu <= last; ++cpu) {
+            out.push_back(static_cast<size_t>(cpu));
+        }
+    }
+    return !out.empty();
+}
+
+void name_current_thread(const std::string& role) noexcept {
+#if defined(__linux__)
+    // The kernel keeps 15 characters.
+    char name[16] = {};
+    const std::string full = "tg:" + role;
+    full.copy(name, sizeof(name) - 1);
+    pthread_setname_np(pthread_self(), name);
+#else
+    (void)role;
+#endif
+}
+
+// Empty string on success.
+std::string apply_sched_policy(SchedPolicy policy, int priority) {
+#if defined(_WIN32)
+    int level = THREAD_PRIORITY_NORMAL;
+    if (policy == SchedPolicy::FIFO || policy == SchedPolicy::RR) {
+        level = THREAD_PRIORITY_TIME_CRITICAL;
+    } else {
+        // Windows priorities grow upwards, nice values downwards.
+        level = priority < -2 ? 2 : priority > 2 ? -2 : -priority;
+    }
+    if (level == THREAD_PRIORITY_NORMAL) return {};
+    return SetThreadPriority(GetCurrentThread(), level) ? std::string{} : "SetThreadPriority failed";
+#elif defined(__linux__)
+    sched_param param{};
+    int native = SCHED_OTHER;
+    switch (policy) {
+        case SchedPolicy::OTHER: native = SCHED_OTHER; break;
+        case SchedPolicy::BATCH: native = SCHED_BATCH; break;
+        case SchedPolicy::FIFO:  native = SCHED_FIFO;  param.sched_priority = priority; break;
+        case SchedPolicy::RR:    native = SCHED_RR;    param.sched_priority = priority; break;
+    }
+    if (policy == SchedPolicy::OTHER && priority == 0) return {};
+    if (const int rc = pthread_setschedparam(pthread_self(), native, &param); rc != 0) {
+        return std::string("pthread_setschedparam: ") + std::strerror(rc);
+    }
+    if ((policy == SchedPolicy::OTHER || policy == SchedPolicy::BATCH) && priority != 0) {
+        // Per-thread nice value.
+        const auto tid = static_cast<id_t>(::syscall(SYS_gettid));
+        if (::setpriority(PRIO_PROCESS, tid, priority) != 0) {
+            return std::string("setpriority: ") + std::strerror(errno);
+        }
+    }
+    return {};
+#else
+    if (policy == SchedPolicy::OTHER && priority == 0) return {};
+    return "scheduling policy not supported on this platform";
+#endif
+}
+
+} // namespace
+
+size_t hardware_cpu_count() noexcept {
+    const unsigned n = std::thread::hardware_concurrency();
+    return n ? static_cast<size_t>(n) : 1;
+}
+
+bool pin_current_thread(size_t cpu) noexcept {
+#if defined(_WIN32)
+    if (cpu >= sizeof(DWORD_PTR) * 8) return false;
+    return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{1} << cpu) != 0;
+#elif defined(__linux__)
+    if (cpu >= CPU_SETSIZE) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+bool pin_current_thread(const std::vector<size_t>& cpus) noexcept {
+    if (cpus.empty()) return true;
+#if defined(_WIN32)
+    DWORD_PTR mask = 0;
+    for (size_t cpu : cpus) {
+        if (cpu >= sizeof(DWORD_PTR) * 8) return false;
+        mask |= DWORD_PTR{1} << cpu;
+    }
+    return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t cpu : cpus) {
+        if (cpu >= CPU_SETSIZE) return false;
+        CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+const char* sched_policy_name(SchedPolicy policy) noexcept {
+    switch (policy) {
+        case SchedPolicy::OTHER: return "other";
+        case SchedPolicy::BATCH: return "batch";
+        case SchedPolicy::FIFO:  return "fifo";
+        case SchedPolicy::RR:    return "rr";
+    }
+    return "unknown";
+}
+
+bool parse_sched_policy(std::string_view name, SchedPolicy& out) noexcept {
+    if (name == "other") { out = SchedPolicy::OTHER; return true; }
+    if (name == "batch") { out = SchedPolicy::BATCH; return true; }
+    if (name == "fifo")  { out = SchedPolicy::FIFO;  return true; }
+    if (name == "rr")    { out = SchedPolicy::RR;    return true; }
+    return false;
+}
+
+bool ThreadTopology::parse(std::string_view text, ThreadTopology& out, std::string& error) {
+    ThreadTopology parsed;
+    std::istringstream lines{std::string(text)};
+    std::string line;
+    while (std::getline(lines, line)) {
+        const size_t hash = line.find('#');
+        if (hash != std::string::npos) line.resize(hash);
+
+        std::istringstream tokens(line);
+        std::string role;
+        if (!(tokens >> role)) continue;
+
+        ThreadPlacement placement;
+        std::string token;
+        bool ok = true;
+        while (ok && tokens >> token) {
+            const size_t eq = token.find('=');
+            const std::string_view key = std::string_view(token).substr(0, eq);
+            const std::string_view value = eq == std::string::npos ? std::string_view{} : std::string_view(token).substr(eq + 1);
+            long priority = 0;
+            if (key == "cpus") {
+                ok = parse_cpu_list(value, placement.cpus);
+            } else if (key == "policy") {
+                ok = parse_sched_policy(value, placement.policy);
+            } else if (key == "priority") {
+                ok = parse_number(value, priority);
+                placement.priority = static_cast<int>(priority);
+            } else {
+                ok = false;
+            }
+        }
+        const bool realtime = placement.policy == SchedPolicy::FIFO || placement.policy == SchedPolicy::RR;
+        if (realtime && (placement.priority < 1 || placement.priority > 99)) ok = false;
+        if (!realtime && (placement.priority < -20 || placement.priority > 19)) ok = false;
+        if (!ok) {
+            error = "invalid thread topology line: " + line;
+            return false;
+        }
+        parsed.set(role, std::move(placement));
+    }
+    out = std::move(parsed);
+    return true;
+}
+
+bool ThreadTopology::load(const std::string& path, ThreadTopology& out, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "cannot open thread topology file " + path;
+        return false;
+    }
+    std::ostringstream text;
+    text << file.rdbuf();
+    return parse(text.str(), out, error);
+}
+
+void ThreadTopology::set(const std::string& role, ThreadPlacement placement) {
+    roles_[role] = std::move(placement);
+}
+
+const ThreadPlacement* ThreadTopology::find(std::string_view role) const noexcept {
+    auto it = roles_.find(role);
+    if (it != roles_.end()) return &it->second;
+
+    size_t family = role.size();
+    while (family > 0 && std::isdigit(static_cast<unsigned char>(role[family - 1]))) --family;
+    if (family == role.size() || family == 0) return nullptr;
+    it = roles_.find(role.substr(0, family));
+    return it != roles_.end() ? &it->second : nullptr;
+}
+
+void set_thread_topology(ThreadTopology topology) {
+    RoleRegistry& registry = role_registry();
+    std::lock_guard<std::mutex> lock(registry.mtx);
+    registry.topology = std::move(topology);
+}
+
+ThreadPlacement thread_placement_for(std::string_view role, std::optional<size_t> default_cpu) {
+    RoleRegistry& registry = role_registry();
+    std::lock_guard<std::mutex> lock(registry.mtx);
+    if (const ThreadPlacement* configured = registry.topology.find(role)) {
+        return *configured;
+    }
+    ThreadPlacement placement;
+    if (default_cpu) placement.cpus = {*default_cpu};
+    return placement;
+}
+
+void enter_thread_role(const std::string& role, std::optional<size_t> default_cpu) noexcept {
+    try {
+        RoleRegistry& registry = role_registry();
+        const ThreadPlacement placement = thread_placement_for(role, default_cpu);
+
+        name_current_thread(role);
+
+        ThreadRoleReport report;
+        report.role = role;
+        report.policy = placement.policy;
+        report.priority = placement.priority;
+        if (pin_current_thread(placement.cpus)) {
+            report.cpus = placement.cpus;
+        } else {
+            report.error = "could not set CPU affinity";
+        }
+        const std::string sched_error = apply_sched_policy(placement.policy, placement.priority);
+        if (!sched_error.empty()) {
+            report.error += (report.error.empty() ? "" : "; ") + sched_error;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(registry.mtx);
+            registry.reports.push_back(std::move(report));
+        }
+        registry.cv.notify_all();
+    } catch (...) {
+        // Placement is best effort; never take a thread down over it.
+    }
+}
+
+std::vector<ThreadRoleReport> thread_role_reports(const std::vector<std::string>& expected,
+                                                  std::chrono::milliseconds timeout) {
+    RoleRegistry& registry = role_registry();
+    std::unique_lock<std::mutex> lock(registry.mtx);
+    registry.cv.wait_for(lock, timeout, [&registry, &expected] {
+        return std::all_of(expected.begin(), expected.end(), [&registry](const std::string& role) {
+            return std::any_of(registry.reports.begin(), registry.reports.end(),
+                               [&role](const ThreadRoleReport& r) { return r.role == role; });
+        });
+    });
+    return registry.reports;
+}
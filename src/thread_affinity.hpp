@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Number of logical CPUs visible to the process (at least 1).
+size_t hardware_cpu_count() noexcept;
+
+// Pins the calling thread to one logical CPU. Returns false (and leaves the
+// thread unpinned) if the platform refuses or cpu is out of range.
+bool pin_current_thread(size_t cpu) noexcept;
+
+// Restricts the calling thread to a set of logical CPUs. An empty set is a
+// no-op; false if the platform refuses or a cpu is out of range.
+bool pin_current_thread(const std::vector<size_t>& cpus) noexcept;
+
+// ------------------------------------------------------------
+// Thread topology
+// ------------------------------------------------------------
+//
+// Names every long-lived thread by role and gives each role a CPU set,
+// scheduling policy and priority.
+//
+// Design:
+// - Roles: engine, io<N> (falls back to io), logger, metrics, clock,
+//   shm_io, shm_poll. A role with no entry keeps its built-in default (the
+//   CPU Application would have pinned it to, otherwise none).
+// - Config text, one role per line, '#' starts a comment:
+//       engine   cpus=2      policy=fifo priority=80
+//       io       cpus=3-5
+//       logger   cpus=7      policy=other priority=10
+//   priority is the realtime priority (1-99) for fifo / rr and the nice
+//   value for other / batch. On Windows fifo / rr map to time-critical and
+//   other priorities are clamped to -2..2.
+// - One process-wide topology, installed before any thread starts. Threads
+//   apply it themselves first thing (enter_thread_role) and record the
+//   outcome, which Application prints at startup. Failures (no CAP_SYS_NICE,
+//   CPU out of range) are reported, never thrown; the thread runs on.
+//
+enum class SchedPolicy : uint8_t {OTHER, BATCH, FIFO, RR};
+
+const char* sched_policy_name(SchedPolicy policy) noexcept;
+bool parse_sched_policy(std::string_view name, SchedPolicy& out) noexcept;
+
+struct ThreadPlacement {
+    std::vector<size_t> cpus; // empty: any CPU
+    SchedPolicy policy = SchedPolicy::OTHER;
+    int priority = 0;
+};
+
+class ThreadTopology {
+    public:
+        // Parses config text (see above). On failure returns false and sets
+        // error to the offending line.
+        static bool parse(std::string_view text, ThreadTopology& out, std::string& error);
+        static bool load(const std::string& path, ThreadTopology& out, std::string& error);
+
+        void set(const std::string& role, ThreadPlacement placement);
+        // Exact role first, then its family ("io3" -> "io").
+        const ThreadPlacement* find(std::string_view role) const noexcept;
+        bool empty() const noexcept { return roles_.empty(); }
+
+    private:
+        std::map<std::string, ThreadPlacement, std::less<>> roles_;
+};
+
+struct ThreadRoleReport {
+    std::string role;
+    std::vector<size_t> cpus; // as applied; empty = any
+    SchedPolicy policy = SchedPolicy::OTHER;
+    int priority = 0;
+    std::string error;        // empty when everything applied
+};
+
+// Installs the process-wide topology. Call before starting threads.
+void set_thread_topology(ThreadTopology topology);
+
+// The configured placement of role, or default_cpu (if any) alone.
+ThreadPlacement thread_placement_for(std::string_view role, std::optional<size_t> default_cpu = std::nullopt);
+
+// Names the calling thread after role and applies the configured placement,
+// or pins to default_cpu when the role is not configured. Records the
+// outcome for thread_role_reports().
+void enter_thread_role(const std::string& role, std::optional<size_t> default_cpu = std::nullopt) noexcept;
+
+// Reports recorded so far, in arrival order, after waiting up to timeout for
+// every role in expected to have reported.
+std::vector<ThreadRoleReport> thread_role_reports(const std::vector<std::string>& expected = {},
+                                                  std::chrono::milliseconds timeout = std::chrono::milliseconds{0});
@@ -17,6 +17,15 @@ static constexpr Price_t MAXIMUM_ASK = 10'000;
 static constexpr size_t NUM_BOOK_LEVELS = MAXIMUM_ASK - MINIMUM_BID + 1;
 static constexpr size_t ORDER_BOOK_MESSAGE_DEPTH = 10;
 static constexpr size_t MAX_TRADES_PER_TICK = 100;
+constexpr size_t MAX_CONNECTIONS = 1 << 5;
+// Connection ids are a slot below MAX_CONNECTIONS plus a per-slot generation
+// times MAX_CONNECTIONS, so slots are reused but ids are not.
+// Constants here stay plain integer expressions: the Python client
+// (python/exchange/util) evaluates them to build its codec.
+constexpr Id_t NO_CONNECTION_ID = 0xFFFF'FFFF; // the largest Id_t
+static_assert(NO_CONNECTION_ID == static_cast<Id_t>(-1), "NO_CONNECTION_ID must be the largest Id_t.");
+inline constexpr size_t connection_slot(Id_t id) noexcept { return static_cast<size_t>(id) & (MAX_CONNECTIONS - 1); }
+static_assert((MAX_CONNECTIONS & (MAX_CONNECTIONS - 1)) == 0, "MAX_CONNECTIONS must be a power of two.");
 constexpr size_t ERROR_TEXT_LEN = 32;
 
 enum class Lifespan : uint8_t {FILL_AND_KILL, GOOD_FOR_DAY};
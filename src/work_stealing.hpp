@@ -0,0 +1,108 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ------------------------------------------------------------
+// WorkStealingScheduler
+// ------------------------------------------------------------
+//
+// Runs a batch of independent, coarse tasks (whole simulations, sweeps) on a
+// fixed number of worker threads.
+//
+// Design:
+// - Each worker owns a deque of task indices, dealt round-robin up front. It
+//   takes from the back of its own and, once that is empty, steals from the
+//   front of the others, starting at a different victim per worker; long
+//   tasks no longer pin the batch to whichever worker drew them.
+// - Deques are mutex-guarded: tasks run for milliseconds or more, so a lock
+//   per pop is noise and the structure stays obviously correct.
+// - Tasks do not spawn tasks, so a worker that finds every deque empty is
+//   done. The first exception stops the batch and is rethrown by run().
+//
+class WorkStealingScheduler {
+    public:
+        // threads == 0: one per hardware thread.
+        explicit WorkStealingScheduler(size_t threads = 0)
+        : threads_(threads ? threads : std::max<size_t>(1, std::thread::hardware_concurrency())) {}
+
+        size_t threads() const { return threads_; }
+        // Tasks taken from another worker's deque in the last run().
+        uint64_t steals() const { return steals_.load(std::memory_order_relaxed); }
+
+        // Calls task(index, worker) for every index in [0, count) and returns
+        // when all have run.
+        template <typename F>
+        void run(size_t count, F&& task) {
+            const size_t workers = std::min(threads_, std::max<size_t>(count, 1));
+            std::vector<std::unique_ptr<WorkerQueue>> queues;
+            queues.reserve(workers);
+            for (size_t w = 0; w < workers; ++w) queues.push_back(std::make_unique<WorkerQueue>());
+            for (size_t idx = 0; idx < count; ++idx) queues[idx % workers]->tasks.push_back(idx);
+
+            steals_.store(0, std::memory_order_relaxed);
+            std::atomic<bool> failed{false};
+            std::exception_ptr error;
+            std::mutex error_mutex;
+
+            auto worker = [&](size_t self) {
+                size_t idx;
+                while (!failed.load(std::memory_order_relaxed) && next_(queues, self, idx)) {
+                    try {
+                        task(idx, self);
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(error_mutex);
+                        if (!error) error = std::current_exception();
+                        failed.store(true, std::memory_order_relaxed);
+                    }
+                }
+            };
+
+            std::vector<std::thread> pool;
+            pool.reserve(workers - 1);
+            for (size_t w = 1; w < workers; ++w) pool.emplace_back(worker, w);
+            worker(0);
+            for (auto& t : pool) t.join();
+
+            if (error) std::rethrow_exception(error);
+        }
+
+    private:
+        struct alignas(64) WorkerQueue {
+            std::mutex mutex;
+            std::deque<size_t> tasks;
+        };
+
+        bool next_(std::vector<std::unique_ptr<WorkerQueue>>& queues, size_t self, size_t& out) {
+            {
+                WorkerQueue& own = *queues[self];
+                std::lock_guard<std::mutex> lock(own.mutex);
+                if (!own.tasks.empty()) {
+                    out = own.tasks.back();
+                    own.tasks.pop_back();
+                    return true;
+                }
+            }
+            for (size_t i = 1; i < queues.size(); ++i) {
+                WorkerQueue& victim = *queues[(self + i) % queues.size()];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (!victim.tasks.empty()) {
+                    out = victim.tasks.front();
+                    victim.tasks.pop_front();
+                    steals_.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        size_t threads_;
+        std::atomic<uint64_t> steals_{0};
+};
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "order_book.hpp"
+
+// ------------------------------------------------------------
+// Book workload
+// ------------------------------------------------------------
+//
+// Shared by the order book tests.
+// - EventLog records every callback as a flat list of numbers, so two books
+//   fed the same commands can be compared event for event.
+// - Workload replays a seeded mix of inserts, cancels and amends around a
+//   mid price; the same seed always produces the same commands.
+//
+struct EventLog final : OrderBookCallbacks {
+    std::vector<uint64_t> events;
+    std::vector<Id_t> inserted; // ids of orders that rested, for cancels and amends
+
+    void clear() {
+        events.clear();
+        inserted.clear();
+    }
+
+    void on_trade(const Order& maker, Id_t taker_client_id, Id_t taker_order_id, Price_t price,
+                  Volume_t taker_total, Volume_t taker_cumulative, Volume_t traded, Time_t timestamp) override {
+        add({1, maker.order_id_, taker_client_id, taker_order_id, static_cast<uint64_t>(price),
+             taker_total, taker_cumulative, traded, timestamp});
+    }
+    void on_order_inserted(Id_t client_request_id, const Order& order, Time_t timestamp) override {
+        add({2, client_request_id, order.order_id_, static_cast<uint64_t>(order.price_),
+             order.quantity_remaining_, timestamp});
+        inserted.push_back(order.order_id_);
+    }
+    void on_order_cancelled(Id_t client_request_id, const Order& order, Time_t timestamp) override {
+        add({3, client_request_id, order.order_id_, timestamp});
+    }
+    void on_order_amended(Id_t client_request_id, Volume_t quantity_old, const Order& order, Time_t timestamp) override {
+        add({4, client_request_id, quantity_old, order.order_id_, order.quantity_, timestamp});
+    }
+    void on_level_update(Side side, PriceLevel const& level, Time_t timestamp) override {
+        add({5, static_cast<uint64_t>(side), static_cast<uint64_t>(level.price_), level.total_quantity_, timestamp});
+    }
+    void on_error(Id_t client_id, Id_t client_request_id, uint16_t code, std::string_view, Time_t timestamp) override {
+        add({6, client_id, client_request_id, code, timestamp});
+    }
+
+    private:
+        void add(std::initializer_list<uint64_t> fields) { events.insert(events.end(), fields); }
+};
+
+struct Workload {
+    uint64_t state;
+    Price_t mid = 5000;
+    Price_t half_width = 40; // limit prices within mid +- half_width
+
+    explicit Workload(uint64_t seed) : state(seed ? seed : 1) {}
+
+    uint64_t next() noexcept {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    // One command: 60% inserts (some crossing), 30% cancels, 10% amends.
+    // Cancels and amends pick any order that ever rested, so some target
+    // filled orders and exercise the error path.
+    template <typename Book>
+    void step(Book& book, EventLog& log, Time_t t) {
+        const uint64_t r = next();
+        const Id_t client = static_cast<Id_t>((r >> 40) % 3);
+        const Id_t request = static_cast<Id_t>(t);
+        const unsigned action = r % 10;
+        if (action < 6 || log.inserted.empty()) {
+            const bool is_bid = (r >> 8) & 1;
+            const Price_t offset = static_cast<Price_t>((r >> 16) % static_cast<uint64_t>(2 * half_width)) - half_width / 4;
+            const Price_t price = is_bid ? mid - offset : mid + 1 + offset;
+            book.submit_order(price, static_cast<Volume_t>(1 + (r >> 32) % 50), is_bid, client, request, t);
+            return;
+        }
+        const size_t k = (r >> 16) % log.inserted.size();
+        const Id_t order_id = log.inserted[k];
+        log.inserted[k] = log.inserted.back();
+        log.inserted.pop_back();
+        if (action < 9) {
+            book.cancel_order(client, request, order_id, t);
+        } else {
+            book.amend_order(client, request, order_id, static_cast<Volume_t>(1 + (r >> 32) % 30), t);
+        }
+    }
+};
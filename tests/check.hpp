@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdlib>
+#include <iostream>
+
+// ------------------------------------------------------------
+// Test checks
+// ------------------------------------------------------------
+//
+// CHECK(cond) reports a failing condition with its location and carries on,
+// so one run lists every failure. A test's main() returns test_result():
+// non-zero if any check failed. Unlike assert(), checks stay on in release
+// builds.
+//
+namespace test_detail {
+    inline int failures = 0;
+
+    inline void fail(const char* expr, const char* file, int line) {
+        ++failures;
+        std::cerr << file << ':' << line << ": CHECK(" << expr << ") failed\n";
+    }
+}
+
+#define CHECK(cond) \
+    do { if (!(cond)) test_detail::fail(#cond, __FILE__, __LINE__); } while (0)
+
+inline int test_result() {
+    if (test_detail::failures) {
+        std::cerr << test_detail::failures << " check(s) failed\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,216 @@
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+
+#include "logging.hpp"
+#include "client_book.hpp"
+#include "order_book.hpp"
+#include "book_workload.hpp"
+#include "check.hpp"
+
+// ClientBook against a std::map per side (best price, level count, volumes,
+// for_each_level order and early stop), with the bitmap's word and summary
+// boundaries targeted directly; then a ClientBook fed the level updates of a
+// real OrderBook must track its levels.
+namespace {
+
+using Levels = std::vector<std::pair<Price_t, Volume_t>>;
+
+Levels levels_of(const ClientBookSide& side, size_t limit = NUM_BOOK_LEVELS) {
+    Levels out;
+    side.for_each_level([&](Price_t price, Volume_t volume) {
+        out.push_back({price, volume});
+        return out.size() < limit;
+    });
+    return out;
+}
+
+template <typename Map>
+Levels levels_of(const Map& side, bool is_bid, size_t limit = NUM_BOOK_LEVELS) {
+    Levels out;
+    if (is_bid) {
+        for (auto it = side.rbegin(); it != side.rend() && out.size() < limit; ++it) out.push_back(*it);
+    } else {
+        for (auto it = side.begin(); it != side.end() && out.size() < limit; ++it) out.push_back(*it);
+    }
+    return out;
+}
+
+template <typename Map>
+bool side_matches(const ClientBookSide& side, const Map& model) {
+    std::optional<Price_t> best;
+    if (!model.empty()) best = side.is_bid() ? model.rbegin()->first : model.begin()->first;
+    return side.best_price() == best
+        && side.best_volume() == (best ? model.at(*best) : 0)
+        && side.empty() == model.empty()
+        && side.num_levels() == model.size()
+        && levels_of(side) == levels_of(model, side.is_bid())
+        && levels_of(side, 5) == levels_of(model, side.is_bid(), 5);
+}
+
+void test_matches_map() {
+    auto book = std::make_unique<ClientBook>();
+    std::map<Price_t, Volume_t> bids;
+    std::map<Price_t, Volume_t> asks;
+    Workload rng(88172645463325252ull);
+
+    for (size_t i = 0; i < 400'000; ++i) {
+        const uint64_t r = rng.next();
+        const bool is_bid = r & 1;
+        // Mostly near the touch, sometimes anywhere, sometimes out of range.
+        Price_t price;
+        switch ((r >> 4) % 8) {
+            case 0: price = MINIMUM_BID + static_cast<Price_t>((r >> 8) % NUM_BOOK_LEVELS); break;
+            case 1: price = (r >> 8) & 1 ? MINIMUM_BID - 1 : MAXIMUM_ASK + 1; break;
+            default: price = 4900 + static_cast<Price_t>((r >> 8) % 300); break;
+        }
+        const Volume_t volume = (r >> 20) % 3 == 0 ? 0 : static_cast<Volume_t>(1 + (r >> 24) % 100);
+
+        (is_bid ? book->bids : book->asks).set(price, volume);
+        if (price >= MINIMUM_BID && price <= MAXIMUM_ASK) {
+            auto& model = is_bid ? bids : asks;
+            if (volume) {
+                model[price] = volume;
+            } else {
+                model.erase(price);
+            }
+        }
+        CHECK(book->volume_at(is_bid ? Side::BUY : Side::SELL, price) == (price >= MINIMUM_BID && price <= MAXIMUM_ASK ? volume : 0));
+
+        if (i % 1000 == 0) {
+            CHECK(side_matches(book->bids, bids));
+            CHECK(side_matches(book->asks, asks));
+        }
+        if (i % 100'000 == 99'999) {
+            book->bids.clear();
+            book->asks.clear();
+            bids.clear();
+            asks.clear();
+            CHECK(side_matches(book->bids, bids));
+            CHECK(book->asks.volume_at(4950) == 0);
+        }
+    }
+}
+
+// Best-level repair when the touch empties: the next level sits in the same
+// word, the next word, across the summary boundary (64 words) or at the far
+// end of the range.
+void test_bitmap_boundaries() {
+    const std::vector<Price_t> prices = {
+        MINIMUM_BID, MINIMUM_BID + 1, MINIMUM_BID + 62, MINIMUM_BID + 63, MINIMUM_BID + 64, MINIMUM_BID + 65,
+        MINIMUM_BID + 4095, MINIMUM_BID + 4096, MINIMUM_BID + 4097, MINIMUM_BID + 8191, MINIMUM_BID + 8192,
+        MAXIMUM_ASK - 64, MAXIMUM_ASK - 1, MAXIMUM_ASK,
+    };
+    for (bool is_bid : {true, false}) {
+        // Remove levels best-first: each removal makes the next one the best.
+        auto side = std::make_unique<ClientBookSide>(is_bid);
+        std::map<Price_t, Volume_t> model;
+        for (Price_t p : prices) {
+            side->set(p, static_cast<Volume_t>(p));
+            model[p] = static_cast<Volume_t>(p);
+        }
+        CHECK(side_matches(*side, model));
+        while (!model.empty()) {
+            const Price_t best = is_bid ? model.rbegin()->first : model.begin()->first;
+            side->set(best, 0);
+            model.erase(best);
+            CHECK(side_matches(*side, model));
+        }
+
+        // Two levels at a time, one at each end, with everything between empty.
+        for (size_t a = 0; a < prices.size(); ++a) {
+            for (size_t b = a + 1; b < prices.size(); ++b) {
+                side->clear();
+                side->set(prices[a], 1);
+                side->set(prices[b], 2);
+                side->set(is_bid ? prices[b] : prices[a], 0);
+                const Price_t survivor = is_bid ? prices[a] : prices[b];
+                const Levels expected(1, {survivor, is_bid ? 1u : 2u});
+                CHECK(side->best_price() == survivor);
+                CHECK(levels_of(*side) == expected);
+            }
+        }
+    }
+}
+
+// Forwards the real book's level updates to a ClientBook, as the feed does.
+struct FeedToClientBook final : OrderBookCallbacks {
+    ClientBook* client = nullptr;
+    EventLog log;
+
+    void on_trade(const Order& maker, Id_t c, Id_t o, Price_t p, Volume_t a, Volume_t b, Volume_t q, Time_t t) override {
+        log.on_trade(maker, c, o, p, a, b, q, t);
+    }
+    void on_order_inserted(Id_t r, const Order& order, Time_t t) override { log.on_order_inserted(r, order, t); }
+    void on_order_cancelled(Id_t r, const Order& order, Time_t t) override { log.on_order_cancelled(r, order, t); }
+    void on_order_amended(Id_t r, Volume_t q, const Order& order, Time_t t) override { log.on_order_amended(r, q, order, t); }
+    void on_level_update(Side side, PriceLevel const& level, Time_t timestamp) override {
+        PayloadPriceLevelUpdate update{};
+        update.side = side;
+        update.price = level.price_;
+        update.total_volume = level.total_quantity_;
+        update.timestamp = timestamp;
+        client->on_price_level_update(&update);
+    }
+    void on_error(Id_t c, Id_t r, uint16_t code, std::string_view m, Time_t t) override { log.on_error(c, r, code, m, t); }
+};
+
+void test_tracks_order_book() {
+    auto book = std::make_unique<OrderBook>();
+    auto client = std::make_unique<ClientBook>();
+    FeedToClientBook feed;
+    feed.client = client.get();
+    book->set_callbacks(&feed);
+    Workload workload(31);
+    workload.half_width = 120;
+
+    for (size_t i = 0; i < 30'000; ++i) {
+        workload.step(*book, feed.log, i);
+        if (i % 500 != 0) continue;
+
+        bool levels_match = true;
+        for (Price_t price = 5000 - 200; price <= 5000 + 200; ++price) {
+            const size_t idx = static_cast<size_t>(price - MINIMUM_BID);
+            levels_match &= client->volume_at(Side::BUY, price) == book->bids.level_quantity(idx);
+            levels_match &= client->volume_at(Side::SELL, price) == book->asks.level_quantity(idx);
+        }
+        CHECK(levels_match);
+        BookDepth depth;
+        book->build_depth(depth);
+        CHECK(client->best_bid_price() == (depth.bid_levels ? std::optional<Price_t>(depth.bid_prices[0]) : std::nullopt));
+        CHECK(client->best_ask_price() == (depth.ask_levels ? std::optional<Price_t>(depth.ask_prices[0]) : std::nullopt));
+        CHECK(client->bids.num_levels() == book->bids.num_active_levels_);
+        CHECK(client->asks.num_levels() == book->asks.num_active_levels_);
+    }
+
+    // A snapshot replaces whatever the client had.
+    PayloadOrderBookSnapshot snapshot{};
+    book->build_snapshot(snapshot.bid_volumes, snapshot.bid_prices, snapshot.ask_volumes, snapshot.ask_prices);
+    client->asks.set(MAXIMUM_ASK, 7); // stale level the snapshot must drop
+    client->on_order_book_snapshot(&snapshot);
+    Levels expected_bids;
+    for (size_t k = 0; k < ORDER_BOOK_MESSAGE_DEPTH && snapshot.bid_volumes[k]; ++k) {
+        expected_bids.push_back({snapshot.bid_prices[k], snapshot.bid_volumes[k]});
+    }
+    CHECK(levels_of(client->bids) == expected_bids);
+    CHECK(client->asks.volume_at(MAXIMUM_ASK) == 0);
+}
+
+}
+
+int main() {
+    boost::log::core::get()->set_filter(
+        boost::log::expressions::attr<LogLevel>("Severity") >= LogLevel::LL_ERROR
+    );
+    test_matches_map();
+    test_bitmap_boundaries();
+    test_tracks_order_book();
+    return test_result();
+}
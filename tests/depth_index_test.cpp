@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+
+#include "logging.hpp"
+#include "depth_index.hpp"
+#include "order_book.hpp"
+#include "book_workload.hpp"
+#include "check.hpp"
+
+// DepthIndex against plain per-level arrays (prefix sums, totals, descend()
+// on both sides of every boundary), then the book's depth queries
+// (volume_within, volume_crossing, sweep, build_depth) against linear walks
+// over the levels while a workload runs, across resets.
+namespace {
+
+using Sums = DepthIndex::Sums;
+
+// Reference: largest pos with prefix(pos) < target (<= when inclusive).
+size_t linear_descend(const std::vector<uint64_t>& volume, uint64_t target, bool inclusive) {
+    uint64_t running = 0;
+    size_t pos = 0;
+    while (pos < volume.size()) {
+        const uint64_t reached = running + volume[pos];
+        if (inclusive ? reached > target : reached >= target) break;
+        running = reached;
+        ++pos;
+    }
+    return pos;
+}
+
+void test_index_matches_arrays() {
+    auto index = std::make_unique<DepthIndex>();
+    std::vector<uint64_t> volume(DepthIndex::SIZE, 0);
+    Workload rng(11);
+
+    for (size_t episode = 0; episode < 3; ++episode) {
+        // Activity clustered in one band per episode, plus the two ends.
+        const size_t centre = 1000 + episode * 3000;
+        for (size_t i = 0; i < 20'000; ++i) {
+            const uint64_t r = rng.next();
+            size_t idx = (centre + (r >> 8) % 400) - 200;
+            if ((r & 63) == 0) idx = (r & 64) ? 0 : DepthIndex::SIZE - 1;
+            const bool remove = (r >> 4) % 3 == 0 && volume[idx] > 0;
+            const int64_t delta = remove
+                ? -static_cast<int64_t>(1 + (r >> 32) % volume[idx])
+                : static_cast<int64_t>(1 + (r >> 32) % 100);
+            index->add(idx, delta);
+            volume[idx] = static_cast<uint64_t>(static_cast<int64_t>(volume[idx]) + delta);
+
+            if (i % 50 != 0) continue;
+
+            std::vector<uint64_t> cumulative(DepthIndex::SIZE + 1, 0);
+            std::vector<uint64_t> notional(DepthIndex::SIZE + 1, 0);
+            for (size_t k = 0; k < DepthIndex::SIZE; ++k) {
+                cumulative[k + 1] = cumulative[k] + volume[k];
+                notional[k + 1] = notional[k] + volume[k] * static_cast<uint64_t>(MINIMUM_BID + static_cast<Price_t>(k));
+            }
+            CHECK(index->total().volume == cumulative.back());
+            CHECK(index->total().notional == notional.back());
+
+            const size_t end = (r >> 16) % (DepthIndex::SIZE + 1);
+            const Sums p = index->prefix(end);
+            CHECK(p.volume == cumulative[end] && p.notional == notional[end]);
+
+            // Targets exactly on a running total are where < and <= differ.
+            const uint64_t on_boundary = cumulative[(r >> 24) % (DepthIndex::SIZE + 1)];
+            for (uint64_t target : {on_boundary, on_boundary + 1, on_boundary ? on_boundary - 1 : 0,
+                                    uint64_t{0}, cumulative.back(), cumulative.back() + 1}) {
+                for (bool inclusive : {false, true}) {
+                    Sums before;
+                    const size_t pos = index->descend(target, inclusive, before);
+                    CHECK(pos == linear_descend(volume, target, inclusive));
+                    CHECK(before.volume == cumulative[pos] && before.notional == notional[pos]);
+                }
+            }
+        }
+
+        index->reset();
+        std::fill(volume.begin(), volume.end(), 0);
+        CHECK(index->total().volume == 0 && index->total().notional == 0);
+        CHECK(index->prefix(DepthIndex::SIZE).volume == 0);
+        Sums before;
+        CHECK(index->descend(1, false, before) == DepthIndex::SIZE && before.volume == 0);
+    }
+}
+
+// Linear references over a side's levels, best first.
+template <typename F>
+void walk_from_best(const OrderBookSide& side, F&& visit) {
+    if (side.best_price_index_ >= NUM_BOOK_LEVELS) return;
+    for (size_t k = 0;; ++k) {
+        const size_t idx = side.is_bid_ ? side.best_price_index_ - k : side.best_price_index_ + k;
+        if (idx >= NUM_BOOK_LEVELS || !visit(k, idx)) return;
+        if (side.is_bid_ && idx == 0) return;
+    }
+}
+
+uint64_t linear_within(const OrderBookSide& side, size_t ticks) {
+    uint64_t volume = 0;
+    walk_from_best(side, [&](size_t k, size_t idx) {
+        if (k > ticks) return false;
+        volume += side.level_quantity(idx);
+        return true;
+    });
+    return volume;
+}
+
+uint64_t linear_crossing(const OrderBookSide& side, Price_t price) {
+    uint64_t volume = 0;
+    for (size_t idx = 0; idx < NUM_BOOK_LEVELS; ++idx) {
+        const Price_t level_price = MINIMUM_BID + static_cast<Price_t>(idx);
+        if (side.is_bid_ ? level_price >= price : level_price <= price) volume += side.level_quantity(idx);
+    }
+    return volume;
+}
+
+BookSweep linear_sweep(const OrderBookSide& side, uint64_t quantity) {
+    BookSweep out;
+    if (quantity == 0) return out;
+    walk_from_best(side, [&](size_t, size_t idx) {
+        const uint64_t available = side.level_quantity(idx);
+        if (available == 0) return true;
+        const uint64_t take = std::min(available, quantity - out.filled);
+        const Price_t price = MINIMUM_BID + static_cast<Price_t>(idx);
+        out.filled += take;
+        out.notional += take * static_cast<uint64_t>(price);
+        out.worst_price = price;
+        return out.filled < quantity;
+    });
+    return out;
+}
+
+// Occupied levels best first, up to BookDepth::LEVELS of them.
+std::vector<std::pair<Price_t, Volume_t>> linear_depth(const OrderBookSide& side) {
+    std::vector<std::pair<Price_t, Volume_t>> levels;
+    walk_from_best(side, [&](size_t, size_t idx) {
+        if (const Volume_t q = side.level_quantity(idx)) {
+            levels.emplace_back(MINIMUM_BID + static_cast<Price_t>(idx), q);
+        }
+        return levels.size() < BookDepth::LEVELS;
+    });
+    return levels;
+}
+
+bool depth_matches(const BookDepth& depth, const OrderBook& book) {
+    const auto bids = linear_depth(book.bids);
+    const auto asks = linear_depth(book.asks);
+    if (depth.bid_levels != bids.size() || depth.ask_levels != asks.size()) return false;
+    for (size_t i = 0; i < bids.size(); ++i) {
+        if (depth.bid_prices[i] != bids[i].first || depth.bid_volumes[i] != bids[i].second) return false;
+    }
+    for (size_t i = 0; i < asks.size(); ++i) {
+        if (depth.ask_prices[i] != asks[i].first || depth.ask_volumes[i] != asks[i].second) return false;
+    }
+    return true;
+}
+
+void test_book_queries_match_walks() {
+    auto book = std::make_unique<OrderBook>();
+    EventLog log;
+    book->set_callbacks(&log);
+    Workload rng(23);
+    size_t partial_sweeps = 0; // the side ran out
+    size_t full_sweeps = 0;
+    size_t deep_books = 0; // a side held more than BookDepth::LEVELS levels
+    BookDepth depth;
+
+    for (uint64_t episode = 0; episode < 3; ++episode) {
+        book->reset();
+        log.clear();
+        Workload workload(100 + episode);
+        workload.half_width = 150;
+        for (size_t i = 0; i < 15'000; ++i) {
+            workload.step(*book, log, i);
+            if (i % 97 != 0) continue;
+
+            book->build_depth(depth);
+            CHECK(depth_matches(depth, *book));
+            deep_books += depth.bid_levels == BookDepth::LEVELS || depth.ask_levels == BookDepth::LEVELS;
+
+            for (const OrderBookSide* side : {&book->bids, &book->asks}) {
+                const uint64_t r = rng.next();
+                const size_t ticks = r % 300;
+                const uint64_t quantity = (r >> 16) % 20'000;
+                const Price_t price = 4700 + static_cast<Price_t>((r >> 40) % 600);
+
+                CHECK(side->volume_within(ticks) == linear_within(*side, ticks));
+                CHECK(side->volume_crossing(price) == linear_crossing(*side, price));
+                const BookSweep fast = side->sweep(quantity);
+                const BookSweep slow = linear_sweep(*side, quantity);
+                CHECK(fast.filled == slow.filled);
+                CHECK(fast.notional == slow.notional);
+                CHECK(fast.worst_price == slow.worst_price);
+                partial_sweeps += slow.filled > 0 && slow.filled < quantity;
+                full_sweeps += quantity > 0 && slow.filled == quantity;
+            }
+        }
+    }
+    CHECK(partial_sweeps > 10);
+    CHECK(full_sweeps > 10);
+    CHECK(deep_books > 10);
+
+    book->reset();
+    CHECK(book->bids.sweep(10).filled == 0);
+    CHECK(book->asks.volume_within(NUM_BOOK_LEVELS) == 0);
+    CHECK(book->asks.volume_crossing(MAXIMUM_ASK) == 0);
+    book->build_depth(depth);
+    CHECK(depth.bid_levels == 0 && depth.ask_levels == 0);
+}
+
+}
+
+int main() {
+    boost::log::core::get()->set_filter(
+        boost::log::expressions::attr<LogLevel>("Severity") >= LogLevel::LL_ERROR
+    );
+    test_index_matches_arrays();
+    test_book_queries_match_walks();
+    return test_result();
+}
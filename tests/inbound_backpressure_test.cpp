@@ -0,0 +1,140 @@
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+
+#include "logging.hpp"
+#include "exchange.hpp"
+#include "check.hpp"
+
+// A connection that overruns its shard's inbox is closed, and its DISCONNECT
+// cannot be queued behind the messages that filled it. Its slot must come
+// back anyway: after many more than MAX_CONNECTIONS such clients, a new one
+// still gets orders accepted.
+namespace {
+
+using tcp = boost::asio::ip::tcp;
+
+constexpr uint16_t PORT = 16432;
+constexpr auto ACCEPT_TIMEOUT = std::chrono::seconds(3);
+
+const PayloadInsertOrder ORDER = make_insert_order(1, Side::SELL, 5000, 1, Lifespan::GOOD_FOR_DAY);
+
+template <typename Payload>
+void append_frame(std::vector<uint8_t>& out, MessageType type, const Payload& payload) {
+    const MessageHeader header{type, sizeof(Payload)};
+    const size_t at = out.size();
+    out.resize(at + sizeof(header) + sizeof(Payload));
+    std::memcpy(out.data() + at, &header, sizeof(header));
+    std::memcpy(out.data() + at + sizeof(header), &payload, sizeof(Payload));
+}
+
+// Sends more frames than the inbox holds while the engine is not draining,
+// then waits for the exchange to hang up.
+void overrun_inbox(const std::vector<uint8_t>& flood) {
+    boost::asio::io_context context;
+    tcp::socket socket(context);
+    boost::system::error_code ec;
+    socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), PORT), ec);
+    if (ec) return;
+    boost::asio::write(socket, boost::asio::buffer(flood), ec);
+    std::array<uint8_t, 256> sink;
+    while (!ec) {
+        socket.read_some(boost::asio::buffer(sink), ec);
+    }
+}
+
+bool tcp_order_accepted() {
+    boost::asio::io_context context;
+    tcp::socket socket(context);
+    boost::system::error_code ec;
+    socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), PORT), ec);
+    if (ec) return false;
+
+    std::vector<uint8_t> frame;
+    append_frame(frame, MessageType::INSERT_ORDER, ORDER);
+    boost::asio::write(socket, boost::asio::buffer(frame), ec);
+    if (ec) return false;
+
+    // An unaccepted connection is closed by the exchange: the read fails.
+    while (true) {
+        MessageHeader reply;
+        boost::asio::read(socket, boost::asio::buffer(&reply, sizeof(reply)), ec);
+        if (ec) return false;
+        std::vector<uint8_t> payload(reply.size);
+        boost::asio::read(socket, boost::asio::buffer(payload), ec);
+        if (ec) return false;
+        if (reply.type == MessageType::CONFIRM_ORDER_INSERTED) return true;
+    }
+}
+
+// Slots come back asynchronously (engine, then the shard's accept strand).
+bool tcp_order_accepted_eventually() {
+    const auto deadline = std::chrono::steady_clock::now() + ACCEPT_TIMEOUT;
+    while (!tcp_order_accepted()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+}
+
+int main() {
+    boost::log::core::get()->set_filter(
+        boost::log::expressions::attr<LogLevel>("Severity") >= LogLevel::LL_ERROR
+    );
+    std::filesystem::create_directories("logs"); // the exchange's event logs
+
+    // Unsubscribing is a no-op for a client that never subscribed.
+    std::vector<uint8_t> flood;
+    const PayloadUnsubscribe unsubscribe{1};
+    for (size_t i = 0; i < INBOUND_Q_CAP + INBOUND_Q_CAP / 4; ++i) {
+        append_frame(flood, MessageType::UNSUBSCRIBE, unsubscribe);
+    }
+
+    boost::asio::io_context engine_context;
+    boost::asio::io_context io_context;
+    auto engine_work = boost::asio::make_work_guard(engine_context);
+    auto io_work = boost::asio::make_work_guard(io_context);
+    {
+        // The book lives inline; too big for the stack.
+        auto exchange = std::make_unique<Exchange>(
+            engine_context, std::vector<boost::asio::io_context*>{&io_context}, PORT,
+            SocketProfile::LATENCY, IoModel::PER_CORE);
+        exchange->start();
+        std::thread io_thread([&] { io_context.run(); });
+
+        // The engine only runs between clients, so each one fills the inbox.
+        // The socket is closed just before the disconnect is reported; give
+        // the IO thread time to report it while the inbox is still full.
+        for (size_t i = 0; i < 2 * MAX_CONNECTIONS; ++i) {
+            overrun_inbox(flood);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            engine_context.run_for(std::chrono::milliseconds(20));
+        }
+
+        std::thread engine_thread([&] { engine_context.run(); });
+        CHECK(tcp_order_accepted_eventually());
+
+        exchange->stop();
+        engine_work.reset();
+        io_work.reset();
+        engine_context.stop();
+        io_context.stop();
+        engine_thread.join();
+        io_thread.join();
+    }
+    return test_result();
+}
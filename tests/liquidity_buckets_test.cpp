@@ -0,0 +1,110 @@
+#include <array>
+#include <cstdint>
+#include <memory>
+
+#include "state.hpp"
+#include "book_workload.hpp"
+#include "check.hpp"
+
+// LiquidityBucketSide keeps its power sums up to date from level updates;
+// they must equal a full recompute over the ClientBook after every kind of
+// update: changes behind the touch, a better touch, the touch emptying, a
+// jump beyond the widest bucket (rebuild), an empty side and clear().
+namespace {
+
+template <size_t N>
+using Sums = typename LiquidityBucketSide<N>::Sums;
+
+template <size_t N>
+std::array<Sums<N>, N> recompute(const ClientBookSide& side, const std::array<Price_t, N>& bounds) {
+    std::array<Sums<N>, N> out{};
+    const auto best = side.best_price();
+    if (!best) return out;
+    side.for_each_level([&](Price_t price, Volume_t volume) {
+        const int64_t d = side.is_bid() ? *best - price : price - *best;
+        const int64_t w = volume;
+        for (size_t i = 0; i < N; ++i) {
+            if (d > bounds[i]) continue;
+            out[i].w += w;
+            out[i].x += w * d;
+            out[i].x2 += w * d * d;
+            out[i].x3 += w * d * d * d;
+        }
+        return true;
+    });
+    return out;
+}
+
+template <size_t N>
+bool same(const std::array<Sums<N>, N>& a, const std::array<Sums<N>, N>& b) {
+    for (size_t i = 0; i < N; ++i) {
+        if (a[i].w != b[i].w || a[i].x != b[i].x || a[i].x2 != b[i].x2 || a[i].x3 != b[i].x3) return false;
+    }
+    return true;
+}
+
+template <size_t N>
+void run(const std::array<Price_t, N>& bounds, uint64_t seed) {
+    auto book = std::make_unique<ClientBook>();
+    LiquidityBucketSide<N> bid_buckets(bounds);
+    LiquidityBucketSide<N> ask_buckets(bounds);
+    Workload rng(seed);
+    size_t mismatches = 0;
+    size_t touch_moves = 0;
+
+    Price_t mid = 5000;
+    for (size_t i = 0; i < 300'000; ++i) {
+        const uint64_t r = rng.next();
+        if (i % 1000 == 0) mid += static_cast<Price_t>(r % 7) - 3; // drift
+        if (i % 25'000 == 0) mid += (r & 1) ? 40 : -40;            // jump past every bucket
+
+        const bool is_bid = r & 1;
+        ClientBookSide& side = is_bid ? book->bids : book->asks;
+        Price_t price;
+        Volume_t volume;
+        if ((r >> 40) % 20 == 0 && !side.empty()) {
+            price = *side.best_price(); // empty the touch
+            volume = 0;
+        } else {
+            const Price_t offset = static_cast<Price_t>((r >> 8) % 30) - 2; // some improve the touch
+            price = is_bid ? mid - offset : mid + 1 + offset;
+            volume = (r >> 16) % 3 == 0 ? 0 : static_cast<Volume_t>(1 + (r >> 20) % 100);
+        }
+
+        const auto best_before = side.best_price();
+        const Volume_t old_volume = side.volume_at(price);
+        side.set(price, volume);
+        (is_bid ? bid_buckets : ask_buckets).on_level_update(side, price, old_volume);
+        touch_moves += side.best_price() != best_before;
+
+        if (i % 50'000 == 49'999) {
+            // Snapshot-style reset of one side, as the simulator does.
+            book->bids.clear();
+            bid_buckets.rebuild(book->bids);
+        }
+
+        mismatches += !same<N>(bid_buckets.sums(), recompute<N>(book->bids, bounds));
+        mismatches += !same<N>(ask_buckets.sums(), recompute<N>(book->asks, bounds));
+    }
+    CHECK(mismatches == 0);
+    CHECK(touch_moves > 10'000);
+
+    // Emptying a side level by level ends with zero sums.
+    while (!book->asks.empty()) {
+        const Price_t best = *book->asks.best_price();
+        const Volume_t old_volume = book->asks.volume_at(best);
+        book->asks.set(best, 0);
+        ask_buckets.on_level_update(book->asks, best, old_volume);
+        CHECK(same<N>(ask_buckets.sums(), recompute<N>(book->asks, bounds)));
+    }
+    CHECK(same<N>(ask_buckets.sums(), std::array<Sums<N>, N>{}));
+}
+
+}
+
+int main() {
+    run<3>({1, 5, 10}, 88172645463325252ull); // the simulator's buckets
+    run<3>({0, 3, 50}, 12345);                // touch-only bucket; wide one shifts more than it rebuilds
+    run<1>({20}, 777);
+    return test_result();
+}
@@ -0,0 +1,98 @@
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+
+#include "logging.hpp"
+#include "exchange.hpp"
+#include "simulator.hpp"
+#include "check.hpp"
+
+// Several agents trading over two sessions while two threads run the
+// simulator's io_context: the callbacks of both sessions, the snapshot
+// included, must stay on the simulator's strand. Orders go out and get
+// filled, and the run shuts down cleanly.
+namespace {
+
+using tcp = boost::asio::ip::tcp;
+
+constexpr uint16_t PORT = 16433;
+constexpr auto RUN_TIME = std::chrono::milliseconds(500);
+
+void test_two_threads_two_sessions() {
+    boost::asio::io_context engine_context;
+    boost::asio::io_context io_context;
+    auto engine_work = boost::asio::make_work_guard(engine_context);
+    auto io_work = boost::asio::make_work_guard(io_context);
+
+    // The book lives inline; too big for the stack.
+    auto exchange = std::make_unique<Exchange>(
+        engine_context, std::vector<boost::asio::io_context*>{&io_context}, PORT,
+        SocketProfile::LATENCY, IoModel::PER_CORE);
+    exchange->start();
+    std::thread engine_thread([&] { engine_context.run(); });
+    std::thread io_thread([&] { io_context.run(); });
+
+    boost::asio::io_context sim_context;
+    SimulatorConfig config;
+    config.sessions = 2;
+    CHECK(parse_agent_population("mm=2,taker=2,noise=2", config.population));
+    config.seed = 3;
+    const SessionFactory make_session = [&](InboundQueue& inbound, OutboundQueue& outbound) -> std::unique_ptr<Session> {
+        tcp::socket socket(sim_context);
+        socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), PORT));
+        return std::make_unique<Connection>(sim_context, std::move(socket), 0, inbound, outbound,
+                                            true, ConnectionRole::CLIENT);
+    };
+    auto sim = std::make_unique<MarketSimulator<3>>(
+        sim_context, make_session, config, std::array<Price_t, 3>{1, 5, 10}, [](Session*) {});
+
+    sim->start();
+    std::vector<std::thread> sim_threads;
+    for (int i = 0; i < 2; ++i) {
+        sim_threads.emplace_back([&] { sim_context.run(); });
+    }
+    std::this_thread::sleep_for(RUN_TIME);
+    sim->stop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    sim_context.stop();
+    for (auto& t : sim_threads) t.join();
+
+    uint64_t inserts = 0;
+    uint64_t fills = 0;
+    for (size_t i = 0; i < sim->agents().size(); ++i) {
+        inserts += sim->agents()[i].inserts;
+        fills += sim->agents()[i].fills;
+    }
+    CHECK(inserts > 0);
+    CHECK(fills > 0);
+
+    sim.reset();
+    exchange->stop();
+    engine_work.reset();
+    io_work.reset();
+    engine_context.stop();
+    io_context.stop();
+    engine_thread.join();
+    io_thread.join();
+}
+
+}
+
+int main() {
+    boost::log::core::get()->set_filter(
+        boost::log::expressions::attr<LogLevel>("Severity") >= LogLevel::LL_ERROR
+    );
+    std::filesystem::create_directories("logs"); // the exchange's event logs
+
+    test_two_threads_two_sessions();
+    return test_result();
+}
@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+
+#include "logging.hpp"
+#include "mirror_ring.hpp"
+#include "check.hpp"
+
+// MirrorRing in both modes, driven the way Connection drives it: reads of
+// arbitrary size into write_ptr(), frames (type u8, payload size u16 LE,
+// payload) parsed in place from read_ptr() and consumed whole, and a
+// compact() whenever nothing is writable before the next read. Frames must
+// come out intact across the mirror boundary and across every compaction.
+// Then the fallback's consume()/compact() rules on hand-placed bytes.
+namespace {
+
+constexpr size_t HEADER = 3;
+
+uint8_t payload_byte(uint64_t frame, size_t i) {
+    return static_cast<uint8_t>(frame * 31 + i * 7);
+}
+
+// Frame number `frame`, with a payload size drawn by the caller.
+void append_frame(std::vector<uint8_t>& stream, uint64_t frame, uint16_t payload_size) {
+    stream.push_back(static_cast<uint8_t>(frame & 0xFF));
+    stream.push_back(static_cast<uint8_t>(payload_size & 0xFF));
+    stream.push_back(static_cast<uint8_t>(payload_size >> 8));
+    for (size_t i = 0; i < payload_size; ++i) stream.push_back(payload_byte(frame, i));
+}
+
+bool frame_intact(const uint8_t* frame, uint64_t expected) {
+    if (frame[0] != static_cast<uint8_t>(expected & 0xFF)) return false;
+    const size_t payload_size = frame[1] | (static_cast<size_t>(frame[2]) << 8);
+    for (size_t i = 0; i < payload_size; ++i) {
+        if (frame[HEADER + i] != payload_byte(expected, i)) return false;
+    }
+    return true;
+}
+
+void run_stream(bool mirror) {
+    MirrorRing ring(4096, mirror);
+    CHECK(ring.capacity() == 4096);
+#if defined(__linux__)
+    CHECK(ring.mirrored() == mirror);
+#endif
+
+    std::mt19937_64 rng(mirror ? 5 : 6);
+    std::vector<uint8_t> stream;
+    constexpr uint64_t FRAMES = 20'000;
+    for (uint64_t f = 0; f < FRAMES; ++f) {
+        // Mostly small frames, some close to the ring's size.
+        const uint16_t payload_size = static_cast<uint16_t>(rng() % 8 == 0 ? rng() % 3000 : rng() % 120);
+        append_frame(stream, f, payload_size);
+    }
+
+    size_t written = 0;
+    size_t consumed = 0;
+    uint64_t parsed = 0;
+    bool intact = true;
+    size_t across_boundary = 0;
+    size_t compactions = 0; // start_read_'s case: full buffer, partial frame
+    while (parsed < FRAMES) {
+        if (ring.writable() == 0) {
+            ring.compact();
+            ++compactions;
+            CHECK(ring.writable() > 0);
+            if (ring.writable() == 0) return;
+        }
+        const size_t want = 1 + static_cast<size_t>(rng() % 5000);
+        const size_t n = std::min({want, ring.writable(), stream.size() - written});
+        std::memcpy(ring.write_ptr(), stream.data() + written, n);
+        ring.commit(n);
+        written += n;
+
+        while (ring.readable() >= HEADER) {
+            const uint8_t* frame = ring.read_ptr();
+            const size_t frame_size = HEADER + (frame[1] | (static_cast<size_t>(frame[2]) << 8));
+            if (ring.readable() < frame_size) break;
+            across_boundary += ring.mirrored() && consumed % ring.capacity() + frame_size > ring.capacity();
+            intact &= frame_intact(frame, parsed);
+            ring.consume(frame_size);
+            consumed += frame_size;
+            ++parsed;
+        }
+    }
+    CHECK(intact);
+    CHECK(written == stream.size());
+    CHECK(ring.readable() == 0);
+    if (ring.mirrored()) {
+        CHECK(across_boundary > 100);
+    } else {
+        CHECK(compactions > 100);
+    }
+}
+
+void test_mirror_boundary() {
+    MirrorRing ring(4096);
+    if (!ring.mirrored()) return; // the double mapping is Linux only
+    std::vector<uint8_t> stream;
+    append_frame(stream, 1, 2900);
+    append_frame(stream, 2, 2000);
+
+    std::memcpy(ring.write_ptr(), stream.data(), 2903);
+    ring.commit(2903);
+    CHECK(frame_intact(ring.read_ptr(), 1));
+    ring.consume(2903);
+
+    // Starts 2903 bytes in and ends 807 bytes past the end of the buffer.
+    CHECK(ring.writable() == ring.capacity());
+    std::memcpy(ring.write_ptr(), stream.data() + 2903, 2003);
+    ring.commit(2003);
+    CHECK(ring.readable() == 2003);
+    CHECK(frame_intact(ring.read_ptr(), 2));
+    // The wrapped bytes landed at the front of the same memory.
+    CHECK(std::memcmp(ring.read_ptr() + (4096 - 2903), ring.read_ptr() - 2903, 2003 - (4096 - 2903)) == 0);
+    ring.consume(2003);
+    CHECK(ring.readable() == 0);
+}
+
+void test_fallback_consume_and_compact() {
+    MirrorRing ring(4096, false);
+    CHECK(!ring.mirrored());
+
+    // One whole frame, then the start of one that does not fit behind it.
+    std::vector<uint8_t> stream;
+    append_frame(stream, 1, 1000);
+    append_frame(stream, 2, 3500);
+    std::memcpy(ring.write_ptr(), stream.data(), 4096);
+    ring.commit(4096);
+    CHECK(ring.writable() == 0);
+
+    // Under half consumed: consume() leaves the partial frame where it is,
+    // so the buffer stays full until start_read_ compacts it.
+    CHECK(frame_intact(ring.read_ptr(), 1));
+    ring.consume(1003);
+    CHECK(ring.readable() == 4096 - 1003);
+    CHECK(ring.writable() == 0);
+    ring.compact();
+    CHECK(ring.writable() == 1003);
+    CHECK(ring.readable() == 4096 - 1003);
+    CHECK(std::memcmp(ring.read_ptr(), stream.data() + 1003, 4096 - 1003) == 0);
+
+    // The rest of the frame arrives; consuming everything rewinds the buffer.
+    const size_t rest = stream.size() - 4096;
+    CHECK(rest <= ring.writable());
+    std::memcpy(ring.write_ptr(), stream.data() + 4096, rest);
+    ring.commit(rest);
+    CHECK(frame_intact(ring.read_ptr(), 2));
+    ring.consume(3503);
+    CHECK(ring.readable() == 0);
+    CHECK(ring.writable() == ring.capacity());
+
+    // Half or more consumed: consume() compacts on its own.
+    std::vector<uint8_t> bytes(4000);
+    for (size_t i = 0; i < bytes.size(); ++i) bytes[i] = static_cast<uint8_t>(i * 13);
+    std::memcpy(ring.write_ptr(), bytes.data(), bytes.size());
+    ring.commit(bytes.size());
+    ring.consume(2500);
+    CHECK(ring.readable() == 1500);
+    CHECK(ring.writable() == ring.capacity() - 1500);
+    CHECK(std::memcmp(ring.read_ptr(), bytes.data() + 2500, 1500) == 0);
+
+    // Nothing consumed: compact() has nothing to move.
+    ring.compact();
+    CHECK(ring.writable() == ring.capacity() - 1500);
+    CHECK(std::memcmp(ring.read_ptr(), bytes.data() + 2500, 1500) == 0);
+}
+
+}
+
+int main() {
+    boost::log::core::get()->set_filter(
+        boost::log::expressions::attr<LogLevel>("Severity") >= LogLevel::LL_ERROR
+    );
+    run_stream(true);
+    run_stream(false);
+    test_mirror_boundary();
+    test_fallback_consume_and_compact();
+    return test_result();
+}
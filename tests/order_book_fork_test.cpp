@@ -0,0 +1,208 @@
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+
+#include "logging.hpp"
+#include "order_book.hpp"
+#include "order_book_fork.hpp"
+#include "book_workload.hpp"
+#include "check.hpp"
+
+// OrderBookFork against the real book: the same hypothetical commands sent
+// to a fork and to an identical OrderBook must give the same fills, the same
+// rejections and the same resulting levels, and must leave the forked book
+// untouched. A fork of the published BookDepth must price a sweep like a
+// fork of the live book.
+namespace {
+
+constexpr size_t ROUNDS = 100;
+constexpr size_t BASE_STEPS = 2'000;
+constexpr size_t WHAT_IF_COMMANDS = 60;
+
+struct Recorder final : OrderBookCallbacks {
+    std::vector<OrderBookFork::Fill> fills;
+    std::vector<Id_t> inserted;
+    size_t errors = 0;
+
+    void on_trade(const Order& maker, Id_t, Id_t taker_order_id, Price_t price,
+                  Volume_t, Volume_t, Volume_t traded, Time_t) override {
+        fills.push_back({taker_order_id, maker.order_id_, maker.client_id_, price, traded});
+    }
+    void on_order_inserted(Id_t, const Order& order, Time_t) override { inserted.push_back(order.order_id_); }
+    void on_order_cancelled(Id_t, const Order&, Time_t) override {}
+    void on_order_amended(Id_t, Volume_t, const Order&, Time_t) override {}
+    void on_level_update(Side, PriceLevel const&, Time_t) override {}
+    void on_error(Id_t, Id_t, uint16_t, std::string_view, Time_t) override { ++errors; }
+};
+
+bool same_fill(const OrderBookFork::Fill& a, const OrderBookFork::Fill& b) {
+    return a.taker_order_id == b.taker_order_id && a.maker_order_id == b.maker_order_id
+        && a.maker_client_id == b.maker_client_id && a.price == b.price && a.quantity == b.quantity;
+}
+
+bool same_depth(const BookDepth& a, const BookDepth& b) {
+    return a.bid_levels == b.bid_levels && a.ask_levels == b.ask_levels && a.next_order_id == b.next_order_id
+        && a.bid_prices == b.bid_prices && a.bid_volumes == b.bid_volumes
+        && a.ask_prices == b.ask_prices && a.ask_volumes == b.ask_volumes;
+}
+
+void test_fork_matches_real_book() {
+    auto base = std::make_unique<OrderBook>();
+    auto real = std::make_unique<OrderBook>();
+    EventLog base_log;
+    EventLog real_log;
+    base->set_callbacks(&base_log);
+    real->set_callbacks(&real_log);
+    size_t total_fills = 0;
+    size_t total_rejects = 0;
+
+    for (uint64_t round = 0; round < ROUNDS; ++round) {
+        // base and real get the same history, then real plays the what-ifs.
+        base->reset();
+        real->reset();
+        base_log.clear();
+        real_log.clear();
+        Workload history_a(round + 1);
+        Workload history_b(round + 1);
+        for (size_t i = 0; i < BASE_STEPS; ++i) {
+            history_a.step(*base, base_log, i);
+            history_b.step(*real, real_log, i);
+        }
+        const std::vector<Id_t> ids = base_log.inserted;
+        const size_t base_events = base_log.events.size();
+        BookDepth base_depth;
+        base->build_depth(base_depth);
+
+        Recorder recorder;
+        real->set_callbacks(&recorder);
+        OrderBookFork fork(*base);
+        Workload rng(~round);
+        size_t fork_rejects = 0;
+        for (size_t i = 0; i < WHAT_IF_COMMANDS; ++i) {
+            const uint64_t r = rng.next();
+            const Id_t client = static_cast<Id_t>((r >> 40) % 3);
+            const unsigned action = r % 10;
+            if (action < 6 || ids.empty()) {
+                const bool is_bid = (r >> 8) & 1;
+                const Price_t offset = static_cast<Price_t>((r >> 16) % 40) - 10;
+                const Price_t price = is_bid ? 5000 - offset : 5001 + offset;
+                const Volume_t quantity = static_cast<Volume_t>(1 + (r >> 32) % 120);
+                real->submit_order(price, quantity, is_bid, client, 0, 0);
+                fork.submit_order(price, quantity, is_bid, client);
+                continue;
+            }
+            // Mostly orders from the history (some filled, some another
+            // client's), sometimes ones the what-ifs just placed.
+            const Id_t order_id = (r >> 20) % 4
+                ? ids[(r >> 16) % ids.size()]
+                : real->next_order_id() - 1 - static_cast<Id_t>((r >> 16) % 5);
+            if (action < 9) {
+                real->cancel_order(client, 0, order_id, 0);
+                fork_rejects += !fork.cancel_order(client, order_id);
+            } else {
+                const Volume_t quantity = static_cast<Volume_t>(1 + (r >> 32) % 40);
+                real->amend_order(client, 0, order_id, quantity, 0);
+                fork_rejects += !fork.amend_order(client, order_id, quantity);
+            }
+        }
+        real->set_callbacks(&real_log);
+
+        CHECK(fork.fills().size() == recorder.fills.size());
+        bool fills_match = fork.fills().size() == recorder.fills.size();
+        for (size_t i = 0; fills_match && i < recorder.fills.size(); ++i) {
+            fills_match = same_fill(fork.fills()[i], recorder.fills[i]);
+        }
+        CHECK(fills_match);
+        CHECK(fork_rejects == recorder.errors);
+        total_fills += recorder.fills.size();
+        total_rejects += recorder.errors;
+
+        bool levels_match = true;
+        for (Price_t price = 5000 - 200; price <= 5000 + 200; ++price) {
+            levels_match &= fork.level_quantity(true, price) == real->bids.level_quantity(static_cast<size_t>(price - MINIMUM_BID));
+            levels_match &= fork.level_quantity(false, price) == real->asks.level_quantity(static_cast<size_t>(price - MINIMUM_BID));
+        }
+        CHECK(levels_match);
+        BookDepth real_depth;
+        real->build_depth(real_depth);
+        CHECK(fork.best_bid() == (real_depth.bid_levels ? real_depth.bid_prices[0] : 0));
+        CHECK(fork.best_ask() == (real_depth.ask_levels ? real_depth.ask_prices[0] : 0));
+        std::array<Volume_t, ORDER_BOOK_MESSAGE_DEPTH> fbv, fav, rbv, rav;
+        std::array<Price_t, ORDER_BOOK_MESSAGE_DEPTH> fbp, fap, rbp, rap;
+        fork.build_snapshot(fbv, fbp, fav, fap);
+        real->build_snapshot(rbv, rbp, rav, rap);
+        CHECK(fbv == rbv && fbp == rbp && fav == rav && fap == rap);
+
+        // Copy-on-write: at most the levels the commands can reach (all
+        // prices stay within 5000 +- 80) were copied, and the base book
+        // neither changed nor sent events.
+        CHECK(fork.levels_copied() <= 2 * 161);
+        BookDepth after;
+        base->build_depth(after);
+        CHECK(same_depth(after, base_depth));
+        CHECK(base_log.events.size() == base_events);
+    }
+    // The what-ifs must have traded and hit the error paths to prove anything.
+    CHECK(total_fills > ROUNDS);
+    CHECK(total_rejects > ROUNDS / 4);
+}
+
+void test_depth_fork_prices_like_live_fork() {
+    auto book = std::make_unique<OrderBook>();
+    EventLog log;
+    book->set_callbacks(&log);
+
+    for (uint64_t round = 0; round < ROUNDS; ++round) {
+        book->reset();
+        log.clear();
+        Workload history(0x5eed + round);
+        for (size_t i = 0; i < BASE_STEPS; ++i) history.step(*book, log, i);
+
+        BookDepth depth;
+        book->build_depth(depth);
+        const bool is_bid = round & 1;
+        const Price_t limit = is_bid ? 5000 + 30 : 5001 - 30;
+        const Volume_t quantity = static_cast<Volume_t>(100 + 37 * round);
+
+        OrderBookFork live(*book);
+        OrderBookFork published(depth);
+        const auto a = live.submit_order(limit, quantity, is_bid, 9);
+        const auto b = published.submit_order(limit, quantity, is_bid, 9);
+        CHECK(a.order_id == b.order_id);
+        CHECK(a.filled == b.filled);
+        CHECK(a.resting == b.resting);
+        CHECK(live.best_bid() == published.best_bid());
+        CHECK(live.best_ask() == published.best_ask());
+
+        // Same prices and quantities, though the depth fork has one
+        // aggregate maker per level.
+        std::vector<std::pair<Price_t, uint64_t>> by_price_live;
+        std::vector<std::pair<Price_t, uint64_t>> by_price_depth;
+        for (const auto& f : live.fills()) {
+            if (by_price_live.empty() || by_price_live.back().first != f.price) by_price_live.push_back({f.price, 0});
+            by_price_live.back().second += f.quantity;
+        }
+        for (const auto& f : published.fills()) {
+            CHECK(f.maker_order_id == OrderBookFork::NONE);
+            if (by_price_depth.empty() || by_price_depth.back().first != f.price) by_price_depth.push_back({f.price, 0});
+            by_price_depth.back().second += f.quantity;
+        }
+        CHECK(by_price_live == by_price_depth);
+    }
+}
+
+}
+
+int main() {
+    boost::log::core::get()->set_filter(
+        boost::log::expressions::attr<LogLevel>("Severity") >= LogLevel::LL_ERROR
+    );
+    test_fork_matches_real_book();
+    test_depth_fork_prices_like_live_fork();
+    return test_result();
+}
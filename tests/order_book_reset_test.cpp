@@ -0,0 +1,127 @@
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+
+#include "logging.hpp"
+#include "order_book.hpp"
+#include "order_id_index.hpp"
+#include "book_workload.hpp"
+#include "check.hpp"
+
+// OrderBook::reset() and the generation-stamped OrderIdIndex behind it: a
+// reset book must behave exactly like a freshly constructed one, and the
+// index must agree with a std::unordered_map through inserts, erases and
+// resets.
+namespace {
+
+constexpr size_t STEPS = 50'000;
+
+void run(OrderBook& book, EventLog& log, uint64_t seed, size_t steps) {
+    log.clear();
+    Workload workload(seed);
+    for (size_t i = 0; i < steps; ++i) workload.step(book, log, i);
+}
+
+bool book_is_empty(const OrderBook& book) {
+    BookDepth depth;
+    book.build_depth(depth);
+    return depth.bid_levels == 0 && depth.ask_levels == 0
+        && book.bids.num_active_levels_ == 0 && book.asks.num_active_levels_ == 0
+        && book.volume_within(true, NUM_BOOK_LEVELS) == 0
+        && book.volume_within(false, NUM_BOOK_LEVELS) == 0
+        && book.next_order_id() == 0;
+}
+
+void test_reset_matches_fresh_book() {
+    auto fresh = std::make_unique<OrderBook>();
+    EventLog expected;
+    fresh->set_callbacks(&expected);
+    CHECK(book_is_empty(*fresh));
+    run(*fresh, expected, 0x1234567, STEPS);
+
+    // Dirty a second book with other traffic, reset it, replay.
+    auto reused = std::make_unique<OrderBook>();
+    EventLog log;
+    reused->set_callbacks(&log);
+    for (uint64_t episode = 0; episode < 3; ++episode) {
+        run(*reused, log, 0x42 + episode, STEPS / 2);
+        const Id_t some_resting = log.inserted.empty() ? 0 : log.inserted.front();
+        reused->reset();
+        CHECK(log.events.size() > 0);
+        CHECK(book_is_empty(*reused));
+        CHECK(reused->find_order(some_resting) == nullptr);
+    }
+
+    const size_t events_before = log.events.size();
+    reused->reset();
+    CHECK(log.events.size() == events_before); // reset sends nothing
+
+    run(*reused, log, 0x1234567, STEPS);
+    CHECK(log.events == expected.events);
+
+    std::array<Volume_t, ORDER_BOOK_MESSAGE_DEPTH> bv1, av1, bv2, av2;
+    std::array<Price_t, ORDER_BOOK_MESSAGE_DEPTH> bp1, ap1, bp2, ap2;
+    fresh->build_snapshot(bv1, bp1, av1, ap1);
+    reused->build_snapshot(bv2, bp2, av2, ap2);
+    CHECK(bv1 == bv2 && bp1 == bp2 && av1 == av2 && ap1 == ap2);
+    CHECK(fresh->next_order_id() == reused->next_order_id());
+}
+
+void test_order_id_index_matches_map() {
+    auto index = std::make_unique<OrderIdIndex>();
+    std::unordered_map<Id_t, Id_t> model;
+    Workload rng(7);
+
+    // Ids sharing a home slot (same low bits) and ids homed near the end of
+    // the table build long clusters that wrap around, which is where the
+    // backward-shift erase can go wrong.
+    auto draw_id = [&rng]() -> Id_t {
+        const uint64_t r = rng.next();
+        const Id_t home = (r & 1) ? static_cast<Id_t>(r >> 8) % 64 : static_cast<Id_t>(OrderIdIndex::CAPACITY - 1 - (r >> 8) % 64);
+        return home + static_cast<Id_t>(OrderIdIndex::CAPACITY) * static_cast<Id_t>((r >> 20) % 16);
+    };
+
+    for (size_t round = 0; round < 3; ++round) {
+        for (size_t i = 0; i < 50'000; ++i) {
+            const Id_t id = draw_id();
+            const auto it = model.find(id);
+            if (it == model.end()) {
+                if (model.size() < 400) {
+                    const Id_t handle = static_cast<Id_t>(i);
+                    index->insert(id, handle);
+                    model.emplace(id, handle);
+                }
+            } else {
+                index->erase(id);
+                model.erase(it);
+            }
+            const Id_t probe = draw_id();
+            const auto expected = model.find(probe);
+            CHECK(index->find(probe) == (expected == model.end() ? OrderIdIndex::NONE : expected->second));
+        }
+        CHECK(index->size() == model.size());
+        for (const auto& [id, handle] : model) CHECK(index->find(id) == handle);
+
+        const Id_t survivor = model.empty() ? 0 : model.begin()->first;
+        index->reset();
+        model.clear();
+        CHECK(index->size() == 0);
+        CHECK(index->find(survivor) == OrderIdIndex::NONE);
+        index->erase(survivor); // absent: a no-op
+        CHECK(index->size() == 0);
+    }
+}
+
+}
+
+int main() {
+    boost::log::core::get()->set_filter(
+        boost::log::expressions::attr<LogLevel>("Severity") >= LogLevel::LL_ERROR
+    );
+    test_reset_matches_fresh_book();
+    test_order_id_index_matches_map();
+    return test_result();
+}
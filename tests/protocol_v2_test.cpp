@@ -0,0 +1,143 @@
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "protocol_v2.hpp"
+#include "check.hpp"
+
+// Every message V2PacketWriter packs must come back from v2_read_packet
+// byte-for-byte in v1 layout: compact types at both ends of the price band,
+// verbatim types, and messages whose sequence or time deltas force a new
+// packet. Prices travel as offsets from the announced base.
+namespace {
+
+constexpr Time_t T0 = 1'700'000'000'000'000'000ull;
+
+struct Frame {
+    Message_t type;
+    std::vector<uint8_t> payload;
+};
+
+template <typename Payload>
+Frame frame(MessageType type, const Payload& payload) {
+    Frame f{static_cast<Message_t>(type), std::vector<uint8_t>(sizeof(Payload))};
+    std::memcpy(f.payload.data(), &payload, sizeof(Payload));
+    return f;
+}
+
+std::vector<Frame> sample_frames() {
+    return {
+        frame(MessageType::PRICE_LEVEL_UPDATE, make_price_level_update(10, Side::SELL, MAXIMUM_ASK, 7, T0)),
+        frame(MessageType::PRICE_LEVEL_UPDATE, make_price_level_update(11, Side::BUY, MINIMUM_BID, 3, T0 + 5)),
+        frame(MessageType::TRADE_EVENT, make_trade_event(12, 99, 5000, 4, Side::BUY, T0 + 9)),
+        frame(MessageType::ORDER_INSERTED_EVENT, make_order_inserted_event(13, 41, Side::SELL, 5001, 8, T0 + 9)),
+        frame(MessageType::ORDER_CANCELLED_EVENT, make_order_cancelled_event(14, 41, 2, T0 + 11)),
+        frame(MessageType::ORDER_AMENDED_EVENT, make_order_amended_event(15, 42, 6, 9, T0 + 12)),
+        frame(MessageType::PARTIAL_FILL_ORDER, make_partial_fill(43, 99, 5000, 4, 1, 4, T0 + 9)),
+        frame(MessageType::CONFIRM_ORDER_INSERTED, make_confirm_order_inserted(7, 44, Side::BUY, 4999, 10, 10, T0 + 20)),
+        frame(MessageType::CONFIRM_ORDER_CANCELLED, make_confirm_order_cancelled(8, 44, 0, 4999, Side::BUY, T0 + 21)),
+        frame(MessageType::CONFIRM_ORDER_AMENDED, make_confirm_order_amended(9, 45, 10, 6, 6, T0 + 22)),
+        frame(MessageType::ERROR_MSG, make_error(10, static_cast<uint16_t>(ErrorType::INVALID_VOLUME), "bad volume", T0 + 23)),
+        // Sequence delta beyond u16: a new packet.
+        frame(MessageType::PRICE_LEVEL_UPDATE, make_price_level_update(10 + 70'000, Side::SELL, 5002, 1, T0 + 24)),
+        // Time going backwards: a new packet.
+        frame(MessageType::TRADE_EVENT, make_trade_event(70'011, 100, 5002, 1, Side::SELL, T0 + 1)),
+    };
+}
+
+// Packs frames in order and returns the encoded bytes.
+std::vector<uint8_t> encode(const std::vector<Frame>& frames, Price_t price_base) {
+    std::vector<uint8_t> buf(64 * 1024);
+    V2PacketWriter writer(buf.data(), buf.size(), price_base);
+    for (const Frame& f : frames) {
+        CHECK(writer.append(f.type, f.payload.data(), static_cast<uint16_t>(f.payload.size())));
+    }
+    buf.resize(writer.finish());
+    return buf;
+}
+
+// Reads every packet in buf; returns the messages, or fewer on an error.
+std::vector<Frame> decode(const std::vector<uint8_t>& buf, Price_t price_base, size_t& packets) {
+    std::vector<Frame> out;
+    packets = 0;
+    size_t at = 0;
+    while (at < buf.size()) {
+        const size_t n = v2_read_packet(buf.data() + at, buf.size() - at, price_base,
+            [&out](Message_t type, const uint8_t* payload, uint16_t size) {
+                out.push_back(Frame{type, std::vector<uint8_t>(payload, payload + size)});
+            });
+        if (n == 0 || n == std::numeric_limits<size_t>::max()) break;
+        at += n;
+        ++packets;
+    }
+    CHECK(at == buf.size());
+    return out;
+}
+
+void test_round_trip() {
+    const std::vector<Frame> frames = sample_frames();
+    const std::vector<uint8_t> buf = encode(frames, V2_PRICE_BASE);
+
+    size_t packets = 0;
+    const std::vector<Frame> decoded = decode(buf, V2_PRICE_BASE, packets);
+    CHECK(packets == 3);
+    CHECK(decoded.size() == frames.size());
+    for (size_t i = 0; i < frames.size() && i < decoded.size(); ++i) {
+        CHECK(decoded[i].type == frames[i].type);
+        CHECK(decoded[i].payload == frames[i].payload);
+    }
+}
+
+void test_prices_are_offsets_from_the_base() {
+    const Frame f = frame(MessageType::PRICE_LEVEL_UPDATE, make_price_level_update(1, Side::SELL, MAXIMUM_ASK, 1, T0));
+    const std::vector<uint8_t> buf = encode({f}, V2_PRICE_BASE);
+    V2PriceLevelUpdate c;
+    std::memcpy(&c, buf.data() + sizeof(V2PacketHeader) + 2, sizeof(c));
+    CHECK(c.price == MAXIMUM_ASK - V2_PRICE_BASE);
+
+    // Read with another base, every price shifts by the difference.
+    size_t packets = 0;
+    const std::vector<Frame> decoded = decode(buf, V2_PRICE_BASE + 100, packets);
+    CHECK(decoded.size() == 1);
+    if (decoded.size() == 1) {
+        PayloadPriceLevelUpdate p;
+        std::memcpy(&p, decoded[0].payload.data(), sizeof(p));
+        CHECK(p.price == MAXIMUM_ASK + 100);
+    }
+}
+
+void test_partial_and_malformed_packets() {
+    const std::vector<uint8_t> buf = encode(sample_frames(), V2_PRICE_BASE);
+    size_t calls = 0;
+    auto count = [&calls](Message_t, const uint8_t*, uint16_t) { ++calls; };
+
+    CHECK(v2_read_packet(buf.data(), sizeof(V2PacketHeader) - 1, V2_PRICE_BASE, count) == 0);
+    CHECK(v2_read_packet(buf.data(), sizeof(V2PacketHeader) + 1, V2_PRICE_BASE, count) == 0);
+    CHECK(calls == 0);
+
+    std::vector<uint8_t> bad = buf;
+    bad[0] = 0;
+    CHECK(v2_read_packet(bad.data(), bad.size(), V2_PRICE_BASE, count) == std::numeric_limits<size_t>::max());
+}
+
+void test_full_buffer_refuses_append() {
+    const PayloadPriceLevelUpdate update = make_price_level_update(1, Side::BUY, 10, 1, T0);
+    std::array<uint8_t, sizeof(V2PacketHeader) + 2 + sizeof(V2PriceLevelUpdate)> buf;
+    V2PacketWriter writer(buf.data(), buf.size(), V2_PRICE_BASE);
+    const auto type = static_cast<Message_t>(MessageType::PRICE_LEVEL_UPDATE);
+    CHECK(writer.append(type, reinterpret_cast<const uint8_t*>(&update), sizeof(update)));
+    CHECK(!writer.append(type, reinterpret_cast<const uint8_t*>(&update), sizeof(update)));
+    CHECK(writer.finish() == buf.size());
+}
+
+}
+
+int main() {
+    test_round_trip();
+    test_prices_are_offsets_from_the_base();
+    test_partial_and_malformed_packets();
+    test_full_buffer_refuses_append();
+    return test_result();
+}
@@ -0,0 +1,360 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "broadcast_ring.hpp"
+#include "mpmc_queue.hpp"
+#include "mpsc_queue.hpp"
+#include "spsc_queue.hpp"
+#include "check.hpp"
+
+// SPSCQueue, MPSCQueue, MPMCQueue and BroadcastRing: capacity limits and the
+// SPSC batch APIs on one thread, then the ordering / delivery guarantees
+// under concurrent producers and consumers (FIFO, exactly-once, gap
+// accounting on overrun).
+namespace {
+
+constexpr uint64_t ITEMS_PER_PRODUCER = 200'000;
+
+struct Item {
+    uint64_t producer;
+    uint64_t seq;
+};
+
+// A payload wide enough to tear if a reader ever copied a half-written slot.
+struct Wide {
+    uint64_t words[8];
+};
+
+void wait_a_little(unsigned& spins) {
+    if (++spins > 64) {
+        std::this_thread::yield();
+        spins = 0;
+    }
+}
+
+void test_spsc_batches() {
+    auto q = std::make_unique<SPSCQueue<uint64_t, 8>>();
+    uint64_t in[16];
+    for (uint64_t i = 0; i < 16; ++i) in[i] = i;
+    uint64_t out[16] = {};
+
+    // A batch larger than the free space goes in partially.
+    CHECK(q->try_push_n(in, 6) == 6);
+    CHECK(q->try_push_n(in + 6, 5) == 2);
+    CHECK(q->try_push_n(in + 8, 1) == 0);
+    CHECK(q->size_approx() == 8);
+
+    CHECK(q->pop_n(out, 5) == 5);
+    CHECK(out[0] == 0 && out[4] == 4);
+    CHECK(q->try_push_n(in + 8, 8) == 5); // 8..12, wrapping to the front
+
+    // peek_n stops at the end of the buffer, however many are readable.
+    const uint64_t* first = nullptr;
+    CHECK(q->peek_n(first, 16) == 3);
+    CHECK(first[0] == 5 && first[2] == 7);
+
+    // consume_n releases what the consumer saw, not what was pushed since.
+    CHECK(q->consume_n(2) == 2);
+    CHECK(*q->peek() == 7);
+    CHECK(q->peek_n(first, 16) == 1 && first[0] == 7);
+    CHECK(q->consume_n(1) == 1);
+    CHECK(q->peek_n(first, 16) == 5);
+    CHECK(first[0] == 8 && first[4] == 12);
+    CHECK(q->try_push_n(in + 15, 1) == 1);
+    CHECK(q->consume_n(5) == 5);
+    CHECK(q->size_approx() == 1);
+    uint64_t v = 0;
+    CHECK(q->try_pop(v) && v == 15);
+
+    CHECK(q->consume_n(4) == 0);
+    CHECK(q->pop_n(out, 4) == 0);
+    CHECK(q->peek_n(first, 4) == 0);
+}
+
+void test_spsc_batch_fifo() {
+    constexpr uint64_t ITEMS = 4 * ITEMS_PER_PRODUCER;
+    auto q = std::make_unique<SPSCQueue<Wide, 256>>();
+
+    // Batches of 1..37, resubmitting whatever did not fit.
+    std::thread producer([&q] {
+        Wide batch[37];
+        unsigned spins = 0;
+        uint64_t seq = 0;
+        while (seq < ITEMS) {
+            const uint64_t n = std::min<uint64_t>(1 + seq % 37, ITEMS - seq);
+            for (uint64_t i = 0; i < n; ++i) {
+                for (uint64_t& w : batch[i].words) w = seq + i;
+            }
+            size_t pushed = 0;
+            while (pushed < n) {
+                const size_t k = q->try_push_n(batch + pushed, n - pushed);
+                if (k == 0) wait_a_little(spins);
+                pushed += k;
+            }
+            seq += n;
+        }
+    });
+
+    // Alternates pop_n with the engine's peek_n / consume_n drain.
+    bool in_order = true;
+    uint64_t next = 0;
+    unsigned spins = 0;
+    bool batch = false;
+    Wide out[64];
+    auto check = [&](const Wide& w) {
+        for (uint64_t word : w.words) in_order &= word == next;
+        ++next;
+    };
+    while (next < ITEMS) {
+        batch = !batch;
+        size_t n = 0;
+        if (batch) {
+            const Wide* first = nullptr;
+            n = q->peek_n(first, 64);
+            for (size_t i = 0; i < n; ++i) check(first[i]);
+            CHECK(q->consume_n(n) == n);
+        } else {
+            n = q->pop_n(out, 1 + next % 64);
+            for (size_t i = 0; i < n; ++i) check(out[i]);
+        }
+        if (n == 0) wait_a_little(spins);
+    }
+    producer.join();
+
+    CHECK(in_order);
+    CHECK(next == ITEMS);
+    CHECK(q->size_approx() == 0);
+}
+
+void test_mpsc_capacity() {
+    auto q = std::make_unique<MPSCQueue<uint64_t, 8>>();
+    for (uint64_t i = 0; i < 8; ++i) CHECK(q->try_push(i));
+    CHECK(!q->try_push(8));
+    CHECK(q->size_approx() == 8);
+
+    const uint64_t* first = nullptr;
+    CHECK(q->peek_n(first, 16) == 8);
+    CHECK(first[0] == 0 && first[7] == 7);
+    CHECK(q->consume_n(3) == 3);
+    CHECK(*q->peek() == 3);
+
+    // Wraps around the end of the buffer.
+    for (uint64_t i = 8; i < 11; ++i) CHECK(q->try_push(i));
+    CHECK(!q->try_push(11));
+    uint64_t out = 0;
+    for (uint64_t i = 3; i < 11; ++i) {
+        CHECK(q->try_pop(out) && out == i);
+    }
+    CHECK(!q->try_pop(out));
+    CHECK(q->peek() == nullptr);
+}
+
+void test_mpsc_per_producer_fifo() {
+    constexpr size_t PRODUCERS = 4;
+    auto q = std::make_unique<MPSCQueue<Item, 1024>>();
+    std::vector<std::thread> producers;
+    for (size_t p = 0; p < PRODUCERS; ++p) {
+        producers.emplace_back([&q, p] {
+            unsigned spins = 0;
+            for (uint64_t i = 0; i < ITEMS_PER_PRODUCER; ++i) {
+                while (!q->try_push(Item{p, i})) wait_a_little(spins);
+            }
+        });
+    }
+
+    // Alternates try_pop with the engine's peek_n / consume_n drain.
+    std::vector<uint64_t> next(PRODUCERS, 0);
+    bool in_order = true;
+    uint64_t received = 0;
+    unsigned spins = 0;
+    bool batch = false;
+    while (received < PRODUCERS * ITEMS_PER_PRODUCER) {
+        batch = !batch;
+        if (batch) {
+            const Item* first = nullptr;
+            const size_t n = q->peek_n(first, 64);
+            for (size_t i = 0; i < n; ++i) {
+                in_order &= first[i].seq == next[first[i].producer]++;
+            }
+            CHECK(q->consume_n(n) == n);
+            received += n;
+            if (n == 0) wait_a_little(spins);
+        } else {
+            Item item{};
+            if (q->try_pop(item)) {
+                in_order &= item.seq == next[item.producer]++;
+                ++received;
+            } else {
+                wait_a_little(spins);
+            }
+        }
+    }
+    for (std::thread& t : producers) t.join();
+
+    CHECK(in_order);
+    for (uint64_t n : next) CHECK(n == ITEMS_PER_PRODUCER);
+    CHECK(q->size_approx() == 0);
+}
+
+void test_mpmc_capacity() {
+    auto q = std::make_unique<MPMCQueue<uint64_t, 4>>();
+    for (uint64_t round = 0; round < 3; ++round) {
+        for (uint64_t i = 0; i < 4; ++i) CHECK(q->try_push(round * 4 + i));
+        CHECK(!q->try_push(99));
+        uint64_t out = 0;
+        for (uint64_t i = 0; i < 4; ++i) CHECK(q->try_pop(out) && out == round * 4 + i);
+        CHECK(!q->try_pop(out));
+    }
+}
+
+void test_mpmc_exactly_once() {
+    constexpr size_t PRODUCERS = 3;
+    constexpr size_t CONSUMERS = 3;
+    constexpr uint64_t TOTAL = PRODUCERS * ITEMS_PER_PRODUCER;
+    auto q = std::make_unique<MPMCQueue<Item, 256>>();
+    auto seen = std::make_unique<std::atomic<uint8_t>[]>(TOTAL);
+    std::atomic<uint64_t> received{0};
+    std::atomic<bool> out_of_order{false};
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < PRODUCERS; ++p) {
+        threads.emplace_back([&q, p] {
+            unsigned spins = 0;
+            for (uint64_t i = 0; i < ITEMS_PER_PRODUCER; ++i) {
+                while (!q->try_push(Item{p, i})) wait_a_little(spins);
+            }
+        });
+    }
+    for (size_t c = 0; c < CONSUMERS; ++c) {
+        threads.emplace_back([&] {
+            // One consumer still sees each producer's items in order.
+            std::vector<int64_t> last(PRODUCERS, -1);
+            unsigned spins = 0;
+            while (received.load(std::memory_order_relaxed) < TOTAL) {
+                Item item{};
+                if (!q->try_pop(item)) {
+                    wait_a_little(spins);
+                    continue;
+                }
+                if (static_cast<int64_t>(item.seq) <= last[item.producer]) out_of_order = true;
+                last[item.producer] = static_cast<int64_t>(item.seq);
+                seen[item.producer * ITEMS_PER_PRODUCER + item.seq].fetch_add(1, std::memory_order_relaxed);
+                received.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (std::thread& t : threads) t.join();
+
+    CHECK(!out_of_order);
+    CHECK(received == TOTAL);
+    uint64_t once = 0;
+    for (uint64_t i = 0; i < TOTAL; ++i) once += seen[i].load() == 1;
+    CHECK(once == TOTAL);
+}
+
+void test_broadcast_overrun() {
+    auto ring = std::make_unique<BroadcastRing<uint64_t, 8>>();
+    using Result = BroadcastRing<uint64_t, 8>::ReadResult;
+
+    auto cursor = ring->subscribe();
+    uint64_t out = 0;
+    CHECK(ring->try_read(cursor, out) == Result::EMPTY);
+
+    for (uint64_t i = 0; i < 5; ++i) ring->publish(i);
+    CHECK(ring->lag(cursor) == 5);
+    CHECK(ring->try_read(cursor, out) == Result::OK && out == 0);
+
+    // Lapped: 20 published, the reader at 1. It resumes at the oldest intact
+    // item (20 - 8 + 1) and counts what it lost.
+    for (uint64_t i = 5; i < 20; ++i) ring->publish(i);
+    CHECK(ring->try_read(cursor, out) == Result::OVERRUN);
+    CHECK(cursor.overruns == 12);
+    for (uint64_t i = 13; i < 20; ++i) {
+        CHECK(ring->try_read(cursor, out) == Result::OK && out == i);
+    }
+    CHECK(ring->try_read(cursor, out) == Result::EMPTY);
+    CHECK(ring->lag(cursor) == 0);
+
+    // A late subscriber starts at the next item, not at the backlog.
+    auto late = ring->subscribe();
+    CHECK(ring->try_read(late, out) == Result::EMPTY);
+    ring->publish(20);
+    CHECK(ring->try_read(late, out) == Result::OK && out == 20);
+}
+
+void test_broadcast_readers() {
+    constexpr size_t READERS = 2;
+    constexpr uint64_t ITEMS = 500'000;
+    using Ring = BroadcastRing<Wide, 64>;
+    auto ring = std::make_unique<Ring>();
+
+    std::atomic<size_t> subscribed{0};
+    std::vector<Ring::Cursor> cursors(READERS);
+    std::vector<uint64_t> received(READERS, 0);
+    std::vector<uint8_t> consistent(READERS, 1);
+    std::vector<std::thread> readers;
+    for (size_t r = 0; r < READERS; ++r) {
+        readers.emplace_back([&, r] {
+            Ring::Cursor& cursor = cursors[r];
+            cursor = ring->subscribe();
+            subscribed.fetch_add(1);
+            // Items read are gap-free except where an overrun accounts for
+            // the gap, and never torn.
+            uint64_t expected = 0;
+            uint64_t overruns = 0;
+            unsigned spins = 0;
+            while (expected < ITEMS) {
+                Wide w{};
+                const Ring::ReadResult result = ring->try_read(cursor, w);
+                if (result == Ring::ReadResult::EMPTY) {
+                    wait_a_little(spins);
+                    continue;
+                }
+                if (result == Ring::ReadResult::OVERRUN) {
+                    expected += cursor.overruns - overruns;
+                    overruns = cursor.overruns;
+                    continue;
+                }
+                bool ok = w.words[0] == expected;
+                for (uint64_t word : w.words) ok &= word == w.words[0];
+                if (!ok) consistent[r] = 0;
+                ++received[r];
+                ++expected;
+            }
+        });
+    }
+
+    while (subscribed.load() < READERS) std::this_thread::yield();
+    for (uint64_t i = 0; i < ITEMS; ++i) {
+        Wide w;
+        for (uint64_t& word : w.words) word = i;
+        ring->publish(w);
+        if ((i & 63) == 0) std::this_thread::yield(); // give readers a chance on few CPUs
+    }
+    for (std::thread& t : readers) t.join();
+
+    CHECK(ring->published() == ITEMS);
+    for (size_t r = 0; r < READERS; ++r) {
+        CHECK(consistent[r]);
+        CHECK(received[r] + cursors[r].overruns == ITEMS);
+        CHECK(cursors[r].next == ITEMS);
+    }
+}
+
+}
+
+int main() {
+    test_spsc_batches();
+    test_spsc_batch_fifo();
+    test_mpsc_capacity();
+    test_mpsc_per_producer_fifo();
+    test_mpmc_capacity();
+    test_mpmc_exactly_once();
+    test_broadcast_overrun();
+    test_broadcast_readers();
+    return test_result();
+}
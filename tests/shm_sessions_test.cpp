@@ -0,0 +1,275 @@
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+
+#include "logging.hpp"
+#include "exchange.hpp"
+#include "shm_transport.hpp"
+#include "check.hpp"
+
+// Shared-memory sessions draw connection ids from the same MAX_CONNECTIONS
+// pool as TCP. Many more than MAX_CONNECTIONS shm sessions opened and closed
+// in a row, and as many clients that drop out mid-handshake, must give every
+// id back: afterwards both a TCP and a shm client still get orders accepted.
+// Clients that take every id and then never ack lose them after
+// SHM_HANDSHAKE_TIMEOUT. A client that publishes a broken ring is
+// disconnected without stalling the poller for everyone else.
+namespace {
+
+using local_stream = boost::asio::local::stream_protocol;
+using tcp = boost::asio::ip::tcp;
+
+constexpr uint16_t PORT = 16431;
+constexpr auto CONNECT_TIMEOUT = std::chrono::seconds(3);
+constexpr auto REPLY_TIMEOUT = std::chrono::seconds(3);
+
+const PayloadInsertOrder ORDER = make_insert_order(1, Side::SELL, 5000, 1, Lifespan::GOOD_FOR_DAY);
+
+// A closed session's id comes back asynchronously (poller, engine, then the
+// handshake thread), so a connect right after a close may still be refused.
+std::unique_ptr<ShmClientSession> connect_shm(boost::asio::io_context& context, const std::string& path,
+                                              InboundQueue& inbound,
+                                              std::chrono::steady_clock::duration timeout = CONNECT_TIMEOUT) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+        try {
+            return std::make_unique<ShmClientSession>(context, path, inbound);
+        } catch (const std::exception&) {
+            if (std::chrono::steady_clock::now() > deadline) return nullptr;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+bool shm_order_accepted(ShmClientSession& session, InboundQueue& inbound) {
+    if (!session.send_message(static_cast<Message_t>(MessageType::INSERT_ORDER), &ORDER)) return false;
+    const auto deadline = std::chrono::steady_clock::now() + REPLY_TIMEOUT;
+    InboundMessage msg;
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (!inbound.try_pop(msg)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (msg.message_type == static_cast<Message_t>(MessageType::CONFIRM_ORDER_INSERTED)) return true;
+    }
+    return false;
+}
+
+bool tcp_order_accepted() {
+    boost::asio::io_context context;
+    tcp::socket socket(context);
+    boost::system::error_code ec;
+    socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), PORT), ec);
+    if (ec) return false;
+
+    const MessageHeader header{MessageType::INSERT_ORDER, sizeof(PayloadInsertOrder)};
+    std::array<uint8_t, sizeof(header) + sizeof(PayloadInsertOrder)> frame;
+    std::memcpy(frame.data(), &header, sizeof(header));
+    std::memcpy(frame.data() + sizeof(header), &ORDER, sizeof(ORDER));
+    boost::asio::write(socket, boost::asio::buffer(frame), ec);
+    if (ec) return false;
+
+    // An unaccepted connection is closed by the exchange: the read fails.
+    while (true) {
+        MessageHeader reply;
+        boost::asio::read(socket, boost::asio::buffer(&reply, sizeof(reply)), ec);
+        if (ec) return false;
+        std::vector<uint8_t> payload(reply.size);
+        boost::asio::read(socket, boost::asio::buffer(payload), ec);
+        if (ec) return false;
+        if (reply.type == MessageType::CONFIRM_ORDER_INSERTED) return true;
+    }
+}
+
+void test_ids_are_recycled(const std::string& path) {
+    boost::asio::io_context client_context;
+
+    // Sessions that attach, trade and leave.
+    size_t opened = 0;
+    size_t accepted = 0;
+    for (size_t i = 0; i < 3 * MAX_CONNECTIONS; ++i) {
+        auto inbound = std::make_unique<InboundQueue>();
+        auto session = connect_shm(client_context, path, *inbound);
+        if (!session) break;
+        ++opened;
+        session->start();
+        accepted += shm_order_accepted(*session, *inbound);
+        session->close();
+    }
+    CHECK(opened == 3 * MAX_CONNECTIONS);
+    CHECK(accepted == opened);
+
+    // Clients that hang up before acking the segment name. Without an id the
+    // exchange closes the socket instead of sending one.
+    size_t named = 0;
+    for (size_t i = 0; i < 2 * MAX_CONNECTIONS; ++i) {
+        local_stream::socket socket(client_context);
+        boost::system::error_code ec;
+        socket.connect(local_stream::endpoint(path), ec);
+        uint8_t name_size = 0;
+        if (!ec) boost::asio::read(socket, boost::asio::buffer(&name_size, 1), ec);
+        named += !ec;
+        socket.close(ec);
+    }
+    CHECK(named == 2 * MAX_CONNECTIONS);
+
+    CHECK(tcp_order_accepted());
+    auto inbound = std::make_unique<InboundQueue>();
+    auto session = connect_shm(client_context, path, *inbound);
+    CHECK(session != nullptr);
+    if (session) {
+        session->start();
+        CHECK(shm_order_accepted(*session, *inbound));
+        session->close();
+    }
+}
+
+void test_silent_clients_time_out(const std::string& path) {
+    boost::asio::io_context client_context;
+
+    // Every id held by a client that reads the segment name and stops there.
+    std::vector<local_stream::socket> silent;
+    for (size_t i = 0; i < MAX_CONNECTIONS; ++i) {
+        local_stream::socket socket(client_context);
+        boost::system::error_code ec;
+        socket.connect(local_stream::endpoint(path), ec);
+        uint8_t name_size = 0;
+        if (!ec) boost::asio::read(socket, boost::asio::buffer(&name_size, 1), ec);
+        if (!ec) silent.push_back(std::move(socket));
+    }
+    CHECK(silent.size() == MAX_CONNECTIONS);
+
+    auto inbound = std::make_unique<InboundQueue>();
+    auto session = connect_shm(client_context, path, *inbound, SHM_HANDSHAKE_TIMEOUT + CONNECT_TIMEOUT);
+    CHECK(session != nullptr);
+    if (session) {
+        session->start();
+        CHECK(shm_order_accepted(*session, *inbound));
+        session->close();
+    }
+}
+
+// Handshake by hand and map the segment, so the test can write the shared
+// header the way a hostile client would.
+bool attach_raw(local_stream::socket& socket, const std::string& path, ShmSegment& segment) {
+    boost::system::error_code ec;
+    socket.connect(local_stream::endpoint(path), ec);
+    uint8_t name_size = 0;
+    if (!ec) boost::asio::read(socket, boost::asio::buffer(&name_size, 1), ec);
+    std::string name(name_size, '\0');
+    if (!ec) boost::asio::read(socket, boost::asio::buffer(name.data(), name.size()), ec);
+    if (ec) return false;
+    segment = ShmSegment::open(name);
+    const uint8_t ack = 1;
+    boost::asio::write(socket, boost::asio::buffer(&ack, 1), ec);
+    return !ec;
+}
+
+// The exchange hangs up on a violating session: its end of the socket closes.
+bool hung_up(local_stream::socket& socket) {
+    pollfd pfd{socket.native_handle(), POLLIN, 0};
+    if (::poll(&pfd, 1, static_cast<int>(std::chrono::milliseconds(REPLY_TIMEOUT).count())) != 1) return false;
+    uint8_t byte;
+    boost::system::error_code ec;
+    socket.read_some(boost::asio::buffer(&byte, 1), ec);
+    return ec == boost::asio::error::eof;
+}
+
+void test_malformed_producer_is_dropped(const std::string& path) {
+    boost::asio::io_context client_context;
+    const uint8_t payload[40] = {};
+
+    // Each case writes through a producer view of the to-server ring, then
+    // publishes a head that does not match what was written.
+    struct Case {
+        Message_t type;       // ShmRing::PAD writes a PAD byte at offset 0
+        uint16_t payload_size;
+        uint64_t head;
+    };
+    const std::vector<Case> cases = {
+        // Far past tail over zeroed (PAD) bytes; was one PAD skip per poll pass.
+        {static_cast<Message_t>(MessageType::INSERT_ORDER), 0, uint64_t{1000} * SHM_RING_BYTES},
+        // A PAD the published bytes do not cover.
+        {ShmRing::PAD, 0, ShmRing::FRAME_HEADER_SIZE},
+        // A frame longer than what was published.
+        {static_cast<Message_t>(MessageType::INSERT_ORDER), sizeof(payload), 5},
+        // Head behind tail.
+        {static_cast<Message_t>(MessageType::INSERT_ORDER), 0, ~uint64_t{0}},
+    };
+    for (const Case& c : cases) {
+        local_stream::socket socket(client_context);
+        ShmSegment segment;
+        CHECK(attach_raw(socket, path, segment));
+        if (!segment.header()) continue;
+        ShmRing ring = segment.to_server_ring();
+        if (c.payload_size || c.type == ShmRing::PAD) {
+            CHECK(ring.try_write_frame(c.type, payload, c.payload_size));
+        }
+        segment.header()->to_server.head.store(c.head, std::memory_order_release);
+        CHECK(hung_up(socket));
+    }
+
+    // The poller still serves well-behaved sessions.
+    auto inbound = std::make_unique<InboundQueue>();
+    auto session = connect_shm(client_context, path, *inbound);
+    CHECK(session != nullptr);
+    if (session) {
+        session->start();
+        CHECK(shm_order_accepted(*session, *inbound));
+        session->close();
+    }
+}
+
+}
+
+int main() {
+    boost::log::core::get()->set_filter(
+        boost::log::expressions::attr<LogLevel>("Severity") >= LogLevel::LL_ERROR
+    );
+    std::filesystem::create_directories("logs"); // the exchange's event logs
+
+    const std::string path = "/tmp/shm_sessions_test_" + std::to_string(::getpid()) + ".sock";
+    boost::asio::io_context engine_context;
+    boost::asio::io_context io_context;
+    auto engine_work = boost::asio::make_work_guard(engine_context);
+    auto io_work = boost::asio::make_work_guard(io_context);
+    {
+        // The book lives inline; too big for the stack.
+        auto exchange = std::make_unique<Exchange>(
+            engine_context, std::vector<boost::asio::io_context*>{&io_context}, PORT,
+            SocketProfile::LATENCY, IoModel::PER_CORE);
+        exchange->enable_shm_transport(path);
+        exchange->start();
+        std::thread engine_thread([&] { engine_context.run(); });
+        std::thread io_thread([&] { io_context.run(); });
+
+        test_ids_are_recycled(path);
+        test_silent_clients_time_out(path);
+        test_malformed_producer_is_dropped(path);
+
+        exchange->stop();
+        engine_work.reset();
+        io_work.reset();
+        engine_context.stop();
+        io_context.stop();
+        engine_thread.join();
+        io_thread.join();
+    }
+    return test_result();
+}
@@ -0,0 +1,55 @@
+#include <cmath>
+#include <optional>
+
+#include "stylized_facts.hpp"
+#include "check.hpp"
+
+// A one-sided book sample breaks the chain of returns: the first return
+// after it is not paired with returns from before the gap, and each lag's
+// autocorrelation divides by the pairs it actually summed.
+namespace {
+
+void sample(StylizedFacts& facts, Price_t bid) {
+    facts.on_book(bid, bid + 2);
+}
+
+void test_one_sided_sample_breaks_the_chain() {
+    StylizedFacts facts;
+    sample(facts, 100);
+    sample(facts, 101); // r1
+    sample(facts, 103); // r2, paired with r1
+    const auto& returns = facts.returns();
+    CHECK(returns.n == 2);
+    CHECK(returns.pairs[1] == 1);
+    const double cross1 = returns.cross[1];
+    const double abs_cross1 = facts.abs_returns().cross[1];
+    CHECK(cross1 > 0.0);
+
+    facts.on_book(std::nullopt, 110);
+    sample(facts, 100); // no return: nothing before it in this chain
+    sample(facts, 104); // r3, the first return after the gap
+    CHECK(returns.n == 3);
+    CHECK(returns.cross[1] == cross1);
+    CHECK(facts.abs_returns().cross[1] == abs_cross1);
+    CHECK(returns.pairs[1] == 1);
+    CHECK(returns.pairs[2] == 0);
+
+    sample(facts, 102); // r4, paired with r3
+    CHECK(returns.n == 4);
+    CHECK(returns.pairs[1] == 2);
+    CHECK(returns.pairs[2] == 0);
+    const double r3 = std::log(105.0 / 101.0);
+    const double r4 = std::log(103.0 / 105.0);
+    CHECK(std::abs(returns.cross[1] - (cross1 + r3 * r4)) < 1e-15);
+
+    // Lags with no pairs report no autocorrelation rather than dividing by n - lag.
+    CHECK(returns.acf(2) == 0.0);
+    CHECK(facts.summary().abs_return_acf10 == 0.0);
+}
+
+}
+
+int main() {
+    test_one_sided_sample_breaks_the_chain();
+    return test_result();
+}